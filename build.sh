@@ -5,7 +5,7 @@ OUT="lang"
 SRC_DIR="src"
 INC_DIR="$SRC_DIR/inc"
 OBJ_DIR="obj"
-FLAGS=""
+FLAGS="-lpthread"
 
 usage() {
   echo "Usage: $0 [--windows]"
@@ -33,6 +33,16 @@ for file in $SRC_DIR/*.c; do
   $CC -c $file -o "$OBJ_DIR/$(basename $file .c).o" -I $INC_DIR
 done
 
-$CC $OBJ_DIR/* -o $OUT $FLAGS
+# the runtime of emitted programs is checked on its own, then embedded into the emitter
+RUNTIME="$SRC_DIR/runtime/runtime.c"
+$CC -fsyntax-only -Wall -DRT_CHECK $RUNTIME
+{
+  echo "const char emitter_runtime[] = {"
+  od -An -v -tx1 $RUNTIME | sed 's/\([0-9a-f][0-9a-f]\)/0x\1,/g'
+  echo "0 };"
+} > "$OBJ_DIR/emitter_runtime.c"
+$CC -c "$OBJ_DIR/emitter_runtime.c" -o "$OBJ_DIR/emitter_runtime.o"
+
+$CC $OBJ_DIR/*.o -o $OUT $FLAGS
 
 rm -rf $OBJ_DIR
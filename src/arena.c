@@ -0,0 +1,63 @@
+#include "inc/arena.h"
+#include <string.h>
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+Arena* init_arena()
+{
+  Arena* arena = calloc(1, sizeof(Arena));
+
+  arena->chunk = (void*)0;
+
+  return arena;
+}
+
+void* arena_alloc(Arena* arena, size_t size)
+{
+  size = (size + 7) & ~(size_t)7;
+  ArenaChunk* chunk = arena->chunk;
+  if (!chunk || chunk->used + size > chunk->size) {
+    size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    chunk = calloc(1, sizeof(ArenaChunk) + chunk_size);
+    chunk->prev = arena->chunk;
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    arena->chunk = chunk;
+  }
+  void* ptr = chunk->data + chunk->used;
+  chunk->used += size;
+  return ptr;
+}
+
+// makes room for one more element, capacity doubles from 4 whenever size reaches it
+void* arena_grow(Arena* arena, void* array, size_t size, size_t elem_size)
+{
+  if (size != 0 && (size < 4 || (size & (size - 1)) != 0)) {
+    return array;
+  }
+  size_t cap = size < 4 ? 4 : size * 2;
+  void* grown = arena_alloc(arena, cap * elem_size);
+  if (size) {
+    memcpy(grown, array, size * elem_size);
+  }
+  return grown;
+}
+
+char* arena_strndup(Arena* arena, char* src, size_t len)
+{
+  char* s = arena_alloc(arena, len + 1);
+  memcpy(s, src, len);
+  s[len] = '\0';
+  return s;
+}
+
+void arena_free(Arena* arena)
+{
+  ArenaChunk* chunk = arena->chunk;
+  while (chunk) {
+    ArenaChunk* prev = chunk->prev;
+    free(chunk);
+    chunk = prev;
+  }
+  free(arena);
+}
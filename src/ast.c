@@ -1,11 +1,47 @@
 #include "inc/ast.h"
+#include <stddef.h>
 
 AST* AST_NOOP = (void*)0;
 AST* AST_TRUE = (void*)0;
 AST* AST_FALSE = (void*)0;
 
+#define AST_SIZE(member) (offsetof(AST, member) + sizeof(((AST*)0)->member))
+
+size_t ast_size(TypeAST type)
+{
+  switch (type) {
+    case AST_COMPOUND: return AST_SIZE(compound);
+    case AST_INT: return AST_SIZE(integer);
+    case AST_FLOAT: return AST_SIZE(floating);
+    case AST_STRING: return AST_SIZE(string);
+    case AST_BOOL: return AST_SIZE(boolean);
+    case AST_BINARY: return AST_SIZE(binary);
+    case AST_UNARY: return AST_SIZE(unary);
+    case AST_VARIABLE_DECLARATION: return AST_SIZE(variable_declaration);
+    case AST_VARIABLE_ASSIGN: return AST_SIZE(variable_assign);
+    case AST_VARIABLE: return AST_SIZE(variable);
+    case AST_FUNCTION_DECLARATION: return AST_SIZE(function_declaration);
+    case AST_FUNCTION_CALL: return AST_SIZE(function_call);
+    case AST_IF: return AST_SIZE(if_block);
+    case AST_ELSE: return AST_SIZE(else_block);
+    case AST_WHILE: return AST_SIZE(while_block);
+    case AST_FOR: return AST_SIZE(for_block);
+    case AST_RETURN: return AST_SIZE(return_expr);
+    case AST_INCLUDE: return AST_SIZE(include);
+    case AST_MODULE_FUNCTION_CALL: return AST_SIZE(module_function_call);
+    case AST_OBJECT_DECLARATION: return AST_SIZE(object_declaration);
+    case AST_MEMBER_ACCESS: return AST_SIZE(member_access);
+    case AST_MEMBER_ASSIGN: return AST_SIZE(member_assign);
+    default:
+      // noop, skip and stop carry nothing past the header
+      return offsetof(AST, compound);
+  }
+}
+
 inline AST* init_ast(TypeAST type)
 {
+  // only the shared nodes and module arguments come from here, they stay whole
+  // since modules get them as an AST of the size they were built with
   AST* ast = calloc(1, sizeof(AST));
   ast->type = type;
   return ast;
@@ -23,6 +59,7 @@ inline AST* get_ast_true()
 {
   if (!AST_TRUE) {
     AST_TRUE = init_ast(AST_BOOL);
+    AST_TRUE->expr_type = TYPE_BOOL;
     AST_TRUE->boolean.val = true;
   }
   return AST_TRUE;
@@ -32,6 +69,7 @@ inline AST* get_ast_false()
 {
   if (!AST_FALSE) {
     AST_FALSE = init_ast(AST_BOOL);
+    AST_FALSE->expr_type = TYPE_BOOL;
     AST_FALSE->boolean.val = false;
   }
   return AST_FALSE;
@@ -58,7 +96,6 @@ char* ast_name(TypeAST type)
     case AST_WHILE: return "AST_WHILE";
     case AST_FOR: return "AST_FOR";
     case AST_RETURN: return "AST_RETURN";
-    case AST_RETURN_VAL: return "AST_RETURN_VAL";
     case AST_UNARY: return "AST_UNARY";
     case AST_SKIP: return "AST_SKIP";
     case AST_STOP: return "AST_STOP";
@@ -67,6 +104,7 @@ char* ast_name(TypeAST type)
     case AST_MEMBER_ACCESS: return "AST_MEMBER_ACCESS";
     case AST_MEMBER_ASSIGN: return "AST_MEMBER_ASSIGN";
   }
+  return (void*)0;
 }
 
 char* var_type_name(VariableType type)
@@ -78,6 +116,21 @@ char* var_type_name(VariableType type)
     case VAR_BOOL: return "VAR_BOOL";
     case VAR_OBJECT: return "VAR_OBJECT";
   }
+  return (void*)0;
+}
+
+char* expr_type_name(ExprType type)
+{
+  switch (type) {
+    case TYPE_UNKNOWN: return "TYPE_UNKNOWN";
+    case TYPE_NONE: return "TYPE_NONE";
+    case TYPE_INT: return "TYPE_INT";
+    case TYPE_FLOAT: return "TYPE_FLOAT";
+    case TYPE_STRING: return "TYPE_STRING";
+    case TYPE_BOOL: return "TYPE_BOOL";
+    case TYPE_OBJECT: return "TYPE_OBJECT";
+  }
+  return (void*)0;
 }
 
 char* compound_name(int type)
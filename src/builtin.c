@@ -0,0 +1,199 @@
+#include "inc/builtin.h"
+#include "inc/table.h"
+#include "inc/symbol.h"
+#include "inc/gc.h"
+#include <stdio.h>
+#include <string.h>
+
+static Value builtin_error(char* msg)
+{
+  printf("Builtin-> Error: %s\n", msg);
+  exit(1);
+  return value_noop();
+}
+
+static Value builtin_write(Value* args, size_t arg_size)
+{
+  for (int i = 0; i < arg_size; i++) {
+    Value arg = args[i];
+
+    switch (arg.type) {
+      case VALUE_STRING:
+        printf("%s ", arg.string);
+        break;
+      case VALUE_INT:
+        printf("%d ", arg.integer);
+        break;
+      case VALUE_FLOAT:
+        printf("%f ", arg.floating);
+        break;
+      case VALUE_BOOL:
+        printf("%s ", arg.boolean ? "true" : "false");
+        break;
+      default: {
+        char msg[64]; sprintf(msg, "unexpected %d indexed arg at function write: '%s'", i, value_name(arg.type));
+        return builtin_error(msg);
+      }
+    }
+  }
+  printf("\n");
+
+  return value_noop();
+}
+
+static Value builtin_read(Value* args, size_t arg_size)
+{
+  if (arg_size > 1) {
+    char msg[64]; sprintf(msg, "function read: at most 1 argument, got %lu", arg_size);
+    return builtin_error(msg);
+  } else if (arg_size == 0) goto no_arg;
+
+  switch (args[0].type) {
+    case VALUE_STRING:
+      printf("%s", args[0].string);
+      break;
+    default: {
+      char msg[64]; sprintf(msg, "unexpected %d indexed arg at function read: '%s'", 0, value_name(args[0].type));
+      return builtin_error(msg);
+    }
+  }
+
+  no_arg:
+
+  char buffer[1024];
+  fgets(buffer, sizeof(buffer), stdin);
+  buffer[strlen(buffer) - 1] = '\0';
+  return gc_string(buffer);
+}
+
+static Value builtin_quit(Value* args, size_t arg_size)
+{
+  if (arg_size != 1) {
+    char msg[64]; sprintf(msg, "function quit: expected 1 argument, got %lu", arg_size);
+    return builtin_error(msg);
+  }
+  switch (args[0].type) {
+    case VALUE_INT:
+      exit(args[0].integer);
+      break;
+    case VALUE_FLOAT:
+      exit(args[0].floating);
+    default: {
+      char msg[64]; sprintf(msg, "unexpected arg at function quit: '%s'", value_name(args[0].type));
+      return builtin_error(msg);
+    }
+  }
+
+  return value_noop();
+}
+
+static Value builtin_int(Value* args, size_t arg_size)
+{
+  if (arg_size != 1) {
+    char msg[64]; sprintf(msg, "function int: expected 1 argument, got %lu", arg_size);
+    return builtin_error(msg);
+  }
+
+  Value arg = args[0];
+  switch (arg.type) {
+    case VALUE_STRING:
+      return value_int(atoi(arg.string));
+    case VALUE_INT:
+      return arg;
+    case VALUE_FLOAT:
+      return value_int((int)arg.floating);
+    case VALUE_BOOL:
+      return value_int(arg.boolean);
+    default: {
+      char msg[64]; sprintf(msg, "unexpected arg at function int: '%s'", value_name(arg.type));
+      return builtin_error(msg);
+    }
+  }
+}
+
+static Value builtin_float(Value* args, size_t arg_size)
+{
+  if (arg_size != 1) {
+    char msg[64]; sprintf(msg, "function float: expected 1 argument, got %lu", arg_size);
+    return builtin_error(msg);
+  }
+
+  Value arg = args[0];
+  switch (arg.type) {
+    case VALUE_STRING:
+      return value_float(atof(arg.string));
+    case VALUE_INT:
+      return value_float((float)arg.integer);
+    case VALUE_FLOAT:
+      return arg;
+    case VALUE_BOOL:
+      return value_float(arg.boolean);
+    default: {
+      char msg[64]; sprintf(msg, "unexpected arg at function float: '%s'", value_name(arg.type));
+      return builtin_error(msg);
+    }
+  }
+}
+
+static Value builtin_string(Value* args, size_t arg_size)
+{
+  if (arg_size != 1) {
+    char msg[64]; sprintf(msg, "function string: expected 1 argument, got %lu", arg_size);
+    return builtin_error(msg);
+  }
+
+  Value arg = args[0];
+  switch (arg.type) {
+    case VALUE_STRING:
+      return arg;
+    case VALUE_INT:
+      return value_noop();
+    case VALUE_FLOAT:
+      return value_noop();
+    case VALUE_BOOL:
+      return value_string(arg.boolean ? "true" : "false");
+    default: {
+      char msg[64]; sprintf(msg, "unexpected arg at function string: '%s'", value_name(arg.type));
+      return builtin_error(msg);
+    }
+  }
+}
+
+int builtin_find(char* name)
+{
+  static Table* table = (void*)0;
+  if (!table) {
+    table = init_table();
+    for (Builtin b = BUILTIN_WRITE; b <= BUILTIN_STRING; b++) {
+      char* name = builtin_name(b);
+      table_set(table, symbol_intern(name, strlen(name)), b);
+    }
+  }
+  return table_get(table, name);
+}
+
+Value builtin_call(Builtin builtin, Value* args, size_t arg_size)
+{
+  switch (builtin) {
+    case BUILTIN_WRITE: return builtin_write(args, arg_size);
+    case BUILTIN_READ: return builtin_read(args, arg_size);
+    case BUILTIN_QUIT: return builtin_quit(args, arg_size);
+    case BUILTIN_INT: return builtin_int(args, arg_size);
+    case BUILTIN_FLOAT: return builtin_float(args, arg_size);
+    case BUILTIN_STRING: return builtin_string(args, arg_size);
+  }
+  return value_noop();
+}
+
+char* builtin_name(Builtin builtin)
+{
+  switch (builtin) {
+    case BUILTIN_WRITE: return "write";
+    case BUILTIN_READ: return "read";
+    case BUILTIN_QUIT: return "quit";
+    case BUILTIN_INT: return "int";
+    case BUILTIN_FLOAT: return "float";
+    case BUILTIN_STRING: return "string";
+  }
+  return (void*)0;
+}
@@ -0,0 +1,204 @@
+#include "inc/bytecode.h"
+#include <string.h>
+
+Function* init_function(char* name, AST* declaration)
+{
+  Function* function = calloc(1, sizeof(Function));
+
+  function->name = name;
+  function->declaration = declaration;
+  function->code = (void*)0;
+  function->code_size = 0;
+  function->code_cap = 0;
+  function->consts = (void*)0;
+  function->const_size = 0;
+  function->calls = 0;
+  function->loops = 0;
+  function->jit_code = (void*)0;
+  function->jit_entries = (void*)0;
+  function->jit_failed = false;
+
+  return function;
+}
+
+Program* init_program()
+{
+  Program* program = calloc(1, sizeof(Program));
+
+  program->main = (void*)0;
+  program->functions = (void*)0;
+  program->function_size = 0;
+  program->global_size = 0;
+
+  return program;
+}
+
+static AST* program_copy_node(AST* node)
+{
+  // whole, like the nodes init_ast makes
+  AST* copy = calloc(1, sizeof(AST));
+  memcpy(copy, node, ast_size(node->type));
+  return copy;
+}
+
+// names are interned apart from the arena, only the nodes the VM reads move
+void program_detach(Program* program)
+{
+  AST** objects = malloc(program->object_size * sizeof(AST*));
+  for (int i = 0; i < program->object_size; i++) {
+    AST* object = program_copy_node(program->object_declarations[i]);
+    size_t field_size = object->object_declaration.field_size;
+    char** field_names = malloc(field_size * sizeof(char*));
+    memcpy(field_names, object->object_declaration.field_names, field_size * sizeof(char*));
+    VariableType* field_types = malloc(field_size * sizeof(VariableType));
+    memcpy(field_types, object->object_declaration.field_types, field_size * sizeof(VariableType));
+    object->object_declaration.field_names = field_names;
+    object->object_declaration.field_types = field_types;
+    objects[i] = object;
+  }
+  program->object_declarations = objects;
+
+  for (int i = 0; i < program->include_size; i++) {
+    program->includes[i] = program_copy_node(program->includes[i]);
+  }
+  for (int i = 0; i < program->module_call_size; i++) {
+    AST* call = program_copy_node(program->module_calls[i]);
+    // the arguments are in registers by the time the call runs
+    AST* func = program_copy_node(call->module_function_call.func);
+    func->function_call.args = (void*)0;
+    call->module_function_call.func = func;
+    program->module_calls[i] = call;
+  }
+
+  program->main->declaration = (void*)0;
+  for (int i = 0; i < program->function_size; i++) {
+    program->functions[i]->declaration = (void*)0;
+  }
+}
+
+int function_emit(Function* function, Opcode op, int a, int b, int c)
+{
+  if (function->code_size == function->code_cap) {
+    function->code_cap = function->code_cap ? function->code_cap * 2 : 64;
+    function->code = realloc(function->code, function->code_cap * sizeof(Instr));
+  }
+  function->code[function->code_size] = (Instr) { op, a, b, c };
+  return function->code_size++;
+}
+
+int function_add_const(Function* function, Value val)
+{
+  for (int i = 0; i < function->const_size; i++) {
+    Value k = function->consts[i];
+    if (k.type != val.type) continue;
+    switch (k.type) {
+      case VALUE_INT:
+        if (k.integer == val.integer) return i;
+        break;
+      case VALUE_FLOAT:
+        if (k.floating == val.floating) return i;
+        break;
+      case VALUE_BOOL:
+        if (k.boolean == val.boolean) return i;
+        break;
+      case VALUE_STRING:
+        if (k.string == val.string) return i;
+        break;
+      default:
+        break;
+    }
+  }
+
+  function->const_size++;
+  function->consts = realloc(function->consts, function->const_size * sizeof(Value));
+  function->consts[function->const_size - 1] = val;
+  return function->const_size - 1;
+}
+
+char* op_name(Opcode op)
+{
+  switch (op) {
+    case OP_LOADK: return "OP_LOADK";
+    case OP_UNDEF: return "OP_UNDEF";
+    case OP_MOVE: return "OP_MOVE";
+    case OP_TESTDEF: return "OP_TESTDEF";
+    case OP_GETGLOBAL: return "OP_GETGLOBAL";
+    case OP_SETGLOBAL: return "OP_SETGLOBAL";
+    case OP_CONV_INT: return "OP_CONV_INT";
+    case OP_CONV_FLOAT: return "OP_CONV_FLOAT";
+    case OP_CHECK_STRING: return "OP_CHECK_STRING";
+    case OP_CHECK_BOOL: return "OP_CHECK_BOOL";
+    case OP_CHECK_OBJECT: return "OP_CHECK_OBJECT";
+    case OP_ADD: return "OP_ADD";
+    case OP_SUB: return "OP_SUB";
+    case OP_MUL: return "OP_MUL";
+    case OP_DIV: return "OP_DIV";
+    case OP_MOD: return "OP_MOD";
+    case OP_EQ: return "OP_EQ";
+    case OP_NE: return "OP_NE";
+    case OP_GT: return "OP_GT";
+    case OP_GE: return "OP_GE";
+    case OP_LT: return "OP_LT";
+    case OP_LE: return "OP_LE";
+    case OP_AND: return "OP_AND";
+    case OP_OR: return "OP_OR";
+    case OP_ADDI: return "OP_ADDI";
+    case OP_SUBI: return "OP_SUBI";
+    case OP_MULI: return "OP_MULI";
+    case OP_DIVI: return "OP_DIVI";
+    case OP_MODI: return "OP_MODI";
+    case OP_EQI: return "OP_EQI";
+    case OP_NEI: return "OP_NEI";
+    case OP_GTI: return "OP_GTI";
+    case OP_GEI: return "OP_GEI";
+    case OP_LTI: return "OP_LTI";
+    case OP_LEI: return "OP_LEI";
+    case OP_ADDF: return "OP_ADDF";
+    case OP_SUBF: return "OP_SUBF";
+    case OP_MULF: return "OP_MULF";
+    case OP_DIVF: return "OP_DIVF";
+    case OP_EQF: return "OP_EQF";
+    case OP_NEF: return "OP_NEF";
+    case OP_GTF: return "OP_GTF";
+    case OP_GEF: return "OP_GEF";
+    case OP_LTF: return "OP_LTF";
+    case OP_LEF: return "OP_LEF";
+    case OP_SHLI: return "OP_SHLI";
+    case OP_SHRI: return "OP_SHRI";
+    case OP_ANDI: return "OP_ANDI";
+    case OP_NEG: return "OP_NEG";
+    case OP_NOT: return "OP_NOT";
+    case OP_JMP: return "OP_JMP";
+    case OP_JMPF: return "OP_JMPF";
+    case OP_ANDJMP: return "OP_ANDJMP";
+    case OP_ORJMP: return "OP_ORJMP";
+    case OP_IFEQI: return "OP_IFEQI";
+    case OP_IFNEI: return "OP_IFNEI";
+    case OP_IFGTI: return "OP_IFGTI";
+    case OP_IFGEI: return "OP_IFGEI";
+    case OP_IFLTI: return "OP_IFLTI";
+    case OP_IFLEI: return "OP_IFLEI";
+    case OP_IFEQF: return "OP_IFEQF";
+    case OP_IFNEF: return "OP_IFNEF";
+    case OP_IFGTF: return "OP_IFGTF";
+    case OP_IFGEF: return "OP_IFGEF";
+    case OP_IFLTF: return "OP_IFLTF";
+    case OP_IFLEF: return "OP_IFLEF";
+    case OP_FORLT: return "OP_FORLT";
+    case OP_FORLE: return "OP_FORLE";
+    case OP_FORGT: return "OP_FORGT";
+    case OP_FORGE: return "OP_FORGE";
+    case OP_CALL: return "OP_CALL";
+    case OP_BUILTIN: return "OP_BUILTIN";
+    case OP_MODCALL: return "OP_MODCALL";
+    case OP_INCLUDE: return "OP_INCLUDE";
+    case OP_NEWOBJ: return "OP_NEWOBJ";
+    case OP_GETFIELD: return "OP_GETFIELD";
+    case OP_SETFIELD: return "OP_SETFIELD";
+    case OP_RETURN: return "OP_RETURN";
+    case OP_RETURN0: return "OP_RETURN0";
+    case OP_HALT: return "OP_HALT";
+    case OP_YIELD: return "OP_YIELD";
+  }
+  return (void*)0;
+}
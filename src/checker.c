@@ -0,0 +1,577 @@
+#include "inc/checker.h"
+#include "inc/builtin.h"
+#include <stdio.h>
+
+Checker* init_checker(Parser* parser)
+{
+  Checker* checker = calloc(1, sizeof(Checker));
+
+  checker->function_declarations = parser->function_declarations;
+  checker->function_size = parser->function_size;
+  checker->function_table = parser->function_table;
+  checker->object_declarations = parser->object_declarations;
+  checker->object_size = parser->object_size;
+  checker->vars = (void*)0;
+  checker->var_size = 0;
+  checker->var_cap = 0;
+  checker->depth = 0;
+  checker->function = (void*)0;
+
+  return checker;
+}
+
+static void checker_error(AST* node, char* msg)
+{
+  printf("Checker-> Error at line: %u, %s\n", node->line, msg);
+  exit(1);
+}
+
+static ExprType checker_var_type(VariableType type)
+{
+  switch (type) {
+    case VAR_INT: return TYPE_INT;
+    case VAR_FLOAT: return TYPE_FLOAT;
+    case VAR_STRING: return TYPE_STRING;
+    case VAR_BOOL: return TYPE_BOOL;
+    case VAR_OBJECT: return TYPE_OBJECT;
+  }
+  return TYPE_UNKNOWN;
+}
+
+static void checker_declare(Checker* checker, char* name, VariableType type, char* object_type)
+{
+  if (checker->var_size == checker->var_cap) {
+    checker->var_cap = checker->var_cap ? checker->var_cap * 2 : 64;
+    checker->vars = realloc(checker->vars, checker->var_cap * sizeof(CheckerVar));
+  }
+  bool is_global = !checker->function && checker->depth == 0;
+  checker->vars[checker->var_size++] = (CheckerVar) { name, type, object_type, is_global };
+}
+
+static CheckerVar* checker_lookup(Checker* checker, char* name)
+{
+  for (size_t i = checker->var_size; i > 0; i--) {
+    if (checker->vars[i - 1].name == name) {
+      return &checker->vars[i - 1];
+    }
+  }
+  return (void*)0;
+}
+
+// reported here rather than by the resolver or compiler, which only see
+// what the optimizer kept, so dead code is held to the same rules
+static CheckerVar* checker_find_var(Checker* checker, AST* node, char* name, char* what)
+{
+  CheckerVar* var = checker_lookup(checker, name);
+  if (!var) {
+    char msg[128];
+    sprintf(msg, "use of undeclared %s: '%s'", what, name);
+    checker_error(node, msg);
+  }
+  return var;
+}
+
+static AST* checker_find_object(Checker* checker, char* name)
+{
+  for (int i = 0; i < checker->object_size; i++) {
+    if (checker->object_declarations[i]->object_declaration.name == name) {
+      return checker->object_declarations[i];
+    }
+  }
+  return (void*)0;
+}
+
+// same rules as visitor_check_types, val is the static type of the new value
+static void checker_assign(AST* node, char* name, VariableType type, _TokenType op, ExprType val)
+{
+  char msg[128];
+  if (val == TYPE_UNKNOWN) return;
+
+  if ((type == VAR_INT || type == VAR_FLOAT) && (val == TYPE_INT || val == TYPE_FLOAT)) {
+    if (op == TOKEN_MODEQ && (type == VAR_FLOAT || val == TYPE_FLOAT)) {
+      sprintf(msg, "'%%' operator cannot be applied to floating values");
+      checker_error(node, msg);
+    }
+    return;
+  } else if (type == VAR_STRING && val == TYPE_STRING) {
+    if (op != TOKEN_ASSIGN) {
+      sprintf(msg, "strings can only get = operator");
+      checker_error(node, msg);
+    }
+    return;
+  } else if (type == VAR_BOOL && val == TYPE_BOOL) {
+    if (op != TOKEN_ASSIGN) {
+      sprintf(msg, "bools can only get = operator");
+      checker_error(node, msg);
+    }
+    return;
+  } else if (type == VAR_OBJECT && val == TYPE_OBJECT) {
+    // the engines compare the declarations
+    return;
+  }
+  sprintf(msg, "variable '%s' type error: '%s', '%s'", name, var_type_name(type), expr_type_name(val));
+  checker_error(node, msg);
+}
+
+static ExprType checker_expr(Checker* checker, AST* node);
+
+static ExprType checker_binary(Checker* checker, AST* node)
+{
+  ExprType left = checker_expr(checker, node->binary.left);
+  ExprType right = checker_expr(checker, node->binary.right);
+  _TokenType op = node->binary.op;
+  bool is_compare = op == TOKEN_EQ || op == TOKEN_NE || op == TOKEN_GT ||
+                    op == TOKEN_GE || op == TOKEN_LT || op == TOKEN_LE;
+  char msg[128];
+
+  if (left == TYPE_UNKNOWN || right == TYPE_UNKNOWN) {
+    // a comparison that does not fail always gives a bool
+    return is_compare ? TYPE_BOOL : TYPE_UNKNOWN;
+  }
+  if ((left == TYPE_INT || left == TYPE_FLOAT) && (right == TYPE_INT || right == TYPE_FLOAT)) {
+    if (op == TOKEN_AND || op == TOKEN_OR) {
+      // numbers give no value for these at runtime
+      return TYPE_NONE;
+    }
+    if (op == TOKEN_MOD && (left == TYPE_FLOAT || right == TYPE_FLOAT)) {
+      sprintf(msg, "'%%' operator cannot be applied to floating values");
+      checker_error(node, msg);
+    }
+    if (left == TYPE_INT) {
+      node->binary.operands = right == TYPE_INT ? OPERANDS_INT : OPERANDS_INT_FLOAT;
+    } else {
+      node->binary.operands = right == TYPE_INT ? OPERANDS_FLOAT_INT : OPERANDS_FLOAT;
+    }
+    if (is_compare) return TYPE_BOOL;
+    return node->binary.operands == OPERANDS_INT ? TYPE_INT : TYPE_FLOAT;
+  }
+  if (left == TYPE_STRING && right == TYPE_STRING) {
+    if (op == TOKEN_EQ || op == TOKEN_NE) return TYPE_BOOL;
+    sprintf(msg, "%s operator cannot be applied to string", token_name(op));
+    checker_error(node, msg);
+  }
+  if (left == TYPE_BOOL && right == TYPE_BOOL) {
+    if (op == TOKEN_AND || op == TOKEN_OR || op == TOKEN_EQ || op == TOKEN_NE) return TYPE_BOOL;
+    sprintf(msg, "%s operator cannot be applied to bool", token_name(op));
+    checker_error(node, msg);
+  }
+  sprintf(msg, "unexpected types in binary: left: %s, right: %s", expr_type_name(left), expr_type_name(right));
+  checker_error(node, msg);
+  return TYPE_UNKNOWN;
+}
+
+static ExprType checker_unary(Checker* checker, AST* node)
+{
+  ExprType expr = checker_expr(checker, node->unary.expr);
+  char msg[128];
+  if (node->unary.op == TOKEN_MINUS) {
+    if (expr == TYPE_INT || expr == TYPE_FLOAT || expr == TYPE_UNKNOWN) return expr;
+    sprintf(msg, "'-' unary operator cannot be applied to %s", expr_type_name(expr));
+    checker_error(node, msg);
+  }
+  if (expr == TYPE_BOOL || expr == TYPE_UNKNOWN) return TYPE_BOOL;
+  sprintf(msg, "'not' unary operator cannot be applied to %s", expr_type_name(expr));
+  checker_error(node, msg);
+  return TYPE_UNKNOWN;
+}
+
+static void checker_args(Checker* checker, AST* call)
+{
+  for (int i = 0; i < call->function_call.arg_size; i++) {
+    checker_expr(checker, call->function_call.args[i]);
+  }
+}
+
+static ExprType checker_builtin(Checker* checker, AST* node, Builtin builtin)
+{
+  char* name = builtin_name(builtin);
+  size_t arg_size = node->function_call.arg_size;
+  AST** args = node->function_call.args;
+  char msg[128];
+
+  switch (builtin) {
+    case BUILTIN_WRITE:
+      for (int i = 0; i < arg_size; i++) {
+        if (args[i]->expr_type == TYPE_NONE || args[i]->expr_type == TYPE_OBJECT) {
+          sprintf(msg, "unexpected %d indexed arg at function write: '%s'", i, expr_type_name(args[i]->expr_type));
+          checker_error(node, msg);
+        }
+      }
+      return TYPE_NONE;
+    case BUILTIN_READ:
+      if (arg_size > 1) {
+        sprintf(msg, "function read: at most 1 argument, got %lu", arg_size);
+        checker_error(node, msg);
+      }
+      if (arg_size == 1 && args[0]->expr_type != TYPE_STRING && args[0]->expr_type != TYPE_UNKNOWN) {
+        sprintf(msg, "unexpected %d indexed arg at function read: '%s'", 0, expr_type_name(args[0]->expr_type));
+        checker_error(node, msg);
+      }
+      return TYPE_STRING;
+    default:
+      break;
+  }
+
+  if (arg_size != 1) {
+    sprintf(msg, "function %s: expected 1 argument, got %lu", name, arg_size);
+    checker_error(node, msg);
+  }
+  ExprType arg = args[0]->expr_type;
+  bool is_number = arg == TYPE_INT || arg == TYPE_FLOAT;
+  bool is_valid = builtin == BUILTIN_QUIT ? is_number : (is_number || arg == TYPE_STRING || arg == TYPE_BOOL);
+  if (arg != TYPE_UNKNOWN && !is_valid) {
+    sprintf(msg, "unexpected arg at function %s: '%s'", name, expr_type_name(arg));
+    checker_error(node, msg);
+  }
+
+  switch (builtin) {
+    case BUILTIN_INT: return TYPE_INT;
+    case BUILTIN_FLOAT: return TYPE_FLOAT;
+    case BUILTIN_STRING:
+      // numbers are not converted and give no value
+      if (arg == TYPE_UNKNOWN) return TYPE_UNKNOWN;
+      return is_number ? TYPE_NONE : TYPE_STRING;
+    default:
+      return TYPE_NONE;
+  }
+}
+
+static ExprType checker_function_call(Checker* checker, AST* node)
+{
+  checker_args(checker, node);
+
+  int builtin = builtin_find(node->function_call.name);
+  if (builtin >= 0) {
+    return checker_builtin(checker, node, builtin);
+  }
+  int index = table_get(checker->function_table, node->function_call.name);
+  char msg[128];
+  if (index < 0) {
+    sprintf(msg, "call to undeclared function named: '%s'", node->function_call.name);
+    checker_error(node, msg);
+  }
+
+  AST* f = checker->function_declarations[index];
+  if (node->function_call.arg_size != f->function_declaration.arg_size) {
+    sprintf(msg, "function %s: expected %lu arg(s), but got %lu",
+            f->function_declaration.name,
+            f->function_declaration.arg_size,
+            node->function_call.arg_size);
+    checker_error(node, msg);
+  }
+  for (int i = 0; i < f->function_declaration.arg_size; i++) {
+    AST* arg = node->function_call.args[i];
+    AST* param = f->function_declaration.args[i];
+    if (f->function_declaration.arg_types[i] != VAR_OBJECT) {
+      checker_assign(arg, param->variable.name, f->function_declaration.arg_types[i], TOKEN_ASSIGN, arg->expr_type);
+      continue;
+    }
+    char* got = (void*)0;
+    if (arg->expr_type != TYPE_OBJECT && arg->expr_type != TYPE_UNKNOWN) {
+      got = expr_type_name(arg->expr_type);
+    } else if (arg->type == AST_VARIABLE) {
+      CheckerVar* var = checker_lookup(checker, arg->variable.name);
+      if (var && var->object_type != param->variable.object_type_name) {
+        got = var->object_type;
+      }
+    }
+    if (got) {
+      sprintf(msg, "function %s: %d index arg is object type: %s, got %s",
+              f->function_declaration.name, i, param->variable.object_type_name, got);
+      checker_error(node, msg);
+    }
+  }
+  return f->function_declaration.has_return ? checker_var_type(f->function_declaration.return_type) : TYPE_NONE;
+}
+
+// checks the object variable and member, returns the field type or -1 when unknown
+static int checker_member(Checker* checker, AST* node)
+{
+  char msg[128];
+  CheckerVar* var = checker_find_var(checker, node, node->member_access.object_name, "object variable");
+  if (var->type != VAR_OBJECT) {
+    sprintf(msg, "variable is not an object: '%s'", node->member_access.object_name);
+    checker_error(node, msg);
+  }
+  AST* obj_dec = checker_find_object(checker, var->object_type);
+  if (!obj_dec) return -1;
+  for (int i = 0; i < obj_dec->object_declaration.field_size; i++) {
+    if (obj_dec->object_declaration.field_names[i] == node->member_access.member_name) {
+      node->expr_type = checker_var_type(obj_dec->object_declaration.field_types[i]);
+      return obj_dec->object_declaration.field_types[i];
+    }
+  }
+  sprintf(msg, "no such field '%s' in object type: '%s'", node->member_access.member_name, var->object_type);
+  checker_error(node, msg);
+  return -1;
+}
+
+static ExprType checker_expr(Checker* checker, AST* node)
+{
+  ExprType type = TYPE_UNKNOWN;
+  switch (node->type) {
+    case AST_INT: type = TYPE_INT; break;
+    case AST_FLOAT: type = TYPE_FLOAT; break;
+    case AST_STRING: type = TYPE_STRING; break;
+    case AST_BOOL: type = TYPE_BOOL; break;
+    case AST_BINARY: type = checker_binary(checker, node); break;
+    case AST_UNARY: type = checker_unary(checker, node); break;
+    case AST_VARIABLE: {
+      CheckerVar* var = checker_find_var(checker, node, node->variable.name, "variable");
+      type = checker_var_type(var->type);
+      break;
+    }
+    case AST_VARIABLE_ASSIGN: {
+      ExprType val = checker_expr(checker, node->variable_assign.assign_val);
+      CheckerVar* var = checker_find_var(checker, node, node->variable_assign.name, "variable");
+      checker_assign(node, var->name, var->type, node->variable_assign.op, val);
+      type = checker_var_type(var->type);
+      break;
+    }
+    case AST_MEMBER_ACCESS: {
+      int field_type = checker_member(checker, node);
+      if (field_type >= 0) type = checker_var_type(field_type);
+      break;
+    }
+    case AST_MEMBER_ASSIGN: {
+      AST* access = node->member_assign.member_access;
+      int field_type = checker_member(checker, access);
+      ExprType val = checker_expr(checker, node->member_assign.assign_val);
+      if (field_type >= 0) {
+        checker_assign(node, access->member_access.member_name, field_type, node->member_assign.op, val);
+        type = checker_var_type(field_type);
+      }
+      break;
+    }
+    case AST_FUNCTION_CALL: type = checker_function_call(checker, node); break;
+    case AST_MODULE_FUNCTION_CALL:
+      // modules are only loaded at runtime
+      checker_args(checker, node->module_function_call.func);
+      break;
+    default:
+      break;
+  }
+  node->expr_type = type;
+  return type;
+}
+
+static void checker_condition(Checker* checker, AST* cond, char* what)
+{
+  ExprType type = checker_expr(checker, cond);
+  if (type != TYPE_BOOL && type != TYPE_UNKNOWN) {
+    char msg[128];
+    sprintf(msg, "%s requires bool but got: '%s'", what, expr_type_name(type));
+    checker_error(cond, msg);
+  }
+}
+
+static void checker_statement(Checker* checker, AST* node);
+
+// blocks drop their variables when they end
+static void checker_block(Checker* checker, AST* compound)
+{
+  size_t mark = checker->var_size;
+  checker->depth++;
+  for (int i = 0; i < compound->compound.statement_size; i++) {
+    checker_statement(checker, compound->compound.statements[i]);
+  }
+  checker->depth--;
+  checker->var_size = mark;
+}
+
+// true if running node could assign name, calls count when a function could see it
+static bool checker_may_assign(AST* node, char* name, bool is_global)
+{
+  switch (node->type) {
+    case AST_COMPOUND:
+      for (int i = 0; i < node->compound.statement_size; i++) {
+        if (checker_may_assign(node->compound.statements[i], name, is_global)) return true;
+      }
+      return false;
+    case AST_BINARY:
+      return checker_may_assign(node->binary.left, name, is_global) ||
+             checker_may_assign(node->binary.right, name, is_global);
+    case AST_UNARY:
+      return checker_may_assign(node->unary.expr, name, is_global);
+    case AST_VARIABLE_DECLARATION:
+      for (int i = 0; i < node->variable_declaration.size; i++) {
+        if (node->variable_declaration.is_defined[i] &&
+            checker_may_assign(node->variable_declaration.values[i], name, is_global)) return true;
+      }
+      return false;
+    case AST_VARIABLE_ASSIGN:
+      return node->variable_assign.name == name ||
+             checker_may_assign(node->variable_assign.assign_val, name, is_global);
+    case AST_MEMBER_ASSIGN:
+      return checker_may_assign(node->member_assign.assign_val, name, is_global);
+    case AST_FUNCTION_CALL:
+      if (is_global && builtin_find(node->function_call.name) < 0) return true;
+      for (int i = 0; i < node->function_call.arg_size; i++) {
+        if (checker_may_assign(node->function_call.args[i], name, is_global)) return true;
+      }
+      return false;
+    case AST_MODULE_FUNCTION_CALL:
+      return is_global || checker_may_assign(node->module_function_call.func, name, is_global);
+    case AST_IF:
+      return checker_may_assign(node->if_block.cond, name, is_global) ||
+             checker_may_assign(node->if_block.compound, name, is_global) ||
+             (node->if_block.got_else && checker_may_assign(node->if_block.else_block, name, is_global));
+    case AST_ELSE:
+      return checker_may_assign(node->else_block.compound, name, is_global);
+    case AST_WHILE:
+      return checker_may_assign(node->while_block.cond, name, is_global) ||
+             checker_may_assign(node->while_block.compound, name, is_global);
+    case AST_FOR:
+      return (node->for_block.has_first && checker_may_assign(node->for_block.first, name, is_global)) ||
+             (node->for_block.has_second && checker_may_assign(node->for_block.second, name, is_global)) ||
+             (node->for_block.has_third && checker_may_assign(node->for_block.third, name, is_global)) ||
+             checker_may_assign(node->for_block.compound, name, is_global);
+    case AST_RETURN:
+      return !node->return_expr.is_empty_return && checker_may_assign(node->return_expr.expr, name, is_global);
+    default:
+      return false;
+  }
+}
+
+// for int i = a; i < n; i += k, with n a literal or an int the loop cannot change
+static void checker_counted_for(Checker* checker, AST* node)
+{
+  if (!node->for_block.has_first || !node->for_block.has_second || !node->for_block.has_third) return;
+  AST* first = node->for_block.first;
+  AST* second = node->for_block.second;
+  AST* third = node->for_block.third;
+  if (first->type != AST_VARIABLE_DECLARATION || first->variable_declaration.size != 1 ||
+      first->variable_declaration.type != VAR_INT || !first->variable_declaration.is_defined[0]) return;
+  char* name = first->variable_declaration.names[0];
+
+  if (second->type != AST_BINARY || second->binary.operands != OPERANDS_INT) return;
+  _TokenType op = second->binary.op;
+  if (op != TOKEN_LT && op != TOKEN_LE && op != TOKEN_GT && op != TOKEN_GE) return;
+  if (second->binary.left->type != AST_VARIABLE || second->binary.left->variable.name != name) return;
+  AST* bound = second->binary.right;
+  if (bound->type == AST_VARIABLE) {
+    CheckerVar* var = checker_lookup(checker, bound->variable.name);
+    if (!var || bound->variable.name == name ||
+        checker_may_assign(node->for_block.compound, bound->variable.name, var->is_global)) return;
+  } else if (bound->type != AST_INT) {
+    return;
+  }
+
+  if (third->type != AST_VARIABLE_ASSIGN || third->variable_assign.name != name ||
+      third->variable_assign.assign_val->type != AST_INT) return;
+  int step = third->variable_assign.assign_val->integer.val;
+  if (third->variable_assign.op == TOKEN_PLUSEQ) {
+    node->for_block.step = step;
+  } else if (third->variable_assign.op == TOKEN_MINUSEQ) {
+    node->for_block.step = -step;
+  } else {
+    return;
+  }
+  node->for_block.is_counted = true;
+}
+
+static void checker_return(Checker* checker, AST* node)
+{
+  AST* f = checker->function;
+  ExprType type = node->return_expr.is_empty_return ? TYPE_NONE : checker_expr(checker, node->return_expr.expr);
+  if (type == TYPE_UNKNOWN) return;
+
+  char msg[128];
+  if (!f->function_declaration.has_return) {
+    if (type != TYPE_NONE) {
+      sprintf(msg, "'%s' function return error: expected no type, got: %s",
+              f->function_declaration.name, expr_type_name(type));
+      checker_error(node, msg);
+    }
+    return;
+  }
+  VariableType return_type = f->function_declaration.return_type;
+  if (type == TYPE_OBJECT || type != checker_var_type(return_type)) {
+    sprintf(msg, "'%s' function return error: expected: %s, got: %s",
+            f->function_declaration.name, var_type_name(return_type), expr_type_name(type));
+    checker_error(node, msg);
+  }
+}
+
+static void checker_statement(Checker* checker, AST* node)
+{
+  switch (node->type) {
+    case AST_VARIABLE_DECLARATION: {
+      VariableType type = node->variable_declaration.type;
+      char* object_type = node->variable_declaration.object_type;
+      if (type == VAR_OBJECT && !checker_find_object(checker, object_type)) {
+        char msg[128];
+        sprintf(msg, "object type '%s' is not declared", object_type);
+        checker_error(node, msg);
+      }
+      for (int i = 0; i < node->variable_declaration.size; i++) {
+        // the initializer cannot see its own name yet
+        if (node->variable_declaration.is_defined[i]) {
+          ExprType val = checker_expr(checker, node->variable_declaration.values[i]);
+          checker_assign(node, node->variable_declaration.names[i], type, TOKEN_ASSIGN, val);
+        }
+        checker_declare(checker, node->variable_declaration.names[i], type, object_type);
+      }
+      break;
+    }
+    case AST_IF:
+      checker_condition(checker, node->if_block.cond, "if");
+      checker_block(checker, node->if_block.compound);
+      if (node->if_block.got_else) {
+        checker_statement(checker, node->if_block.else_block);
+      }
+      break;
+    case AST_ELSE:
+      checker_block(checker, node->else_block.compound);
+      break;
+    case AST_WHILE:
+      checker_condition(checker, node->while_block.cond, "while");
+      checker_block(checker, node->while_block.compound);
+      break;
+    case AST_FOR: {
+      size_t mark = checker->var_size;
+      checker->depth++;
+      if (node->for_block.has_first) {
+        checker_statement(checker, node->for_block.first);
+      }
+      if (node->for_block.has_second) {
+        checker_condition(checker, node->for_block.second, "for condition body");
+      }
+      if (node->for_block.has_third) {
+        checker_expr(checker, node->for_block.third);
+      }
+      checker_block(checker, node->for_block.compound);
+      checker_counted_for(checker, node);
+      checker->depth--;
+      checker->var_size = mark;
+      break;
+    }
+    case AST_RETURN:
+      checker_return(checker, node);
+      break;
+    default:
+      checker_expr(checker, node);
+      break;
+  }
+}
+
+void checker_check(Checker* checker, AST* root)
+{
+  // the top level stays declared while the functions are checked
+  for (int i = 0; i < root->compound.statement_size; i++) {
+    checker_statement(checker, root->compound.statements[i]);
+  }
+
+  for (int i = 0; i < checker->function_size; i++) {
+    AST* f = checker->function_declarations[i];
+    size_t mark = checker->var_size;
+    checker->function = f;
+    for (int j = 0; j < f->function_declaration.arg_size; j++) {
+      AST* arg = f->function_declaration.args[j];
+      checker_declare(checker, arg->variable.name, f->function_declaration.arg_types[j], arg->variable.object_type_name);
+    }
+    checker_block(checker, f->function_declaration.compound);
+    checker->var_size = mark;
+  }
+  checker->function = (void*)0;
+}
@@ -0,0 +1,1272 @@
+#include "inc/closure.h"
+#include "inc/visitor.h"
+#include "inc/builtin.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef Value (*ClosureRun)(Closure* closure, Var* frame);
+
+// operand forms every proven int operator is specialized for
+enum {
+  CLOSURE_CHILDREN,        // both sides are closures
+  CLOSURE_LOCAL_CONSTANT,  // frame slot and constant
+  CLOSURE_LOCALS,          // two frame slots
+  CLOSURE_CONSTANT,        // closure and constant
+};
+
+// closures run against the frames, globals, signal and modules of this visitor
+static Visitor* closure_visitor;
+
+static Value closure_error(char* msg)
+{
+  printf("Closure-> Error: %s\n", msg);
+  exit(1);
+  return value_noop();
+}
+
+static inline Value closure_int(int val)
+{
+  return (Value) { .type = VALUE_INT, .integer = val };
+}
+
+static inline Value closure_float(float val)
+{
+  return (Value) { .type = VALUE_FLOAT, .floating = val };
+}
+
+static inline Value closure_bool(bool val)
+{
+  return (Value) { .type = VALUE_BOOL, .boolean = val };
+}
+
+static Closure* init_closure(ClosureRun run, AST* node)
+{
+  Closure* closure = calloc(1, sizeof(Closure));
+
+  closure->run = run;
+  closure->node = node;
+
+  return closure;
+}
+
+static int closure_global_index(ClosureBuilder* builder, char* name);
+static ValueType closure_return_type(AST* f);
+
+ClosureBuilder* init_closure_builder(Parser* parser, Resolver* resolver, AST* root)
+{
+  ClosureBuilder* builder = calloc(1, sizeof(ClosureBuilder));
+
+  builder->parser = parser;
+  builder->resolver = resolver;
+  builder->root = root;
+  // every function exists before any body is built, so calls can point at it
+  builder->functions = calloc(parser->function_size ? parser->function_size : 1, sizeof(ClosureFunction));
+  for (int i = 0; i < parser->function_size; i++) {
+    builder->functions[i].declaration = parser->function_declarations[i];
+    builder->functions[i].return_type = closure_return_type(parser->function_declarations[i]);
+  }
+  // globals are typed up front, functions may use ones declared after them
+  builder->global_size = resolver->global_scope->name_size;
+  builder->global_types = calloc(builder->global_size ? builder->global_size : 1, sizeof(VariableType));
+  builder->global_objects = calloc(builder->global_size ? builder->global_size : 1, sizeof(char*));
+  for (int i = 0; i < root->compound.statement_size; i++) {
+    AST* statement = root->compound.statements[i];
+    if (statement->type != AST_VARIABLE_DECLARATION) continue;
+    for (int j = 0; j < statement->variable_declaration.size; j++) {
+      int slot = closure_global_index(builder, statement->variable_declaration.names[j]);
+      builder->global_types[slot] = statement->variable_declaration.type;
+      builder->global_objects[slot] = statement->variable_declaration.object_type;
+    }
+  }
+
+  return builder;
+}
+
+// pushes size cleared vars, for a call frame or for temporaries the collector must see
+static inline Var* closure_reserve(size_t size)
+{
+  Visitor* visitor = closure_visitor;
+  if (size > visitor->stack_cap - visitor->stack_size && !visitor_grow_fixed(visitor, visitor->stack_size + size)) {
+    char msg[64];
+    sprintf(msg, "stack overflow");
+    closure_error(msg);
+  }
+  Var* base = visitor->stack + visitor->stack_size;
+  visitor->stack_size += size;
+  memset(base, 0, size * sizeof(Var));
+  return base;
+}
+
+static inline void closure_release(Var* base)
+{
+  closure_visitor->stack_size = base - closure_visitor->stack;
+}
+
+// variables
+
+static Value closure_undefined(Closure* closure)
+{
+  char msg[96];
+  sprintf(msg, "use of value of undefined variable: '%s'", closure->name);
+  return closure_error(msg);
+}
+
+static inline Value closure_local(Closure* closure, Var* frame, int slot)
+{
+  Value val = frame[slot].val;
+  if (val.type == VALUE_UNDEFINED) {
+    closure_undefined(closure);
+  }
+  return val;
+}
+
+static inline Value* closure_global(char* name, int slot)
+{
+  Scope* scope = closure_visitor->global_scope;
+  // a function may run before the global it uses has been declared
+  if (slot >= scope->var_size) {
+    char msg[64];
+    sprintf(msg, "use of undeclared variable: '%s'", name);
+    closure_error(msg);
+  }
+  return &scope->vars[slot]->val;
+}
+
+static Value closure_constant(Closure* closure, Var* frame)
+{
+  return closure->val;
+}
+
+static Value closure_read_local(Closure* closure, Var* frame)
+{
+  return closure_local(closure, frame, closure->slot);
+}
+
+static Value closure_read_global(Closure* closure, Var* frame)
+{
+  Value val = *closure_global(closure->name, closure->slot);
+  if (val.type == VALUE_UNDEFINED) {
+    return closure_undefined(closure);
+  }
+  return val;
+}
+
+// a message found while building, raised only if the program gets there
+static Value closure_fail(Closure* closure, Var* frame)
+{
+  return closure_error(closure->name);
+}
+
+// proven operands
+
+#define CLOSURE_INT_OP(name, make) \
+  static Value closure_int_##name(Closure* closure, Var* frame) \
+  { \
+    int left = closure->a->run(closure->a, frame).integer; \
+    int right = closure->b->run(closure->b, frame).integer; \
+    return make; \
+  } \
+  static Value closure_int_##name##_lk(Closure* closure, Var* frame) \
+  { \
+    int left = closure_local(closure->a, frame, closure->slot).integer; \
+    int right = closure->val.integer; \
+    return make; \
+  } \
+  static Value closure_int_##name##_ll(Closure* closure, Var* frame) \
+  { \
+    int left = closure_local(closure->a, frame, closure->slot).integer; \
+    int right = closure_local(closure->b, frame, closure->index).integer; \
+    return make; \
+  } \
+  static Value closure_int_##name##_k(Closure* closure, Var* frame) \
+  { \
+    int left = closure->a->run(closure->a, frame).integer; \
+    int right = closure->val.integer; \
+    return make; \
+  } \
+  static const ClosureRun closure_int_##name##_forms[] = { \
+    closure_int_##name, closure_int_##name##_lk, closure_int_##name##_ll, closure_int_##name##_k \
+  };
+
+CLOSURE_INT_OP(add, closure_int(left + right))
+CLOSURE_INT_OP(sub, closure_int(left - right))
+CLOSURE_INT_OP(mul, closure_int(left * right))
+CLOSURE_INT_OP(div, closure_int(left / right))
+CLOSURE_INT_OP(mod, closure_int(left % right))
+CLOSURE_INT_OP(eq, closure_bool(left == right))
+CLOSURE_INT_OP(ne, closure_bool(left != right))
+CLOSURE_INT_OP(gt, closure_bool(left > right))
+CLOSURE_INT_OP(ge, closure_bool(left >= right))
+CLOSURE_INT_OP(lt, closure_bool(left < right))
+CLOSURE_INT_OP(le, closure_bool(left <= right))
+
+static const ClosureRun* closure_int_forms(_TokenType op)
+{
+  switch (op) {
+    case TOKEN_PLUS: return closure_int_add_forms;
+    case TOKEN_MINUS: return closure_int_sub_forms;
+    case TOKEN_MUL: return closure_int_mul_forms;
+    case TOKEN_DIV: return closure_int_div_forms;
+    case TOKEN_MOD: return closure_int_mod_forms;
+    case TOKEN_EQ: return closure_int_eq_forms;
+    case TOKEN_NE: return closure_int_ne_forms;
+    case TOKEN_GT: return closure_int_gt_forms;
+    case TOKEN_GE: return closure_int_ge_forms;
+    case TOKEN_LT: return closure_int_lt_forms;
+    case TOKEN_LE: return closure_int_le_forms;
+    default: return (void*)0;
+  }
+}
+
+// mixed operands get their int side converted first
+#define CLOSURE_FLOAT_OP(name, make) \
+  static Value closure_float_##name(Closure* closure, Var* frame) \
+  { \
+    float left = closure->a->run(closure->a, frame).floating; \
+    float right = closure->b->run(closure->b, frame).floating; \
+    return make; \
+  }
+
+CLOSURE_FLOAT_OP(add, closure_float(left + right))
+CLOSURE_FLOAT_OP(sub, closure_float(left - right))
+CLOSURE_FLOAT_OP(mul, closure_float(left * right))
+CLOSURE_FLOAT_OP(div, closure_float(left / right))
+CLOSURE_FLOAT_OP(eq, closure_bool(left == right))
+CLOSURE_FLOAT_OP(ne, closure_bool(left != right))
+CLOSURE_FLOAT_OP(gt, closure_bool(left > right))
+CLOSURE_FLOAT_OP(ge, closure_bool(left >= right))
+CLOSURE_FLOAT_OP(lt, closure_bool(left < right))
+CLOSURE_FLOAT_OP(le, closure_bool(left <= right))
+
+static ClosureRun closure_float_run(_TokenType op)
+{
+  switch (op) {
+    case TOKEN_PLUS: return closure_float_add;
+    case TOKEN_MINUS: return closure_float_sub;
+    case TOKEN_MUL: return closure_float_mul;
+    case TOKEN_DIV: return closure_float_div;
+    case TOKEN_EQ: return closure_float_eq;
+    case TOKEN_NE: return closure_float_ne;
+    case TOKEN_GT: return closure_float_gt;
+    case TOKEN_GE: return closure_float_ge;
+    case TOKEN_LT: return closure_float_lt;
+    case TOKEN_LE: return closure_float_le;
+    default: return (void*)0;
+  }
+}
+
+static Value closure_to_float(Closure* closure, Var* frame)
+{
+  return closure_float(closure->a->run(closure->a, frame).integer);
+}
+
+// and/or of proven bools, the right side only runs when the left does not decide
+static Value closure_and(Closure* closure, Var* frame)
+{
+  Value left = closure->a->run(closure->a, frame);
+  return left.boolean ? closure->b->run(closure->b, frame) : left;
+}
+
+static Value closure_or(Closure* closure, Var* frame)
+{
+  Value left = closure->a->run(closure->a, frame);
+  return left.boolean ? left : closure->b->run(closure->b, frame);
+}
+
+static Value closure_negate_int(Closure* closure, Var* frame)
+{
+  return closure_int(-closure->a->run(closure->a, frame).integer);
+}
+
+static Value closure_negate_float(Closure* closure, Var* frame)
+{
+  return closure_float(-closure->a->run(closure->a, frame).floating);
+}
+
+static Value closure_not(Closure* closure, Var* frame)
+{
+  return closure_bool(!closure->a->run(closure->a, frame).boolean);
+}
+
+// operands only known at runtime, same rules as the visitor
+
+static Value closure_binary_int(_TokenType op, int left, int right)
+{
+  switch (op) {
+    case TOKEN_PLUS: return closure_int(left + right);
+    case TOKEN_MINUS: return closure_int(left - right);
+    case TOKEN_MUL: return closure_int(left * right);
+    case TOKEN_DIV: return closure_int(left / right);
+    case TOKEN_MOD: return closure_int(left % right);
+    case TOKEN_EQ: return closure_bool(left == right);
+    case TOKEN_NE: return closure_bool(left != right);
+    case TOKEN_GT: return closure_bool(left > right);
+    case TOKEN_GE: return closure_bool(left >= right);
+    case TOKEN_LT: return closure_bool(left < right);
+    case TOKEN_LE: return closure_bool(left <= right);
+    default: return value_noop();
+  }
+}
+
+static Value closure_binary_float(_TokenType op, float left, float right)
+{
+  switch (op) {
+    case TOKEN_PLUS: return closure_float(left + right);
+    case TOKEN_MINUS: return closure_float(left - right);
+    case TOKEN_MUL: return closure_float(left * right);
+    case TOKEN_DIV: return closure_float(left / right);
+    case TOKEN_MOD: {
+      char msg[64];
+      sprintf(msg, "'%%' operator cannot be applied to floating values");
+      return closure_error(msg);
+    }
+    case TOKEN_EQ: return closure_bool(left == right);
+    case TOKEN_NE: return closure_bool(left != right);
+    case TOKEN_GT: return closure_bool(left > right);
+    case TOKEN_GE: return closure_bool(left >= right);
+    case TOKEN_LT: return closure_bool(left < right);
+    case TOKEN_LE: return closure_bool(left <= right);
+    default: return value_noop();
+  }
+}
+
+static Value closure_binary(Closure* closure, Var* frame)
+{
+  _TokenType op = closure->op;
+  Value left = closure->a->run(closure->a, frame);
+  if (left.type == VALUE_BOOL && ((op == TOKEN_AND && !left.boolean) || (op == TOKEN_OR && left.boolean))) {
+    return left;
+  }
+  Value right;
+  if (left.is_managed) {
+    // keep the left string alive while the right side runs
+    Var* temp = closure_reserve(1);
+    temp->val = left;
+    right = closure->b->run(closure->b, frame);
+    closure_release(temp);
+  } else {
+    right = closure->b->run(closure->b, frame);
+  }
+
+  if (left.type == VALUE_INT && right.type == VALUE_INT) {
+    return closure_binary_int(op, left.integer, right.integer);
+  } else if ((left.type == VALUE_INT || left.type == VALUE_FLOAT) &&
+             (right.type == VALUE_INT || right.type == VALUE_FLOAT)) {
+    return closure_binary_float(op, left.type == VALUE_FLOAT ? left.floating : (float)left.integer,
+                                right.type == VALUE_FLOAT ? right.floating : (float)right.integer);
+  } else if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
+    switch (op) {
+      case TOKEN_EQ: return closure_bool(strcmp(left.string, right.string) == 0);
+      case TOKEN_NE: return closure_bool(strcmp(left.string, right.string) != 0);
+      default: {
+        char msg[64];
+        sprintf(msg, "%s operator cannot be applied to string", token_name(op));
+        return closure_error(msg);
+      }
+    }
+  } else if (left.type == VALUE_BOOL && right.type == VALUE_BOOL) {
+    switch (op) {
+      case TOKEN_AND: return closure_bool(left.boolean && right.boolean);
+      case TOKEN_OR: return closure_bool(left.boolean || right.boolean);
+      case TOKEN_EQ: return closure_bool(left.boolean == right.boolean);
+      case TOKEN_NE: return closure_bool(left.boolean != right.boolean);
+      default: {
+        char msg[64];
+        sprintf(msg, "%s operator cannot be applied to bool", token_name(op));
+        return closure_error(msg);
+      }
+    }
+  }
+  char msg[64];
+  sprintf(msg, "unexpected types in binary: left: %s, right: %s", value_name(left.type), value_name(right.type));
+  return closure_error(msg);
+}
+
+static Value closure_unary(Closure* closure, Var* frame)
+{
+  Value expr = closure->a->run(closure->a, frame);
+  char msg[128];
+  if (closure->op == TOKEN_MINUS) {
+    if (expr.type == VALUE_INT) return closure_int(-expr.integer);
+    if (expr.type == VALUE_FLOAT) return closure_float(-expr.floating);
+    sprintf(msg, "'-' unary operator cannot be applied to %s", value_name(expr.type));
+    return closure_error(msg);
+  }
+  if (expr.type == VALUE_BOOL) return closure_bool(!expr.boolean);
+  sprintf(msg, "'not' unary operator cannot be applied to %s", value_name(expr.type));
+  return closure_error(msg);
+}
+
+// checks of values whose type is only known at runtime
+
+static Value closure_convert(Closure* closure, Var* frame)
+{
+  Value val = value_undefined();
+  visitor_check_types(closure->name, closure->type, &val, TOKEN_ASSIGN, closure->a->run(closure->a, frame));
+  return val;
+}
+
+static Value closure_test(Closure* closure, Var* frame)
+{
+  Value val = closure->a->run(closure->a, frame);
+  if (val.type != VALUE_BOOL) {
+    char msg[128];
+    sprintf(msg, "%s requires bool but got: '%s'", closure->name, value_name(val.type));
+    closure_error(msg);
+  }
+  return val;
+}
+
+// assignments
+
+// locals keep their name and type, the visitor may run the rest of the frame
+static Value closure_declare_local(Closure* closure, Var* frame)
+{
+  Value val = closure->a ? closure->a->run(closure->a, frame) : value_undefined();
+  frame[closure->slot] = (Var) { closure->name, val, closure->type };
+  return val;
+}
+
+static Value closure_declare_global(Closure* closure, Var* frame)
+{
+  Value val = closure->a ? closure->a->run(closure->a, frame) : value_undefined();
+  scope_add_var(closure_visitor->global_scope, init_var(closure->name, val, closure->type));
+  return val;
+}
+
+static Value closure_declare_object_local(Closure* closure, Var* frame)
+{
+  Value val = value_object(init_object(closure->node));
+  frame[closure->slot] = (Var) { closure->name, val, VAR_OBJECT };
+  return val;
+}
+
+static Value closure_declare_object_global(Closure* closure, Var* frame)
+{
+  Value val = value_object(init_object(closure->node));
+  scope_add_var(closure_visitor->global_scope, init_var(closure->name, val, VAR_OBJECT));
+  return val;
+}
+
+static Value closure_assign_local(Closure* closure, Var* frame)
+{
+  return frame[closure->slot].val = closure->a->run(closure->a, frame);
+}
+
+static Value closure_assign_global(Closure* closure, Var* frame)
+{
+  Value val = closure->a->run(closure->a, frame);
+  return *closure_global(closure->name, closure->slot) = val;
+}
+
+static Value closure_assign_checked(Closure* closure, Value* dst, Value val)
+{
+  visitor_check_types(closure->name, closure->type, dst, closure->op, val);
+  return *dst;
+}
+
+static Value closure_update_local(Closure* closure, Var* frame)
+{
+  Value val = closure->a->run(closure->a, frame);
+  return closure_assign_checked(closure, &frame[closure->slot].val, val);
+}
+
+static Value closure_update_global(Closure* closure, Var* frame)
+{
+  Value val = closure->a->run(closure->a, frame);
+  return closure_assign_checked(closure, closure_global(closure->name, closure->slot), val);
+}
+
+// int variable and proven int value, only an undefined variable needs the checks
+#define CLOSURE_UPDATE_INT(name, op) \
+  static Value closure_update_int_##name(Closure* closure, Var* frame) \
+  { \
+    Value val = closure->a->run(closure->a, frame); \
+    Value* dst = &frame[closure->slot].val; \
+    if (dst->type != VALUE_INT) { \
+      return closure_assign_checked(closure, dst, val); \
+    } \
+    dst->integer op val.integer; \
+    return *dst; \
+  }
+
+CLOSURE_UPDATE_INT(add, +=)
+CLOSURE_UPDATE_INT(sub, -=)
+CLOSURE_UPDATE_INT(mul, *=)
+
+// calls
+
+static Value closure_return_error(AST* f, Value ret)
+{
+  char msg[128];
+  if (!f->function_declaration.has_return) {
+    sprintf(msg, "'%s' function return error: expected no type, got: %s",
+            f->function_declaration.name, value_name(ret.type));
+  } else {
+    sprintf(msg, "'%s' function return error: expected: %s, got: %s",
+            f->function_declaration.name, var_type_name(f->function_declaration.return_type), value_name(ret.type));
+  }
+  return closure_error(msg);
+}
+
+static Value closure_call(Closure* closure, Var* frame)
+{
+  ClosureFunction* function = closure->function;
+  // args run straight into the new frame so they stay visible to the collector
+  Var* base = closure_reserve(closure->index);
+  for (size_t i = 0; i < closure->size; i++) {
+    Closure* arg = closure->list[i];
+    base[i].val = arg->run(arg, frame);
+  }
+
+  Value ret;
+  Closure* body = __atomic_load_n(&function->body, __ATOMIC_ACQUIRE);
+  if (body) {
+    ret = body->run(body, base);
+    closure_release(base);
+  } else {
+    // not built yet, the visitor runs it and wants the names and types of the args
+    AST* f = function->declaration;
+    for (size_t i = 0; i < closure->size; i++) {
+      base[i].name = f->function_declaration.args[i]->variable.name;
+      base[i].type = f->function_declaration.arg_types[i];
+    }
+    ret = visitor_call_body(closure_visitor, closure->node->function_call.function, base - closure_visitor->stack);
+  }
+  if (closure_visitor->signal == SIGNAL_RETURN) {
+    closure_visitor->signal = SIGNAL_NONE;
+  } else {
+    ret = value_noop();
+  }
+  if (ret.type != function->return_type) {
+    return closure_return_error(function->declaration, ret);
+  }
+  return ret;
+}
+
+// objects are passed by reference and must be of the declared object type
+static Value closure_object_arg(Closure* closure, Var* frame)
+{
+  Value val = closure->a->run(closure->a, frame);
+  if (val.type == VALUE_OBJECT && val.object->declaration->object_declaration.name == closure->name) {
+    return val;
+  }
+  char msg[128];
+  sprintf(msg, "function %s: %d index arg is object type: %s, got %s",
+          closure->node->function_declaration.name,
+          closure->index,
+          closure->name,
+          val.type == VALUE_OBJECT ? val.object->declaration->object_declaration.name : value_name(val.type));
+  return closure_error(msg);
+}
+
+static Value closure_builtin(Closure* closure, Var* frame)
+{
+  Var* base = closure_reserve(closure->size);
+  Value args[closure->size ? closure->size : 1];
+  for (size_t i = 0; i < closure->size; i++) {
+    Closure* arg = closure->list[i];
+    args[i] = base[i].val = arg->run(arg, frame);
+  }
+  Value ret = builtin_call(closure->index, args, closure->size);
+  closure_release(base);
+  return ret;
+}
+
+static Value closure_include(Closure* closure, Var* frame)
+{
+  return visitor_visit_include(closure_visitor, closure->node);
+}
+
+static Value closure_module_call(Closure* closure, Var* frame)
+{
+  // modules are only included at runtime, once found they stay
+  Visitor* visitor = closure_visitor;
+  for (int i = 0; !closure->module && i < visitor->module_size; i++) {
+    if (visitor->modules[i]->name == closure->name) {
+      closure->module = visitor->modules[i];
+    }
+  }
+  if (!closure->module) {
+    char msg[128];
+    sprintf(msg, "undeclared module: '%s'", closure->name);
+    return closure_error(msg);
+  }
+  AST* f_call = closure->node->module_function_call.func;
+  Var* base = closure_reserve(closure->size);
+  Value args[closure->size ? closure->size : 1];
+  for (size_t i = 0; i < closure->size; i++) {
+    Closure* arg = closure->list[i];
+    args[i] = base[i].val = arg->run(arg, frame);
+  }
+  Value ret = module_call(closure->module, f_call->function_call.name, args, closure->size);
+  closure_release(base);
+  return ret;
+}
+
+// objects, the field index is found while building
+
+static Value closure_field(Closure* closure, Object* object)
+{
+  Value val = object->fields[closure->index];
+  if (val.type == VALUE_UNDEFINED) {
+    char msg[96];
+    sprintf(msg, "member '%s' of object variable is not defined or does not have it: '%s'",
+                  closure->node->member_access.member_name, closure->name);
+    return closure_error(msg);
+  }
+  return val;
+}
+
+static Value closure_member_local(Closure* closure, Var* frame)
+{
+  return closure_field(closure, frame[closure->slot].val.object);
+}
+
+static Value closure_member_global(Closure* closure, Var* frame)
+{
+  return closure_field(closure, closure_global(closure->name, closure->slot)->object);
+}
+
+static Value closure_member_assign_local(Closure* closure, Var* frame)
+{
+  Object* object = frame[closure->slot].val.object;
+  Value val = closure->a->run(closure->a, frame);
+  return closure_assign_checked(closure, &object->fields[closure->index], val);
+}
+
+static Value closure_member_assign_global(Closure* closure, Var* frame)
+{
+  AST* access = closure->node->member_assign.member_access;
+  Object* object = closure_global(access->member_access.object_name, closure->slot)->object;
+  Value val = closure->a->run(closure->a, frame);
+  return closure_assign_checked(closure, &object->fields[closure->index], val);
+}
+
+// statements, return, skip and stop leave a signal for the enclosing function or loop
+
+static Value closure_compound(Closure* closure, Var* frame)
+{
+  for (size_t i = 0; i < closure->size; i++) {
+    Closure* statement = closure->list[i];
+    Value visited = statement->run(statement, frame);
+    if (closure_visitor->signal != SIGNAL_NONE) {
+      return visited;
+    }
+  }
+  return value_noop();
+}
+
+static Value closure_if(Closure* closure, Var* frame)
+{
+  if (closure->a->run(closure->a, frame).boolean) {
+    return closure->b->run(closure->b, frame);
+  } else if (closure->c) {
+    return closure->c->run(closure->c, frame);
+  }
+  return value_noop();
+}
+
+// handles the signal a loop body left, true when the loop is done
+static inline bool closure_loop_ends()
+{
+  Signal signal = closure_visitor->signal;
+  if (signal == SIGNAL_RETURN) return true;
+  closure_visitor->signal = SIGNAL_NONE;
+  return signal == SIGNAL_STOP;
+}
+
+static Value closure_while(Closure* closure, Var* frame)
+{
+  while (closure->a->run(closure->a, frame).boolean) {
+    Value visited = closure->b->run(closure->b, frame);
+    if (closure_visitor->signal != SIGNAL_NONE && closure_loop_ends()) {
+      return visited;
+    }
+  }
+  return value_noop();
+}
+
+// loops are built without their first, so the visitor can switch to one it is already running
+static Value closure_for_first(Closure* closure, Var* frame)
+{
+  closure->a->run(closure->a, frame);
+  return closure->b->run(closure->b, frame);
+}
+
+static Value closure_for(Closure* closure, Var* frame)
+{
+  while (!closure->b || closure->b->run(closure->b, frame).boolean) {
+    Value visited = closure->d->run(closure->d, frame);
+    if (closure_visitor->signal != SIGNAL_NONE && closure_loop_ends()) {
+      return visited;
+    }
+    if (closure->c) {
+      closure->c->run(closure->c, frame);
+    }
+  }
+  return value_noop();
+}
+
+// the checker proved the bound cannot change, the counter is stepped in its slot
+#define CLOSURE_COUNTED_FOR(name, compare) \
+  static Value closure_counted_for_##name(Closure* closure, Var* frame) \
+  { \
+    int bound = closure->b->run(closure->b, frame).integer; \
+    int step = closure->val.integer; \
+    Value* counter = &frame[closure->slot].val; \
+    while (counter->integer compare bound) { \
+      Value visited = closure->d->run(closure->d, frame); \
+      if (closure_visitor->signal != SIGNAL_NONE && closure_loop_ends()) { \
+        return visited; \
+      } \
+      counter->integer += step; \
+    } \
+    return value_noop(); \
+  }
+
+CLOSURE_COUNTED_FOR(lt, <)
+CLOSURE_COUNTED_FOR(le, <=)
+CLOSURE_COUNTED_FOR(gt, >)
+CLOSURE_COUNTED_FOR(ge, >=)
+
+static Value closure_return(Closure* closure, Var* frame)
+{
+  Value val = closure->a ? closure->a->run(closure->a, frame) : value_noop();
+  closure_visitor->signal = SIGNAL_RETURN;
+  return val;
+}
+
+static Value closure_skip(Closure* closure, Var* frame)
+{
+  closure_visitor->signal = SIGNAL_SKIP;
+  return value_noop();
+}
+
+static Value closure_stop(Closure* closure, Var* frame)
+{
+  closure_visitor->signal = SIGNAL_STOP;
+  return value_noop();
+}
+
+// building
+
+static Closure* closure_build_node(ClosureBuilder* builder, AST* node);
+
+static Closure* closure_build_fail(AST* node, char* msg)
+{
+  Closure* closure = init_closure(closure_fail, node);
+  closure->name = strdup(msg);
+  return closure;
+}
+
+static int closure_global_index(ClosureBuilder* builder, char* name)
+{
+  ResolverScope* scope = builder->resolver->global_scope;
+  for (int i = 0; i < scope->name_size; i++) {
+    if (scope->names[i] == name) return i;
+  }
+  return -1;
+}
+
+static AST* closure_find_object(ClosureBuilder* builder, char* name)
+{
+  for (int i = 0; i < builder->parser->object_size; i++) {
+    if (builder->parser->object_declarations[i]->object_declaration.name == name) {
+      return builder->parser->object_declarations[i];
+    }
+  }
+  return (void*)0;
+}
+
+static VariableType closure_var_type(ClosureBuilder* builder, int depth, int slot)
+{
+  return depth == RESOLVER_FRAME ? builder->local_types[slot] : builder->global_types[slot];
+}
+
+static char* closure_var_object(ClosureBuilder* builder, int depth, int slot)
+{
+  return depth == RESOLVER_FRAME ? builder->local_objects[slot] : builder->global_objects[slot];
+}
+
+// a plain assignment of a value the checker proved to have the variable's type
+static bool closure_is_exact(VariableType type, AST* val)
+{
+  switch (type) {
+    case VAR_INT: return val->expr_type == TYPE_INT;
+    case VAR_FLOAT: return val->expr_type == TYPE_FLOAT;
+    case VAR_STRING: return val->expr_type == TYPE_STRING;
+    case VAR_BOOL: return val->expr_type == TYPE_BOOL;
+    default: return false;
+  }
+}
+
+static Closure* closure_build_convert(ClosureBuilder* builder, AST* val, char* name, VariableType type)
+{
+  Closure* closure = closure_build_node(builder, val);
+  if (closure_is_exact(type, val)) return closure;
+  Closure* convert = init_closure(closure_convert, val);
+  convert->a = closure;
+  convert->name = name;
+  convert->type = type;
+  return convert;
+}
+
+// conditions the checker could not prove to be bools are checked when they run
+static Closure* closure_build_test(ClosureBuilder* builder, AST* cond, char* what)
+{
+  Closure* closure = closure_build_node(builder, cond);
+  if (cond->expr_type == TYPE_BOOL) return closure;
+  Closure* test = init_closure(closure_test, cond);
+  test->a = closure;
+  test->name = what;
+  return test;
+}
+
+static Closure* closure_build_variable(ClosureBuilder* builder, AST* node)
+{
+  Closure* closure = init_closure(node->variable.depth == RESOLVER_FRAME ? closure_read_local : closure_read_global, node);
+  closure->slot = node->variable.slot;
+  closure->name = node->variable.name;
+  return closure;
+}
+
+static Closure* closure_build_int_binary(AST* node, const ClosureRun* forms, Closure* left, Closure* right)
+{
+  Closure* closure = init_closure(forms[CLOSURE_CHILDREN], node);
+  closure->a = left;
+  closure->b = right;
+  if (left->run == closure_read_local && right->run == closure_constant) {
+    closure->run = forms[CLOSURE_LOCAL_CONSTANT];
+    closure->slot = left->slot;
+    closure->val = right->val;
+  } else if (left->run == closure_read_local && right->run == closure_read_local) {
+    closure->run = forms[CLOSURE_LOCALS];
+    closure->slot = left->slot;
+    closure->index = right->slot;
+  } else if (right->run == closure_constant) {
+    closure->run = forms[CLOSURE_CONSTANT];
+    closure->val = right->val;
+  }
+  return closure;
+}
+
+static Closure* closure_wrap(ClosureRun run, AST* node, Closure* a)
+{
+  Closure* closure = init_closure(run, node);
+  closure->a = a;
+  return closure;
+}
+
+static Closure* closure_build_binary(ClosureBuilder* builder, AST* node)
+{
+  _TokenType op = node->binary.op;
+  Closure* left = closure_build_node(builder, node->binary.left);
+  Closure* right = closure_build_node(builder, node->binary.right);
+  switch (node->binary.operands) {
+    case OPERANDS_INT: {
+      const ClosureRun* forms = closure_int_forms(op);
+      if (forms) return closure_build_int_binary(node, forms, left, right);
+      break;
+    }
+    case OPERANDS_FLOAT:
+    case OPERANDS_INT_FLOAT:
+    case OPERANDS_FLOAT_INT: {
+      ClosureRun run = closure_float_run(op);
+      if (!run) break;
+      Closure* closure = init_closure(run, node);
+      closure->a = node->binary.operands == OPERANDS_INT_FLOAT ? closure_wrap(closure_to_float, node, left) : left;
+      closure->b = node->binary.operands == OPERANDS_FLOAT_INT ? closure_wrap(closure_to_float, node, right) : right;
+      return closure;
+    }
+    default:
+      break;
+  }
+  if ((op == TOKEN_AND || op == TOKEN_OR) &&
+      node->binary.left->expr_type == TYPE_BOOL && node->binary.right->expr_type == TYPE_BOOL) {
+    Closure* closure = init_closure(op == TOKEN_AND ? closure_and : closure_or, node);
+    closure->a = left;
+    closure->b = right;
+    return closure;
+  }
+  Closure* closure = init_closure(closure_binary, node);
+  closure->a = left;
+  closure->b = right;
+  closure->op = op;
+  return closure;
+}
+
+static Closure* closure_build_unary(ClosureBuilder* builder, AST* node)
+{
+  Closure* expr = closure_build_node(builder, node->unary.expr);
+  ExprType type = node->unary.expr->expr_type;
+  if (node->unary.op == TOKEN_MINUS && type == TYPE_INT) return closure_wrap(closure_negate_int, node, expr);
+  if (node->unary.op == TOKEN_MINUS && type == TYPE_FLOAT) return closure_wrap(closure_negate_float, node, expr);
+  if (node->unary.op == TOKEN_NOT && type == TYPE_BOOL) return closure_wrap(closure_not, node, expr);
+  if (node->unary.op != TOKEN_MINUS && node->unary.op != TOKEN_NOT) {
+    Closure* closure = init_closure(closure_constant, node);
+    closure->val = value_noop();
+    return closure;
+  }
+  Closure* closure = closure_wrap(closure_unary, node, expr);
+  closure->op = node->unary.op;
+  return closure;
+}
+
+static Closure** closure_build_args(ClosureBuilder* builder, AST* f_call)
+{
+  size_t arg_size = f_call->function_call.arg_size;
+  Closure** args = calloc(arg_size ? arg_size : 1, sizeof(Closure*));
+  for (int i = 0; i < arg_size; i++) {
+    args[i] = closure_build_node(builder, f_call->function_call.args[i]);
+  }
+  return args;
+}
+
+static Closure* closure_build_call(ClosureBuilder* builder, AST* node)
+{
+  size_t arg_size = node->function_call.arg_size;
+  if (node->function_call.builtin >= 0) {
+    Closure* closure = init_closure(closure_builtin, node);
+    closure->list = closure_build_args(builder, node);
+    closure->size = arg_size;
+    closure->index = node->function_call.builtin;
+    return closure;
+  }
+
+  ClosureFunction* function = &builder->functions[node->function_call.function];
+  AST* f = function->declaration;
+  if (arg_size != f->function_declaration.arg_size) {
+    char msg[128];
+    sprintf(msg, "function %s: expected %lu arg(s), but got %lu",
+            f->function_declaration.name, f->function_declaration.arg_size, arg_size);
+    return closure_build_fail(node, msg);
+  }
+  Closure* closure = init_closure(closure_call, node);
+  closure->function = function;
+  closure->index = f->function_declaration.frame_size;
+  closure->size = arg_size;
+  closure->list = calloc(arg_size ? arg_size : 1, sizeof(Closure*));
+  for (int i = 0; i < arg_size; i++) {
+    AST* param = f->function_declaration.args[i];
+    VariableType type = f->function_declaration.arg_types[i];
+    if (type == VAR_OBJECT) {
+      Closure* arg = init_closure(closure_object_arg, f);
+      arg->a = closure_build_node(builder, node->function_call.args[i]);
+      arg->name = param->variable.object_type_name;
+      arg->index = i;
+      closure->list[i] = arg;
+      continue;
+    }
+    closure->list[i] = closure_build_convert(builder, node->function_call.args[i], param->variable.name, type);
+  }
+  return closure;
+}
+
+static Closure* closure_build_module_call(ClosureBuilder* builder, AST* node)
+{
+  AST* f_call = node->module_function_call.func;
+  Closure* closure = init_closure(closure_module_call, node);
+  closure->name = node->module_function_call.module_name;
+  closure->list = closure_build_args(builder, f_call);
+  closure->size = f_call->function_call.arg_size;
+  return closure;
+}
+
+static Closure* closure_build_declaration(ClosureBuilder* builder, AST* node)
+{
+  size_t size = node->variable_declaration.size;
+  VariableType type = node->variable_declaration.type;
+  Closure* closure = init_closure(closure_compound, node);
+  closure->list = calloc(size, sizeof(Closure*));
+  closure->size = size;
+  for (int i = 0; i < size; i++) {
+    char* name = node->variable_declaration.names[i];
+    bool is_global = node->variable_declaration.slot == RESOLVER_GLOBAL;
+    int slot = is_global ? closure_global_index(builder, name) : node->variable_declaration.slot + i;
+    Closure* declare;
+    if (type == VAR_OBJECT) {
+      AST* obj_dec = closure_find_object(builder, node->variable_declaration.object_type);
+      if (obj_dec) {
+        declare = init_closure(is_global ? closure_declare_object_global : closure_declare_object_local, obj_dec);
+      } else {
+        char msg[128];
+        sprintf(msg, "object type '%s' is not declared", node->variable_declaration.object_type);
+        declare = closure_build_fail(node, msg);
+      }
+    } else {
+      declare = init_closure(is_global ? closure_declare_global : closure_declare_local, node);
+      if (node->variable_declaration.is_defined[i]) {
+        declare->a = closure_build_convert(builder, node->variable_declaration.values[i], name, type);
+      }
+    }
+    if (declare->run != closure_fail) {
+      declare->slot = slot;
+      declare->name = name;
+      declare->type = type;
+    }
+    closure->list[i] = declare;
+    // the name is only visible once its initializer is built
+    if (is_global) {
+      builder->global_types[slot] = type;
+      builder->global_objects[slot] = node->variable_declaration.object_type;
+    } else {
+      builder->local_types[slot] = type;
+      builder->local_objects[slot] = node->variable_declaration.object_type;
+    }
+  }
+  return size == 1 ? closure->list[0] : closure;
+}
+
+static Closure* closure_build_assign(ClosureBuilder* builder, AST* node)
+{
+  int depth = node->variable_assign.depth;
+  int slot = node->variable_assign.slot;
+  _TokenType op = node->variable_assign.op;
+  AST* val = node->variable_assign.assign_val;
+  VariableType type = closure_var_type(builder, depth, slot);
+  bool is_local = depth == RESOLVER_FRAME;
+
+  ClosureRun run = is_local ? closure_update_local : closure_update_global;
+  if (op == TOKEN_ASSIGN && closure_is_exact(type, val)) {
+    run = is_local ? closure_assign_local : closure_assign_global;
+  } else if (is_local && type == VAR_INT && val->expr_type == TYPE_INT) {
+    if (op == TOKEN_PLUSEQ) run = closure_update_int_add;
+    if (op == TOKEN_MINUSEQ) run = closure_update_int_sub;
+    if (op == TOKEN_MULEQ) run = closure_update_int_mul;
+  }
+  Closure* closure = init_closure(run, node);
+  closure->a = closure_build_node(builder, val);
+  closure->slot = slot;
+  closure->name = node->variable_assign.name;
+  closure->type = type;
+  closure->op = op;
+  return closure;
+}
+
+static int closure_field_index(AST* obj_dec, char* member_name)
+{
+  for (int i = 0; i < obj_dec->object_declaration.field_size; i++) {
+    if (obj_dec->object_declaration.field_names[i] == member_name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static Closure* closure_build_member(ClosureBuilder* builder, AST* node)
+{
+  int depth = node->member_access.depth;
+  int slot = node->member_access.slot;
+  char msg[128];
+  if (closure_var_type(builder, depth, slot) != VAR_OBJECT) {
+    sprintf(msg, "variable is not an object: '%s'", node->member_access.object_name);
+    return closure_build_fail(node, msg);
+  }
+  AST* obj_dec = closure_find_object(builder, closure_var_object(builder, depth, slot));
+  int field = obj_dec ? closure_field_index(obj_dec, node->member_access.member_name) : -1;
+  if (field < 0) {
+    sprintf(msg, "member '%s' of object variable is not defined or does not have it: '%s'",
+                  node->member_access.member_name, node->member_access.object_name);
+    return closure_build_fail(node, msg);
+  }
+  Closure* closure = init_closure(depth == RESOLVER_FRAME ? closure_member_local : closure_member_global, node);
+  closure->slot = slot;
+  closure->index = field;
+  closure->name = node->member_access.object_name;
+  return closure;
+}
+
+static Closure* closure_build_member_assign(ClosureBuilder* builder, AST* node)
+{
+  AST* access = node->member_assign.member_access;
+  int depth = access->member_access.depth;
+  int slot = access->member_access.slot;
+  char msg[128];
+  if (closure_var_type(builder, depth, slot) != VAR_OBJECT) {
+    sprintf(msg, "variable is not an object: '%s'", access->member_access.object_name);
+    return closure_build_fail(node, msg);
+  }
+  char* object_type = closure_var_object(builder, depth, slot);
+  AST* obj_dec = closure_find_object(builder, object_type);
+  int field = obj_dec ? closure_field_index(obj_dec, access->member_access.member_name) : -1;
+  if (field < 0) {
+    sprintf(msg, "no such field '%s' in object type: '%s'", access->member_access.member_name, object_type);
+    return closure_build_fail(node, msg);
+  }
+  Closure* closure = init_closure(depth == RESOLVER_FRAME ? closure_member_assign_local : closure_member_assign_global, node);
+  closure->a = closure_build_node(builder, node->member_assign.assign_val);
+  closure->slot = slot;
+  closure->index = field;
+  closure->name = obj_dec->object_declaration.field_names[field];
+  closure->type = obj_dec->object_declaration.field_types[field];
+  closure->op = node->member_assign.op;
+  return closure;
+}
+
+static Closure* closure_build_compound(ClosureBuilder* builder, AST* node)
+{
+  Closure* closure = init_closure(closure_compound, node);
+  closure->list = calloc(node->compound.statement_size ? node->compound.statement_size : 1, sizeof(Closure*));
+  for (int i = 0; i < node->compound.statement_size; i++) {
+    AST* statement = node->compound.statements[i];
+    // declarations were taken out by the parser, noops do nothing
+    if (statement->type == AST_FUNCTION_DECLARATION || statement->type == AST_OBJECT_DECLARATION ||
+        statement->type == AST_TYPE_NOOP) continue;
+    closure->list[closure->size++] = closure_build_node(builder, statement);
+  }
+  return closure;
+}
+
+// the visitor switches to a loop's closure between two passes once it is published
+static void closure_publish_loop(LoopTier* tier, Closure* loop)
+{
+  __atomic_store_n(&tier->compiled, loop, __ATOMIC_RELEASE);
+}
+
+static Closure* closure_build_for(ClosureBuilder* builder, AST* node)
+{
+  static const ClosureRun counted[] = { closure_counted_for_lt, closure_counted_for_le, closure_counted_for_gt, closure_counted_for_ge };
+  Closure* first = node->for_block.has_first ? closure_build_node(builder, node->for_block.first) : (void*)0;
+  Closure* loop = init_closure(closure_for, node);
+  if (node->for_block.is_counted) {
+    AST* second = node->for_block.second;
+    loop->b = closure_build_node(builder, second->binary.right);
+    loop->slot = second->binary.left->variable.slot;
+    loop->val = closure_int(node->for_block.step);
+    switch (second->binary.op) {
+      case TOKEN_LT: loop->run = counted[0]; break;
+      case TOKEN_LE: loop->run = counted[1]; break;
+      case TOKEN_GT: loop->run = counted[2]; break;
+      default: loop->run = counted[3]; break;
+    }
+  } else {
+    if (node->for_block.has_second) {
+      loop->b = closure_build_test(builder, node->for_block.second, "for condition body");
+    }
+    if (node->for_block.has_third) {
+      loop->c = closure_build_node(builder, node->for_block.third);
+    }
+  }
+  loop->d = closure_build_node(builder, node->for_block.compound);
+  closure_publish_loop(&node->for_block.tier, loop);
+  if (!first) return loop;
+
+  Closure* closure = init_closure(closure_for_first, node);
+  closure->a = first;
+  closure->b = loop;
+  return closure;
+}
+
+static Closure* closure_build_node(ClosureBuilder* builder, AST* node)
+{
+  Closure* closure;
+  switch (node->type) {
+    case AST_COMPOUND: return closure_build_compound(builder, node);
+    case AST_INT:
+    case AST_FLOAT:
+    case AST_STRING:
+    case AST_BOOL:
+      closure = init_closure(closure_constant, node);
+      closure->val = value_from_ast(node);
+      return closure;
+    case AST_BINARY: return closure_build_binary(builder, node);
+    case AST_UNARY: return closure_build_unary(builder, node);
+    case AST_FUNCTION_CALL: return closure_build_call(builder, node);
+    case AST_MODULE_FUNCTION_CALL: return closure_build_module_call(builder, node);
+    case AST_VARIABLE_DECLARATION: return closure_build_declaration(builder, node);
+    case AST_VARIABLE: return closure_build_variable(builder, node);
+    case AST_VARIABLE_ASSIGN: return closure_build_assign(builder, node);
+    case AST_MEMBER_ACCESS: return closure_build_member(builder, node);
+    case AST_MEMBER_ASSIGN: return closure_build_member_assign(builder, node);
+    case AST_IF:
+      closure = init_closure(closure_if, node);
+      closure->a = closure_build_test(builder, node->if_block.cond, "if");
+      closure->b = closure_build_node(builder, node->if_block.compound);
+      if (node->if_block.got_else) {
+        closure->c = closure_build_node(builder, node->if_block.else_block);
+      }
+      return closure;
+    case AST_ELSE: return closure_build_node(builder, node->else_block.compound);
+    case AST_WHILE:
+      closure = init_closure(closure_while, node);
+      closure->a = closure_build_test(builder, node->while_block.cond, "while");
+      closure->b = closure_build_node(builder, node->while_block.compound);
+      closure_publish_loop(&node->while_block.tier, closure);
+      return closure;
+    case AST_FOR: return closure_build_for(builder, node);
+    case AST_RETURN:
+      closure = init_closure(closure_return, node);
+      if (!node->return_expr.is_empty_return) {
+        closure->a = closure_build_node(builder, node->return_expr.expr);
+      }
+      return closure;
+    case AST_SKIP: return init_closure(closure_skip, node);
+    case AST_STOP: return init_closure(closure_stop, node);
+    case AST_INCLUDE: return init_closure(closure_include, node);
+    default:
+      closure = init_closure(closure_constant, node);
+      closure->val = value_noop();
+      return closure;
+  }
+}
+
+static ValueType closure_return_type(AST* f)
+{
+  if (!f->function_declaration.has_return) return VALUE_NOOP;
+  switch (f->function_declaration.return_type) {
+    case VAR_INT: return VALUE_INT;
+    case VAR_FLOAT: return VALUE_FLOAT;
+    case VAR_STRING: return VALUE_STRING;
+    case VAR_BOOL: return VALUE_BOOL;
+    // no value matches, so every return is an error like in the visitor
+    default: return VALUE_UNDEFINED;
+  }
+}
+
+static void closure_build_frame(ClosureBuilder* builder, size_t frame_size)
+{
+  free(builder->local_types);
+  free(builder->local_objects);
+  builder->local_types = calloc(frame_size ? frame_size : 1, sizeof(VariableType));
+  builder->local_objects = calloc(frame_size ? frame_size : 1, sizeof(char*));
+}
+
+void closure_build_function(ClosureBuilder* builder, int function)
+{
+  AST* f = builder->functions[function].declaration;
+  closure_build_frame(builder, f->function_declaration.frame_size);
+  for (int i = 0; i < f->function_declaration.arg_size; i++) {
+    builder->local_types[i] = f->function_declaration.arg_types[i];
+    builder->local_objects[i] = f->function_declaration.args[i]->variable.object_type_name;
+  }
+  Closure* body = closure_build_node(builder, f->function_declaration.compound);
+  __atomic_store_n(&builder->functions[function].body, body, __ATOMIC_RELEASE);
+}
+
+Closure* closure_build_top(ClosureBuilder* builder)
+{
+  closure_build_frame(builder, builder->resolver->frame_size);
+  return closure_build_node(builder, builder->root);
+}
+
+Closure* closure_build(ClosureBuilder* builder)
+{
+  for (int i = 0; i < builder->parser->function_size; i++) {
+    closure_build_function(builder, i);
+  }
+  return closure_build_top(builder);
+}
+
+void closure_attach(Visitor* visitor)
+{
+  // closures keep pointers to their frame across calls, the stack only grows in place from here
+  visitor_fix_stack(visitor, CLOSURE_STACK_SIZE);
+  closure_visitor = visitor;
+}
+
+Value closure_enter(Closure* closure)
+{
+  return closure->run(closure, closure_visitor->stack + closure_visitor->frame);
+}
@@ -0,0 +1,988 @@
+#include "inc/compiler.h"
+#include "inc/builtin.h"
+#include <stdio.h>
+
+Compiler* init_compiler(Parser* parser)
+{
+  Compiler* compiler = calloc(1, sizeof(Compiler));
+
+  compiler->program = init_program();
+  compiler->program->object_declarations = parser->object_declarations;
+  compiler->program->object_size = parser->object_size;
+  compiler->function_declarations = parser->function_declarations;
+  compiler->function_size = parser->function_size;
+  compiler->function_table = parser->function_table;
+  compiler->globals = (void*)0;
+  compiler->global_size = 0;
+  compiler->function = (void*)0;
+  compiler->locals = (void*)0;
+  compiler->local_size = 0;
+  compiler->depth = 0;
+  compiler->reg_top = 0;
+  compiler->loop = (void*)0;
+
+  return compiler;
+}
+
+static int compiler_error(char* msg)
+{
+  printf("Compiler-> Error: %s\n", msg);
+  exit(1);
+  return -1;
+}
+
+static int compiler_expr(Compiler* compiler, AST* node, int dst);
+static void compiler_statement(Compiler* compiler, AST* node);
+
+static int compiler_alloc_reg(Compiler* compiler)
+{
+  int reg = compiler->reg_top++;
+  if (compiler->reg_top > compiler->function->reg_size) {
+    compiler->function->reg_size = compiler->reg_top;
+  }
+  return reg;
+}
+
+static int compiler_target(Compiler* compiler, int dst)
+{
+  return dst >= 0 ? dst : compiler_alloc_reg(compiler);
+}
+
+static int compiler_emit(Compiler* compiler, Opcode op, int a, int b, int c)
+{
+  return function_emit(compiler->function, op, a, b, c);
+}
+
+static void compiler_patch(Compiler* compiler, int at, int target)
+{
+  Instr* instr = &compiler->function->code[at];
+  if (instr->op == OP_JMP) {
+    instr->a = target;
+  } else if (instr->op >= OP_IFEQI && instr->op <= OP_IFLEF) {
+    instr->c = target;
+  } else {
+    instr->b = target;
+  }
+}
+
+static int compiler_name_const(Compiler* compiler, char* name)
+{
+  return function_add_const(compiler->function, value_string(name));
+}
+
+static int compiler_locals_top(Compiler* compiler)
+{
+  return compiler->local_size ? compiler->locals[compiler->local_size - 1].reg + 1 : 0;
+}
+
+static bool compiler_is_global_scope(Compiler* compiler)
+{
+  return compiler->function == compiler->program->main && compiler->depth == 0;
+}
+
+static Local* compiler_find_local(Compiler* compiler, char* name)
+{
+  for (int i = compiler->local_size - 1; i >= 0; i--) {
+    if (compiler->locals[i].name == name) {
+      return &compiler->locals[i];
+    }
+  }
+  return (void*)0;
+}
+
+static int compiler_find_global(Compiler* compiler, char* name)
+{
+  bool is_main = compiler->function == compiler->program->main;
+  for (int i = 0; i < compiler->global_size; i++) {
+    // top level code sees globals in declaration order, functions see them all
+    if (is_main && !compiler->globals[i].is_declared) continue;
+    if (compiler->globals[i].name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static AST* compiler_find_object_declaration(Compiler* compiler, char* name, int* index)
+{
+  for (int i = 0; i < compiler->program->object_size; i++) {
+    AST* obj_dec = compiler->program->object_declarations[i];
+    if (obj_dec->object_declaration.name == name) {
+      if (index) *index = i;
+      return obj_dec;
+    }
+  }
+  char msg[128]; sprintf(msg, "object type '%s' is not declared", name);
+  compiler_error(msg);
+  return (void*)0;
+}
+
+static void compiler_add_local(Compiler* compiler, char* name, int reg, VariableType type, AST* object_declaration, bool maybe_undefined)
+{
+  compiler->local_size++;
+  compiler->locals = realloc(compiler->locals, compiler->local_size * sizeof(Local));
+  compiler->locals[compiler->local_size - 1] = (Local) {
+    name, reg, compiler->depth, type, object_declaration, maybe_undefined
+  };
+}
+
+static void compiler_begin_block(Compiler* compiler)
+{
+  compiler->depth++;
+}
+
+static void compiler_end_block(Compiler* compiler)
+{
+  while (compiler->local_size && compiler->locals[compiler->local_size - 1].depth == compiler->depth) {
+    compiler->local_size--;
+  }
+  compiler->depth--;
+  compiler->reg_top = compiler_locals_top(compiler);
+}
+
+static Opcode compiler_binary_op(_TokenType op)
+{
+  switch (op) {
+    case TOKEN_PLUS: case TOKEN_PLUSEQ: return OP_ADD;
+    case TOKEN_MINUS: case TOKEN_MINUSEQ: return OP_SUB;
+    case TOKEN_MUL: case TOKEN_MULEQ: return OP_MUL;
+    case TOKEN_DIV: case TOKEN_DIVEQ: return OP_DIV;
+    case TOKEN_MOD: case TOKEN_MODEQ: return OP_MOD;
+    case TOKEN_EQ: return OP_EQ;
+    case TOKEN_NE: return OP_NE;
+    case TOKEN_GT: return OP_GT;
+    case TOKEN_GE: return OP_GE;
+    case TOKEN_LT: return OP_LT;
+    case TOKEN_LE: return OP_LE;
+    case TOKEN_AND: return OP_AND;
+    case TOKEN_OR: return OP_OR;
+    default: {
+      char msg[64]; sprintf(msg, "unexpected binary operator: '%s'", token_name(op));
+      return compiler_error(msg);
+    }
+  }
+}
+
+static ExprType compiler_var_type(VariableType type)
+{
+  switch (type) {
+    case VAR_INT: return TYPE_INT;
+    case VAR_FLOAT: return TYPE_FLOAT;
+    case VAR_STRING: return TYPE_STRING;
+    case VAR_BOOL: return TYPE_BOOL;
+    default: return TYPE_UNKNOWN;
+  }
+}
+
+// arithmetic and comparisons on operands the checker proved to be both int
+// or both float skip the VM's type tests
+static Opcode compiler_typed_op(Opcode op, ExprType left, ExprType right)
+{
+  if (op < OP_ADD || op > OP_LE) return op;
+  if (left == TYPE_INT && right == TYPE_INT) {
+    return OP_ADDI + (op - OP_ADD);
+  }
+  if (left == TYPE_FLOAT && right == TYPE_FLOAT) {
+    switch (op) {
+      case OP_ADD: return OP_ADDF;
+      case OP_SUB: return OP_SUBF;
+      case OP_MUL: return OP_MULF;
+      case OP_DIV: return OP_DIVF;
+      case OP_EQ: return OP_EQF;
+      case OP_NE: return OP_NEF;
+      case OP_GT: return OP_GTF;
+      case OP_GE: return OP_GEF;
+      case OP_LT: return OP_LTF;
+      case OP_LE: return OP_LEF;
+      default: break;
+    }
+  }
+  return op;
+}
+
+// static type of left op right for the arithmetic ops compound assignment uses
+static ExprType compiler_arith_type(ExprType left, ExprType right)
+{
+  if (left == TYPE_INT && right == TYPE_INT) return TYPE_INT;
+  if ((left == TYPE_INT || left == TYPE_FLOAT) && (right == TYPE_INT || right == TYPE_FLOAT)) return TYPE_FLOAT;
+  return TYPE_UNKNOWN;
+}
+
+// stores src into dst, converting or checking it against the variable type
+// unless the checker already proved src has exactly that type
+static void compiler_store_typed(Compiler* compiler, int dst, int src, ExprType src_type, VariableType type, AST* object_declaration, char* name)
+{
+  if (src_type != TYPE_UNKNOWN && src_type == compiler_var_type(type)) {
+    if (dst != src) {
+      compiler_emit(compiler, OP_MOVE, dst, src, 0);
+    }
+    return;
+  }
+  switch (type) {
+    case VAR_INT:
+      compiler_emit(compiler, OP_CONV_INT, dst, src, compiler_name_const(compiler, name));
+      break;
+    case VAR_FLOAT:
+      compiler_emit(compiler, OP_CONV_FLOAT, dst, src, compiler_name_const(compiler, name));
+      break;
+    case VAR_STRING:
+      compiler_emit(compiler, OP_CHECK_STRING, dst, src, compiler_name_const(compiler, name));
+      break;
+    case VAR_BOOL:
+      compiler_emit(compiler, OP_CHECK_BOOL, dst, src, compiler_name_const(compiler, name));
+      break;
+    case VAR_OBJECT: {
+      int index;
+      compiler_find_object_declaration(compiler, object_declaration->object_declaration.name, &index);
+      compiler_emit(compiler, OP_CHECK_OBJECT, dst, src, index);
+      break;
+    }
+  }
+}
+
+static void compiler_check_compound_op(_TokenType op, VariableType type)
+{
+  if (op == TOKEN_ASSIGN) return;
+  if (type == VAR_STRING) {
+    compiler_error("strings can only get = operator");
+  } else if (type == VAR_BOOL) {
+    compiler_error("bools can only get = operator");
+  } else if (type == VAR_OBJECT) {
+    compiler_error("objects cannot be assigned");
+  }
+}
+
+static int compiler_variable(Compiler* compiler, AST* node, int dst)
+{
+  char* name = node->variable.name;
+  Local* local = compiler_find_local(compiler, name);
+  if (local) {
+    if (local->maybe_undefined) {
+      compiler_emit(compiler, OP_TESTDEF, local->reg, compiler_name_const(compiler, name), 0);
+    }
+    if (dst >= 0 && dst != local->reg) {
+      compiler_emit(compiler, OP_MOVE, dst, local->reg, 0);
+      return dst;
+    }
+    return local->reg;
+  }
+  int global = compiler_find_global(compiler, name);
+  if (global >= 0) {
+    int reg = compiler_target(compiler, dst);
+    compiler_emit(compiler, OP_GETGLOBAL, reg, global, compiler_name_const(compiler, name));
+    return reg;
+  }
+
+  char msg[64]; sprintf(msg, "use of undeclared variable: '%s'", name);
+  return compiler_error(msg);
+}
+
+static int compiler_variable_assign(Compiler* compiler, AST* node, int dst)
+{
+  char* name = node->variable_assign.name;
+  _TokenType op = node->variable_assign.op;
+  Local* local = compiler_find_local(compiler, name);
+  int global = local ? -1 : compiler_find_global(compiler, name);
+  if (!local && global < 0) {
+    char msg[64]; sprintf(msg, "use of undeclared variable: '%s'", name);
+    return compiler_error(msg);
+  }
+  VariableType type = local ? local->type : compiler->globals[global].type;
+  compiler_check_compound_op(op, type);
+
+  int save = compiler->reg_top;
+  int val = compiler_expr(compiler, node->variable_assign.assign_val, -1);
+  ExprType val_type = node->variable_assign.assign_val->expr_type;
+  if (op != TOKEN_ASSIGN) {
+    AST var = { .type = AST_VARIABLE, .variable.name = name };
+    int cur = compiler_variable(compiler, &var, -1);
+    int reg = compiler_alloc_reg(compiler);
+    compiler_emit(compiler, compiler_typed_op(compiler_binary_op(op), compiler_var_type(type), val_type), reg, cur, val);
+    val = reg;
+    val_type = compiler_arith_type(compiler_var_type(type), val_type);
+  }
+
+  if (local) {
+    compiler_store_typed(compiler, local->reg, val, val_type, type, local->object_declaration, name);
+    compiler->reg_top = save;
+    if (dst >= 0 && dst != local->reg) {
+      compiler_emit(compiler, OP_MOVE, dst, local->reg, 0);
+      return dst;
+    }
+    return local->reg;
+  }
+
+  compiler->reg_top = save;
+  int reg = compiler_target(compiler, dst);
+  compiler_store_typed(compiler, reg, val, val_type, type, compiler->globals[global].object_declaration, name);
+  // top level code only sees globals already declared, functions may run before
+  bool is_main = compiler->function == compiler->program->main;
+  compiler_emit(compiler, OP_SETGLOBAL, reg, global, is_main ? -1 : compiler_name_const(compiler, name));
+  return reg;
+}
+
+// resolves the object variable of a member access and returns its field index
+static int compiler_member(Compiler* compiler, AST* member_access, int* obj_reg, VariableType* field_type)
+{
+  char* object_name = member_access->member_access.object_name;
+  char* member_name = member_access->member_access.member_name;
+
+  AST var = { .type = AST_VARIABLE, .variable.name = object_name };
+  Local* local = compiler_find_local(compiler, object_name);
+  int global = local ? -1 : compiler_find_global(compiler, object_name);
+  if (!local && global < 0) {
+    char msg[128]; sprintf(msg, "use of undeclared object variable: '%s'", object_name);
+    return compiler_error(msg);
+  }
+  VariableType type = local ? local->type : compiler->globals[global].type;
+  AST* obj_dec = local ? local->object_declaration : compiler->globals[global].object_declaration;
+  if (type != VAR_OBJECT) {
+    char msg[96]; sprintf(msg, "variable is not an object: '%s'", object_name);
+    return compiler_error(msg);
+  }
+  *obj_reg = compiler_variable(compiler, &var, -1);
+
+  for (int i = 0; i < obj_dec->object_declaration.field_size; i++) {
+    if (obj_dec->object_declaration.field_names[i] == member_name) {
+      *field_type = obj_dec->object_declaration.field_types[i];
+      return i;
+    }
+  }
+  char msg[128];
+  sprintf(msg, "no such field '%s' in object type: '%s'", member_name, obj_dec->object_declaration.name);
+  return compiler_error(msg);
+}
+
+static void compiler_get_field(Compiler* compiler, int dst, int obj, int field, char* object_name)
+{
+  int name = compiler_name_const(compiler, object_name);
+  if (field >= FIELD_MAX || name >= FIELD_NAME_MAX) {
+    compiler_error("too many fields or constants to read a field");
+  }
+  compiler_emit(compiler, OP_GETFIELD, dst, obj, FIELD_OPERAND(field, name));
+}
+
+static int compiler_member_access(Compiler* compiler, AST* node, int dst)
+{
+  int save = compiler->reg_top;
+  int obj;
+  VariableType field_type;
+  int field = compiler_member(compiler, node, &obj, &field_type);
+  compiler->reg_top = save;
+  int reg = compiler_target(compiler, dst);
+  compiler_get_field(compiler, reg, obj, field, node->member_access.object_name);
+  return reg;
+}
+
+static int compiler_member_assign(Compiler* compiler, AST* node, int dst)
+{
+  AST* member_access = node->member_assign.member_access;
+  _TokenType op = node->member_assign.op;
+
+  int save = compiler->reg_top;
+  int obj;
+  VariableType field_type;
+  int field = compiler_member(compiler, member_access, &obj, &field_type);
+  compiler_check_compound_op(op, field_type);
+
+  int val = compiler_expr(compiler, node->member_assign.assign_val, -1);
+  ExprType val_type = node->member_assign.assign_val->expr_type;
+  if (op != TOKEN_ASSIGN) {
+    int cur = compiler_alloc_reg(compiler);
+    compiler_get_field(compiler, cur, obj, field, member_access->member_access.object_name);
+    compiler_emit(compiler, compiler_typed_op(compiler_binary_op(op), compiler_var_type(field_type), val_type), cur, cur, val);
+    val = cur;
+    val_type = compiler_arith_type(compiler_var_type(field_type), val_type);
+  }
+  int reg = compiler_alloc_reg(compiler);
+  compiler_store_typed(compiler, reg, val, val_type, field_type, (void*)0, member_access->member_access.member_name);
+  compiler_emit(compiler, OP_SETFIELD, obj, field, reg);
+
+  compiler->reg_top = save;
+  int res = compiler_target(compiler, dst);
+  if (res != reg) {
+    compiler_emit(compiler, OP_MOVE, res, reg, 0);
+  }
+  return res;
+}
+
+// evaluates args into consecutive registers starting at the returned base
+static int compiler_args(Compiler* compiler, AST** args, size_t arg_size)
+{
+  int base = compiler->reg_top;
+  for (int i = 0; i < arg_size; i++) {
+    compiler->reg_top = base + i;
+    int reg = compiler_alloc_reg(compiler);
+    compiler_expr(compiler, args[i], reg);
+  }
+  compiler->reg_top = base;
+  if (arg_size == 0) {
+    compiler_alloc_reg(compiler);
+    compiler->reg_top = base;
+  }
+  return base;
+}
+
+static int compiler_call_result(Compiler* compiler, int base, int dst)
+{
+  compiler->reg_top = base;
+  int reg = compiler_target(compiler, dst);
+  if (reg != base) {
+    compiler_emit(compiler, OP_MOVE, reg, base, 0);
+  }
+  return reg;
+}
+
+static int compiler_function_call(Compiler* compiler, AST* node, int dst)
+{
+  char* name = node->function_call.name;
+  size_t arg_size = node->function_call.arg_size;
+
+  int builtin = builtin_find(name);
+  if (builtin >= 0) {
+    int base = compiler_args(compiler, node->function_call.args, arg_size);
+    compiler_emit(compiler, OP_BUILTIN, base, builtin, arg_size);
+    return compiler_call_result(compiler, base, dst);
+  }
+
+  int index = table_get(compiler->function_table, name);
+  if (index < 0) {
+    char msg[64]; sprintf(msg, "call to undeclared function named: '%s'", name);
+    return compiler_error(msg);
+  }
+  AST* f = compiler->function_declarations[index];
+  if (f->function_declaration.arg_size != arg_size) {
+    char msg[128];
+    sprintf(msg, "function %s: expected %lu arg(s), but got %lu",
+            f->function_declaration.name,
+            f->function_declaration.arg_size,
+            arg_size);
+    return compiler_error(msg);
+  }
+
+  int base = compiler_args(compiler, node->function_call.args, arg_size);
+  compiler_emit(compiler, OP_CALL, base, index, arg_size);
+  return compiler_call_result(compiler, base, dst);
+}
+
+static int compiler_module_function_call(Compiler* compiler, AST* node, int dst)
+{
+  Program* program = compiler->program;
+  program->module_call_size++;
+  program->module_calls = realloc(program->module_calls, program->module_call_size * sizeof(AST*));
+  program->module_calls[program->module_call_size - 1] = node;
+
+  AST* f_call = node->module_function_call.func;
+  int base = compiler_args(compiler, f_call->function_call.args, f_call->function_call.arg_size);
+  compiler_emit(compiler, OP_MODCALL, base, program->module_call_size - 1, f_call->function_call.arg_size);
+  return compiler_call_result(compiler, base, dst);
+}
+
+// the right side only runs when the left one is not a bool that already
+// decides the result, anything else still goes through OP_AND/OP_OR
+static int compiler_logical(Compiler* compiler, AST* node, int dst)
+{
+  int save = compiler->reg_top;
+  int reg = compiler_alloc_reg(compiler);
+  compiler_expr(compiler, node->binary.left, reg);
+  bool is_and = node->binary.op == TOKEN_AND;
+  int jump = compiler_emit(compiler, is_and ? OP_ANDJMP : OP_ORJMP, reg, -1, 0);
+  int right = compiler_expr(compiler, node->binary.right, -1);
+  compiler_emit(compiler, is_and ? OP_AND : OP_OR, reg, reg, right);
+  compiler_patch(compiler, jump, compiler->function->code_size);
+  compiler->reg_top = save + 1;
+  if (dst >= 0) {
+    compiler_emit(compiler, OP_MOVE, dst, reg, 0);
+    compiler->reg_top = save;
+    return dst;
+  }
+  return reg;
+}
+
+static int compiler_expr(Compiler* compiler, AST* node, int dst)
+{
+  switch (node->type) {
+    case AST_INT: {
+      int reg = compiler_target(compiler, dst);
+      compiler_emit(compiler, OP_LOADK, reg, function_add_const(compiler->function, value_int(node->integer.val)), 0);
+      return reg;
+    }
+    case AST_FLOAT: {
+      int reg = compiler_target(compiler, dst);
+      compiler_emit(compiler, OP_LOADK, reg, function_add_const(compiler->function, value_float(node->floating.val)), 0);
+      return reg;
+    }
+    case AST_STRING: {
+      int reg = compiler_target(compiler, dst);
+      compiler_emit(compiler, OP_LOADK, reg, function_add_const(compiler->function, value_string(node->string.val)), 0);
+      return reg;
+    }
+    case AST_BOOL: {
+      int reg = compiler_target(compiler, dst);
+      compiler_emit(compiler, OP_LOADK, reg, function_add_const(compiler->function, value_bool(node->boolean.val)), 0);
+      return reg;
+    }
+    case AST_BINARY: {
+      if (node->binary.op == TOKEN_AND || node->binary.op == TOKEN_OR) {
+        return compiler_logical(compiler, node, dst);
+      }
+      int save = compiler->reg_top;
+      int left = compiler_expr(compiler, node->binary.left, -1);
+      int right = compiler_expr(compiler, node->binary.right, -1);
+      compiler->reg_top = save;
+      int reg = compiler_target(compiler, dst);
+      compiler_emit(compiler, compiler_typed_op(compiler_binary_op(node->binary.op),
+                                                node->binary.left->expr_type, node->binary.right->expr_type), reg, left, right);
+      return reg;
+    }
+    case AST_UNARY: {
+      int save = compiler->reg_top;
+      int expr = compiler_expr(compiler, node->unary.expr, -1);
+      compiler->reg_top = save;
+      int reg = compiler_target(compiler, dst);
+      compiler_emit(compiler, node->unary.op == TOKEN_MINUS ? OP_NEG : OP_NOT, reg, expr, 0);
+      return reg;
+    }
+    case AST_VARIABLE: return compiler_variable(compiler, node, dst);
+    case AST_VARIABLE_ASSIGN: return compiler_variable_assign(compiler, node, dst);
+    case AST_FUNCTION_CALL: return compiler_function_call(compiler, node, dst);
+    case AST_MODULE_FUNCTION_CALL: return compiler_module_function_call(compiler, node, dst);
+    case AST_MEMBER_ACCESS: return compiler_member_access(compiler, node, dst);
+    case AST_MEMBER_ASSIGN: return compiler_member_assign(compiler, node, dst);
+    default: {
+      char msg[64]; sprintf(msg, "unexpected node in expression: '%s'", ast_name(node->type));
+      return compiler_error(msg);
+    }
+  }
+}
+
+static void compiler_declare_global(Compiler* compiler, char* name, VariableType type, AST* object_declaration)
+{
+  for (int i = 0; i < compiler->global_size; i++) {
+    if (compiler->globals[i].name == name) return;
+  }
+  compiler->global_size++;
+  compiler->globals = realloc(compiler->globals, compiler->global_size * sizeof(Global));
+  compiler->globals[compiler->global_size - 1] = (Global) { name, type, object_declaration, false };
+}
+
+static bool compiler_is_declared_in_scope(Compiler* compiler, char* name)
+{
+  if (compiler_is_global_scope(compiler)) {
+    int global = compiler_find_global(compiler, name);
+    return global >= 0;
+  }
+  for (int i = compiler->local_size - 1; i >= 0 && compiler->locals[i].depth == compiler->depth; i--) {
+    if (compiler->locals[i].name == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void compiler_variable_declaration(Compiler* compiler, AST* node)
+{
+  VariableType type = node->variable_declaration.type;
+  for (int i = 0; i < node->variable_declaration.size; i++) {
+    char* name = node->variable_declaration.names[i];
+    if (compiler_is_declared_in_scope(compiler, name)) {
+      char msg[64]; sprintf(msg, "variable '%s' has already been declared", name);
+      compiler_error(msg);
+    }
+
+    int obj_index = -1;
+    AST* obj_dec = type == VAR_OBJECT
+      ? compiler_find_object_declaration(compiler, node->variable_declaration.object_type, &obj_index)
+      : (void*)0;
+    bool is_defined = type == VAR_OBJECT || node->variable_declaration.is_defined[i];
+
+    if (compiler_is_global_scope(compiler)) {
+      int global;
+      for (global = 0; compiler->globals[global].name != name; global++);
+      int reg = compiler_alloc_reg(compiler);
+      if (type == VAR_OBJECT) {
+        compiler_emit(compiler, OP_NEWOBJ, reg, obj_index, 0);
+      } else if (is_defined) {
+        int val = compiler_expr(compiler, node->variable_declaration.values[i], -1);
+        compiler_store_typed(compiler, reg, val, node->variable_declaration.values[i]->expr_type, type, obj_dec, name);
+      } else {
+        // declared without a value, no longer undeclared
+        compiler_emit(compiler, OP_UNDEF, reg, 0, 0);
+      }
+      compiler_emit(compiler, OP_SETGLOBAL, reg, global, -1);
+      compiler->globals[global].is_declared = true;
+      compiler->reg_top = compiler_locals_top(compiler);
+      continue;
+    }
+
+    int reg = compiler_alloc_reg(compiler);
+    if (type == VAR_OBJECT) {
+      compiler_emit(compiler, OP_NEWOBJ, reg, obj_index, 0);
+    } else if (is_defined) {
+      int val = compiler_expr(compiler, node->variable_declaration.values[i], -1);
+      compiler_store_typed(compiler, reg, val, node->variable_declaration.values[i]->expr_type, type, obj_dec, name);
+    } else {
+      compiler_emit(compiler, OP_UNDEF, reg, 0, 0);
+    }
+    compiler->reg_top = reg + 1;
+    compiler_add_local(compiler, name, reg, type, obj_dec, !is_defined);
+  }
+}
+
+static void compiler_statements(Compiler* compiler, AST* compound)
+{
+  for (int i = 0; i < compound->compound.statement_size; i++) {
+    compiler_statement(compiler, compound->compound.statements[i]);
+  }
+}
+
+static void compiler_block(Compiler* compiler, AST* compound)
+{
+  compiler_begin_block(compiler);
+  compiler_statements(compiler, compound);
+  compiler_end_block(compiler);
+}
+
+static bool compiler_is_true(AST* node)
+{
+  return node->type == AST_BOOL && node->boolean.val;
+}
+
+static void compiler_add_jump(JumpList* jumps, int at)
+{
+  jumps->size++;
+  jumps->at = realloc(jumps->at, jumps->size * sizeof(int));
+  jumps->at[jumps->size - 1] = at;
+}
+
+static void compiler_patch_jumps(Compiler* compiler, JumpList* jumps, int target)
+{
+  for (int i = 0; i < jumps->size; i++) {
+    compiler_patch(compiler, jumps->at[i], target);
+  }
+  free(jumps->at);
+}
+
+// comparison of two proven ints or floats as a single compare-and-branch,
+// OP_HALT when the condition has to be built as a value first
+static Opcode compiler_branch_op(AST* cond)
+{
+  if (cond->type != AST_BINARY) return OP_HALT;
+  Opcode op = compiler_binary_op(cond->binary.op);
+  if (op < OP_EQ || op > OP_LE) return OP_HALT;
+  ExprType left = cond->binary.left->expr_type, right = cond->binary.right->expr_type;
+  if (left == TYPE_INT && right == TYPE_INT) return OP_IFEQI + (op - OP_EQ);
+  if (left == TYPE_FLOAT && right == TYPE_FLOAT) return OP_IFEQF + (op - OP_EQ);
+  return OP_HALT;
+}
+
+static bool compiler_is_bool_logic(AST* cond, _TokenType op)
+{
+  return cond->type == AST_BINARY && cond->binary.op == op &&
+         cond->binary.left->expr_type == TYPE_BOOL && cond->binary.right->expr_type == TYPE_BOOL;
+}
+
+// falls through when cond holds, the jumps added go to the false branch;
+// comparisons never build a bool and and/or stop once the result is known
+static void compiler_branch_false(Compiler* compiler, AST* cond, CondKind kind, JumpList* jumps)
+{
+  if (compiler_is_bool_logic(cond, TOKEN_AND)) {
+    compiler_branch_false(compiler, cond->binary.left, kind, jumps);
+    compiler_branch_false(compiler, cond->binary.right, kind, jumps);
+    return;
+  }
+  if (compiler_is_bool_logic(cond, TOKEN_OR)) {
+    int left = compiler_expr(compiler, cond->binary.left, -1);
+    compiler->reg_top = compiler_locals_top(compiler);
+    int jump_true = compiler_emit(compiler, OP_ORJMP, left, -1, 0);
+    compiler_branch_false(compiler, cond->binary.right, kind, jumps);
+    compiler_patch(compiler, jump_true, compiler->function->code_size);
+    return;
+  }
+  Opcode branch = compiler_branch_op(cond);
+  if (branch != OP_HALT) {
+    int left = compiler_expr(compiler, cond->binary.left, -1);
+    int right = compiler_expr(compiler, cond->binary.right, -1);
+    compiler->reg_top = compiler_locals_top(compiler);
+    compiler_add_jump(jumps, compiler_emit(compiler, branch, left, right, -1));
+    return;
+  }
+  int reg = compiler_expr(compiler, cond, -1);
+  compiler->reg_top = compiler_locals_top(compiler);
+  compiler_add_jump(jumps, compiler_emit(compiler, OP_JMPF, reg, -1, kind));
+}
+
+static void compiler_if(Compiler* compiler, AST* node)
+{
+  // the optimizer leaves a literal true where the branch is always taken
+  if (compiler_is_true(node->if_block.cond) && !node->if_block.got_else) {
+    compiler_block(compiler, node->if_block.compound);
+    return;
+  }
+  JumpList jump_false = { (void*)0, 0 };
+  compiler_branch_false(compiler, node->if_block.cond, COND_IF, &jump_false);
+  compiler_block(compiler, node->if_block.compound);
+
+  if (!node->if_block.got_else) {
+    compiler_patch_jumps(compiler, &jump_false, compiler->function->code_size);
+    return;
+  }
+  int jump_end = compiler_emit(compiler, OP_JMP, -1, 0, 0);
+  compiler_patch_jumps(compiler, &jump_false, compiler->function->code_size);
+  AST* else_block = node->if_block.else_block;
+  if (else_block->type == AST_IF) {
+    compiler_if(compiler, else_block);
+  } else {
+    compiler_block(compiler, else_block->else_block.compound);
+  }
+  compiler_patch(compiler, jump_end, compiler->function->code_size);
+}
+
+static void compiler_begin_loop(Compiler* compiler, Loop* loop)
+{
+  loop->stops = (void*)0;
+  loop->stop_size = 0;
+  loop->skips = (void*)0;
+  loop->skip_size = 0;
+  loop->prev = compiler->loop;
+  compiler->loop = loop;
+}
+
+static void compiler_end_loop(Compiler* compiler, int skip_target, int stop_target)
+{
+  Loop* loop = compiler->loop;
+  for (int i = 0; i < loop->skip_size; i++) {
+    compiler_patch(compiler, loop->skips[i], skip_target);
+  }
+  for (int i = 0; i < loop->stop_size; i++) {
+    compiler_patch(compiler, loop->stops[i], stop_target);
+  }
+  free(loop->skips);
+  free(loop->stops);
+  compiler->loop = loop->prev;
+}
+
+static void compiler_while(Compiler* compiler, AST* node)
+{
+  Loop loop;
+  compiler_begin_loop(compiler, &loop);
+
+  int start = compiler->function->code_size;
+  JumpList jump_false = { (void*)0, 0 };
+  if (!compiler_is_true(node->while_block.cond)) {
+    compiler_branch_false(compiler, node->while_block.cond, COND_WHILE, &jump_false);
+  }
+  compiler_block(compiler, node->while_block.compound);
+  compiler_emit(compiler, OP_JMP, start, 0, 0);
+  compiler_patch_jumps(compiler, &jump_false, compiler->function->code_size);
+
+  compiler_end_loop(compiler, start, compiler->function->code_size);
+}
+
+static Opcode compiler_forloop_op(_TokenType op)
+{
+  switch (op) {
+    case TOKEN_LT: return OP_FORLT;
+    case TOKEN_LE: return OP_FORLE;
+    case TOKEN_GT: return OP_FORGT;
+    default: return OP_FORGE;
+  }
+}
+
+// the bound and step live in two hidden registers after the counter, one
+// OP_FORLT..OP_FORGE at the bottom steps the counter and jumps back
+static void compiler_counted_for(Compiler* compiler, AST* node)
+{
+  compiler_begin_block(compiler);
+  compiler_statement(compiler, node->for_block.first);
+  int counter = compiler_find_local(compiler, node->for_block.first->variable_declaration.names[0])->reg;
+
+  AST* second = node->for_block.second;
+  int bound = compiler_alloc_reg(compiler);
+  compiler_expr(compiler, second->binary.right, bound);
+  compiler_add_local(compiler, (void*)0, bound, VAR_INT, (void*)0, false);
+  int step = compiler_alloc_reg(compiler);
+  compiler_emit(compiler, OP_LOADK, step, function_add_const(compiler->function, value_int(node->for_block.step)), 0);
+  compiler_add_local(compiler, (void*)0, step, VAR_INT, (void*)0, false);
+
+  Loop loop;
+  compiler_begin_loop(compiler, &loop);
+
+  int jump_false = compiler_emit(compiler, compiler_branch_op(second), counter, bound, -1);
+  int start = compiler->function->code_size;
+  compiler_block(compiler, node->for_block.compound);
+  int next = compiler_emit(compiler, compiler_forloop_op(second->binary.op), counter, bound, start);
+  compiler_patch(compiler, jump_false, compiler->function->code_size);
+
+  compiler_end_loop(compiler, next, compiler->function->code_size);
+  compiler_end_block(compiler);
+}
+
+static void compiler_for(Compiler* compiler, AST* node)
+{
+  if (node->for_block.is_counted) {
+    compiler_counted_for(compiler, node);
+    return;
+  }
+  compiler_begin_block(compiler);
+  if (node->for_block.has_first) {
+    compiler_statement(compiler, node->for_block.first);
+  }
+
+  Loop loop;
+  compiler_begin_loop(compiler, &loop);
+
+  int start = compiler->function->code_size;
+  JumpList jump_false = { (void*)0, 0 };
+  if (node->for_block.has_second) {
+    compiler_branch_false(compiler, node->for_block.second, COND_FOR, &jump_false);
+  }
+  compiler_block(compiler, node->for_block.compound);
+  int next = compiler->function->code_size;
+  if (node->for_block.has_third) {
+    compiler_expr(compiler, node->for_block.third, -1);
+    compiler->reg_top = compiler_locals_top(compiler);
+  }
+  compiler_emit(compiler, OP_JMP, start, 0, 0);
+  compiler_patch_jumps(compiler, &jump_false, compiler->function->code_size);
+
+  compiler_end_loop(compiler, next, compiler->function->code_size);
+  compiler_end_block(compiler);
+}
+
+static void compiler_jump_out(Compiler* compiler, AST* node)
+{
+  Loop* loop = compiler->loop;
+  int at = compiler_emit(compiler, OP_JMP, -1, 0, 0);
+  if (node->type == AST_SKIP) {
+    loop->skip_size++;
+    loop->skips = realloc(loop->skips, loop->skip_size * sizeof(int));
+    loop->skips[loop->skip_size - 1] = at;
+  } else {
+    loop->stop_size++;
+    loop->stops = realloc(loop->stops, loop->stop_size * sizeof(int));
+    loop->stops[loop->stop_size - 1] = at;
+  }
+}
+
+static void compiler_include(Compiler* compiler, AST* node)
+{
+  Program* program = compiler->program;
+  program->include_size++;
+  program->includes = realloc(program->includes, program->include_size * sizeof(AST*));
+  program->includes[program->include_size - 1] = node;
+  compiler_emit(compiler, OP_INCLUDE, program->include_size - 1, 0, 0);
+}
+
+static void compiler_statement(Compiler* compiler, AST* node)
+{
+  switch (node->type) {
+    case AST_TYPE_NOOP:
+      break;
+    case AST_VARIABLE_DECLARATION:
+      compiler_variable_declaration(compiler, node);
+      break;
+    case AST_IF:
+      compiler_if(compiler, node);
+      break;
+    case AST_WHILE:
+      compiler_while(compiler, node);
+      break;
+    case AST_FOR:
+      compiler_for(compiler, node);
+      break;
+    case AST_RETURN:
+      if (node->return_expr.is_empty_return) {
+        compiler_emit(compiler, OP_RETURN0, 0, 0, 0);
+      } else {
+        int reg = compiler_expr(compiler, node->return_expr.expr, -1);
+        compiler_emit(compiler, OP_RETURN, reg, 0, 0);
+      }
+      break;
+    case AST_SKIP:
+    case AST_STOP:
+      compiler_jump_out(compiler, node);
+      break;
+    case AST_INCLUDE:
+      compiler_include(compiler, node);
+      break;
+    default:
+      compiler_expr(compiler, node, -1);
+      break;
+  }
+  compiler->reg_top = compiler_locals_top(compiler);
+}
+
+static void compiler_begin_function(Compiler* compiler, Function* function)
+{
+  compiler->function = function;
+  compiler->local_size = 0;
+  compiler->depth = 0;
+  compiler->reg_top = 0;
+  compiler->loop = (void*)0;
+}
+
+static Function* compiler_function(Compiler* compiler, AST* node)
+{
+  Function* function = init_function(node->function_declaration.name, node);
+  function->has_return = node->function_declaration.has_return;
+  function->return_type = node->function_declaration.return_type;
+  function->arg_size = node->function_declaration.arg_size;
+  compiler_begin_function(compiler, function);
+
+  for (int i = 0; i < node->function_declaration.arg_size; i++) {
+    AST* arg = node->function_declaration.args[i];
+    VariableType type = node->function_declaration.arg_types[i];
+    if (compiler_is_declared_in_scope(compiler, arg->variable.name)) {
+      char msg[64]; sprintf(msg, "variable '%s' has already been declared", arg->variable.name);
+      compiler_error(msg);
+    }
+    AST* obj_dec = type == VAR_OBJECT
+      ? compiler_find_object_declaration(compiler, arg->variable.object_type_name, (void*)0)
+      : (void*)0;
+    int reg = compiler_alloc_reg(compiler);
+    // callers pass anything, the args are converted on entry
+    compiler_store_typed(compiler, reg, reg, TYPE_UNKNOWN, type, obj_dec, arg->variable.name);
+    compiler_add_local(compiler, arg->variable.name, reg, type, obj_dec, false);
+  }
+
+  compiler_statements(compiler, node->function_declaration.compound);
+  compiler_emit(compiler, OP_RETURN0, 0, 0, 0);
+
+  return function;
+}
+
+Program* compiler_compile(Compiler* compiler, AST* root)
+{
+  Program* program = compiler->program;
+
+  // every top level declaration gets a global slot up front so that
+  // functions can refer to globals declared after them
+  for (int i = 0; i < root->compound.statement_size; i++) {
+    AST* statement = root->compound.statements[i];
+    if (statement->type != AST_VARIABLE_DECLARATION) continue;
+    for (int j = 0; j < statement->variable_declaration.size; j++) {
+      VariableType type = statement->variable_declaration.type;
+      compiler_declare_global(compiler,
+                              statement->variable_declaration.names[j],
+                              type,
+                              type == VAR_OBJECT
+                                ? compiler_find_object_declaration(compiler, statement->variable_declaration.object_type, (void*)0)
+                                : (void*)0);
+    }
+  }
+  program->global_size = compiler->global_size;
+
+  program->main = init_function("main", root);
+  compiler_begin_function(compiler, program->main);
+  compiler_statements(compiler, root);
+  compiler_emit(compiler, OP_HALT, 0, 0, 0);
+
+  program->function_size = compiler->function_size;
+  program->functions = calloc(compiler->function_size, sizeof(Function*));
+  for (int i = 0; i < compiler->function_size; i++) {
+    program->functions[i] = compiler_function(compiler, compiler->function_declarations[i]);
+  }
+
+  return program;
+}
@@ -0,0 +1,483 @@
+#include "inc/emitter.h"
+#include "inc/builtin.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// src/runtime/runtime.c, embedded by build.sh and copied in front of every emitted program
+extern const char emitter_runtime[];
+
+static void emitter_error(char* msg)
+{
+  printf("Emitter-> Error: %s\n", msg);
+  exit(1);
+}
+
+Emitter* init_emitter(Program* program, char* source_path)
+{
+  Emitter* emitter = calloc(1, sizeof(Emitter));
+
+  emitter->program = program;
+  emitter->source_path = source_path;
+  size_t len = strlen(source_path);
+  if (len > 5 && strcmp(source_path + len - 5, ".lang") == 0) {
+    len -= 5;
+  }
+  emitter->c_path = malloc(len + 3);
+  sprintf(emitter->c_path, "%.*s.c", (int)len, source_path);
+  emitter->exe_path = malloc(len + 5);
+#ifdef _WIN32
+  sprintf(emitter->exe_path, "%.*s.exe", (int)len, source_path);
+#else
+  // a script without the extension would be overwritten
+  sprintf(emitter->exe_path, len == strlen(source_path) ? "%.*s.out" : "%.*s", (int)len, source_path);
+#endif
+  emitter->out = (void*)0;
+
+  return emitter;
+}
+
+static void emitter_string(Emitter* emitter, char* str)
+{
+  fputc('"', emitter->out);
+  for (unsigned char* c = (unsigned char*)str; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      fprintf(emitter->out, "\\%c", *c);
+    } else if (*c == '\n') {
+      fprintf(emitter->out, "\\n");
+    } else if (*c < ' ' || *c >= 127) {
+      // three digits so a following digit is not taken into the escape
+      fprintf(emitter->out, "\\%03o", *c);
+    } else {
+      fputc(*c, emitter->out);
+    }
+  }
+  fputc('"', emitter->out);
+}
+
+static void emitter_const(Emitter* emitter, Value val)
+{
+  switch (val.type) {
+    case VALUE_INT:
+      fprintf(emitter->out, "INT(%d)", val.integer);
+      break;
+    case VALUE_FLOAT:
+      // hex floats keep every bit of the folded constants
+      if (isnan(val.floating)) {
+        fprintf(emitter->out, "FLOAT(%s__builtin_nanf(\"\"))", signbit(val.floating) ? "-" : "");
+      } else if (isinf(val.floating)) {
+        fprintf(emitter->out, "FLOAT(%s__builtin_inff())", val.floating < 0 ? "-" : "");
+      } else {
+        fprintf(emitter->out, "FLOAT(%af)", (double)val.floating);
+      }
+      break;
+    case VALUE_STRING:
+      fprintf(emitter->out, "STRING(");
+      emitter_string(emitter, val.string);
+      fprintf(emitter->out, ")");
+      break;
+    case VALUE_BOOL:
+      fprintf(emitter->out, "BOOL(%s)", val.boolean ? "true" : "false");
+      break;
+    default:
+      fprintf(emitter->out, "NOOP");
+      break;
+  }
+}
+
+static char* emitter_cond_name(CondKind kind)
+{
+  switch (kind) {
+    case COND_IF: return "COND_IF";
+    case COND_WHILE: return "COND_WHILE";
+    case COND_FOR: return "COND_FOR";
+  }
+  return (void*)0;
+}
+
+static char* emitter_value_type(VariableType type)
+{
+  switch (type) {
+    case VAR_INT: return "VALUE_INT";
+    case VAR_FLOAT: return "VALUE_FLOAT";
+    case VAR_STRING: return "VALUE_STRING";
+    case VAR_BOOL: return "VALUE_BOOL";
+    default: return "-1";
+  }
+}
+
+// C operator of OP_ADD..OP_LE and of their typed and branch forms
+static char* emitter_operator(int compare)
+{
+  static char* operators[] = { "+", "-", "*", "/", "%", "==", "!=", ">", ">=", "<", "<=" };
+  return operators[compare];
+}
+
+// registers live in C locals, the frame in R only gets them where the
+// collector may run or a callee reads its args. Registers from the base
+// of a call upwards are free, the compiler puts args at the top
+static void emitter_spill(Emitter* emitter, int from, int to)
+{
+  for (int i = from; i < to; i++) {
+    fprintf(emitter->out, "  R[%d] = r%d;\n", i, i);
+  }
+}
+
+// int expression of OP_ADD..OP_LE on registers b and c, division keeps the trap of the interpreter
+static void emitter_int_op(Emitter* emitter, int compare, int b, int c)
+{
+  if (compare == OP_DIV - OP_ADD || compare == OP_MOD - OP_ADD) {
+    fprintf(emitter->out, "INT(rt_%s(r%d.integer, r%d.integer))", compare == OP_DIV - OP_ADD ? "div" : "mod", b, c);
+  } else {
+    fprintf(emitter->out, "%s(r%d.integer %s r%d.integer)",
+            compare < OP_EQ - OP_ADD ? "INT" : "BOOL", b, emitter_operator(compare), c);
+  }
+}
+
+static void emitter_return(Emitter* emitter, Function* function, char* val)
+{
+  if (function->has_return) {
+    fprintf(emitter->out, "rt_return(%s, ", val);
+    emitter_string(emitter, function->name);
+    fprintf(emitter->out, ", true, %s, \"%s\")",
+            emitter_value_type(function->return_type), var_type_name(function->return_type));
+  } else {
+    fprintf(emitter->out, "rt_return(%s, ", val);
+    emitter_string(emitter, function->name);
+    fprintf(emitter->out, ", false, 0, \"\")");
+  }
+}
+
+static void emitter_instr(Emitter* emitter, Function* function, int pc)
+{
+  FILE* out = emitter->out;
+  Instr* ip = &function->code[pc];
+  int a = ip->a, b = ip->b, c = ip->c;
+  Value* K = function->consts;
+  switch (ip->op) {
+    case OP_LOADK:
+      fprintf(out, "  r%d = ", a);
+      emitter_const(emitter, K[b]);
+      fprintf(out, ";\n");
+      break;
+    case OP_UNDEF:
+      fprintf(out, "  r%d = UNDEFINED;\n", a);
+      break;
+    case OP_MOVE:
+      fprintf(out, "  r%d = r%d;\n", a, b);
+      break;
+    case OP_TESTDEF:
+      fprintf(out, "  if (r%d.type == VALUE_UNDEFINED) rt_undefined(", a);
+      emitter_string(emitter, K[b].string);
+      fprintf(out, ");\n");
+      break;
+    case OP_GETGLOBAL:
+      fprintf(out, "  if (lang_globals[%d].type == VALUE_UNDEFINED) rt_undefined_global(lang_globals[%d], ", b, b);
+      emitter_string(emitter, K[c].string);
+      fprintf(out, ");\n  r%d = lang_globals[%d];\n", a, b);
+      break;
+    case OP_SETGLOBAL:
+      if (c >= 0) {
+        fprintf(out, "  if (rt_is_undeclared(lang_globals[%d])) rt_undefined_global(lang_globals[%d], ", b, b);
+        emitter_string(emitter, K[c].string);
+        fprintf(out, ");\n");
+      }
+      fprintf(out, "  lang_globals[%d] = r%d;\n", b, a);
+      break;
+    case OP_CONV_INT: case OP_CONV_FLOAT:
+      fprintf(out, "  r%d = rt_conv_%s(r%d, ", a, ip->op == OP_CONV_INT ? "int" : "float", b);
+      emitter_string(emitter, K[c].string);
+      fprintf(out, ");\n");
+      break;
+    case OP_CHECK_STRING: case OP_CHECK_BOOL:
+      fprintf(out, "  r%d = rt_check(r%d, %s, ", a, b,
+              ip->op == OP_CHECK_STRING ? "VALUE_STRING, \"VAR_STRING\"" : "VALUE_BOOL, \"VAR_BOOL\"");
+      emitter_string(emitter, K[c].string);
+      fprintf(out, ");\n");
+      break;
+    case OP_CHECK_OBJECT:
+      fprintf(out, "  r%d = rt_check_object(r%d, &lang_objects[%d]);\n", a, b, c);
+      break;
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+    case OP_EQ: case OP_NE: case OP_GT: case OP_GE: case OP_LT: case OP_LE:
+      fprintf(out, "  r%d = r%d.type == VALUE_INT && r%d.type == VALUE_INT ? ", a, b, c);
+      emitter_int_op(emitter, ip->op - OP_ADD, b, c);
+      fprintf(out, " : rt_binary(BIN_%s, r%d, r%d);\n", op_name(ip->op) + 3, b, c);
+      break;
+    case OP_AND: case OP_OR:
+      fprintf(out, "  r%d = rt_binary(BIN_%s, r%d, r%d);\n", a, op_name(ip->op) + 3, b, c);
+      break;
+    case OP_ADDI: case OP_SUBI: case OP_MULI: case OP_DIVI: case OP_MODI:
+    case OP_EQI: case OP_NEI: case OP_GTI: case OP_GEI: case OP_LTI: case OP_LEI:
+      fprintf(out, "  r%d = ", a);
+      emitter_int_op(emitter, ip->op - OP_ADDI, b, c);
+      fprintf(out, ";\n");
+      break;
+    case OP_ADDF: case OP_SUBF: case OP_MULF: case OP_DIVF:
+      fprintf(out, "  r%d = FLOAT(r%d.floating %s r%d.floating);\n", a, b, emitter_operator(ip->op - OP_ADDF), c);
+      break;
+    case OP_EQF: case OP_NEF: case OP_GTF: case OP_GEF: case OP_LTF: case OP_LEF:
+      fprintf(out, "  r%d = BOOL(r%d.floating %s r%d.floating);\n",
+              a, b, emitter_operator(ip->op - OP_EQF + OP_EQ - OP_ADD), c);
+      break;
+    case OP_SHLI:
+      fprintf(out, "  r%d = INT((int)((unsigned)r%d.integer << %d));\n", a, b, c);
+      break;
+    case OP_SHRI:
+      fprintf(out, "  r%d = INT(r%d.integer >> %d);\n", a, b, c);
+      break;
+    case OP_ANDI:
+      fprintf(out, "  r%d = INT(r%d.integer & %d);\n", a, b, c);
+      break;
+    case OP_NEG:
+      fprintf(out, "  r%d = rt_neg(r%d);\n", a, b);
+      break;
+    case OP_NOT:
+      fprintf(out, "  r%d = rt_not(r%d);\n", a, b);
+      break;
+    case OP_JMP:
+      fprintf(out, "  goto L%d;\n", a);
+      break;
+    case OP_JMPF:
+      fprintf(out, "  if (!rt_cond(r%d, %s)) goto L%d;\n", a, emitter_cond_name(c), b);
+      break;
+    case OP_ANDJMP: case OP_ORJMP:
+      fprintf(out, "  if (r%d.type == VALUE_BOOL && %sr%d.boolean) goto L%d;\n", a, ip->op == OP_ANDJMP ? "!" : "", a, b);
+      break;
+    case OP_IFEQI: case OP_IFNEI: case OP_IFGTI: case OP_IFGEI: case OP_IFLTI: case OP_IFLEI:
+      fprintf(out, "  if (!(r%d.integer %s r%d.integer)) goto L%d;\n",
+              a, emitter_operator(ip->op - OP_IFEQI + OP_EQ - OP_ADD), b, c);
+      break;
+    case OP_IFEQF: case OP_IFNEF: case OP_IFGTF: case OP_IFGEF: case OP_IFLTF: case OP_IFLEF:
+      fprintf(out, "  if (!(r%d.floating %s r%d.floating)) goto L%d;\n",
+              a, emitter_operator(ip->op - OP_IFEQF + OP_EQ - OP_ADD), b, c);
+      break;
+    case OP_FORLT: case OP_FORLE: case OP_FORGT: case OP_FORGE: {
+      static char* operators[] = { "<", "<=", ">", ">=" };
+      fprintf(out, "  if ((r%d.integer += r%d.integer) %s r%d.integer) goto L%d;\n",
+              a, b + 1, operators[ip->op - OP_FORLT], b, c);
+      break;
+    }
+    case OP_CALL:
+      emitter_spill(emitter, 0, a + c);
+      fprintf(out, "  r%d = lang_f%d(R + %d);\n", a, b, a);
+      break;
+    case OP_BUILTIN:
+      emitter_spill(emitter, b == BUILTIN_READ ? 0 : a, a + c);
+      fprintf(out, "  r%d = rt_%s(R + %d, %d);\n", a, builtin_name(b), a, c);
+      break;
+    case OP_MODCALL:
+      emitter_spill(emitter, a, a + c);
+      fprintf(out, "  r%d = rt_module_call(&lang_module_calls[%d], R + %d, %d);\n", a, b, a, c);
+      break;
+    case OP_INCLUDE: {
+      AST* include = emitter->program->includes[a];
+      fprintf(out, "  rt_include(");
+      emitter_string(emitter, include->include.module_name);
+      if (include->include.is_alias) {
+        fprintf(out, ", ");
+        emitter_string(emitter, include->include.module_alias_name);
+        fprintf(out, ");\n");
+      } else {
+        fprintf(out, ", (void*)0);\n");
+      }
+      break;
+    }
+    case OP_NEWOBJ:
+      emitter_spill(emitter, 0, function->reg_size);
+      fprintf(out, "  r%d = rt_new_object(&lang_objects[%d]);\n", a, b);
+      break;
+    case OP_GETFIELD:
+      fprintf(out, "  r%d = rt_get_field(r%d, %d, ", a, b, FIELD_INDEX(c));
+      emitter_string(emitter, K[FIELD_NAME(c)].string);
+      fprintf(out, ");\n");
+      break;
+    case OP_SETFIELD:
+      fprintf(out, "  r%d.object->fields[%d] = r%d;\n", a, b, c);
+      break;
+    case OP_RETURN: {
+      char val[32]; sprintf(val, "r%d", a);
+      fprintf(out, "  { Value ret = ");
+      emitter_return(emitter, function, val);
+      fprintf(out, "; rt_top = top; return ret; }\n");
+      break;
+    }
+    case OP_RETURN0:
+      fprintf(out, "  { ");
+      emitter_return(emitter, function, "NOOP");
+      fprintf(out, "; rt_top = top; return NOOP; }\n");
+      break;
+    case OP_HALT:
+      fprintf(out, "  { rt_top = top; return NOOP; }\n");
+      break;
+    default: {
+      char msg[64]; sprintf(msg, "unexpected instruction: %s", op_name(ip->op));
+      emitter_error(msg);
+    }
+  }
+}
+
+// pc that some jump goes to, each gets a label
+static int emitter_target(Instr* ip)
+{
+  switch (ip->op) {
+    case OP_JMP:
+      return ip->a;
+    case OP_JMPF: case OP_ANDJMP: case OP_ORJMP:
+      return ip->b;
+    case OP_IFEQI: case OP_IFNEI: case OP_IFGTI: case OP_IFGEI: case OP_IFLTI: case OP_IFLEI:
+    case OP_IFEQF: case OP_IFNEF: case OP_IFGTF: case OP_IFGEF: case OP_IFLTF: case OP_IFLEF:
+    case OP_FORLT: case OP_FORLE: case OP_FORGT: case OP_FORGE:
+      return ip->c;
+    default:
+      return -1;
+  }
+}
+
+static void emitter_function(Emitter* emitter, Function* function, char* c_name)
+{
+  FILE* out = emitter->out;
+  bool* is_target = calloc(function->code_size + 1, sizeof(bool));
+  for (int pc = 0; pc < function->code_size; pc++) {
+    int target = emitter_target(&function->code[pc]);
+    if (target >= 0) is_target[target] = true;
+  }
+
+  fprintf(out, "// %s\nstatic Value %s(Value* R)\n{\n", function->name, c_name);
+  fprintf(out, "  Value* top = rt_enter(R, %lu, %lu);\n", function->arg_size, function->reg_size);
+  for (int i = 0; i < function->reg_size; i++) {
+    if (i < function->arg_size) {
+      fprintf(out, "  Value r%d = R[%d];\n", i, i);
+    } else {
+      fprintf(out, "  Value r%d = UNDEFINED;\n", i);
+    }
+  }
+  for (int pc = 0; pc < function->code_size; pc++) {
+    if (is_target[pc]) fprintf(out, "L%d:\n", pc);
+    emitter_instr(emitter, function, pc);
+  }
+  if (is_target[function->code_size]) fprintf(out, "L%lu:;\n", function->code_size);
+  fprintf(out, "}\n\n");
+  free(is_target);
+}
+
+void emitter_emit(Emitter* emitter)
+{
+  Program* program = emitter->program;
+  FILE* out = fopen(emitter->c_path, "w");
+  if (!out) {
+    char msg[128]; sprintf(msg, "cannot write '%s'", emitter->c_path);
+    emitter_error(msg);
+  }
+  emitter->out = out;
+
+  fprintf(out, "// generated by lang from %s\n", emitter->source_path);
+  fprintf(out, "// build: gcc -O2 -fwrapv -o %s %s -ldl\n\n", emitter->exe_path, emitter->c_path);
+  // module calls pass AST nodes laid out like the interpreter's
+  fprintf(out, "#define RT_AST_SIZE %lu\n", sizeof(AST));
+  fprintf(out, "#define RT_AST_PAYLOAD %lu\n", offsetof(AST, integer));
+  fprintf(out, "#define RT_AST_NOOP %d\n", AST_TYPE_NOOP);
+  fprintf(out, "#define RT_AST_INT %d\n", AST_INT);
+  fprintf(out, "#define RT_AST_FLOAT %d\n", AST_FLOAT);
+  fprintf(out, "#define RT_AST_STRING %d\n", AST_STRING);
+  fprintf(out, "#define RT_AST_BOOL %d\n\n", AST_BOOL);
+  fputs(emitter_runtime, out);
+
+  fprintf(out, "\nstatic Value lang_globals[%lu];\n", program->global_size ? program->global_size : 1);
+  for (int i = 0; i < program->object_size; i++) {
+    AST* declaration = program->object_declarations[i];
+    fprintf(out, "static char* lang_object%d_fields[] = { ", i);
+    for (int j = 0; j < declaration->object_declaration.field_size; j++) {
+      emitter_string(emitter, declaration->object_declaration.field_names[j]);
+      fprintf(out, ", ");
+    }
+    fprintf(out, "(void*)0 };\n");
+  }
+  if (program->object_size) {
+    fprintf(out, "static Declaration lang_objects[] = {\n");
+    for (int i = 0; i < program->object_size; i++) {
+      AST* declaration = program->object_declarations[i];
+      fprintf(out, "  { ");
+      emitter_string(emitter, declaration->object_declaration.name);
+      fprintf(out, ", %lu, lang_object%d_fields },\n", declaration->object_declaration.field_size, i);
+    }
+    fprintf(out, "};\n");
+  }
+  if (program->module_call_size) {
+    fprintf(out, "static ModuleCall lang_module_calls[] = {\n");
+    for (int i = 0; i < program->module_call_size; i++) {
+      AST* call = program->module_calls[i];
+      fprintf(out, "  { ");
+      emitter_string(emitter, call->module_function_call.module_name);
+      fprintf(out, ", ");
+      emitter_string(emitter, call->module_function_call.func->function_call.name);
+      fprintf(out, ", (void*)0 },\n");
+    }
+    fprintf(out, "};\n");
+  }
+
+  fprintf(out, "\nstatic Value lang_main(Value* R);\n");
+  for (int i = 0; i < program->function_size; i++) {
+    fprintf(out, "static Value lang_f%d(Value* R);\n", i);
+  }
+  fprintf(out, "\n");
+  emitter_function(emitter, program->main, "lang_main");
+  for (int i = 0; i < program->function_size; i++) {
+    char c_name[32]; sprintf(c_name, "lang_f%d", i);
+    emitter_function(emitter, program->functions[i], c_name);
+  }
+
+  fprintf(out, "int main()\n{\n");
+  fprintf(out, "  rt_stack = calloc(RT_STACK_SIZE, sizeof(Value));\n");
+  fprintf(out, "  rt_top = rt_stack;\n");
+  fprintf(out, "  rt_globals = lang_globals;\n");
+  fprintf(out, "  rt_global_size = %lu;\n", program->global_size);
+  fprintf(out, "  for (size_t i = 0; i < rt_global_size; i++) rt_globals[i] = UNDECLARED;\n");
+  fprintf(out, "  lang_main(rt_stack);\n");
+  fprintf(out, "  return 0;\n}\n");
+
+  fclose(out);
+  emitter->out = (void*)0;
+}
+
+int emitter_build(Emitter* emitter)
+{
+  // gcc gets its arguments directly, the paths never pass through a shell
+#ifdef _WIN32
+  // spawn joins the arguments into one command line, quotes keep paths with spaces whole,
+  // windows paths cannot contain quotes themselves
+  char exe[MAX_PATH + 2];
+  char c[MAX_PATH + 2];
+  if (snprintf(exe, sizeof(exe), "\"%s\"", emitter->exe_path) >= (int) sizeof(exe) ||
+      snprintf(c, sizeof(c), "\"%s\"", emitter->c_path) >= (int) sizeof(c)) {
+    printf("Emitter-> Error: path too long to build '%s'\n", emitter->c_path);
+    return 1;
+  }
+  char* argv[] = { "gcc", "-O2", "-fwrapv", "-o", exe, c, (void*)0 };
+  int status = _spawnvp(_P_WAIT, "gcc", (const char* const*) argv);
+  bool ok = status == 0;
+#else
+  char* argv[] = { "gcc", "-O2", "-fwrapv", "-o", emitter->exe_path, emitter->c_path, "-ldl", (void*)0 };
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+  int status = 0;
+  bool ok = pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+  if (!ok) {
+    printf("Emitter-> Error: gcc could not build '%s'\n", emitter->c_path);
+    return 1;
+  }
+  return 0;
+}
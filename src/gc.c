@@ -0,0 +1,111 @@
+#include "inc/gc.h"
+#include <stdio.h>
+#include <string.h>
+
+#define GC_FIRST_COLLECT (1024 * 1024)
+
+// mark and sweep over every string and object created at runtime
+static struct {
+  GCObject* objects;
+  size_t bytes;
+  size_t next_collect;
+  GCMarkRoots mark_roots;
+  void* ctx;
+  // --gc-stats
+  size_t collections;
+  size_t allocated, allocated_bytes;
+  size_t freed, freed_bytes;
+  size_t peak_bytes;
+} gc = { .next_collect = GC_FIRST_COLLECT };
+
+void gc_set_roots(GCMarkRoots mark_roots, void* ctx)
+{
+  gc.mark_roots = mark_roots;
+  gc.ctx = ctx;
+}
+
+void* gc_alloc(GCKind kind, size_t size)
+{
+  if (gc.bytes + size > gc.next_collect) {
+    gc_collect();
+  }
+
+  GCObject* object = calloc(1, size);
+  object->next = gc.objects;
+  object->size = size;
+  object->kind = kind;
+  object->marked = false;
+  gc.objects = object;
+
+  gc.bytes += size;
+  gc.allocated++;
+  gc.allocated_bytes += size;
+  if (gc.bytes > gc.peak_bytes) {
+    gc.peak_bytes = gc.bytes;
+  }
+  return object;
+}
+
+Value gc_string(char* src)
+{
+  size_t len = strlen(src);
+  GCObject* object = gc_alloc(GC_STRING, sizeof(GCObject) + len + 1);
+  char* str = (char*)(object + 1);
+  memcpy(str, src, len + 1);
+  return (Value) { .type = VALUE_STRING, .is_managed = true, .string = str };
+}
+
+static void gc_mark(GCObject* object)
+{
+  if (object->marked) return;
+  object->marked = true;
+  if (object->kind == GC_OBJECT) {
+    Object* obj = (Object*)object;
+    for (int i = 0; i < obj->declaration->object_declaration.field_size; i++) {
+      gc_mark_value(obj->fields[i]);
+    }
+  }
+}
+
+void gc_mark_value(Value val)
+{
+  if (val.type == VALUE_STRING && val.is_managed) {
+    gc_mark((GCObject*)val.string - 1);
+  } else if (val.type == VALUE_OBJECT) {
+    gc_mark(&val.object->gc);
+  }
+}
+
+void gc_collect()
+{
+  // without roots nothing can be proven dead
+  if (!gc.mark_roots) return;
+
+  gc.mark_roots(gc.ctx);
+
+  GCObject** link = &gc.objects;
+  while (*link) {
+    GCObject* object = *link;
+    if (object->marked) {
+      object->marked = false;
+      link = &object->next;
+      continue;
+    }
+    *link = object->next;
+    gc.bytes -= object->size;
+    gc.freed++;
+    gc.freed_bytes += object->size;
+    free(object);
+  }
+
+  gc.collections++;
+  gc.next_collect = gc.bytes * 2 > GC_FIRST_COLLECT ? gc.bytes * 2 : GC_FIRST_COLLECT;
+}
+
+void gc_print_stats()
+{
+  printf("GC-> collections: %lu\n", gc.collections);
+  printf("GC-> allocated: %lu objects, %lu bytes\n", gc.allocated, gc.allocated_bytes);
+  printf("GC-> freed: %lu objects, %lu bytes\n", gc.freed, gc.freed_bytes);
+  printf("GC-> live: %lu objects, %lu bytes, peak %lu bytes\n", gc.allocated - gc.freed, gc.bytes, gc.peak_bytes);
+}
@@ -0,0 +1,25 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdlib.h>
+
+typedef struct ArenaChunk {
+  struct ArenaChunk* prev;
+  size_t size;
+  size_t used;
+  char data[];
+} ArenaChunk;
+
+// bump allocator, everything it hands out is released at once by arena_free
+typedef struct {
+  ArenaChunk* chunk;
+} Arena;
+
+Arena* init_arena();
+
+void* arena_alloc(Arena* arena, size_t size);
+void* arena_grow(Arena* arena, void* array, size_t size, size_t elem_size);
+char* arena_strndup(Arena* arena, char* src, size_t len);
+void arena_free(Arena* arena);
+
+#endif
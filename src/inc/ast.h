@@ -31,7 +31,6 @@ typedef enum {
   AST_WHILE,
   AST_FOR,
   AST_RETURN,
-  AST_RETURN_VAL,
   AST_SKIP,
   AST_STOP,
   AST_INCLUDE,
@@ -41,9 +40,78 @@ typedef enum {
   AST_MEMBER_ASSIGN,
 } TypeAST;
 
+// static type of an expression, worked out by the checker
+typedef enum {
+  TYPE_UNKNOWN,  // only known at runtime, e.g. module call results
+  TYPE_NONE,     // calls that give back no value
+  TYPE_INT,
+  TYPE_FLOAT,
+  TYPE_STRING,
+  TYPE_BOOL,
+  TYPE_OBJECT,
+} ExprType;
+
+// specialized forms a binary node takes once the visitor has seen its operand tags
+typedef enum {
+  QUICK_NONE,     // not specialized yet
+  QUICK_GENERIC,  // types kept changing, stays on the generic path
+  QUICK_INT_ADD,
+  QUICK_INT_SUB,
+  QUICK_INT_MUL,
+  QUICK_INT_DIV,
+  QUICK_INT_MOD,
+  QUICK_INT_EQ,
+  QUICK_INT_NE,
+  QUICK_INT_GT,
+  QUICK_INT_GE,
+  QUICK_INT_LT,
+  QUICK_INT_LE,
+  QUICK_FLOAT_ADD,
+  QUICK_FLOAT_SUB,
+  QUICK_FLOAT_MUL,
+  QUICK_FLOAT_DIV,
+  QUICK_FLOAT_EQ,
+  QUICK_FLOAT_NE,
+  QUICK_FLOAT_GT,
+  QUICK_FLOAT_GE,
+  QUICK_FLOAT_LT,
+  QUICK_FLOAT_LE,
+  QUICK_STRING_EQ,
+  QUICK_STRING_NE,
+  QUICK_BOOL_AND,
+  QUICK_BOOL_OR,
+  QUICK_BOOL_EQ,
+  QUICK_BOOL_NE,
+} QuickBinary;
+
+// stored in binary.operands
+typedef enum {
+  OPERANDS_ANY,
+  OPERANDS_INT,
+  OPERANDS_FLOAT,
+  OPERANDS_INT_FLOAT,
+  OPERANDS_FLOAT_INT,
+} BinaryOperands;
+
+struct Closure;
+
+// how often the visitor ran a loop, and its closure once --engine=tiered built it
+typedef struct {
+  unsigned passes;
+  struct Closure* compiled;
+} LoopTier;
+
+// lines past this are reported as this one
+#define AST_MAX_LINE 0xFFFFF
+
 typedef struct AST {
+  // type and is_return stay where modules built against older headers read them,
+  // the checker's type and the line fill the padding after is_return
   TypeAST type;
   bool is_return;
+  ExprType expr_type : 4;
+  // line the node starts on, for errors reported before running
+  unsigned line : 20;
   union {
     struct {
       struct AST** statements;
@@ -55,7 +123,6 @@ typedef struct AST {
         COMPOUND_FOR,
         COMPOUND_FUNCTION,
       } type;
-      struct AST* return_val;
     } compound;
 
     struct {
@@ -76,6 +143,12 @@ typedef struct AST {
 
     struct {
       _TokenType op;
+      // operand types proven by the checker, picks a path without type tests
+      unsigned char operands;
+      // rewritten by the visitor at runtime, guarded by a tag check on every use;
+      // a byte of its own, not a bitfield, since the tier worker reads operands meanwhile
+      unsigned char quick;
+      unsigned char deopts;
       struct AST* left;
       struct AST* right;
     } binary;
@@ -92,17 +165,23 @@ typedef struct AST {
       size_t size;
       VariableType type;
       char* object_type;
+      // set by the resolver: frame slot of the first name, the rest follow, or RESOLVER_GLOBAL
+      int slot;
     } variable_declaration;
 
     struct {
       char* name;
       struct AST* assign_val;
       _TokenType op;
+      // set by the resolver, see variable
+      int depth, slot;
     } variable_assign;
 
     struct {
       char* name;
       char* object_type_name;
+      // set by the resolver: RESOLVER_GLOBAL or RESOLVER_FRAME, and var index there
+      int depth, slot;
     } variable;
 
     struct {
@@ -113,12 +192,16 @@ typedef struct AST {
       VariableType* arg_types;
       size_t arg_size;
       struct AST* compound;
+      // set by the resolver: args and every local of the body
+      size_t frame_size;
     } function_declaration;
 
     struct {
       char* name;
       struct AST** args;
       size_t arg_size;
+      // set by the resolver: builtin, or index into the function declarations when builtin is -1
+      int builtin, function;
     } function_call;
 
     struct {
@@ -129,6 +212,8 @@ typedef struct AST {
     struct {
       char* object_name;
       char* member_name;
+      // set by the resolver, see variable
+      int depth, slot;
     } member_access;
 
     struct {
@@ -151,12 +236,17 @@ typedef struct AST {
     struct {
       struct AST* cond;
       struct AST* compound;
+      LoopTier tier;
     } while_block;
 
     struct {
       bool has_first, has_second, has_third;
       struct AST *first, *second, *third;
       struct AST* compound;
+      // set by the checker for `for int i = a; i < n; i += k` when the body cannot change n
+      bool is_counted;
+      int step;
+      LoopTier tier;
     } for_block;
 
     struct {
@@ -164,10 +254,6 @@ typedef struct AST {
       struct AST* expr;
     } return_expr;
 
-    struct {
-      struct AST* val;
-    } return_val;
-
     struct {
       char* module_name;
       bool is_alias;
@@ -183,6 +269,8 @@ typedef struct AST {
   };
 } AST;
 
+// bytes a node of this type occupies, the union is cut after its own member
+size_t ast_size(TypeAST type);
 AST* init_ast(TypeAST type);
 AST* get_ast_noop();
 AST* get_ast_true();
@@ -190,6 +278,7 @@ AST* get_ast_false();
 
 char* ast_name(TypeAST type);
 char* var_type_name(VariableType type);
+char* expr_type_name(ExprType type);
 char* compound_name(int type);
 
 #endif
@@ -0,0 +1,20 @@
+#ifndef BUILTIN_H
+#define BUILTIN_H
+
+#include "value.h"
+
+typedef enum {
+  BUILTIN_WRITE,
+  BUILTIN_READ,
+  BUILTIN_QUIT,
+  BUILTIN_INT,
+  BUILTIN_FLOAT,
+  BUILTIN_STRING,
+} Builtin;
+
+int builtin_find(char* name);
+Value builtin_call(Builtin builtin, Value* args, size_t arg_size);
+
+char* builtin_name(Builtin builtin);
+
+#endif
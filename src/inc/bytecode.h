@@ -0,0 +1,158 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "value.h"
+
+// register operands (R) are slots of the current call frame,
+// K is the constant table of the function, G the global table
+typedef enum {
+  OP_LOADK,         // R[a] = K[b]
+  OP_UNDEF,         // R[a] = undefined
+  OP_MOVE,          // R[a] = R[b]
+  OP_TESTDEF,       // error if R[a] is undefined, K[b] is the variable name
+  OP_GETGLOBAL,     // R[a] = G[b], K[c] is the variable name
+  OP_SETGLOBAL,     // G[b] = R[a], K[c] is the variable name in functions, which may run before it is declared, else -1
+  OP_CONV_INT,      // R[a] = int(R[b]), K[c] is the variable name
+  OP_CONV_FLOAT,    // R[a] = float(R[b]), K[c] is the variable name
+  OP_CHECK_STRING,  // R[a] = R[b] if it is a string, K[c] is the variable name
+  OP_CHECK_BOOL,    // R[a] = R[b] if it is a bool, K[c] is the variable name
+  OP_CHECK_OBJECT,  // R[a] = R[b] if it is an object of declaration c
+  OP_ADD,           // R[a] = R[b] + R[c]
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_MOD,
+  OP_EQ,
+  OP_NE,
+  OP_GT,
+  OP_GE,
+  OP_LT,
+  OP_LE,
+  OP_AND,
+  OP_OR,
+  OP_ADDI,          // OP_ADD to OP_LE on operands proven to be int
+  OP_SUBI,
+  OP_MULI,
+  OP_DIVI,
+  OP_MODI,
+  OP_EQI,
+  OP_NEI,
+  OP_GTI,
+  OP_GEI,
+  OP_LTI,
+  OP_LEI,
+  OP_ADDF,          // the same on operands proven to be float, no modulo
+  OP_SUBF,
+  OP_MULF,
+  OP_DIVF,
+  OP_EQF,
+  OP_NEF,
+  OP_GTF,
+  OP_GEF,
+  OP_LTF,
+  OP_LEF,
+  OP_SHLI,          // R[a] = R[b] << c on an int, multiplication by 2^c
+  OP_SHRI,          // R[a] = R[b] >> c on an int proven not negative, division by 2^c
+  OP_ANDI,          // R[a] = R[b] & c on an int proven not negative, modulo c + 1
+  OP_NEG,           // R[a] = -R[b]
+  OP_NOT,           // R[a] = not R[b]
+  OP_JMP,           // pc = a
+  OP_JMPF,          // if not R[a] then pc = b, c is the CondKind for errors
+  OP_ANDJMP,        // if R[a] is the bool false then pc = b, the left side of and decided
+  OP_ORJMP,         // if R[a] is the bool true then pc = b, the left side of or decided
+  OP_IFEQI,         // if not R[a] == R[b] then pc = c, on operands proven to be int
+  OP_IFNEI,
+  OP_IFGTI,
+  OP_IFGEI,
+  OP_IFLTI,
+  OP_IFLEI,
+  OP_IFEQF,         // the same on operands proven to be float
+  OP_IFNEF,
+  OP_IFGTF,
+  OP_IFGEF,
+  OP_IFLTF,
+  OP_IFLEF,
+  OP_FORLT,         // R[a] += R[b + 1], if R[a] < R[b] then pc = c; counted for loops
+  OP_FORLE,
+  OP_FORGT,
+  OP_FORGE,
+  OP_CALL,          // R[a] = functions[b](R[a], ..., R[a + c - 1])
+  OP_BUILTIN,       // R[a] = builtins[b](R[a], ..., R[a + c - 1])
+  OP_MODCALL,       // R[a] = module_calls[b](R[a], ..., R[a + c - 1])
+  OP_INCLUDE,       // load includes[a]
+  OP_NEWOBJ,        // R[a] = new object of object_declarations[b]
+  OP_GETFIELD,      // R[a] = R[b].fields[c], K[c] of the variable name packed above, see FIELD_OPERAND
+  OP_SETFIELD,      // R[a].fields[b] = R[c]
+  OP_RETURN,        // return R[a]
+  OP_RETURN0,       // return nothing
+  OP_HALT,
+  OP_YIELD,         // back to native code that had one instruction interpreted, see vm_step
+} Opcode;
+
+typedef enum {
+  COND_IF,
+  COND_WHILE,
+  COND_FOR,
+} CondKind;
+
+typedef struct {
+  Opcode op;
+  int a, b, c;
+} Instr;
+
+// OP_GETFIELD keeps the field in the low bits of c and the constant naming the
+// object variable above them, for the error when the field is not defined
+#define FIELD_BITS 12
+#define FIELD_MAX (1 << FIELD_BITS)
+#define FIELD_NAME_MAX (1 << (31 - FIELD_BITS))
+#define FIELD_OPERAND(field, name) ((name) << FIELD_BITS | (field))
+#define FIELD_INDEX(c) ((c) & (FIELD_MAX - 1))
+#define FIELD_NAME(c) ((c) >> FIELD_BITS)
+
+typedef struct {
+  char* name;
+  AST* declaration;
+  bool has_return;
+  VariableType return_type;
+  size_t arg_size;
+  size_t reg_size;
+
+  Instr* code;
+  size_t code_size, code_cap;
+
+  Value* consts;
+  size_t const_size;
+
+  // counted by the VM until the function is hot enough to compile
+  unsigned calls, loops;
+  // machine code from the JIT and where each instruction starts in it
+  void* jit_code;
+  void** jit_entries;
+  bool jit_failed;
+} Function;
+
+typedef struct {
+  Function* main;
+  Function** functions;
+  size_t function_size;
+  size_t global_size;
+
+  AST** object_declarations;
+  size_t object_size;
+  AST** includes;
+  size_t include_size;
+  AST** module_calls;
+  size_t module_call_size;
+} Program;
+
+Function* init_function(char* name, AST* declaration);
+Program* init_program();
+// copies what running reads out of the front end's arena, which can be freed after
+void program_detach(Program* program);
+
+int function_emit(Function* function, Opcode op, int a, int b, int c);
+int function_add_const(Function* function, Value val);
+
+char* op_name(Opcode op);
+
+#endif
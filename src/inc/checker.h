@@ -0,0 +1,39 @@
+#ifndef CHECKER_H
+#define CHECKER_H
+
+#include "parser.h"
+
+typedef struct {
+  char* name;
+  VariableType type;
+  // declaration name of object variables
+  char* object_type;
+  // declared at the top level outside any block, any function may assign it
+  bool is_global;
+} CheckerVar;
+
+typedef struct {
+  // function declarations
+  AST** function_declarations;
+  size_t function_size;
+  Table* function_table;
+  // object declarations
+  AST** object_declarations;
+  size_t object_size;
+  // variables in scope, innermost last; the top level ones stay at the bottom
+  CheckerVar* vars;
+  size_t var_size;
+  size_t var_cap;
+  // block nesting, 0 at the top level
+  int depth;
+  // function being checked, null for the top level
+  AST* function;
+} Checker;
+
+Checker* init_checker(Parser* parser);
+
+// reports type errors before anything runs and annotates every expression
+// with its static type so the engines can skip their runtime type tests
+void checker_check(Checker* checker, AST* root);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef CLOSURE_H
+#define CLOSURE_H
+
+#include "resolver.h"
+#include "visitor.h"
+
+// vars of address space the visitor's stack may grow to once closures run on it
+#define CLOSURE_STACK_SIZE ((size_t)1 << 27)
+
+struct ClosureFunction;
+
+// one node of the program, specialized once for its operands and types,
+// e.g. int add of frame slot 3 and the constant 1
+typedef struct Closure {
+  // runs the node against the frame of the call it is in
+  Value (*run)(struct Closure* closure, Var* frame);
+  // children, what each one is depends on run
+  struct Closure *a, *b, *c, *d;
+  struct Closure** list;
+  size_t size;
+  // constant operand, or the step of a counted for
+  Value val;
+  // frame or global slot of the operand, index of the second one or of a field
+  int slot, index;
+  _TokenType op;
+  VariableType type;
+  // name for errors, or what a condition belongs to
+  char* name;
+  AST* node;
+  struct ClosureFunction* function;
+  // cached once the module has been included
+  Module* module;
+} Closure;
+
+typedef struct ClosureFunction {
+  AST* declaration;
+  // null until built, calls fall back to the visitor until then
+  Closure* body;
+  // value type the function must give back, VALUE_NOOP when it has none
+  ValueType return_type;
+} ClosureFunction;
+
+typedef struct {
+  Parser* parser;
+  Resolver* resolver;
+  AST* root;
+  ClosureFunction* functions;
+  // declared types of the frame being built, reused by sibling blocks like their slots
+  VariableType* local_types;
+  char** local_objects;
+  // and of every global, in declaration order
+  VariableType* global_types;
+  char** global_objects;
+  size_t global_size;
+} ClosureBuilder;
+
+ClosureBuilder* init_closure_builder(Parser* parser, Resolver* resolver, AST* root);
+
+// each walks its part of the resolved AST once, publishing the function body
+// and the loops in it for the visitor to switch to
+void closure_build_function(ClosureBuilder* builder, int function);
+Closure* closure_build_top(ClosureBuilder* builder);
+// the whole program, gives back the closure of the top level
+Closure* closure_build(ClosureBuilder* builder);
+
+// closures run on the frames, globals and modules of visitor
+void closure_attach(Visitor* visitor);
+// runs closure in the current frame of the attached visitor
+Value closure_enter(Closure* closure);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "parser.h"
+#include "bytecode.h"
+
+typedef struct {
+  char* name;
+  int reg;
+  int depth;
+  VariableType type;
+  AST* object_declaration;
+  bool maybe_undefined;
+} Local;
+
+typedef struct {
+  char* name;
+  VariableType type;
+  AST* object_declaration;
+  bool is_declared;
+} Global;
+
+// jumps of a condition that still need the target of its false branch
+typedef struct {
+  int* at;
+  size_t size;
+} JumpList;
+
+typedef struct Loop {
+  int* stops;
+  size_t stop_size;
+  int* skips;
+  size_t skip_size;
+  struct Loop* prev;
+} Loop;
+
+typedef struct {
+  Program* program;
+  // function declarations
+  AST** function_declarations;
+  size_t function_size;
+  Table* function_table;
+  // global variables
+  Global* globals;
+  size_t global_size;
+
+  // function being compiled
+  Function* function;
+  Local* locals;
+  size_t local_size;
+  int depth;
+  int reg_top;
+  Loop* loop;
+} Compiler;
+
+Compiler* init_compiler(Parser* parser);
+
+Program* compiler_compile(Compiler* compiler, AST* root);
+
+#endif
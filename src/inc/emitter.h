@@ -0,0 +1,23 @@
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include "bytecode.h"
+#include <stdio.h>
+
+typedef struct {
+  Program* program;
+  char* source_path;
+  // script.lang becomes script.c and the executable script
+  char* c_path;
+  char* exe_path;
+  FILE* out;
+} Emitter;
+
+Emitter* init_emitter(Program* program, char* source_path);
+
+// writes the program as a standalone C file with its runtime
+void emitter_emit(Emitter* emitter);
+// compiles the C file with the system gcc, 0 on success
+int emitter_build(Emitter* emitter);
+
+#endif
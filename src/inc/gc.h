@@ -0,0 +1,19 @@
+#ifndef GC_H
+#define GC_H
+
+#include "value.h"
+
+// called at the start of a collection to mark everything the running engine can reach
+typedef void (*GCMarkRoots)(void* ctx);
+
+void gc_set_roots(GCMarkRoots mark_roots, void* ctx);
+
+void* gc_alloc(GCKind kind, size_t size);
+Value gc_string(char* src);
+
+void gc_mark_value(Value val);
+void gc_collect();
+
+void gc_print_stats();
+
+#endif
@@ -1,6 +1,17 @@
 #ifndef IO_H
 #define IO_H
 
-char* read_file(char* path);
+#include <stdlib.h>
+#include <stdbool.h>
+
+// a read-only view of a source file, tokens keep offsets into it
+typedef struct {
+	char* data;
+	size_t size;
+	bool is_mapped;
+} Source;
+
+Source* read_source(char* path);
+void source_free(Source* source);
 
 #endif
@@ -0,0 +1,90 @@
+#ifndef IR_H
+#define IR_H
+
+#include "bytecode.h"
+
+typedef enum {
+  IR_ENTRY,  // what a register, or memory, holds when the function is entered
+  IR_PHI,
+  IR_INSTR,  // the bytecode instruction at one pc
+} IrKind;
+
+// a register an instruction reads. field is the operand it came from, 0 to 2
+// for a to c, or -1 when the register is fixed, like the args of a call
+typedef struct {
+  int value;
+  int reg;
+  int field;
+} IrUse;
+
+typedef struct {
+  IrKind kind;
+  // the instruction as the passes rewrote it, register operands are taken from uses
+  Instr instr;
+  int block;
+  // register the value lives in, -1 for memory and instructions without a result
+  int reg;
+  IrUse* uses;
+  size_t use_size;
+  // state of globals and fields a load reads, or the one a store or call follows
+  int mem;
+  bool is_memory;
+  // the value it is everywhere, set for trivial phis
+  int same;
+  // value it copies, reads that may come from any register read that one
+  int copy_of;
+  bool is_removed;
+  bool is_live;
+  bool maybe_undefined;
+  bool is_nonnegative;
+  // register of its own the value is moved to, or copied to, while lowering
+  int copy;
+  bool is_moved;
+} IrValue;
+
+typedef struct {
+  // pcs of its instructions, block 0 is empty and comes before pc 0
+  int start, end;
+  int* preds;
+  size_t pred_size;
+  int succs[2];
+  size_t succ_size;
+  bool is_reachable;
+  // position in reverse postorder and the immediate dominator
+  int order;
+  int idom;
+  int* children;
+  size_t child_size;
+  int* frontier;
+  size_t frontier_size;
+  // phis first, then the instructions in order
+  int* values;
+  size_t value_size;
+  // where it starts once lowered
+  int label;
+} IrBlock;
+
+typedef struct {
+  Program* program;
+  Function* function;
+  IrBlock* blocks;
+  size_t block_size;
+  // block starting at each pc
+  int* block_of;
+  int* rpo;
+  size_t rpo_size;
+  IrValue* values;
+  size_t value_size, value_cap;
+  // registers of the function, memory is the pseudo register after them
+  size_t reg_size;
+  // registers added right after the args for values that outlive their own
+  size_t fresh_size;
+  // what the passes did, reported by --dump-ir
+  unsigned numbered, forwarded, copies, reduced, tests, dead;
+} IrFunction;
+
+// puts every function of program through SSA and lowers it back to bytecode,
+// optimizing it unless only dump is asked for; dump prints the IR
+void ir_optimize(Program* program, bool optimize, bool dump);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "vm.h"
+
+// calls and backward jumps a function takes before --jit=on compiles it
+#define JIT_CALL_THRESHOLD 100
+#define JIT_LOOP_THRESHOLD 1000
+// native code calls nest on the C stack, about a kilobyte each; past the
+// nesting the stack allows, the interpreter runs further calls in its own frames
+#define JIT_MAX_NESTING 4096
+#define JIT_NESTING_BYTES 2048
+
+// translates the bytecode of function to x86-64 machine code, false on other
+// platforms or when no executable memory could be mapped
+bool jit_compile(Function* function);
+// runs the top frame natively from instruction at until it returns
+void jit_enter(VM* vm, Instr* at);
+// how deep native code may nest, half the C stack at most
+size_t jit_max_nesting();
+// runs program interpreted and with --jit=always and compares what they print
+int jit_diff(Program* program);
+
+#endif
@@ -2,21 +2,49 @@
 #define LEXER_H
 
 #include "token.h"
+#include <stdbool.h>
+#include <setjmp.h>
+
+// a run of tokens lexed up front, served in place
+typedef struct {
+  // the DEDENT/NEWL pairs that close blocks left open before the run
+  Token* fixups;
+  size_t fixup_size;
+  Token* tokens;
+  size_t token_size;
+} LexerSegment;
 
 typedef struct {
   char* src;
   size_t src_size;
-  unsigned i;
+  size_t i;
   unsigned line;
   unsigned prev_indent, cur_indent;
   int encountered_word;
-  Token** tokens;
+  // tokens are lexed as the parser pulls them, only a small window is kept in a ring
+  Token* ring;
+  size_t ring_cap;
+  // tokens lexed so far, the newest one is ring[(token_size - 1) & (ring_cap - 1)]
   size_t token_size;
+  // tokens before this index are never asked for again
+  size_t released;
+  // TOKEN_EOF has been added
+  bool is_done;
+  // set while lexing ahead of the parser, errors jump back here instead of exiting
+  jmp_buf* recover;
+  // tokens below ahead_size were lexed by lexer_lex_parallel, the cursor remembers the last segment used
+  LexerSegment* segments;
+  size_t segment_size;
+  size_t ahead_size;
+  size_t segment;
+  size_t segment_first;
 } Lexer;
 
-Lexer* init_lexer(char* src);
+Lexer* init_lexer(char* src, size_t src_size);
 
-void lexer_collect_tokens(Lexer* lexer);
+Token* lexer_get_token(Lexer* lexer, size_t index);
+void lexer_release(Lexer* lexer, size_t index);
+void lexer_lex_parallel(Lexer* lexer, int threads);
 void lexer_collect_token(Lexer* lexer);
 char lexer_advance(Lexer* lexer);
 char lexer_peek(Lexer* lexer);
@@ -25,7 +53,7 @@ int lexer_is_end(Lexer* lexer);
 void lexer_get_id(Lexer* lexer);
 void lexer_get_digit(Lexer* lexer);
 void lexer_get_string(Lexer* lexer);
-void lexer_add_token(Lexer* lexer, Token* token);
+void lexer_add_token(Lexer* lexer, Token token);
 void lexer_skip_comment_line(Lexer* lexer);
 void lexer_skip_comment_block(Lexer* lexer);
 
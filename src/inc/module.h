@@ -1,7 +1,7 @@
 #ifndef MODULE_H
 #define MODULE_H
 
-#include "ast.h"
+#include "value.h"
 #include <stdio.h>
 
 typedef struct {
@@ -14,5 +14,6 @@ typedef struct {
 
 Module* init_module(char* name);
 AST* module_function_call(Module* module, char* func_name, AST** args, size_t arg_size);
+Value module_call(Module* module, char* func_name, Value* args, size_t arg_size);
 
 #endif
@@ -0,0 +1,19 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "parser.h"
+
+typedef struct {
+  // folded literals are allocated next to the nodes they replace
+  Arena* arena;
+  // function declarations
+  AST** function_declarations;
+  size_t function_size;
+} Optimizer;
+
+Optimizer* init_optimizer(Parser* parser);
+
+// rewrites the program in place before either engine sees it
+void optimizer_optimize(Optimizer* optimizer, AST* root);
+
+#endif
@@ -3,22 +3,36 @@
 
 #include "lexer.h"
 #include "ast.h"
+#include "table.h"
+#include "arena.h"
 
 typedef struct {
-  Token** tokens;
-  size_t token_size;
-  unsigned i;
+  // owns every node and array the parser builds
+  Arena* arena;
+  // tokens are pulled from the lexer as the parser needs them
+  Lexer* lexer;
+  // the source the tokens slice into
+  char* src;
+  size_t i;
+
+  // statements and args are stacked here until their list is complete,
+  // then copied into the arena at exactly their size
+  void** list;
+  size_t list_size;
+  size_t list_cap;
 
   // function declaration
   AST** function_declarations;
   size_t function_size;
+  // function name -> index in function_declarations
+  Table* function_table;
 
   // object declaration
   AST** object_declarations;
   size_t object_size;
 } Parser;
 
-Parser* init_parser(Lexer* lexer);
+Parser* init_parser(Lexer* lexer, Arena* arena);
 
 int parser_is_end(Parser* parser);
 Token* parser_peek(Parser* parser);
@@ -0,0 +1,38 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "parser.h"
+
+// depth of a variable that lives in the global scope
+#define RESOLVER_GLOBAL -1
+// depth of a variable that lives in the current call frame
+#define RESOLVER_FRAME -2
+
+typedef struct ResolverScope {
+  char** names;
+  size_t name_size;
+  // frame slot of the first name, nested blocks share the enclosing frame
+  int first_slot;
+  struct ResolverScope* prev;
+} ResolverScope;
+
+typedef struct {
+  // function declarations
+  AST** function_declarations;
+  size_t function_size;
+  Table* function_table;
+  // top-level variables in declaration order
+  ResolverScope* global_scope;
+  // innermost block, null at the top level of the program
+  ResolverScope* scope;
+  // function being resolved, null for the top level
+  AST* function;
+  // frame for the locals of top-level blocks
+  size_t frame_size;
+} Resolver;
+
+Resolver* init_resolver(Parser* parser);
+
+void resolver_resolve(Resolver* resolver, AST* root);
+
+#endif
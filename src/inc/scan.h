@@ -0,0 +1,20 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdlib.h>
+
+typedef enum {
+  SCAN_SCALAR,
+  SCAN_SSE2,
+  SCAN_AVX2,
+} ScanLevel;
+
+// picks the widest scanners the cpu supports, up to max
+ScanLevel scan_init(ScanLevel max);
+
+// each scanner returns the index of the first matching byte at or after i, or size
+extern size_t (*scan_until)(char* src, size_t i, size_t size, char a, char b);
+extern size_t (*scan_skip)(char* src, size_t i, size_t size, char c);
+extern size_t (*scan_ident)(char* src, size_t i, size_t size);
+
+#endif
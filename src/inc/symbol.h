@@ -0,0 +1,9 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <stdlib.h>
+
+// every identifier and string literal is stored once, so equal names share a pointer
+char* symbol_intern(char* src, size_t len);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef TABLE_H
+#define TABLE_H
+
+#include <stdlib.h>
+
+typedef struct {
+  char* key;
+  int val;
+} TableEntry;
+
+// open addressing hash table from interned names to indexes
+typedef struct {
+  TableEntry* entries;
+  size_t size;
+  size_t cap;
+} Table;
+
+Table* init_table();
+
+void table_set(Table* table, char* key, int val);
+int table_get(Table* table, char* key);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef TIER_H
+#define TIER_H
+
+#include "closure.h"
+#include <pthread.h>
+#include <time.h>
+
+// calls of a function, or passes of one of its loops, before it is queued for closures
+#define TIER_CALL_THRESHOLD 100
+#define TIER_LOOP_THRESHOLD 1000
+
+// a function, or the top level after the last function
+typedef struct {
+  // copied when queued, the report may come after the AST is freed
+  char* name;
+  unsigned calls;
+  bool is_queued;
+  // what made it hot, calls or passes of the loop at line, kept for --tier-stats
+  unsigned count;
+  unsigned line;
+  // milliseconds since the program started, ready is 0 until the closures are published
+  double queued_at;
+  double ready_at;
+} TierUnit;
+
+typedef struct Tier {
+  ClosureBuilder* builder;
+  TierUnit* units;
+  size_t unit_size;
+  // units in the order they got hot, the worker takes them from head
+  int* queue;
+  size_t queue_head;
+  size_t queue_size;
+  bool is_done;
+  pthread_t worker;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  struct timespec start;
+} Tier;
+
+// starts the worker that builds closures while visitor runs the program
+Tier* init_tier(Visitor* visitor, ClosureBuilder* builder);
+
+// count a call of function or a pass of loop, and give back its closure once it is built
+Closure* tier_function(Tier* tier, int function);
+Closure* tier_loop(Tier* tier, int function, AST* loop);
+
+// stops the worker after the unit it is building, the AST must outlive it
+void tier_finish(Tier* tier);
+
+void tier_print_stats();
+
+#endif
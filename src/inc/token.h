@@ -19,13 +19,15 @@ typedef enum {
   TOKEN_EOF
 } _TokenType;
 
+// the lexeme is a slice of the source, it is only copied out when the parser needs a name or value
 typedef struct {
   _TokenType type;
-  char* value;
   unsigned line;
+  size_t offset;
+  size_t length;
 } Token;
 
-Token* init_token(_TokenType type, char* value, unsigned line);
+Token init_token(_TokenType type, size_t offset, size_t length, unsigned line);
 char* token_name(_TokenType type);
 
 #endif
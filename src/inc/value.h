@@ -0,0 +1,67 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include "ast.h"
+
+typedef enum {
+  VALUE_UNDEFINED,
+  VALUE_NOOP,
+  VALUE_INT,
+  VALUE_FLOAT,
+  VALUE_STRING,
+  VALUE_BOOL,
+  VALUE_OBJECT,
+} ValueType;
+
+typedef enum {
+  GC_STRING,
+  GC_OBJECT,
+} GCKind;
+
+// header of every allocation owned by the collector, see gc.h
+typedef struct GCObject {
+  struct GCObject* next;
+  size_t size;
+  GCKind kind;
+  bool marked;
+} GCObject;
+
+typedef struct Value {
+  ValueType type;
+  // string was allocated by the collector, not taken from the source or a module
+  bool is_managed;
+  union {
+    int integer;
+    float floating;
+    char* string;
+    bool boolean;
+    struct Object* object;
+  };
+} Value;
+
+typedef struct Object {
+  GCObject gc;
+  AST* declaration;
+  Value fields[];
+} Object;
+
+Value value_int(int val);
+Value value_float(float val);
+Value value_string(char* val);
+Value value_bool(bool val);
+Value value_object(Object* val);
+Value value_noop();
+Value value_undefined();
+// globals hold it until their declaration runs, told apart from a variable declared without a value
+Value value_undeclared();
+bool value_is_undeclared(Value val);
+
+Object* init_object(AST* declaration);
+
+AST* value_to_ast(Value val);
+Value value_from_ast(AST* ast);
+void value_free_ast(AST* ast);
+
+char* value_name(ValueType type);
+
+#endif
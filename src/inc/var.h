@@ -1,22 +1,15 @@
 #ifndef VAR_H
 #define VAR_H
 
-#include "ast.h"
+#include "value.h"
 
 typedef struct Var {
   char* name;
-  union {
-    AST* val;
-    struct {
-      AST* declaration;
-      struct Var** vars;
-      size_t size;
-    } object;
-  };
-  bool is_defined;
+  // VALUE_UNDEFINED until the variable is assigned
+  Value val;
   VariableType type;
 } Var;
 
-Var* init_var(bool is_object, char* name, AST* val, VariableType type, bool is_defined);
+Var* init_var(char* name, Value val, VariableType type);
 
 #endif
@@ -6,8 +6,30 @@
 #include "scope.h"
 #include "module.h"
 
+typedef enum {
+  SIGNAL_NONE,
+  SIGNAL_RETURN,
+  SIGNAL_SKIP,
+  SIGNAL_STOP,
+} Signal;
+
+struct Tier;
+
 typedef struct {
   Scope* global_scope;
+  // set by return, skip and stop until the enclosing function or loop handles it
+  Signal signal;
+  // call frames, each frame_size vars of the function starting at frame
+  Var* stack;
+  size_t stack_size;
+  size_t stack_cap;
+  // closures hold pointers into the stack, so once set it only grows in place,
+  // into address space reserved for stack_max vars
+  bool is_fixed;
+  size_t stack_max;
+  size_t frame;
+  // function whose frame is on top, -1 for the top level
+  int function;
   // function declarations
   AST** function_declarations;
   size_t function_size;
@@ -17,37 +39,43 @@ typedef struct {
   // object declarations
   AST** object_declarations;
   size_t object_size;
+  // switches hot functions and loops to closures, null unless --engine=tiered
+  struct Tier* tier;
 } Visitor;
 
-Visitor* init_visitor(Parser* parser);
-
-void visitor_check_types(bool is_declared, Var* var, _TokenType op, AST* var_val);
-
-AST* visitor_visit(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_compound(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_int(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_float(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_string(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_bool(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_binary(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_unary(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_binary_bool(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_function(Visitor* visitor, Scope* scope, AST* f, AST* f_call);
-AST* visitor_visit_function_call(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_variable_declaration(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_variable(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_variable_assign(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_if(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_else(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_while(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_for(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_return(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_return_val(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_skip(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_stop(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_include(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_module_function_call(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_member_access(Visitor* visitor, Scope* scope, AST* node);
-AST* visitor_visit_member_assign(Visitor* visitor, Scope* scope, AST* node);
+Visitor* init_visitor(Parser* parser, size_t frame_size);
+
+void visitor_fix_stack(Visitor* visitor, size_t max);
+bool visitor_grow_fixed(Visitor* visitor, size_t cap);
+
+void visitor_print_quick_stats();
+
+void visitor_check_types(char* name, VariableType type, Value* dst, _TokenType op, Value val);
+
+Value visitor_visit(Visitor* visitor, AST* node);
+Value visitor_visit_compound(Visitor* visitor, AST* node);
+Value visitor_visit_int(Visitor* visitor, AST* node);
+Value visitor_visit_float(Visitor* visitor, AST* node);
+Value visitor_visit_string(Visitor* visitor, AST* node);
+Value visitor_visit_bool(Visitor* visitor, AST* node);
+Value visitor_visit_binary(Visitor* visitor, AST* node);
+Value visitor_visit_unary(Visitor* visitor, AST* node);
+Value visitor_visit_function(Visitor* visitor, AST* f, AST* f_call);
+Value visitor_call_body(Visitor* visitor, int function, size_t base);
+Value visitor_visit_function_call(Visitor* visitor, AST* node);
+Value visitor_visit_variable_declaration(Visitor* visitor, AST* node);
+Value visitor_visit_variable(Visitor* visitor, AST* node);
+Value visitor_visit_variable_assign(Visitor* visitor, AST* node);
+Value visitor_visit_if(Visitor* visitor, AST* node);
+Value visitor_visit_else(Visitor* visitor, AST* node);
+Value visitor_visit_while(Visitor* visitor, AST* node);
+Value visitor_visit_for(Visitor* visitor, AST* node);
+Value visitor_visit_return(Visitor* visitor, AST* node);
+Value visitor_visit_skip(Visitor* visitor, AST* node);
+Value visitor_visit_stop(Visitor* visitor, AST* node);
+Value visitor_visit_include(Visitor* visitor, AST* node);
+Value visitor_visit_module_function_call(Visitor* visitor, AST* node);
+Value visitor_visit_member_access(Visitor* visitor, AST* node);
+Value visitor_visit_member_assign(Visitor* visitor, AST* node);
 
 #endif
@@ -0,0 +1,43 @@
+#ifndef VM_H
+#define VM_H
+
+#include "bytecode.h"
+#include "module.h"
+
+typedef enum {
+  JIT_OFF,     // interpret everything
+  JIT_ON,      // compile functions once their calls or loops get hot
+  JIT_ALWAYS,  // compile every function before it first runs
+} JitMode;
+
+typedef struct {
+  Function* function;
+  Instr* ip;
+  size_t base;
+} Frame;
+
+typedef struct {
+  Program* program;
+  Value* globals;
+  // register stack shared by all call frames
+  Value* stack;
+  size_t stack_size;
+  Frame* frames;
+  size_t frame_size, frame_cap;
+  // included modules
+  Module** modules;
+  size_t module_size;
+  JitMode jit;
+  // native code entered and not yet returned, each one holds C stack
+  size_t native_depth;
+  size_t native_limit;
+} VM;
+
+VM* init_vm(Program* program);
+
+void vm_run(VM* vm);
+// runs the instruction at ip for the top frame through the interpreter,
+// native code calls it for everything it does not emit itself
+void vm_step(VM* vm, Instr* ip);
+
+#endif
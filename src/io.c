@@ -1,23 +1,82 @@
 #include "inc/io.h"
 #include <stdio.h>
-#include <stdlib.h>
 
-char* read_file(char* path)
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+static Source* source_error(char* path)
+{
+	printf("No file found named \"%s\"\n", path);
+	return (void*)0;
+}
+
+Source* read_source(char* path)
 {
-	FILE* file = fopen(path, "r");
-	if (!file) {
-		printf("No file found named \"%s\"\n", path);
-		return (void*)0;
-	} else {
-		fseek(file, 0, SEEK_END);
-		unsigned len = ftell(file);
-		char* content = calloc(len + 1, sizeof(char));
-		fseek(file, 0, SEEK_SET);
-		if (content) {
-			fread(content, sizeof(char), len, file);
+	Source* source = calloc(1, sizeof(Source));
+	source->data = "";
+	source->size = 0;
+	source->is_mapped = false;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, (void*)0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, (void*)0);
+	if (file == INVALID_HANDLE_VALUE) {
+		free(source);
+		return source_error(path);
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	source->size = size.QuadPart;
+	if (source->size) {
+		HANDLE mapping = CreateFileMappingA(file, (void*)0, PAGE_READONLY, 0, 0, (void*)0);
+		source->data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : (void*)0;
+		if (mapping) CloseHandle(mapping);
+		if (!source->data) {
+			CloseHandle(file);
+			free(source);
+			return source_error(path);
+		}
+		source->is_mapped = true;
+	}
+	CloseHandle(file);
+#else
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		if (fd >= 0) close(fd);
+		free(source);
+		return source_error(path);
+	}
+	source->size = st.st_size;
+	// mmap refuses empty files, those keep the static empty string
+	if (source->size) {
+		source->data = mmap((void*)0, source->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (source->data == MAP_FAILED) {
+			close(fd);
+			free(source);
+			return source_error(path);
 		}
-		fclose(file);
-		content[len] = '\0';
-		return content;
+		source->is_mapped = true;
+	}
+	close(fd);
+#endif
+
+	return source;
+}
+
+void source_free(Source* source)
+{
+	if (source->is_mapped) {
+#ifdef _WIN32
+		UnmapViewOfFile(source->data);
+#else
+		munmap(source->data, source->size);
+#endif
 	}
+	free(source);
 }
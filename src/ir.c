@@ -0,0 +1,1309 @@
+#include "inc/ir.h"
+#include "inc/builtin.h"
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+// loads look back through at most this many stores for the one they read
+#define IR_WALK_LIMIT 32
+#define IR_BUCKET_SIZE 4096
+
+// register states while lowering checks where each value is still held
+#define IR_TOP -2
+#define IR_UNKNOWN -3
+
+typedef enum {
+  IR_IMM,     // constant, slot, field, name or count
+  IR_DEF,     // register written
+  IR_USE,     // register read, any register holding the same value will do
+  IR_TARGET,  // pc of a jump
+} IrField;
+
+// values already computed on the way down the dominator tree
+typedef struct {
+  Opcode op;
+  int x, y, z;
+  int value;
+  int next;
+} IrEntry;
+
+typedef struct {
+  IrEntry* entries;
+  size_t size, cap;
+  int* buckets;
+} IrTable;
+
+// calls and counted loops read fixed registers, see ir_instr
+static void ir_fields(Opcode op, IrField fields[3])
+{
+  fields[0] = fields[1] = fields[2] = IR_IMM;
+  switch (op) {
+    case OP_LOADK: case OP_UNDEF: case OP_GETGLOBAL: case OP_NEWOBJ:
+      fields[0] = IR_DEF;
+      break;
+    case OP_MOVE: case OP_NEG: case OP_NOT: case OP_GETFIELD:
+    case OP_CONV_INT: case OP_CONV_FLOAT: case OP_CHECK_STRING: case OP_CHECK_BOOL: case OP_CHECK_OBJECT:
+    case OP_SHLI: case OP_SHRI: case OP_ANDI:
+      fields[0] = IR_DEF;
+      fields[1] = IR_USE;
+      break;
+    case OP_TESTDEF: case OP_SETGLOBAL: case OP_RETURN:
+      fields[0] = IR_USE;
+      break;
+    case OP_SETFIELD:
+      fields[0] = IR_USE;
+      fields[2] = IR_USE;
+      break;
+    case OP_JMP:
+      fields[0] = IR_TARGET;
+      break;
+    case OP_JMPF: case OP_ANDJMP: case OP_ORJMP:
+      fields[0] = IR_USE;
+      fields[1] = IR_TARGET;
+      break;
+    default:
+      if (op >= OP_ADD && op <= OP_LEF) {
+        fields[0] = IR_DEF;
+        fields[1] = fields[2] = IR_USE;
+      } else if (op >= OP_IFEQI && op <= OP_IFLEF) {
+        fields[0] = fields[1] = IR_USE;
+        fields[2] = IR_TARGET;
+      } else if (op >= OP_FORLT && op <= OP_FORGE) {
+        fields[2] = IR_TARGET;
+      }
+      break;
+  }
+}
+
+static bool ir_is_call(Opcode op)
+{
+  return op == OP_CALL || op == OP_BUILTIN || op == OP_MODCALL;
+}
+
+static bool ir_is_for(Opcode op)
+{
+  return op >= OP_FORLT && op <= OP_FORGE;
+}
+
+static int* ir_target_field(Instr* ip)
+{
+  IrField fields[3];
+  ir_fields(ip->op, fields);
+  int* operands[3] = { &ip->a, &ip->b, &ip->c };
+  for (int i = 0; i < 3; i++) {
+    if (fields[i] == IR_TARGET) return operands[i];
+  }
+  return (void*)0;
+}
+
+static bool ir_falls_through(Opcode op)
+{
+  return op != OP_JMP && op != OP_RETURN && op != OP_RETURN0 && op != OP_HALT;
+}
+
+static int ir_def(Instr* ip)
+{
+  IrField fields[3];
+  ir_fields(ip->op, fields);
+  if (fields[0] == IR_DEF || ir_is_call(ip->op) || ir_is_for(ip->op)) return ip->a;
+  return -1;
+}
+
+static bool ir_writes_memory(Opcode op)
+{
+  // module functions get no objects, but are left opaque like calls
+  return op == OP_SETGLOBAL || op == OP_SETFIELD || op == OP_CALL || op == OP_MODCALL;
+}
+
+static void ir_append(int** list, size_t* size, int item)
+{
+  (*size)++;
+  *list = realloc(*list, *size * sizeof(int));
+  (*list)[*size - 1] = item;
+}
+
+static int ir_add_value(IrFunction* ir, IrKind kind, int block, int reg)
+{
+  if (ir->value_size == ir->value_cap) {
+    ir->value_cap = ir->value_cap ? ir->value_cap * 2 : 256;
+    ir->values = realloc(ir->values, ir->value_cap * sizeof(IrValue));
+  }
+  ir->values[ir->value_size] = (IrValue) {
+    .kind = kind, .block = block, .reg = reg, .uses = (void*)0, .use_size = 0,
+    .mem = -1, .same = -1, .copy_of = -1, .copy = -1,
+  };
+  return ir->value_size++;
+}
+
+static void ir_add_use(IrFunction* ir, int value, int used, int reg, int field)
+{
+  IrValue* v = &ir->values[value];
+  v->use_size++;
+  v->uses = realloc(v->uses, v->use_size * sizeof(IrUse));
+  v->uses[v->use_size - 1] = (IrUse) { used, reg, field };
+}
+
+static int ir_same(IrFunction* ir, int value)
+{
+  while (ir->values[value].same >= 0) {
+    value = ir->values[value].same;
+  }
+  return value;
+}
+
+// what a read that may come from any register gets
+static int ir_source(IrFunction* ir, int value)
+{
+  value = ir_same(ir, value);
+  while (ir->values[value].copy_of >= 0) {
+    value = ir_same(ir, ir->values[value].copy_of);
+  }
+  return value;
+}
+
+static int ir_final(IrFunction* ir, IrUse* use)
+{
+  return use->field >= 0 ? ir_source(ir, use->value) : ir_same(ir, use->value);
+}
+
+static bool ir_int_const(IrFunction* ir, int value, int* k)
+{
+  IrValue* v = &ir->values[ir_source(ir, value)];
+  while (v->kind == IR_INSTR && v->instr.op == OP_MOVE) {
+    v = &ir->values[ir_source(ir, v->uses[0].value)];
+  }
+  if (v->kind != IR_INSTR || v->instr.op != OP_LOADK) return false;
+  Value val = ir->function->consts[v->instr.b];
+  if (val.type != VALUE_INT) return false;
+  *k = val.integer;
+  return true;
+}
+
+static int ir_log2(int k)
+{
+  if (k <= 0 || (k & (k - 1))) return -1;
+  int n = 0;
+  while ((1 << n) != k) n++;
+  return n;
+}
+
+static void ir_add_block(IrFunction* ir, int start, int end)
+{
+  ir->block_size++;
+  ir->blocks = realloc(ir->blocks, ir->block_size * sizeof(IrBlock));
+  ir->blocks[ir->block_size - 1] = (IrBlock) { .start = start, .end = end, .idom = -1, .order = -1 };
+}
+
+static void ir_add_succ(IrBlock* block, int succ)
+{
+  // a branch to the next instruction is one edge
+  if (block->succ_size && block->succs[0] == succ) return;
+  block->succs[block->succ_size++] = succ;
+}
+
+static void ir_visit_block(IrFunction* ir, int b, int* post, size_t* post_size)
+{
+  ir->blocks[b].is_reachable = true;
+  for (int i = 0; i < ir->blocks[b].succ_size; i++) {
+    int succ = ir->blocks[b].succs[i];
+    if (!ir->blocks[succ].is_reachable) {
+      ir_visit_block(ir, succ, post, post_size);
+    }
+  }
+  post[(*post_size)++] = b;
+}
+
+// false for code the pass does not handle, which then stays as compiled
+static bool ir_build_blocks(IrFunction* ir)
+{
+  Function* function = ir->function;
+  size_t size = function->code_size;
+  if (size == 0 || ir_falls_through(function->code[size - 1].op)) return false;
+
+  bool* is_leader = calloc(size + 1, sizeof(bool));
+  is_leader[0] = true;
+  for (int pc = 0; pc < size; pc++) {
+    Instr* ip = &function->code[pc];
+    if (ip->op == OP_YIELD) {
+      free(is_leader);
+      return false;
+    }
+    int* target = ir_target_field(ip);
+    if (target) {
+      if (*target < 0 || *target >= size) {
+        free(is_leader);
+        return false;
+      }
+      is_leader[*target] = true;
+      is_leader[pc + 1] = true;
+    } else if (!ir_falls_through(ip->op)) {
+      is_leader[pc + 1] = true;
+    }
+  }
+
+  ir->block_of = malloc(size * sizeof(int));
+  // block 0 runs once before pc 0, even when a loop jumps back to it
+  ir_add_block(ir, 0, 0);
+  for (int pc = 0; pc < size; pc++) {
+    if (is_leader[pc]) {
+      if (ir->block_size > 1) ir->blocks[ir->block_size - 1].end = pc;
+      ir_add_block(ir, pc, size);
+    }
+    ir->block_of[pc] = ir->block_size - 1;
+  }
+  free(is_leader);
+
+  ir_add_succ(&ir->blocks[0], 1);
+  for (int b = 1; b < ir->block_size; b++) {
+    IrBlock* block = &ir->blocks[b];
+    Instr* last = &function->code[block->end - 1];
+    if (ir_falls_through(last->op)) ir_add_succ(block, b + 1);
+    int* target = ir_target_field(last);
+    if (target) ir_add_succ(block, ir->block_of[*target]);
+  }
+
+  int* post = malloc(ir->block_size * sizeof(int));
+  size_t post_size = 0;
+  ir_visit_block(ir, 0, post, &post_size);
+  ir->rpo = malloc(post_size * sizeof(int));
+  ir->rpo_size = post_size;
+  for (int i = 0; i < post_size; i++) {
+    ir->rpo[i] = post[post_size - 1 - i];
+    ir->blocks[ir->rpo[i]].order = i;
+  }
+  free(post);
+
+  // unreachable code takes no part, it is dropped when lowering
+  for (int i = 0; i < ir->rpo_size; i++) {
+    IrBlock* block = &ir->blocks[ir->rpo[i]];
+    for (int j = 0; j < block->succ_size; j++) {
+      IrBlock* succ = &ir->blocks[block->succs[j]];
+      ir_append(&succ->preds, &succ->pred_size, ir->rpo[i]);
+    }
+  }
+  return true;
+}
+
+static int ir_intersect(IrFunction* ir, int a, int b)
+{
+  while (a != b) {
+    while (ir->blocks[a].order > ir->blocks[b].order) a = ir->blocks[a].idom;
+    while (ir->blocks[b].order > ir->blocks[a].order) b = ir->blocks[b].idom;
+  }
+  return a;
+}
+
+static bool ir_dominates(IrFunction* ir, int a, int b)
+{
+  while (b != a && b != 0) {
+    b = ir->blocks[b].idom;
+  }
+  return b == a;
+}
+
+// iterative dominators over the reverse postorder, then the dominance frontiers
+static void ir_dominators(IrFunction* ir)
+{
+  ir->blocks[0].idom = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 1; i < ir->rpo_size; i++) {
+      IrBlock* block = &ir->blocks[ir->rpo[i]];
+      int idom = -1;
+      for (int j = 0; j < block->pred_size; j++) {
+        int pred = block->preds[j];
+        if (ir->blocks[pred].idom < 0) continue;
+        idom = idom < 0 ? pred : ir_intersect(ir, pred, idom);
+      }
+      if (block->idom != idom) {
+        block->idom = idom;
+        changed = true;
+      }
+    }
+  }
+
+  for (int b = 1; b < ir->block_size; b++) {
+    IrBlock* block = &ir->blocks[b];
+    if (!block->is_reachable) continue;
+    ir_append(&ir->blocks[block->idom].children, &ir->blocks[block->idom].child_size, b);
+    if (block->pred_size < 2) continue;
+    for (int j = 0; j < block->pred_size; j++) {
+      int runner = block->preds[j];
+      while (runner != block->idom) {
+        IrBlock* r = &ir->blocks[runner];
+        if (!r->frontier_size || r->frontier[r->frontier_size - 1] != b) {
+          ir_append(&r->frontier, &r->frontier_size, b);
+        }
+        runner = r->idom;
+      }
+    }
+  }
+}
+
+// a phi for every register, and for memory, where differing definitions meet
+static void ir_place_phis(IrFunction* ir)
+{
+  size_t regs = ir->reg_size + 1;
+  int** defs = calloc(regs, sizeof(int*));
+  size_t* def_sizes = calloc(regs, sizeof(size_t));
+  for (int i = 0; i < ir->rpo_size; i++) {
+    int b = ir->rpo[i];
+    IrBlock* block = &ir->blocks[b];
+    for (int pc = block->start; pc < block->end; pc++) {
+      Instr* ip = &ir->function->code[pc];
+      int reg = ir_def(ip);
+      if (reg >= 0 && (!def_sizes[reg] || defs[reg][def_sizes[reg] - 1] != b)) {
+        ir_append(&defs[reg], &def_sizes[reg], b);
+      }
+      if (ir_writes_memory(ip->op) && (!def_sizes[ir->reg_size] || defs[ir->reg_size][def_sizes[ir->reg_size] - 1] != b)) {
+        ir_append(&defs[ir->reg_size], &def_sizes[ir->reg_size], b);
+      }
+    }
+  }
+
+  // stamps of the register a block last got a phi for, or was queued for
+  int* placed = malloc(ir->block_size * sizeof(int));
+  int* queued = malloc(ir->block_size * sizeof(int));
+  for (int b = 0; b < ir->block_size; b++) {
+    placed[b] = queued[b] = -1;
+  }
+  int* work = malloc(ir->block_size * sizeof(int));
+  for (int reg = 0; reg < regs; reg++) {
+    size_t work_size = 0;
+    for (int i = 0; i < def_sizes[reg]; i++) {
+      queued[defs[reg][i]] = reg;
+      work[work_size++] = defs[reg][i];
+    }
+    while (work_size) {
+      IrBlock* block = &ir->blocks[work[--work_size]];
+      for (int i = 0; i < block->frontier_size; i++) {
+        int f = block->frontier[i];
+        if (placed[f] == reg) continue;
+        placed[f] = reg;
+        IrBlock* frontier = &ir->blocks[f];
+        int phi = ir_add_value(ir, IR_PHI, f, reg == ir->reg_size ? -1 : reg);
+        ir->values[phi].is_memory = reg == ir->reg_size;
+        for (int j = 0; j < frontier->pred_size; j++) {
+          ir_add_use(ir, phi, -1, reg, -1);
+        }
+        ir_append(&frontier->values, &frontier->value_size, phi);
+        if (queued[f] != reg) {
+          queued[f] = reg;
+          work[work_size++] = f;
+        }
+      }
+    }
+    free(defs[reg]);
+  }
+  free(work);
+  free(placed);
+  free(queued);
+  free(defs);
+  free(def_sizes);
+}
+
+static void ir_instr(IrFunction* ir, int block, int pc, int* map)
+{
+  Instr* ip = &ir->function->code[pc];
+  int id = ir_add_value(ir, IR_INSTR, block, ir_def(ip));
+  ir->values[id].instr = *ip;
+
+  IrField fields[3];
+  ir_fields(ip->op, fields);
+  int operands[3] = { ip->a, ip->b, ip->c };
+  for (int i = 0; i < 3; i++) {
+    if (fields[i] == IR_USE) ir_add_use(ir, id, map[operands[i]], operands[i], i);
+  }
+  if (ir_is_call(ip->op)) {
+    for (int i = 0; i < ip->c; i++) {
+      ir_add_use(ir, id, map[ip->a + i], ip->a + i, -1);
+    }
+  } else if (ir_is_for(ip->op)) {
+    // counter, bound and the step right after it
+    ir_add_use(ir, id, map[ip->a], ip->a, -1);
+    ir_add_use(ir, id, map[ip->b], ip->b, -1);
+    ir_add_use(ir, id, map[ip->b + 1], ip->b + 1, -1);
+  }
+
+  int memory = ir->reg_size;
+  if (ip->op == OP_GETGLOBAL || ip->op == OP_GETFIELD) {
+    ir->values[id].mem = map[memory];
+  } else if (ir_writes_memory(ip->op)) {
+    ir->values[id].mem = map[memory];
+    ir->values[id].is_memory = true;
+    map[memory] = id;
+  }
+  if (ir->values[id].reg >= 0) map[ir->values[id].reg] = id;
+  ir_append(&ir->blocks[block].values, &ir->blocks[block].value_size, id);
+}
+
+// names every definition down the dominator tree and fills in the phis
+static void ir_rename(IrFunction* ir, int b, int* map)
+{
+  size_t regs = ir->reg_size + 1;
+  int* saved = malloc(regs * sizeof(int));
+  memcpy(saved, map, regs * sizeof(int));
+
+  IrBlock* block = &ir->blocks[b];
+  for (int i = 0; i < block->value_size; i++) {
+    IrValue* phi = &ir->values[block->values[i]];
+    map[phi->is_memory ? ir->reg_size : phi->reg] = block->values[i];
+  }
+  for (int pc = block->start; pc < block->end; pc++) {
+    ir_instr(ir, b, pc, map);
+  }
+
+  block = &ir->blocks[b];
+  for (int i = 0; i < block->succ_size; i++) {
+    IrBlock* succ = &ir->blocks[block->succs[i]];
+    int from;
+    for (from = 0; succ->preds[from] != b; from++);
+    for (int j = 0; j < succ->value_size; j++) {
+      IrValue* phi = &ir->values[succ->values[j]];
+      if (phi->kind != IR_PHI) break;
+      phi->uses[from].value = map[phi->is_memory ? ir->reg_size : phi->reg];
+    }
+  }
+  for (int i = 0; i < ir->blocks[b].child_size; i++) {
+    ir_rename(ir, ir->blocks[b].children[i], map);
+  }
+
+  memcpy(map, saved, regs * sizeof(int));
+  free(saved);
+}
+
+static void ir_build_ssa(IrFunction* ir)
+{
+  ir_dominators(ir);
+  // entry values are 0 to reg_size - 1 for the registers, reg_size for memory
+  for (int reg = 0; reg <= ir->reg_size; reg++) {
+    int entry = ir_add_value(ir, IR_ENTRY, 0, reg == ir->reg_size ? -1 : reg);
+    ir->values[entry].is_memory = reg == ir->reg_size;
+    // registers past the args start out undefined
+    ir->values[entry].maybe_undefined = reg >= ir->function->arg_size && reg < ir->reg_size;
+  }
+  ir_place_phis(ir);
+  int* map = malloc((ir->reg_size + 1) * sizeof(int));
+  for (int reg = 0; reg <= ir->reg_size; reg++) {
+    map[reg] = reg;
+  }
+  ir_rename(ir, 0, map);
+  free(map);
+
+  // a phi of one value and itself is that value
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int id = 0; id < ir->value_size; id++) {
+      IrValue* phi = &ir->values[id];
+      if (phi->kind != IR_PHI || phi->same >= 0) continue;
+      int only = -1;
+      bool is_trivial = true;
+      for (int i = 0; i < phi->use_size && is_trivial; i++) {
+        int v = ir_same(ir, phi->uses[i].value);
+        if (v == id) continue;
+        if (only < 0) {
+          only = v;
+        } else if (v != only) {
+          is_trivial = false;
+        }
+      }
+      if (is_trivial && only >= 0) {
+        phi->same = only;
+        changed = true;
+      }
+    }
+  }
+}
+
+// undefined values reach only through copies and phis
+static void ir_find_undefined(IrFunction* ir)
+{
+  for (int id = 0; id < ir->value_size; id++) {
+    IrValue* v = &ir->values[id];
+    if (v->kind == IR_INSTR) {
+      Opcode op = v->instr.op;
+      v->maybe_undefined = op == OP_UNDEF || op == OP_BUILTIN || op == OP_MODCALL;
+    }
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int id = 0; id < ir->value_size; id++) {
+      IrValue* v = &ir->values[id];
+      if (v->maybe_undefined || v->same >= 0) continue;
+      if (v->kind != IR_PHI && !(v->kind == IR_INSTR && v->instr.op == OP_MOVE)) continue;
+      for (int i = 0; i < v->use_size; i++) {
+        if (ir->values[ir_same(ir, v->uses[i].value)].maybe_undefined) {
+          v->maybe_undefined = true;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+}
+
+static bool ir_nonnegative(IrFunction* ir, int value)
+{
+  return ir->values[ir_same(ir, value)].is_nonnegative;
+}
+
+// ints wrap, so a counted loop only stays not negative when its counter starts at
+// constants and steps a constant amount toward a constant bound it cannot step past
+static bool ir_counter_nonnegative(IrFunction* ir, int id)
+{
+  IrValue* v = &ir->values[id];
+  int bound, step;
+  if (!ir_int_const(ir, v->uses[2].value, &step) || step < 0) return false;
+  if (!ir_int_const(ir, v->uses[1].value, &bound) || bound > INT_MAX - step) return false;
+  // the counter the body left must be the loop's own phi, fed only by this step
+  IrValue* phi = &ir->values[ir_same(ir, v->uses[0].value)];
+  if (phi->kind != IR_PHI) return false;
+  for (int i = 0; i < phi->use_size; i++) {
+    int start;
+    int used = ir_same(ir, phi->uses[i].value);
+    if (used == id) continue;
+    if (!ir_int_const(ir, used, &start) || start < 0 || start > INT_MAX - step) return false;
+  }
+  return true;
+}
+
+static bool ir_is_nonnegative(IrFunction* ir, int id)
+{
+  IrValue* v = &ir->values[id];
+  if (v->kind == IR_PHI) {
+    for (int i = 0; i < v->use_size; i++) {
+      if (!ir_nonnegative(ir, v->uses[i].value)) return false;
+    }
+    return true;
+  }
+  if (v->kind != IR_INSTR) return false;
+  switch (v->instr.op) {
+    case OP_LOADK: {
+      Value val = ir->function->consts[v->instr.b];
+      return val.type == VALUE_INT && val.integer >= 0;
+    }
+    case OP_MOVE: case OP_MODI: case OP_SHRI:
+      return ir_nonnegative(ir, v->uses[0].value);
+    case OP_ANDI:
+      return v->instr.c >= 0;
+    case OP_DIVI:
+      return ir_nonnegative(ir, v->uses[0].value) && ir_nonnegative(ir, v->uses[1].value);
+    case OP_FORLT: case OP_FORLE:
+      return ir_counter_nonnegative(ir, id);
+    default:
+      return false;
+  }
+}
+
+// everything starts out not negative and is cleared until nothing changes,
+// so counters stay not negative through the phis of their loops
+static void ir_find_nonnegative(IrFunction* ir)
+{
+  for (int id = 0; id < ir->value_size; id++) {
+    ir->values[id].is_nonnegative = ir->values[id].kind != IR_ENTRY;
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int id = 0; id < ir->value_size; id++) {
+      IrValue* v = &ir->values[id];
+      if (v->is_nonnegative && v->same < 0 && !ir_is_nonnegative(ir, id)) {
+        v->is_nonnegative = false;
+        changed = true;
+      }
+    }
+  }
+}
+
+static unsigned ir_hash(Opcode op, int x, int y, int z)
+{
+  unsigned h = op;
+  h = h * 31 + x;
+  h = h * 31 + y;
+  h = h * 31 + z;
+  return h & (IR_BUCKET_SIZE - 1);
+}
+
+static int ir_table_find(IrTable* table, Opcode op, int x, int y, int z)
+{
+  for (int i = table->buckets[ir_hash(op, x, y, z)]; i >= 0; i = table->entries[i].next) {
+    IrEntry* e = &table->entries[i];
+    if (e->op == op && e->x == x && e->y == y && e->z == z) return e->value;
+  }
+  return -1;
+}
+
+static void ir_table_add(IrTable* table, Opcode op, int x, int y, int z, int value)
+{
+  if (table->size == table->cap) {
+    table->cap = table->cap ? table->cap * 2 : 256;
+    table->entries = realloc(table->entries, table->cap * sizeof(IrEntry));
+  }
+  unsigned h = ir_hash(op, x, y, z);
+  table->entries[table->size] = (IrEntry) { op, x, y, z, value, table->buckets[h] };
+  table->buckets[h] = table->size++;
+}
+
+// forgets what was added since mark, leaving a dominator subtree
+static void ir_table_pop(IrTable* table, size_t mark)
+{
+  while (table->size > mark) {
+    IrEntry* e = &table->entries[--table->size];
+    table->buckets[ir_hash(e->op, e->x, e->y, e->z)] = e->next;
+  }
+}
+
+static void ir_to_copy(IrFunction* ir, int id, int source)
+{
+  IrValue* v = &ir->values[id];
+  v->instr.op = OP_MOVE;
+  v->uses = realloc(v->uses, sizeof(IrUse));
+  v->uses[0] = (IrUse) { source, ir->values[source].reg, 1 };
+  v->use_size = 1;
+  v->mem = -1;
+  v->copy_of = source;
+}
+
+static void ir_to_unary(IrFunction* ir, int id, Opcode op, int operand, int c)
+{
+  IrValue* v = &ir->values[id];
+  v->instr.op = op;
+  v->instr.c = c;
+  v->uses[0] = (IrUse) { operand, ir->values[operand].reg, 1 };
+  v->use_size = 1;
+}
+
+// int multiplication, division and modulo by powers of two
+static void ir_reduce(IrFunction* ir, int id)
+{
+  IrValue* v = &ir->values[id];
+  Opcode op = v->instr.op;
+  if (op != OP_MULI && op != OP_DIVI && op != OP_MODI) return;
+  int left = v->uses[0].value, right = v->uses[1].value;
+  int k;
+  if (op == OP_MULI && !ir_int_const(ir, right, &k)) {
+    int swap = left;
+    left = right;
+    right = swap;
+  }
+  if (!ir_int_const(ir, right, &k)) return;
+  int shift = ir_log2(k);
+  if (shift < 0) return;
+  if (op != OP_MULI && !ir_nonnegative(ir, left)) return;
+
+  if (op == OP_MODI) {
+    ir_to_unary(ir, id, OP_ANDI, left, k - 1);
+  } else if (shift == 0) {
+    ir_to_copy(ir, id, left);
+  } else {
+    ir_to_unary(ir, id, op == OP_MULI ? OP_SHLI : OP_SHRI, left, shift);
+  }
+  ir->reduced++;
+}
+
+// the state a load of slot depends on, looking back through stores that do
+// not touch it; stored is the value a store of the same slot left there
+static int ir_walk(IrFunction* ir, int mem, Opcode op, int slot, int object, int* stored)
+{
+  *stored = -1;
+  for (int steps = 0; steps < IR_WALK_LIMIT; steps++) {
+    IrValue* m = &ir->values[mem];
+    if (m->kind != IR_INSTR) return mem;
+    if (m->instr.op == OP_SETGLOBAL) {
+      if (op == OP_GETGLOBAL && m->instr.b == slot) {
+        *stored = ir_source(ir, m->uses[0].value);
+        return mem;
+      }
+    } else if (m->instr.op == OP_SETFIELD) {
+      // another object may be the same one
+      if (op == OP_GETFIELD && m->instr.b == slot) {
+        if (ir_source(ir, m->uses[0].value) == object) *stored = ir_source(ir, m->uses[1].value);
+        return mem;
+      }
+    } else {
+      return mem;
+    }
+    mem = ir_same(ir, m->mem);
+  }
+  return mem;
+}
+
+static bool ir_is_commutative(Opcode op)
+{
+  switch (op) {
+    case OP_ADDI: case OP_MULI: case OP_EQI: case OP_NEI:
+    case OP_ADDF: case OP_MULF: case OP_EQF: case OP_NEF:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// the same operation on the same values gives the same result, errors included,
+// so only the first of them has to run
+static bool ir_is_numbered(Opcode op)
+{
+  switch (op) {
+    case OP_LOADK: case OP_NEG: case OP_NOT:
+    case OP_CONV_INT: case OP_CONV_FLOAT: case OP_CHECK_STRING: case OP_CHECK_BOOL: case OP_CHECK_OBJECT:
+    case OP_SHLI: case OP_SHRI: case OP_ANDI:
+      return true;
+    default:
+      return op >= OP_ADD && op <= OP_LEF;
+  }
+}
+
+static void ir_number_value(IrFunction* ir, IrTable* table, int id)
+{
+  IrValue* v = &ir->values[id];
+  for (int i = 0; i < v->use_size; i++) {
+    IrUse* use = &v->uses[i];
+    int same = ir_same(ir, use->value);
+    use->value = ir_final(ir, use);
+    if (use->value != same) ir->copies++;
+  }
+  if (v->mem >= 0) v->mem = ir_same(ir, v->mem);
+
+  if (v->instr.op == OP_MOVE) {
+    v->copy_of = v->uses[0].value;
+    return;
+  }
+  ir_reduce(ir, id);
+  v = &ir->values[id];
+  Opcode op = v->instr.op;
+  if (op == OP_MOVE) return;
+
+  if (op == OP_TESTDEF) {
+    int tested = v->uses[0].value;
+    if (!ir->values[tested].maybe_undefined || ir_table_find(table, op, tested, 0, 0) >= 0) {
+      v->is_removed = true;
+      ir->tests++;
+    } else {
+      ir_table_add(table, op, tested, 0, 0, id);
+    }
+    return;
+  }
+
+  int x, y = 0, z = 0;
+  if (op == OP_GETGLOBAL || op == OP_GETFIELD) {
+    int stored;
+    int slot = op == OP_GETGLOBAL ? v->instr.b : FIELD_INDEX(v->instr.c);
+    int object = op == OP_GETFIELD ? v->uses[0].value : -1;
+    int mem = ir_walk(ir, v->mem, op, slot, object, &stored);
+    // the load reports an undefined value, a copy would not
+    if (stored >= 0 && !ir->values[stored].maybe_undefined) {
+      ir_to_copy(ir, id, stored);
+      ir->forwarded++;
+      return;
+    }
+    x = slot;
+    y = object;
+    z = mem;
+  } else if (ir_is_numbered(op)) {
+    if (op == OP_LOADK) {
+      x = v->instr.b;
+    } else {
+      x = v->uses[0].value;
+      if (v->use_size > 1) {
+        y = v->uses[1].value;
+      } else if (op == OP_SHLI || op == OP_SHRI || op == OP_ANDI || op == OP_CHECK_OBJECT) {
+        y = v->instr.c;
+      }
+      if (ir_is_commutative(op) && x > y) {
+        int swap = x;
+        x = y;
+        y = swap;
+      }
+    }
+  } else {
+    return;
+  }
+
+  int leader = ir_table_find(table, op, x, y, z);
+  if (leader >= 0) {
+    ir_to_copy(ir, id, leader);
+    ir->numbered++;
+  } else {
+    ir_table_add(table, op, x, y, z, id);
+  }
+}
+
+// global value numbering down the dominator tree, with loads forwarded from
+// stores, copies propagated and strength reduced on the way
+static void ir_number(IrFunction* ir, IrTable* table, int b)
+{
+  size_t mark = table->size;
+  for (int i = 0; i < ir->blocks[b].value_size; i++) {
+    int id = ir->blocks[b].values[i];
+    if (ir->values[id].kind == IR_INSTR) ir_number_value(ir, table, id);
+  }
+  for (int i = 0; i < ir->blocks[b].child_size; i++) {
+    ir_number(ir, table, ir->blocks[b].children[i]);
+  }
+  ir_table_pop(table, mark);
+}
+
+// instructions that neither fail nor do anything but give a value
+static bool ir_is_removable(IrFunction* ir, IrValue* v)
+{
+  Opcode op = v->instr.op;
+  switch (op) {
+    case OP_LOADK: case OP_UNDEF: case OP_MOVE: case OP_NEWOBJ:
+    case OP_SHLI: case OP_SHRI: case OP_ANDI:
+      return true;
+    case OP_DIVI: case OP_MODI: {
+      // the interpreter traps on these
+      int k;
+      return ir_int_const(ir, v->uses[1].value, &k) && k != 0 && k != -1;
+    }
+    default:
+      return op >= OP_ADDI && op <= OP_LEF;
+  }
+}
+
+static void ir_mark(IrFunction* ir, int value, int* work, size_t* work_size)
+{
+  IrValue* v = &ir->values[value];
+  if (v->is_live) return;
+  v->is_live = true;
+  work[(*work_size)++] = value;
+}
+
+static void ir_remove_dead(IrFunction* ir)
+{
+  int* work = malloc(ir->value_size * sizeof(int));
+  size_t work_size = 0;
+  for (int id = 0; id < ir->value_size; id++) {
+    IrValue* v = &ir->values[id];
+    if (v->kind == IR_INSTR && !v->is_removed && !ir_is_removable(ir, v)) {
+      ir_mark(ir, id, work, &work_size);
+    }
+  }
+  while (work_size) {
+    IrValue* v = &ir->values[work[--work_size]];
+    for (int i = 0; i < v->use_size; i++) {
+      ir_mark(ir, ir_final(ir, &v->uses[i]), work, &work_size);
+    }
+    if (v->mem >= 0) ir_mark(ir, ir_same(ir, v->mem), work, &work_size);
+  }
+  free(work);
+
+  for (int id = 0; id < ir->value_size; id++) {
+    IrValue* v = &ir->values[id];
+    if (v->kind == IR_INSTR && !v->is_removed && !v->is_live) {
+      v->is_removed = true;
+      ir->dead++;
+    }
+  }
+}
+
+static bool ir_reads_reg(IrFunction* ir, IrValue* v, int reg)
+{
+  for (int i = 0; i < v->use_size; i++) {
+    IrUse* use = &v->uses[i];
+    int read = use->field >= 0 ? ir->values[ir_final(ir, use)].reg : use->reg;
+    if (read == reg) return true;
+  }
+  // the frame of a callee covers the registers from its base up
+  return v->instr.op == OP_CALL && reg >= v->instr.a;
+}
+
+// a move whose source is used by nothing else gets the source written
+// straight into its register, when nothing in between touches that register
+static void ir_coalesce(IrFunction* ir)
+{
+  int* counts = calloc(ir->value_size, sizeof(int));
+  for (int id = 0; id < ir->value_size; id++) {
+    IrValue* v = &ir->values[id];
+    bool is_kept = v->kind == IR_INSTR ? !v->is_removed : v->kind == IR_PHI && v->is_live && v->same < 0;
+    if (!is_kept) continue;
+    for (int i = 0; i < v->use_size; i++) {
+      counts[ir_final(ir, &v->uses[i])]++;
+    }
+  }
+
+  for (int i = 0; i < ir->rpo_size; i++) {
+    IrBlock* block = &ir->blocks[ir->rpo[i]];
+    for (int j = 0; j < block->value_size; j++) {
+      int id = block->values[j];
+      IrValue* move = &ir->values[id];
+      if (move->kind != IR_INSTR || move->is_removed || move->instr.op != OP_MOVE) continue;
+      int source = ir_final(ir, &move->uses[0]);
+      IrValue* s = &ir->values[source];
+      if (s->kind != IR_INSTR || s->block != move->block || counts[source] != 1) continue;
+      IrField fields[3];
+      ir_fields(s->instr.op, fields);
+      if (fields[0] != IR_DEF) continue;
+
+      int from;
+      for (from = j - 1; from >= 0 && block->values[from] != source; from--);
+      if (from < 0) continue;
+      bool is_free = true;
+      for (int k = from + 1; k < j && is_free; k++) {
+        IrValue* between = &ir->values[block->values[k]];
+        if (between->kind != IR_INSTR || between->is_removed) continue;
+        is_free = between->reg != move->reg && !ir_reads_reg(ir, between, move->reg);
+      }
+      if (!is_free) continue;
+
+      s->reg = move->reg;
+      move->is_removed = true;
+      move->same = source;
+      ir->copies++;
+    }
+  }
+  free(counts);
+}
+
+static void ir_block_in(IrFunction* ir, int b, int* out, int* map)
+{
+  size_t regs = ir->reg_size;
+  IrBlock* block = &ir->blocks[b];
+  if (b == 0) {
+    for (int reg = 0; reg < regs; reg++) {
+      map[reg] = reg;
+    }
+    return;
+  }
+  for (int reg = 0; reg < regs; reg++) {
+    map[reg] = IR_TOP;
+    for (int i = 0; i < block->pred_size; i++) {
+      int v = out[block->preds[i] * regs + reg];
+      if (v == IR_TOP) continue;
+      map[reg] = map[reg] == IR_TOP || map[reg] == v ? v : IR_UNKNOWN;
+    }
+  }
+  for (int i = 0; i < block->value_size; i++) {
+    IrValue* phi = &ir->values[block->values[i]];
+    if (phi->kind != IR_PHI) break;
+    if (phi->is_live && phi->same < 0 && !phi->is_memory) map[phi->reg] = block->values[i];
+  }
+}
+
+// runs the registers through block; with broken set, reads are checked to find
+// their value where lowering will look for it, false when a fixed one is not
+static bool ir_transfer(IrFunction* ir, int b, int* map, bool* broken)
+{
+  IrBlock* block = &ir->blocks[b];
+  for (int i = 0; i < block->value_size; i++) {
+    int id = block->values[i];
+    IrValue* v = &ir->values[id];
+    if (v->kind != IR_INSTR || v->is_removed) continue;
+    for (int j = 0; broken && j < v->use_size; j++) {
+      IrUse* use = &v->uses[j];
+      int value = ir_final(ir, use);
+      if (use->field < 0) {
+        if (map[use->reg] != value) return false;
+      } else {
+        int reg = ir->values[value].reg;
+        if (reg < 0) return false;
+        if (map[reg] != value) broken[value] = true;
+      }
+    }
+    if (v->reg >= 0) map[v->reg] = id;
+    if (v->instr.op == OP_CALL) {
+      for (int reg = v->instr.a + 1; reg < ir->reg_size; reg++) {
+        map[reg] = IR_UNKNOWN;
+      }
+    }
+  }
+  if (!broken) return true;
+  for (int i = 0; i < block->succ_size; i++) {
+    IrBlock* succ = &ir->blocks[block->succs[i]];
+    int from;
+    for (from = 0; succ->preds[from] != b; from++);
+    for (int j = 0; j < succ->value_size; j++) {
+      IrValue* phi = &ir->values[succ->values[j]];
+      if (phi->kind != IR_PHI) break;
+      if (!phi->is_live || phi->same >= 0 || phi->is_memory) continue;
+      if (map[phi->reg] != ir_same(ir, phi->uses[from].value)) return false;
+    }
+  }
+  return true;
+}
+
+// finds the values some read now reaches after their register was written
+// again, and gives each a register of its own; false to keep the bytecode
+static bool ir_allocate(IrFunction* ir)
+{
+  size_t regs = ir->reg_size;
+  int* out = malloc((ir->block_size * regs + 1) * sizeof(int));
+  for (int i = 0; i < ir->block_size * regs; i++) {
+    out[i] = IR_TOP;
+  }
+  int* map = malloc((regs + 1) * sizeof(int));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < ir->rpo_size; i++) {
+      int b = ir->rpo[i];
+      ir_block_in(ir, b, out, map);
+      ir_transfer(ir, b, map, (void*)0);
+      if (memcmp(out + b * regs, map, regs * sizeof(int))) {
+        memcpy(out + b * regs, map, regs * sizeof(int));
+        changed = true;
+      }
+    }
+  }
+
+  bool* broken = calloc(ir->value_size, sizeof(bool));
+  bool is_sound = true;
+  for (int i = 0; i < ir->rpo_size && is_sound; i++) {
+    ir_block_in(ir, ir->rpo[i], out, map);
+    is_sound = ir_transfer(ir, ir->rpo[i], map, broken);
+  }
+  free(out);
+  free(map);
+
+  // values read from fixed registers, or merged by phis, stay where they are
+  bool* is_pinned = calloc(ir->value_size, sizeof(bool));
+  for (int id = 0; id < ir->value_size && is_sound; id++) {
+    IrValue* v = &ir->values[id];
+    bool is_phi = v->kind == IR_PHI && v->is_live && v->same < 0;
+    if (!is_phi && (v->kind != IR_INSTR || v->is_removed)) continue;
+    if (is_phi) is_pinned[id] = true;
+    for (int i = 0; i < v->use_size; i++) {
+      if (v->uses[i].field < 0) is_pinned[ir_final(ir, &v->uses[i])] = true;
+    }
+  }
+  for (int id = 0; id < ir->value_size && is_sound; id++) {
+    if (!broken[id]) continue;
+    IrValue* v = &ir->values[id];
+    if (v->kind == IR_INSTR && ir_target_field(&v->instr)) {
+      is_sound = false;
+      break;
+    }
+    v->copy = ir->fresh_size++;
+    v->is_moved = v->kind == IR_INSTR && !is_pinned[id] && !ir_is_call(v->instr.op);
+  }
+  free(broken);
+  free(is_pinned);
+  return is_sound;
+}
+
+// registers after the args make room for the added ones
+static int ir_reg(IrFunction* ir, int reg)
+{
+  return reg < ir->function->arg_size ? reg : reg + ir->fresh_size;
+}
+
+static int ir_fresh(IrFunction* ir, int copy)
+{
+  return ir->function->arg_size + copy;
+}
+
+static void ir_emit_copy(IrFunction* ir, IrValue* v)
+{
+  function_emit(ir->function, OP_MOVE, ir_fresh(ir, v->copy), ir_reg(ir, v->reg), 0);
+}
+
+static void ir_lower(IrFunction* ir)
+{
+  Function* function = ir->function;
+  function->code = (void*)0;
+  function->code_size = 0;
+  function->code_cap = 0;
+
+  for (int b = 0; b < ir->block_size; b++) {
+    IrBlock* block = &ir->blocks[b];
+    if (!block->is_reachable) continue;
+    block->label = function->code_size;
+    if (b == 0) {
+      for (int reg = 0; reg < ir->reg_size; reg++) {
+        if (ir->values[reg].copy >= 0) ir_emit_copy(ir, &ir->values[reg]);
+      }
+    }
+    for (int i = 0; i < block->value_size; i++) {
+      IrValue* v = &ir->values[block->values[i]];
+      if (v->kind == IR_PHI) {
+        if (v->copy >= 0 && v->same < 0) ir_emit_copy(ir, v);
+        continue;
+      }
+      if (v->is_removed) continue;
+
+      Instr instr = v->instr;
+      int* operands[3] = { &instr.a, &instr.b, &instr.c };
+      IrField fields[3];
+      ir_fields(instr.op, fields);
+      if (ir_is_call(instr.op)) {
+        instr.a = ir_reg(ir, instr.a);
+      } else if (ir_is_for(instr.op)) {
+        instr.a = ir_reg(ir, instr.a);
+        instr.b = ir_reg(ir, instr.b);
+      } else if (fields[0] == IR_DEF) {
+        instr.a = v->is_moved ? ir_fresh(ir, v->copy) : ir_reg(ir, v->reg);
+      }
+      for (int j = 0; j < v->use_size; j++) {
+        IrUse* use = &v->uses[j];
+        if (use->field < 0) continue;
+        IrValue* read = &ir->values[ir_final(ir, use)];
+        *operands[use->field] = read->copy >= 0 ? ir_fresh(ir, read->copy) : ir_reg(ir, read->reg);
+      }
+      function_emit(function, instr.op, instr.a, instr.b, instr.c);
+      if (v->copy >= 0 && !v->is_moved) ir_emit_copy(ir, v);
+    }
+  }
+
+  for (int pc = 0; pc < function->code_size; pc++) {
+    int* target = ir_target_field(&function->code[pc]);
+    if (target) *target = ir->blocks[ir->block_of[*target]].label;
+  }
+  function->reg_size += ir->fresh_size;
+}
+
+static void ir_print_const(Value val)
+{
+  switch (val.type) {
+    case VALUE_INT: printf(" %d", val.integer); break;
+    case VALUE_FLOAT: printf(" %f", val.floating); break;
+    case VALUE_STRING: printf(" \"%s\"", val.string); break;
+    case VALUE_BOOL: printf(" %s", val.boolean ? "true" : "false"); break;
+    default: printf(" %s", value_name(val.type)); break;
+  }
+}
+
+static void ir_print_instr(IrFunction* ir, int id)
+{
+  IrValue* v = &ir->values[id];
+  Instr* ip = &v->instr;
+  printf("    ");
+  // stores and calls are named too, loads refer to them
+  if (v->reg >= 0 || v->is_memory) printf("v%d = ", id);
+  printf("%s", op_name(ip->op) + 3);
+  switch (ip->op) {
+    case OP_LOADK:
+      ir_print_const(ir->function->consts[ip->b]);
+      break;
+    case OP_GETGLOBAL: case OP_SETGLOBAL:
+      printf(" g%d", ip->b);
+      break;
+    case OP_CALL:
+      printf(" %s", ir->program->functions[ip->b]->name);
+      break;
+    case OP_BUILTIN:
+      printf(" %s", builtin_name(ip->b));
+      break;
+    case OP_TESTDEF:
+      printf(" '%s'", ir->function->consts[ip->b].string);
+      break;
+    default:
+      break;
+  }
+  for (int i = 0; i < v->use_size; i++) {
+    printf(" v%d", ir_final(ir, &v->uses[i]));
+    if (i == 0 && (ip->op == OP_GETFIELD || ip->op == OP_SETFIELD)) {
+      printf(".%d", ip->op == OP_GETFIELD ? FIELD_INDEX(ip->c) : ip->b);
+    }
+  }
+  if (ip->op == OP_SHLI || ip->op == OP_SHRI || ip->op == OP_ANDI) printf(" %d", ip->c);
+  int* target = ir_target_field(ip);
+  if (target) printf(" -> b%d", ir->block_of[*target]);
+  if (v->mem >= 0) printf(" [v%d]", ir_same(ir, v->mem));
+  printf("\n");
+}
+
+static void ir_dump(IrFunction* ir, bool is_kept)
+{
+  Function* function = ir->function;
+  printf("function %s: %lu args, %lu registers\n", function->name, function->arg_size, function->reg_size);
+  for (int b = 0; b < ir->block_size; b++) {
+    IrBlock* block = &ir->blocks[b];
+    if (!block->is_reachable) continue;
+    printf("  b%d", b);
+    for (int i = 0; i < block->pred_size; i++) {
+      if (ir_dominates(ir, b, block->preds[i])) {
+        printf(" loop");
+        break;
+      }
+    }
+    if (block->pred_size) printf(" <-");
+    for (int i = 0; i < block->pred_size; i++) {
+      printf(" b%d", block->preds[i]);
+    }
+    printf("\n");
+    for (int i = 0; i < block->value_size; i++) {
+      int id = block->values[i];
+      IrValue* v = &ir->values[id];
+      if (v->kind == IR_PHI) {
+        if (!v->is_live || v->same >= 0) continue;
+        printf("    v%d = phi%s", id, v->is_memory ? " memory" : "");
+        for (int j = 0; j < v->use_size; j++) {
+          printf(" v%d", ir_same(ir, v->uses[j].value));
+        }
+        printf("\n");
+      } else if (!v->is_removed) {
+        ir_print_instr(ir, id);
+      }
+    }
+  }
+  printf("  numbered %u, forwarded %u, copies %u, reduced %u, checks %u, dead %u, registers added %lu\n%s",
+         ir->numbered, ir->forwarded, ir->copies, ir->reduced, ir->tests, ir->dead, ir->fresh_size,
+         is_kept ? "  registers could not be assigned, kept as compiled\n\n" : "\n");
+}
+
+static void ir_free(IrFunction* ir)
+{
+  for (int b = 0; b < ir->block_size; b++) {
+    free(ir->blocks[b].preds);
+    free(ir->blocks[b].children);
+    free(ir->blocks[b].frontier);
+    free(ir->blocks[b].values);
+  }
+  for (int id = 0; id < ir->value_size; id++) {
+    free(ir->values[id].uses);
+  }
+  free(ir->blocks);
+  free(ir->block_of);
+  free(ir->rpo);
+  free(ir->values);
+  free(ir);
+}
+
+static void ir_function(Program* program, Function* function, bool optimize, bool dump)
+{
+  IrFunction* ir = calloc(1, sizeof(IrFunction));
+  ir->program = program;
+  ir->function = function;
+  ir->reg_size = function->reg_size;
+
+  if (!ir_build_blocks(ir)) {
+    if (dump) printf("function %s: kept as compiled\n\n", function->name);
+    ir_free(ir);
+    return;
+  }
+  ir_build_ssa(ir);
+
+  if (optimize) {
+    ir_find_undefined(ir);
+    ir_find_nonnegative(ir);
+    IrTable table = { (void*)0, 0, 0, malloc(IR_BUCKET_SIZE * sizeof(int)) };
+    for (int i = 0; i < IR_BUCKET_SIZE; i++) {
+      table.buckets[i] = -1;
+    }
+    ir_number(ir, &table, 0);
+    free(table.entries);
+    free(table.buckets);
+  }
+  ir_remove_dead(ir);
+  if (optimize) ir_coalesce(ir);
+
+  bool is_sound = optimize && ir_allocate(ir);
+  if (dump) ir_dump(ir, optimize && !is_sound);
+  if (is_sound) {
+    Instr* code = function->code;
+    ir_lower(ir);
+    free(code);
+  }
+  ir_free(ir);
+}
+
+void ir_optimize(Program* program, bool optimize, bool dump)
+{
+  ir_function(program, program->main, optimize, dump);
+  for (int i = 0; i < program->function_size; i++) {
+    ir_function(program, program->functions[i], optimize, dump);
+  }
+}
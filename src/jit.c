@@ -0,0 +1,568 @@
+#include "inc/jit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// native code of a function is called as code(vm, base, entry) and jumps to
+// entry, the start of one of its instructions. rbx points at the registers
+// of the frame, r12 holds vm and r13 the byte offset of the frame in the
+// register stack. Registers stay in memory, so entering at any instruction
+// and calling back into the interpreter need no state to be moved around.
+typedef void (*JitCode)(VM* vm, size_t base, void* entry);
+
+#define JIT_EAX 0
+#define JIT_ECX 1
+#define JIT_EDX 2
+
+typedef struct {
+  // rel32 to fill in and the instruction it jumps to
+  size_t at;
+  int target;
+} JitJump;
+
+typedef struct {
+  unsigned char* code;
+  size_t size, cap;
+  // where each instruction starts in code
+  size_t* offsets;
+  JitJump* jumps;
+  size_t jump_size;
+} Jit;
+
+static void jit_emit(Jit* jit, int n, ...)
+{
+  if (jit->size + n > jit->cap) {
+    jit->cap = jit->cap ? jit->cap * 2 : 4096;
+    jit->code = realloc(jit->code, jit->cap);
+  }
+  va_list bytes;
+  va_start(bytes, n);
+  for (int i = 0; i < n; i++) {
+    jit->code[jit->size++] = va_arg(bytes, int);
+  }
+  va_end(bytes);
+}
+
+static void jit_int32(Jit* jit, int val)
+{
+  jit_emit(jit, 4, val & 0xff, (val >> 8) & 0xff, (val >> 16) & 0xff, (val >> 24) & 0xff);
+}
+
+static void jit_int64(Jit* jit, unsigned long long val)
+{
+  jit_int32(jit, (int)val);
+  jit_int32(jit, (int)(val >> 32));
+}
+
+// [rbx + disp32] operand with reg in the ModRM reg field
+static void jit_mem(Jit* jit, int reg, int disp)
+{
+  jit_emit(jit, 1, 0x83 | reg << 3);
+  jit_int32(jit, disp);
+}
+
+static int jit_type(int reg)
+{
+  return reg * sizeof(Value) + offsetof(Value, type);
+}
+
+static int jit_payload(int reg)
+{
+  return reg * sizeof(Value) + offsetof(Value, integer);
+}
+
+// rax holds the zero-extended payload, the header clears is_managed
+static void jit_store(Jit* jit, int reg, ValueType type)
+{
+  jit_emit(jit, 2, 0x48, 0x89); jit_mem(jit, JIT_EAX, jit_payload(reg));
+  jit_emit(jit, 2, 0x48, 0xC7); jit_mem(jit, 0, jit_type(reg)); jit_int32(jit, type);
+}
+
+static void jit_load_int(Jit* jit, int reg)
+{
+  jit_emit(jit, 1, 0x8B); jit_mem(jit, JIT_EAX, jit_payload(reg));
+}
+
+static void jit_load_float(Jit* jit, int reg)
+{
+  jit_emit(jit, 3, 0xF3, 0x0F, 0x10); jit_mem(jit, JIT_EAX, jit_payload(reg));
+}
+
+static void jit_jump(Jit* jit, int cc, int target)
+{
+  if (cc) {
+    jit_emit(jit, 2, 0x0F, cc);
+  } else {
+    jit_emit(jit, 1, 0xE9);
+  }
+  jit->jump_size++;
+  jit->jumps = realloc(jit->jumps, jit->jump_size * sizeof(JitJump));
+  jit->jumps[jit->jump_size - 1] = (JitJump) { jit->size, target };
+  jit_int32(jit, 0);
+}
+
+// jump forward inside the code of one instruction, bound by jit_bind
+static size_t jit_forward(Jit* jit, int cc)
+{
+  jit_emit(jit, 2, 0x0F, cc);
+  jit_int32(jit, 0);
+  return jit->size - 4;
+}
+
+static void jit_bind(Jit* jit, size_t at)
+{
+  int rel = jit->size - (at + 4);
+  memcpy(jit->code + at, &rel, 4);
+}
+
+// rbx = vm->stack + base, again after anything that may grow the stack
+static void jit_load_registers(Jit* jit)
+{
+  jit_emit(jit, 4, 0x49, 0x8B, 0x9C, 0x24); jit_int32(jit, offsetof(VM, stack));
+  jit_emit(jit, 3, 0x4C, 0x01, 0xEB);
+}
+
+static void jit_prologue(Jit* jit)
+{
+  // five pushes keep the stack 16 byte aligned for the calls
+  jit_emit(jit, 9, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57);
+  jit_emit(jit, 6, 0x49, 0x89, 0xFC, 0x49, 0x89, 0xF5);
+  jit_load_registers(jit);
+  jit_emit(jit, 2, 0xFF, 0xE2);
+}
+
+static void jit_epilogue(Jit* jit)
+{
+  jit_emit(jit, 10, 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3);
+}
+
+// everything not emitted natively goes through vm_step
+static void jit_step(Jit* jit, Instr* ip)
+{
+  jit_emit(jit, 3, 0x4C, 0x89, 0xE7);
+  jit_emit(jit, 2, 0x48, 0xBE); jit_int64(jit, (size_t)ip);
+  jit_emit(jit, 2, 0x48, 0xB8); jit_int64(jit, (size_t)vm_step);
+  jit_emit(jit, 2, 0xFF, 0xD0);
+  jit_load_registers(jit);
+}
+
+// jne to the slow path of an instruction unless R[reg] has the tag type
+static size_t jit_guard(Jit* jit, int reg, ValueType type)
+{
+  jit_emit(jit, 1, 0x81); jit_mem(jit, 7, jit_type(reg)); jit_int32(jit, type);
+  return jit_forward(jit, 0x85);
+}
+
+// jmp over the slow path, bound by jit_bind
+static size_t jit_skip(Jit* jit)
+{
+  jit_emit(jit, 1, 0xE9);
+  jit_int32(jit, 0);
+  return jit->size - 4;
+}
+
+static void jit_move(Jit* jit, int a, int b)
+{
+  jit_emit(jit, 2, 0x48, 0x8B); jit_mem(jit, JIT_EDX, jit_type(b));
+  jit_emit(jit, 2, 0x48, 0x8B); jit_mem(jit, JIT_ECX, jit_payload(b));
+  jit_emit(jit, 2, 0x48, 0x89); jit_mem(jit, JIT_EDX, jit_type(a));
+  jit_emit(jit, 2, 0x48, 0x89); jit_mem(jit, JIT_ECX, jit_payload(a));
+}
+
+// rax = vm->globals, then [rax + disp32] operands for global slot
+static void jit_load_globals(Jit* jit)
+{
+  jit_emit(jit, 4, 0x49, 0x8B, 0x84, 0x24); jit_int32(jit, offsetof(VM, globals));
+}
+
+static void jit_global(Jit* jit, int opcode, int reg, int disp)
+{
+  jit_emit(jit, 3, 0x48, opcode, 0x80 | reg << 3);
+  jit_int32(jit, disp);
+}
+
+// condition codes of setcc/jcc for OP_EQ..OP_LE on ints
+static int jit_int_cc(int compare)
+{
+  static int cc[] = { 0x4, 0x5, 0xF, 0xD, 0xC, 0xE };
+  return cc[compare];
+}
+
+// OP_ADD..OP_LE on ints, op counted from OP_ADD
+static void jit_int_binary(Jit* jit, int op, int a, int b, int c)
+{
+  jit_load_int(jit, b);
+  switch (op + OP_ADD) {
+    case OP_ADD:
+      jit_emit(jit, 1, 0x03); jit_mem(jit, JIT_EAX, jit_payload(c));
+      break;
+    case OP_SUB:
+      jit_emit(jit, 1, 0x2B); jit_mem(jit, JIT_EAX, jit_payload(c));
+      break;
+    case OP_MUL:
+      jit_emit(jit, 2, 0x0F, 0xAF); jit_mem(jit, JIT_EAX, jit_payload(c));
+      break;
+    case OP_DIV: case OP_MOD:
+      // traps on zero and INT_MIN / -1 just like the interpreter
+      jit_emit(jit, 2, 0x99, 0xF7); jit_mem(jit, 7, jit_payload(c));
+      if (op + OP_ADD == OP_MOD) {
+        jit_emit(jit, 2, 0x89, 0xD0);
+      }
+      break;
+    default:
+      jit_emit(jit, 1, 0x3B); jit_mem(jit, JIT_EAX, jit_payload(c));
+      jit_emit(jit, 6, 0x0F, 0x90 | jit_int_cc(op + OP_ADD - OP_EQ), 0xC0, 0x0F, 0xB6, 0xC0);
+      jit_store(jit, a, VALUE_BOOL);
+      return;
+  }
+  jit_store(jit, a, VALUE_INT);
+}
+
+// al = the comparison of two floats, false when either is NaN like in C
+static void jit_float_compare(Jit* jit, int compare, int b, int c)
+{
+  bool swap = compare == OP_LT - OP_EQ || compare == OP_LE - OP_EQ;
+  jit_load_float(jit, swap ? c : b);
+  jit_emit(jit, 2, 0x0F, 0x2E); jit_mem(jit, JIT_EAX, jit_payload(swap ? b : c));
+  switch (compare + OP_EQ) {
+    case OP_EQ:
+      jit_emit(jit, 8, 0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC1, 0x20, 0xC8);
+      break;
+    case OP_NE:
+      jit_emit(jit, 8, 0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8);
+      break;
+    case OP_GT: case OP_LT:
+      jit_emit(jit, 3, 0x0F, 0x97, 0xC0);
+      break;
+    default:
+      jit_emit(jit, 3, 0x0F, 0x93, 0xC0);
+      break;
+  }
+}
+
+static void jit_instr(Jit* jit, Function* function, int pc)
+{
+  Instr* ip = &function->code[pc];
+  int a = ip->a, b = ip->b, c = ip->c;
+  switch (ip->op) {
+    case OP_LOADK:
+      jit_emit(jit, 2, 0x48, 0xB8); jit_int64(jit, (size_t)&function->consts[b]);
+      jit_emit(jit, 7, 0x48, 0x8B, 0x10, 0x48, 0x8B, 0x48, 0x08);
+      jit_emit(jit, 2, 0x48, 0x89); jit_mem(jit, JIT_EDX, jit_type(a));
+      jit_emit(jit, 2, 0x48, 0x89); jit_mem(jit, JIT_ECX, jit_payload(a));
+      break;
+    case OP_MOVE:
+      jit_move(jit, a, b);
+      break;
+    case OP_TESTDEF: {
+      jit_emit(jit, 1, 0x83); jit_mem(jit, 7, jit_type(a)); jit_emit(jit, 1, VALUE_UNDEFINED);
+      size_t defined = jit_forward(jit, 0x85);
+      jit_step(jit, ip);
+      jit_bind(jit, defined);
+      break;
+    }
+    case OP_GETGLOBAL: {
+      // an undefined global is reported by the interpreter
+      jit_load_globals(jit);
+      jit_global(jit, 0x8B, JIT_EDX, b * sizeof(Value));
+      jit_global(jit, 0x8B, JIT_ECX, b * sizeof(Value) + 8);
+      jit_emit(jit, 2, 0x85, 0xD2);
+      size_t undefined = jit_forward(jit, 0x84);
+      jit_emit(jit, 2, 0x48, 0x89); jit_mem(jit, JIT_EDX, jit_type(a));
+      jit_emit(jit, 2, 0x48, 0x89); jit_mem(jit, JIT_ECX, jit_payload(a));
+      size_t done = jit_skip(jit);
+      jit_bind(jit, undefined);
+      jit_step(jit, ip);
+      jit_bind(jit, done);
+      break;
+    }
+    case OP_SETGLOBAL: {
+      jit_load_globals(jit);
+      // stores from functions into an undefined global may come before its declaration,
+      // the interpreter tells
+      size_t undefined = 0;
+      if (c >= 0) {
+        jit_global(jit, 0x8B, JIT_EDX, b * sizeof(Value));
+        jit_emit(jit, 2, 0x85, 0xD2);
+        undefined = jit_forward(jit, 0x84);
+      }
+      jit_emit(jit, 2, 0x48, 0x8B); jit_mem(jit, JIT_EDX, jit_type(a));
+      jit_emit(jit, 2, 0x48, 0x8B); jit_mem(jit, JIT_ECX, jit_payload(a));
+      jit_global(jit, 0x89, JIT_EDX, b * sizeof(Value));
+      jit_global(jit, 0x89, JIT_ECX, b * sizeof(Value) + 8);
+      if (c >= 0) {
+        size_t done = jit_skip(jit);
+        jit_bind(jit, undefined);
+        jit_step(jit, ip);
+        jit_bind(jit, done);
+      }
+      break;
+    }
+    case OP_CONV_INT: case OP_CONV_FLOAT: case OP_CHECK_STRING: case OP_CHECK_BOOL: {
+      // values that already have the type are moved, conversions and errors are interpreted
+      static ValueType types[] = { VALUE_INT, VALUE_FLOAT, VALUE_STRING, VALUE_BOOL };
+      size_t other = jit_guard(jit, b, types[ip->op - OP_CONV_INT]);
+      jit_move(jit, a, b);
+      size_t done = jit_skip(jit);
+      jit_bind(jit, other);
+      jit_step(jit, ip);
+      jit_bind(jit, done);
+      break;
+    }
+    case OP_ADDI: case OP_SUBI: case OP_MULI: case OP_DIVI: case OP_MODI:
+    case OP_EQI: case OP_NEI: case OP_GTI: case OP_GEI: case OP_LTI: case OP_LEI:
+      jit_int_binary(jit, ip->op - OP_ADDI, a, b, c);
+      break;
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+    case OP_EQ: case OP_NE: case OP_GT: case OP_GE: case OP_LT: case OP_LE: {
+      // two ints run inline, every other mix goes through vm_binary
+      size_t left = jit_guard(jit, b, VALUE_INT);
+      size_t right = jit_guard(jit, c, VALUE_INT);
+      jit_int_binary(jit, ip->op - OP_ADD, a, b, c);
+      size_t done = jit_skip(jit);
+      jit_bind(jit, left);
+      jit_bind(jit, right);
+      jit_step(jit, ip);
+      jit_bind(jit, done);
+      break;
+    }
+    case OP_ADDF: case OP_SUBF: case OP_MULF: case OP_DIVF: {
+      static int ops[] = { 0x58, 0x5C, 0x59, 0x5E };
+      jit_load_float(jit, b);
+      jit_emit(jit, 3, 0xF3, 0x0F, ops[ip->op - OP_ADDF]); jit_mem(jit, JIT_EAX, jit_payload(c));
+      jit_emit(jit, 4, 0x66, 0x0F, 0x7E, 0xC0);
+      jit_store(jit, a, VALUE_FLOAT);
+      break;
+    }
+    case OP_EQF: case OP_NEF: case OP_GTF: case OP_GEF: case OP_LTF: case OP_LEF:
+      jit_float_compare(jit, ip->op - OP_EQF, b, c);
+      jit_emit(jit, 3, 0x0F, 0xB6, 0xC0);
+      jit_store(jit, a, VALUE_BOOL);
+      break;
+    case OP_SHLI: case OP_SHRI:
+      jit_load_int(jit, b);
+      jit_emit(jit, 3, 0xC1, ip->op == OP_SHLI ? 0xE0 : 0xF8, c);
+      jit_store(jit, a, VALUE_INT);
+      break;
+    case OP_ANDI:
+      jit_load_int(jit, b);
+      jit_emit(jit, 1, 0x25); jit_int32(jit, c);
+      jit_store(jit, a, VALUE_INT);
+      break;
+    case OP_JMP:
+      jit_jump(jit, 0, a);
+      break;
+    case OP_JMPF: {
+      // anything but a bool is reported by the interpreter
+      jit_emit(jit, 1, 0x81); jit_mem(jit, 7, jit_type(a)); jit_int32(jit, VALUE_BOOL);
+      size_t is_bool = jit_forward(jit, 0x84);
+      jit_step(jit, ip);
+      jit_bind(jit, is_bool);
+      jit_emit(jit, 1, 0x80); jit_mem(jit, 7, jit_payload(a)); jit_emit(jit, 1, 0);
+      jit_jump(jit, 0x84, b);
+      break;
+    }
+    case OP_ANDJMP: case OP_ORJMP: {
+      jit_emit(jit, 1, 0x81); jit_mem(jit, 7, jit_type(a)); jit_int32(jit, VALUE_BOOL);
+      size_t not_bool = jit_forward(jit, 0x85);
+      jit_emit(jit, 1, 0x80); jit_mem(jit, 7, jit_payload(a)); jit_emit(jit, 1, 0);
+      jit_jump(jit, ip->op == OP_ANDJMP ? 0x84 : 0x85, b);
+      jit_bind(jit, not_bool);
+      break;
+    }
+    case OP_IFEQI: case OP_IFNEI: case OP_IFGTI: case OP_IFGEI: case OP_IFLTI: case OP_IFLEI:
+      jit_load_int(jit, a);
+      jit_emit(jit, 1, 0x3B); jit_mem(jit, JIT_EAX, jit_payload(b));
+      // the inverse condition leaves for the false branch
+      jit_jump(jit, 0x80 | (jit_int_cc(ip->op - OP_IFEQI) ^ 1), c);
+      break;
+    case OP_IFEQF: case OP_IFNEF: case OP_IFGTF: case OP_IFGEF: case OP_IFLTF: case OP_IFLEF:
+      jit_float_compare(jit, ip->op - OP_IFEQF, a, b);
+      jit_emit(jit, 2, 0x84, 0xC0);
+      jit_jump(jit, 0x84, c);
+      break;
+    case OP_FORLT: case OP_FORLE: case OP_FORGT: case OP_FORGE: {
+      static int cc[] = { 0x8C, 0x8E, 0x8F, 0x8D };
+      jit_load_int(jit, a);
+      jit_emit(jit, 1, 0x03); jit_mem(jit, JIT_EAX, jit_payload(b + 1));
+      jit_emit(jit, 1, 0x89); jit_mem(jit, JIT_EAX, jit_payload(a));
+      jit_emit(jit, 1, 0x3B); jit_mem(jit, JIT_EAX, jit_payload(b));
+      jit_jump(jit, cc[ip->op - OP_FORLT], c);
+      break;
+    }
+    case OP_RETURN: case OP_RETURN0: case OP_HALT:
+      // the interpreter checks the value and pops the frame
+      jit_step(jit, ip);
+      jit_epilogue(jit);
+      break;
+    default:
+      jit_step(jit, ip);
+      break;
+  }
+}
+
+bool jit_compile(Function* function)
+{
+  Jit jit = { (void*)0, 0, 0, (void*)0, (void*)0, 0 };
+  // jumps may target the end of the code
+  jit.offsets = malloc((function->code_size + 1) * sizeof(size_t));
+  jit_prologue(&jit);
+  for (int pc = 0; pc < function->code_size; pc++) {
+    jit.offsets[pc] = jit.size;
+    jit_instr(&jit, function, pc);
+  }
+  jit.offsets[function->code_size] = jit.size;
+  jit_emit(&jit, 2, 0x0F, 0x0B);
+
+  for (int i = 0; i < jit.jump_size; i++) {
+    int rel = jit.offsets[jit.jumps[i].target] - (jit.jumps[i].at + 4);
+    memcpy(jit.code + jit.jumps[i].at, &rel, 4);
+  }
+  free(jit.jumps);
+
+  void* code = mmap((void*)0, jit.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED) {
+    free(jit.code);
+    free(jit.offsets);
+    function->jit_failed = true;
+    return false;
+  }
+  memcpy(code, jit.code, jit.size);
+  mprotect(code, jit.size, PROT_READ | PROT_EXEC);
+
+  function->jit_entries = malloc(function->code_size * sizeof(void*));
+  for (int pc = 0; pc < function->code_size; pc++) {
+    function->jit_entries[pc] = (char*)code + jit.offsets[pc];
+  }
+  function->jit_code = code;
+  free(jit.code);
+  free(jit.offsets);
+  return true;
+}
+
+void jit_enter(VM* vm, Instr* at)
+{
+  Frame* frame = &vm->frames[vm->frame_size - 1];
+  Function* function = frame->function;
+  JitCode code = (JitCode)function->jit_code;
+  vm->native_depth++;
+  code(vm, frame->base * sizeof(Value), function->jit_entries[at - function->code]);
+  vm->native_depth--;
+}
+
+size_t jit_max_nesting()
+{
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_STACK, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) return JIT_MAX_NESTING;
+  size_t nesting = limit.rlim_cur / 2 / JIT_NESTING_BYTES;
+  return nesting < JIT_MAX_NESTING ? nesting : JIT_MAX_NESTING;
+}
+
+// runs a fresh VM on program in a child, input is replayed and output kept in out
+static int jit_run(Program* program, JitMode mode, FILE* in, FILE* out)
+{
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (in) {
+      lseek(fileno(in), 0, SEEK_SET);
+      dup2(fileno(in), 0);
+    }
+    dup2(fileno(out), 1);
+    VM* vm = init_vm(program);
+    vm->jit = mode;
+    vm_run(vm);
+    exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  return status;
+}
+
+static char* jit_read_all(FILE* file, size_t* size)
+{
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  rewind(file);
+  char* data = malloc(*size + 1);
+  *size = fread(data, 1, *size, file);
+  return data;
+}
+
+int jit_diff(Program* program)
+{
+  // both runs get the same input, a terminal is left to the first one
+  FILE* in = (void*)0;
+  if (!isatty(0)) {
+    in = tmpfile();
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(0, buf, sizeof(buf))) > 0) {
+      fwrite(buf, 1, n, in);
+    }
+    fflush(in);
+  }
+  FILE* interpreted = tmpfile();
+  FILE* native = tmpfile();
+  int interpreted_status = jit_run(program, JIT_OFF, in, interpreted);
+  int native_status = jit_run(program, JIT_ALWAYS, in, native);
+
+  size_t interpreted_size, native_size;
+  char* interpreted_out = jit_read_all(interpreted, &interpreted_size);
+  char* native_out = jit_read_all(native, &native_size);
+  fwrite(interpreted_out, 1, interpreted_size, stdout);
+
+  size_t at = 0;
+  while (at < interpreted_size && at < native_size && interpreted_out[at] == native_out[at]) {
+    at++;
+  }
+  int result = 0;
+  if (at < interpreted_size || at < native_size) {
+    printf("JIT-> Error: output differs from the interpreter at byte %lu\n", at);
+    result = 1;
+  }
+  if (interpreted_status != native_status) {
+    printf("JIT-> Error: exit status %d interpreted, %d native\n", interpreted_status, native_status);
+    result = 1;
+  }
+  if (!result) {
+    printf("JIT-> native code matches the interpreter, %lu bytes of output\n", interpreted_size);
+  }
+  free(interpreted_out);
+  free(native_out);
+  return result;
+}
+
+#else
+
+bool jit_compile(Function* function)
+{
+  function->jit_failed = true;
+  return false;
+}
+
+void jit_enter(VM* vm, Instr* at)
+{
+}
+
+size_t jit_max_nesting()
+{
+  return 0;
+}
+
+int jit_diff(Program* program)
+{
+  printf("JIT-> Error: the JIT needs x86-64 Linux\n");
+  return 1;
+}
+
+#endif
@@ -1,37 +1,106 @@
 #include "inc/lexer.h"
+#include "inc/scan.h"
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <pthread.h>
+#ifndef _WIN32
+  #include <unistd.h>
+#endif
 
-Lexer* init_lexer(char* src)
+#define LEXER_RING_SIZE 16
+#define LEXER_SHORT_ID 16
+// sources are only split when every thread gets at least this much
+#define LEXER_MIN_CHUNK (64 * 1024)
+
+Lexer* init_lexer(char* src, size_t src_size)
 {
   Lexer* lexer = calloc(1, sizeof(Lexer));
 
   lexer->src = src;
-  lexer->src_size = strlen(src);
+  lexer->src_size = src_size;
   lexer->i = 0;
   lexer->line = 1;
-  lexer->tokens = (void*)0;
+  lexer->ring = calloc(LEXER_RING_SIZE, sizeof(Token));
+  lexer->ring_cap = LEXER_RING_SIZE;
   lexer->token_size = 0;
+  lexer->released = 0;
+  lexer->is_done = false;
+  lexer->recover = (void*)0;
+  lexer->segments = (void*)0;
+  lexer->segment_size = 0;
+  lexer->ahead_size = 0;
+  lexer->segment = 0;
+  lexer->segment_first = 0;
   lexer->encountered_word = 0;
   lexer->prev_indent = 0;
   lexer->cur_indent = 0;
 
+  scan_init(SCAN_AVX2);
+
   return lexer;
 }
 
+// the token's slice ends where the lexer stands
+static Token lexer_token(Lexer* lexer, _TokenType type, size_t length)
+{
+  return init_token(type, lexer->i - length, length, lexer->line);
+}
+
 static void lexer_error(Lexer* lexer, char* msg)
 {
+  if (lexer->recover) {
+    longjmp(*lexer->recover, 1);
+  }
   printf("Lexer-> Error at line: %u, %s\n", lexer->line, msg);
   exit(1);
 }
 
-void lexer_collect_tokens(Lexer* lexer)
+static Token* lexer_ahead_token(Lexer* lexer, size_t index)
 {
-  while (!lexer_is_end(lexer)) {
-    lexer_collect_token(lexer);
+  // the parser moves forward, so the segment under the cursor almost always holds the index
+  while (index < lexer->segment_first) {
+    lexer->segment--;
+    lexer->segment_first -= lexer->segments[lexer->segment].fixup_size + lexer->segments[lexer->segment].token_size;
   }
-  lexer_add_token(lexer, init_token(TOKEN_EOF, "\0", lexer->line));
+  while (index >= lexer->segment_first + lexer->segments[lexer->segment].fixup_size + lexer->segments[lexer->segment].token_size) {
+    lexer->segment_first += lexer->segments[lexer->segment].fixup_size + lexer->segments[lexer->segment].token_size;
+    lexer->segment++;
+  }
+  LexerSegment* segment = &lexer->segments[lexer->segment];
+  size_t i = index - lexer->segment_first;
+  return i < segment->fixup_size ? &segment->fixups[i] : &segment->tokens[i - segment->fixup_size];
+}
+
+static Token* lexer_token_at(Lexer* lexer, size_t index)
+{
+  if (index < lexer->ahead_size) {
+    return lexer_ahead_token(lexer, index);
+  }
+  return &lexer->ring[index & (lexer->ring_cap - 1)];
+}
+
+Token* lexer_get_token(Lexer* lexer, size_t index)
+{
+  // one token past the index, a '(' may still turn it into TOKEN_ID
+  while (!lexer->is_done && lexer->token_size <= index + 1) {
+    if (lexer_is_end(lexer)) {
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_EOF, 0));
+      lexer->is_done = true;
+    } else {
+      lexer_collect_token(lexer);
+    }
+  }
+  if (index >= lexer->token_size) {
+    index = lexer->token_size - 1;
+  }
+  return lexer_token_at(lexer, index);
+}
+
+void lexer_release(Lexer* lexer, size_t index)
+{
+  // tokens lexed up front are kept, the ring only holds what comes after them
+  lexer->released = index < lexer->ahead_size ? lexer->ahead_size : index;
 }
 
 void lexer_collect_token(Lexer* lexer)
@@ -48,41 +117,44 @@ void lexer_collect_token(Lexer* lexer)
       lexer_skip_comment_line(lexer);
       break;
     case ',':
-      lexer_add_token(lexer, init_token(TOKEN_COMMA, ",", lexer->line));
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_COMMA, 1));
       break;
     case '.':
-      lexer_add_token(lexer, init_token(TOKEN_DOT, ".", lexer->line));
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_DOT, 1));
       break;
     case ';':
-      lexer_add_token(lexer, init_token(TOKEN_SEMICOLON, ";", lexer->line));
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_SEMICOLON, 1));
       break;
     case '^':
-      lexer_add_token(lexer, init_token(TOKEN_POW, "^", lexer->line));
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_POW, 1));
       break;
     case '(':
-      switch (lexer->tokens[lexer->token_size - 1]->type) {
-        case TOKEN_INT:
-        case TOKEN_FLOAT:
-        case TOKEN_STRING:
-        case TOKEN_BOOL:
-          lexer->tokens[lexer->token_size - 1]->type = TOKEN_ID;
-          break;
-        default:
-          break;
+      if (lexer->token_size) {
+        Token* prev = lexer_token_at(lexer, lexer->token_size - 1);
+        switch (prev->type) {
+          case TOKEN_INT:
+          case TOKEN_FLOAT:
+          case TOKEN_STRING:
+          case TOKEN_BOOL:
+            prev->type = TOKEN_ID;
+            break;
+          default:
+            break;
+        }
       }
-      lexer_add_token(lexer, init_token(TOKEN_LPAREN, "(", lexer->line));
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_LPAREN, 1));
       break;
     case ')':
-      lexer_add_token(lexer, init_token(TOKEN_RPAREN, ")", lexer->line));
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_RPAREN, 1));
       break;
     case '{':
-      lexer_add_token(lexer, init_token(TOKEN_LBRACE, "{", lexer->line));
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_LBRACE, 1));
       break;
     case '}':
-      lexer_add_token(lexer, init_token(TOKEN_RBRACE, "}", lexer->line));
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_RBRACE, 1));
       break;
     case '\\':
-      while ((c = lexer_advance(lexer)) != '\n') {
+      while (!lexer_is_end(lexer) && (c = lexer_advance(lexer)) != '\n') {
         if (c != ' ' && c != '\t') {
           if (c == '~') {
             lexer_skip_comment_line(lexer);
@@ -97,7 +169,7 @@ void lexer_collect_token(Lexer* lexer)
       if (!lexer->encountered_word) {
         lexer->cur_indent = 0;
       } else {
-        lexer_add_token(lexer, init_token(TOKEN_NEWL, "\0", lexer->line)); 
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_NEWL, 0)); 
       }
       lexer->line++;
       break;
@@ -107,6 +179,10 @@ void lexer_collect_token(Lexer* lexer)
       }
       break;
     case ' ':
+      // single spaces between tokens are the common case
+      if (lexer_peek(lexer) == ' ') {
+        lexer->i = scan_skip(lexer->src, lexer->i, lexer->src_size, ' ');
+      }
       break;
     case '\"':
       lexer_get_string(lexer);
@@ -114,61 +190,61 @@ void lexer_collect_token(Lexer* lexer)
     case '+':
       if (lexer_peek(lexer) == '=') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_PLUSEQ, "+=", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_PLUSEQ, 2));
       }
       /*
       else if (lexer_peek(lexer) == '+') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_INCREMENT, "++", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_INCREMENT, 2));
       } */
       else {
-        lexer_add_token(lexer, init_token(TOKEN_PLUS, "+", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_PLUS, 1));
       }
       break;
     case '-':
       if (lexer_peek(lexer) == '=') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_MINUSEQ, "-=", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_MINUSEQ, 2));
       }
       /*
       else if (lexer_peek(lexer) == '-') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_DECREMENT, "--", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_DECREMENT, 2));
       } */
       else {
-        lexer_add_token(lexer, init_token(TOKEN_MINUS, "-", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_MINUS, 1));
       }
       break;
     case '*':
        if (lexer_peek(lexer) == '=') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_MULEQ, "*=", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_MULEQ, 2));
       } else {
-        lexer_add_token(lexer, init_token(TOKEN_MUL, "*", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_MUL, 1));
       }
       break;
     case '/':
       if (lexer_peek(lexer) == '=') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_DIVEQ, "/=", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_DIVEQ, 2));
       } else {
-        lexer_add_token(lexer, init_token(TOKEN_DIV, "/", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_DIV, 1));
       }
       break;
     case '%':
       if (lexer_peek(lexer) == '=') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_MODEQ, "%=", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_MODEQ, 2));
       } else {
-        lexer_add_token(lexer, init_token(TOKEN_MOD, "%", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_MOD, 1));
       }
       break;
     case '=':
       if (lexer_peek(lexer) == '=') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_EQ, "==", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_EQ, 2));
       } else {
-        lexer_add_token(lexer, init_token(TOKEN_ASSIGN, "=", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_ASSIGN, 1));
       }
       break;
     case '!':
@@ -176,22 +252,22 @@ void lexer_collect_token(Lexer* lexer)
         lexer_error(lexer, "expected '=' after '!'");
       }
       lexer_advance(lexer);
-      lexer_add_token(lexer, init_token(TOKEN_NE, "!=", lexer->line));
+      lexer_add_token(lexer, lexer_token(lexer, TOKEN_NE, 2));
       break;
     case '>':
       if (lexer_peek(lexer) == '=') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_GE, ">=", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_GE, 2));
       } else {
-        lexer_add_token(lexer, init_token(TOKEN_GT, ">", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_GT, 1));
       }
       break;
     case '<':
       if (lexer_peek(lexer) == '=') {
         lexer_advance(lexer);
-        lexer_add_token(lexer, init_token(TOKEN_LE, "<=", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_LE, 2));
       } else {
-        lexer_add_token(lexer, init_token(TOKEN_LT, "<", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_LT, 1));
       }
       break;
     case '_':
@@ -219,12 +295,13 @@ char lexer_advance(Lexer* lexer)
 
 char lexer_peek(Lexer* lexer)
 {
-  return lexer->src[lexer->i];
+  // the mapped source has no terminator to read past the end
+  return lexer->i >= lexer->src_size ? '\0' : lexer->src[lexer->i];
 }
 
 char lexer_peek_offset(Lexer* lexer, int offset)
 {
-  int i = lexer->i + offset;
+  size_t i = lexer->i + offset;
   return i >= lexer->src_size ? '\0' : lexer->src[i];
 }
 
@@ -233,147 +310,173 @@ int lexer_is_end(Lexer* lexer)
   return lexer->i >= lexer->src_size; 
 }
 
-void lexer_get_id(Lexer* lexer)
+// keywords are told apart by length and first char, then checked with one memcmp
+static _TokenType lexer_keyword(char* s, size_t len)
 {
-  int len = 1;
-  char* s = calloc(len + 1, sizeof(char));
-  s[len - 1] = lexer_peek_offset(lexer, -1);
-  s[len] = '\0';
+#define KEYWORD(word, type) (memcmp(s, word, len) == 0 ? type : TOKEN_ID)
+  switch (len) {
+    case 2:
+      switch (s[0]) {
+        case 'i': return KEYWORD("if", TOKEN_IF);
+        case 'o': return KEYWORD("or", TOKEN_OR);
+      }
+      break;
+    case 3:
+      switch (s[0]) {
+        case 'i': return KEYWORD("int", TOKEN_INT);
+        case 'f': return KEYWORD("for", TOKEN_FOR);
+        case 'a': return KEYWORD("and", TOKEN_AND);
+        case 'n': return KEYWORD("not", TOKEN_NOT);
+      }
+      break;
+    case 4:
+      switch (s[0]) {
+        case 'b': return KEYWORD("bool", TOKEN_BOOL);
+        case 't': return KEYWORD("true", TOKEN_TRUE);
+        case 'e': return KEYWORD("else", TOKEN_ELSE);
+        case 's':
+          if (s[1] == 'k') return KEYWORD("skip", TOKEN_SKIP);
+          return KEYWORD("stop", TOKEN_STOP);
+      }
+      break;
+    case 5:
+      switch (s[0]) {
+        case 'f':
+          if (s[1] == 'l') return KEYWORD("float", TOKEN_FLOAT);
+          return KEYWORD("false", TOKEN_FALSE);
+        case 'w': return KEYWORD("while", TOKEN_WHILE);
+      }
+      break;
+    case 6:
+      switch (s[0]) {
+        case 's': return KEYWORD("string", TOKEN_STRING);
+        case 'o': return KEYWORD("object", TOKEN_OBJECT);
+        case 'r': return KEYWORD("return", TOKEN_RETURN);
+      }
+      break;
+    case 7:
+      return KEYWORD("include", TOKEN_INCLUDE);
+    case 8:
+      return KEYWORD("function", TOKEN_FUNCTION);
+  }
+#undef KEYWORD
+  return TOKEN_ID;
+}
 
+void lexer_get_id(Lexer* lexer)
+{
+  size_t start = lexer->i - 1;
+  // most names end within a vector's width, only long ones are worth the scanner
   char c;
   while ((isalnum(c = lexer_peek(lexer)) || c == '_') && !lexer_is_end(lexer)) {
-    len++;
-    s = realloc(s, (len + 1) * sizeof(char));
-    s[len - 1] = c;
-    s[len] = '\0';
     lexer_advance(lexer);
+    if (lexer->i - start == LEXER_SHORT_ID) {
+      lexer->i = scan_ident(lexer->src, lexer->i, lexer->src_size);
+      break;
+    }
   }
+  size_t len = lexer->i - start;
 
-  if (strcmp(s, "int") == 0) lexer_add_token(lexer, init_token(TOKEN_INT, s, lexer->line));
-  else if (strcmp(s, "float") == 0) lexer_add_token(lexer, init_token(TOKEN_FLOAT, s, lexer->line));
-  else if (strcmp(s, "string") == 0) lexer_add_token(lexer, init_token(TOKEN_STRING, s, lexer->line));
-  else if (strcmp(s, "bool") == 0) lexer_add_token(lexer, init_token(TOKEN_BOOL, s, lexer->line));
-  else if (strcmp(s, "object") == 0) lexer_add_token(lexer, init_token(TOKEN_OBJECT, s, lexer->line));
-  else if (strcmp(s, "true") == 0) lexer_add_token(lexer, init_token(TOKEN_TRUE, s, lexer->line));
-  else if (strcmp(s, "false") == 0) lexer_add_token(lexer, init_token(TOKEN_FALSE, s, lexer->line));
-  else if (strcmp(s, "function") == 0) lexer_add_token(lexer, init_token(TOKEN_FUNCTION, s, lexer->line));
-  else if (strcmp(s, "if") == 0) lexer_add_token(lexer, init_token(TOKEN_IF, s, lexer->line));
-  else if (strcmp(s, "else") == 0) lexer_add_token(lexer, init_token(TOKEN_ELSE, s, lexer->line));
-  else if (strcmp(s, "while") == 0) lexer_add_token(lexer, init_token(TOKEN_WHILE, s, lexer->line));
-  else if (strcmp(s, "for") == 0) lexer_add_token(lexer, init_token(TOKEN_FOR, s, lexer->line));
-  else if (strcmp(s, "return") == 0) lexer_add_token(lexer, init_token(TOKEN_RETURN, s, lexer->line));
-  else if (strcmp(s, "skip") == 0) lexer_add_token(lexer, init_token(TOKEN_SKIP, s, lexer->line));
-  else if (strcmp(s, "stop") == 0) lexer_add_token(lexer, init_token(TOKEN_STOP, s, lexer->line));
-  else if (strcmp(s, "and") == 0) lexer_add_token(lexer, init_token(TOKEN_AND, s, lexer->line));
-  else if (strcmp(s, "or") == 0) lexer_add_token(lexer, init_token(TOKEN_OR, s, lexer->line));
-  else if (strcmp(s, "not") == 0) lexer_add_token(lexer, init_token(TOKEN_NOT, s, lexer->line));
-  else if (strcmp(s, "include") == 0) lexer_add_token(lexer, init_token(TOKEN_INCLUDE, s, lexer->line));
-  else lexer_add_token(lexer, init_token(TOKEN_ID, s, lexer->line));
+  lexer_add_token(lexer, init_token(lexer_keyword(lexer->src + start, len), start, len, lexer->line));
 }
 
 void lexer_get_digit(Lexer* lexer)
 {
-  int len = 1;
-  char* s = calloc(len + 1, sizeof(char));
-  s[len - 1] = lexer_peek_offset(lexer, -1);
-  s[len] = '\0';
-
+  size_t start = lexer->i - 1;
   _TokenType type = TOKEN_INT_VAL;
   char c;
   while (isdigit(c = lexer_peek(lexer)) && !lexer_is_end(lexer)) {
-    len++;
-    s = realloc(s, (len + 1) * sizeof(char));
-    s[len - 1] = c;
-    s[len] = '\0';
     lexer_advance(lexer);
   }
   if (c == '.') {
     type = TOKEN_FLOAT_VAL;
-    len++;
-    s = realloc(s, (len + 1) * sizeof(char));
-    s[len - 1] = c;
-    s[len] = '\0';
     lexer_advance(lexer);
     if (!isdigit(lexer_peek(lexer))) {
       lexer_error(lexer, "expected digit after '.'");
     }
     while (isdigit(c = lexer_peek(lexer)) && !lexer_is_end(lexer)) {
-      len++;
-      s = realloc(s, (len + 1) * sizeof(char));
-      s[len - 1] = c;
-      s[len] = '\0';
       lexer_advance(lexer);
     }
   }
-
-  lexer_add_token(lexer, init_token(type, s, lexer->line));
+  lexer_add_token(lexer, init_token(type, start, lexer->i - start, lexer->line));
 }
 
 void lexer_get_string(Lexer* lexer)
 {
-  int len = 0;
-  char* s = (void*)0;
+  size_t start = lexer->i;
+  lexer->i = scan_until(lexer->src, lexer->i, lexer->src_size, '\n', '\"');
+  size_t len = lexer->i - start;
 
-  char c;
-  while ((c = lexer_peek(lexer)) != '\n' && c != '\"' && !lexer_is_end(lexer)) {
-    len++;
-    s = realloc(s, (len + 1) * sizeof(char));
-    s[len - 1] = c;
-    s[len] = '\0';
-    lexer_advance(lexer);
-  }
-
-  if (len == 0) {
-    s = "\0";
-  }
   if (lexer_peek(lexer) != '\"') {
-    char msg[128];
-    sprintf(msg, "unterminated string '%s'", s);
+    char msg[len + 32];
+    sprintf(msg, "unterminated string '%.*s'", (int)len, lexer->src + start);
     lexer_error(lexer, msg);
   }
   lexer_advance(lexer); // for '\"'
 
-  lexer_add_token(lexer, init_token(TOKEN_STRING_VAL, s, lexer->line));
+  lexer_add_token(lexer, init_token(TOKEN_STRING_VAL, start, len, lexer->line));
+}
+
+static void lexer_grow_ring(Lexer* lexer)
+{
+  size_t cap = lexer->ring_cap * 2;
+  Token* ring = calloc(cap, sizeof(Token));
+  for (size_t i = lexer->released; i < lexer->token_size; i++) {
+    ring[i & (cap - 1)] = lexer->ring[i & (lexer->ring_cap - 1)];
+  }
+  free(lexer->ring);
+  lexer->ring = ring;
+  lexer->ring_cap = cap;
+}
+
+// stores a token without looking at indentation
+static void lexer_push_token(Lexer* lexer, Token token)
+{
+  // only grows when the parser still holds the whole window, e.g. a long run of dedents
+  if (lexer->token_size - lexer->released == lexer->ring_cap) {
+    lexer_grow_ring(lexer);
+  }
+  lexer->ring[lexer->token_size & (lexer->ring_cap - 1)] = token;
+  lexer->token_size++;
 }
 
-void lexer_add_token(Lexer* lexer, Token* token)
+void lexer_add_token(Lexer* lexer, Token token)
 {
-  if (!lexer->encountered_word && token->type != TOKEN_NEWL && token->type != TOKEN_INDENT && token->type != TOKEN_DEDENT) {
+  if (!lexer->encountered_word && token.type != TOKEN_NEWL && token.type != TOKEN_INDENT && token.type != TOKEN_DEDENT) {
     if (lexer->cur_indent > lexer->prev_indent) {
       int times = lexer->cur_indent - lexer->prev_indent;
       for (int i = 0; i < times; i++) {
-        lexer_add_token(lexer, init_token(TOKEN_INDENT, "\0", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_INDENT, 0));
       }
     } else if (lexer->cur_indent < lexer->prev_indent) {
       int times = lexer->prev_indent - lexer->cur_indent;
       for (int i = 0; i < times; i++) {
-        lexer_add_token(lexer, init_token(TOKEN_DEDENT, "\0", lexer->line));
-        lexer_add_token(lexer, init_token(TOKEN_NEWL, "\0", lexer->line));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_DEDENT, 0));
+        lexer_add_token(lexer, lexer_token(lexer, TOKEN_NEWL, 0));
       }
     }
     lexer->encountered_word = 1;
   } 
-  else if (lexer->encountered_word && token->type == TOKEN_NEWL) {
+  else if (lexer->encountered_word && token.type == TOKEN_NEWL) {
     lexer->encountered_word = 0;
     lexer->prev_indent = lexer->cur_indent;
     lexer->cur_indent = 0;
   }
 
-  lexer->token_size++;
-  lexer->tokens = realloc(lexer->tokens, lexer->token_size * sizeof(Token*));
-  lexer->tokens[lexer->token_size - 1] = token;
+  lexer_push_token(lexer, token);
 }
 
 void lexer_skip_comment_line(Lexer* lexer)
 {
-  while (!lexer_is_end(lexer) && lexer_peek(lexer) != '\n') {
-    lexer_advance(lexer);
-  }
+  lexer->i = scan_until(lexer->src, lexer->i, lexer->src_size, '\n', '\n');
 }
 
 void lexer_skip_comment_block(Lexer* lexer)
 {
   while (!lexer_is_end(lexer)) {
+    // jump to the next line break or '~', lines still have to be counted
+    lexer->i = scan_until(lexer->src, lexer->i, lexer->src_size, '~', '\n');
+    if (lexer_is_end(lexer)) break;
     if (lexer_peek(lexer) == '~' && lexer_peek_offset(lexer, 1) == '~') {
       lexer_advance(lexer);
       lexer_advance(lexer);
@@ -387,3 +490,176 @@ void lexer_skip_comment_block(Lexer* lexer)
     lexer_error(lexer, "unclosed comment block (~~)");
   }
 }
+
+typedef struct {
+  Lexer* lexer;
+  size_t end;
+  bool failed;
+} LexerChunk;
+
+static void* lexer_lex_chunk(void* arg)
+{
+  LexerChunk* chunk = arg;
+  jmp_buf recover;
+  chunk->lexer->recover = &recover;
+  if (setjmp(recover)) {
+    chunk->failed = true;
+    return (void*)0;
+  }
+  while (chunk->lexer->i < chunk->end) {
+    lexer_collect_token(chunk->lexer);
+  }
+  chunk->lexer->recover = (void*)0;
+  return (void*)0;
+}
+
+static LexerChunk lexer_init_chunk(Lexer* lexer, size_t start, size_t end)
+{
+  LexerChunk chunk = { init_lexer(lexer->src, lexer->src_size), end, false };
+  chunk.lexer->i = start;
+  // sized for dense code so the ring rarely grows while the chunk is lexed
+  size_t cap = chunk.lexer->ring_cap;
+  while (cap < (end - start) / 4) {
+    cap *= 2;
+  }
+  free(chunk.lexer->ring);
+  chunk.lexer->ring = calloc(cap, sizeof(Token));
+  chunk.lexer->ring_cap = cap;
+  return chunk;
+}
+
+// splits before names at column 0, there the lexer is usually back at the top level
+static size_t lexer_split(Lexer* lexer, size_t* bounds, size_t chunk_size)
+{
+  size_t n = 0;
+  bounds[n++] = 0;
+  size_t i = chunk_size;
+  while (i < lexer->src_size) {
+    i = scan_until(lexer->src, i, lexer->src_size, '\n', '\n') + 1;
+    if (i < lexer->src_size && (isalpha(lexer->src[i]) || lexer->src[i] == '_')) {
+      bounds[n++] = i;
+      i += chunk_size;
+    }
+  }
+  bounds[n] = lexer->src_size;
+  return n;
+}
+
+// the chunk's tokens are served in place, it never wrapped its ring since nothing was released
+static void lexer_add_segment(Lexer* lexer, Lexer* chunk, size_t first, Token* fixups, size_t fixup_size)
+{
+  lexer->segment_size++;
+  lexer->segments = realloc(lexer->segments, lexer->segment_size * sizeof(LexerSegment));
+  lexer->segments[lexer->segment_size - 1] = (LexerSegment) {
+    fixups, fixup_size, chunk->ring + first, chunk->token_size - first
+  };
+  lexer->ahead_size += fixup_size + chunk->token_size - first;
+
+  lexer->i = chunk->i;
+  lexer->encountered_word = chunk->encountered_word;
+  lexer->cur_indent = chunk->cur_indent;
+  lexer->prev_indent = chunk->prev_indent;
+  free(chunk);
+}
+
+// a chunk lexed from a fresh state is correct once its lines are shifted and the blocks left open before it are closed
+static void lexer_stitch(Lexer* lexer, Lexer* chunk)
+{
+  unsigned lines = lexer->line - 1;
+  for (size_t i = 0; i < chunk->token_size; i++) {
+    chunk->ring[i].line += lines;
+  }
+
+  // sequentially these come out with the chunk's first name
+  Token* first = &chunk->ring[0];
+  size_t fixup_size = 2 * lexer->prev_indent;
+  Token* fixups = fixup_size ? calloc(fixup_size, sizeof(Token)) : (void*)0;
+  for (size_t i = 0; i < fixup_size; i += 2) {
+    fixups[i] = init_token(TOKEN_DEDENT, first->offset + first->length, 0, first->line);
+    fixups[i + 1] = init_token(TOKEN_NEWL, first->offset + first->length, 0, first->line);
+  }
+
+  lexer->line = chunk->line + lines;
+  // prev_indent is only stale when the chunk ended on its first line, then nothing is lexed after it
+  lexer_add_segment(lexer, chunk, 0, fixups, fixup_size);
+}
+
+// lexes up to end from the exact state, false leaves the error for when the parser gets there
+static bool lexer_catch_up(Lexer* lexer, size_t end)
+{
+  LexerChunk chunk = lexer_init_chunk(lexer, lexer->i, end);
+  Lexer* part = chunk.lexer;
+  part->line = lexer->line;
+  part->encountered_word = lexer->encountered_word;
+  part->cur_indent = lexer->cur_indent;
+  part->prev_indent = lexer->prev_indent;
+  // a '(' right at the start may still retag the token before it
+  Token* last = lexer->ahead_size ? lexer_token_at(lexer, lexer->ahead_size - 1) : (void*)0;
+  if (last) {
+    lexer_push_token(part, *last);
+  }
+
+  lexer_lex_chunk(&chunk);
+  if (chunk.failed) {
+    free(part->ring);
+    free(part);
+    return false;
+  }
+  if (last) {
+    last->type = part->ring[0].type;
+  }
+  lexer->line = part->line;
+  lexer_add_segment(lexer, part, last ? 1 : 0, (void*)0, 0);
+  return true;
+}
+
+void lexer_lex_parallel(Lexer* lexer, int threads)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+  // more threads than cores only adds the cost of keeping every token around
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cores > 0 && threads > cores) {
+    threads = cores;
+  }
+#endif
+  if (threads < 2 || lexer->token_size || lexer->src_size < LEXER_MIN_CHUNK * 2) return;
+  size_t chunk_size = lexer->src_size / threads;
+  if (chunk_size < LEXER_MIN_CHUNK) {
+    chunk_size = LEXER_MIN_CHUNK;
+  }
+
+  size_t bounds[lexer->src_size / chunk_size + 2];
+  size_t n = lexer_split(lexer, bounds, chunk_size);
+  LexerChunk chunks[n];
+  pthread_t handles[n];
+  for (size_t k = 0; k < n; k++) {
+    chunks[k] = lexer_init_chunk(lexer, bounds[k], bounds[k + 1]);
+  }
+  for (size_t k = 1; k < n; k++) {
+    pthread_create(&handles[k], (void*)0, lexer_lex_chunk, &chunks[k]);
+  }
+  lexer_lex_chunk(&chunks[0]);
+  for (size_t k = 1; k < n; k++) {
+    pthread_join(handles[k], (void*)0);
+  }
+
+  bool is_stitching = true;
+  for (size_t k = 0; k < n; k++) {
+    Lexer* chunk = chunks[k].lexer;
+    // a block comment or a line continuation can run over the split, the chunk then started in the wrong state
+    bool fits = lexer->i == bounds[k] && !lexer->encountered_word && lexer->cur_indent == 0;
+    if (is_stitching && fits && !chunks[k].failed) {
+      lexer_stitch(lexer, chunk);
+      continue;
+    }
+    if (is_stitching && lexer->i < chunks[k].end) {
+      is_stitching = lexer_catch_up(lexer, chunks[k].end);
+    }
+    free(chunk->ring);
+    free(chunk);
+  }
+
+  // lexing on demand carries on after the last token lexed here
+  lexer->token_size = lexer->ahead_size;
+  lexer->released = lexer->ahead_size;
+}
@@ -4,12 +4,38 @@
 #include "inc/lexer.h"
 #include "inc/parser.h"
 #include "inc/visitor.h"
+#include "inc/closure.h"
+#include "inc/tier.h"
+#include "inc/resolver.h"
+#include "inc/checker.h"
+#include "inc/optimizer.h"
+#include "inc/ir.h"
+#include "inc/compiler.h"
+#include "inc/vm.h"
+#include "inc/jit.h"
+#include "inc/emitter.h"
+#include "inc/gc.h"
+#include <string.h>
 
-static void print_tokens(Token** tokens, size_t size)
+typedef enum {
+  ENGINE_VM,
+  ENGINE_VISITOR,
+  ENGINE_CLOSURE,
+  ENGINE_TIERED,
+} Engine;
+
+typedef enum {
+  EMIT_NONE,
+  EMIT_C,
+  EMIT_BUILD,
+} Emit;
+
+static void print_tokens(Lexer* lexer)
 {
-  for (int i = 0; i < size; i++) {
-    Token* t = tokens[i];
-    printf("type: %s, value: %s, line: %u\n", token_name(t->type), t->value, t->line);
+  for (size_t i = 0; !lexer->is_done || i < lexer->token_size; i++) {
+    Token* t = lexer_get_token(lexer, i);
+    lexer_release(lexer, i);
+    printf("type: %s, value: %.*s, line: %u\n", token_name(t->type), (int)t->length, lexer->src + t->offset, t->line);
   }
 }
 
@@ -158,20 +184,150 @@ static void print_ast(AST* root)
   }
 }
 
+static void usage(char* prog)
+{
+  printf("Usage: %s [--engine=vm|visitor|closure|tiered] [--no-opt] [--dump-ir] [--jit=off|on|always] [--jit-diff] [--emit-c] [--build] [--gc-stats] [--quick-stats] [--tier-stats] [--lex-threads=N] <file>\n", prog);
+  printf("  --engine=vm         run compiled bytecode (default)\n");
+  printf("  --engine=visitor    walk the AST directly\n");
+  printf("  --engine=closure    turn the AST into specialized closures once, then run those\n");
+  printf("  --engine=tiered     start in the visitor, hot functions and loops switch to closures built in the background\n");
+  printf("  --jit=off|on|always compile hot functions and loops to machine code (default off)\n");
+  printf("  --jit-diff          run interpreted and with --jit=always and compare the output\n");
+  printf("  --emit-c            write the script as a standalone C file, script.lang becomes script.c\n");
+  printf("  --build             also compile that file with gcc into a native executable\n");
+  printf("  --no-opt            skip the AST and SSA optimizations\n");
+  printf("  --dump-ir           print the SSA form of every compiled function once optimized, instead of running\n");
+  printf("  --gc-stats          report runtime memory when the script exits\n");
+  printf("  --quick-stats       report how often the visitor's specialized binary nodes hit\n");
+  printf("  --tier-stats        report what --engine=tiered promoted and when\n");
+  printf("  --lex-threads=N     lex large sources up front on N threads\n");
+}
+
 int main(int argc, char** argv)
 {
 //  printf("%d\n", AST_TRUE->boolean.val);
-  char* src = read_file(argv[1]);
-  if (src == (void*)0) return -1;
-  Lexer* lexer = init_lexer(src);
-  lexer_collect_tokens(lexer);
-//                print_tokens(lexer->tokens, lexer->token_size);
+  Engine engine = ENGINE_VM;
+  bool optimize = true;
+  bool dump_ir = false;
+  JitMode jit = JIT_OFF;
+  bool jit_differential = false;
+  Emit emit = EMIT_NONE;
+  int lex_threads = 1;
+  char* path = (void*)0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--engine=vm") == 0) {
+      engine = ENGINE_VM;
+    } else if (strcmp(argv[i], "--engine=visitor") == 0) {
+      engine = ENGINE_VISITOR;
+    } else if (strcmp(argv[i], "--engine=closure") == 0) {
+      engine = ENGINE_CLOSURE;
+    } else if (strcmp(argv[i], "--engine=tiered") == 0) {
+      engine = ENGINE_TIERED;
+    } else if (strcmp(argv[i], "--jit=off") == 0) {
+      jit = JIT_OFF;
+    } else if (strcmp(argv[i], "--jit=on") == 0) {
+      jit = JIT_ON;
+    } else if (strcmp(argv[i], "--jit=always") == 0) {
+      jit = JIT_ALWAYS;
+    } else if (strcmp(argv[i], "--jit-diff") == 0) {
+      jit_differential = true;
+    } else if (strcmp(argv[i], "--emit-c") == 0) {
+      emit = EMIT_C;
+    } else if (strcmp(argv[i], "--build") == 0) {
+      emit = EMIT_BUILD;
+    } else if (strcmp(argv[i], "--no-opt") == 0) {
+      optimize = false;
+    } else if (strcmp(argv[i], "--dump-ir") == 0) {
+      dump_ir = true;
+    } else if (strcmp(argv[i], "--gc-stats") == 0) {
+      // atexit so scripts ending in quit() still report
+      atexit(gc_print_stats);
+    } else if (strcmp(argv[i], "--quick-stats") == 0) {
+      atexit(visitor_print_quick_stats);
+    } else if (strcmp(argv[i], "--tier-stats") == 0) {
+      atexit(tier_print_stats);
+    } else if (strncmp(argv[i], "--lex-threads=", 14) == 0) {
+      lex_threads = atoi(argv[i] + 14);
+    } else if (argv[i][0] == '-' || path) {
+      usage(argv[0]);
+      return -1;
+    } else {
+      path = argv[i];
+    }
+  }
+  if (!path) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  Source* source = read_source(path);
+  if (source == (void*)0) return -1;
+  // AST nodes and parser arrays, released once the program is done with them
+  Arena* arena = init_arena();
+  Lexer* lexer = init_lexer(source->data, source->size);
+  // otherwise tokens are lexed as the parser asks for them
+  lexer_lex_parallel(lexer, lex_threads);
+//                print_tokens(lexer);
 
-  Parser* parser = init_parser(lexer);
+  Parser* parser = init_parser(lexer, arena);
   AST* root = parser_parse(parser);
 //   print_ast(root);
+  // every name the AST keeps is interned by now
+  source_free(source);
 
-  Visitor* visitor = init_visitor(parser);
-  visitor_visit(visitor, visitor->global_scope, root);
+  Checker* checker = init_checker(parser);
+  checker_check(checker, root);
+
+  if (optimize) {
+    Optimizer* optimizer = init_optimizer(parser);
+    optimizer_optimize(optimizer, root);
+    free(optimizer);
+  }
+
+  if (!dump_ir && (engine == ENGINE_VISITOR || engine == ENGINE_CLOSURE || engine == ENGINE_TIERED)) {
+    Resolver* resolver = init_resolver(parser);
+    resolver_resolve(resolver, root);
+    Visitor* visitor = init_visitor(parser, resolver->frame_size);
+    if (engine == ENGINE_VISITOR) {
+      visitor_visit(visitor, root);
+    } else if (engine == ENGINE_CLOSURE) {
+      ClosureBuilder* builder = init_closure_builder(parser, resolver, root);
+      closure_attach(visitor);
+      closure_enter(closure_build(builder));
+    } else {
+      Tier* tier = init_tier(visitor, init_closure_builder(parser, resolver, root));
+      visitor_visit(visitor, root);
+      // the worker reads the AST
+      tier_finish(tier);
+    }
+    arena_free(arena);
+    return 0;
+  }
+
+  Compiler* compiler = init_compiler(parser);
+  Program* program = compiler_compile(compiler, root);
+  if (optimize || dump_ir) ir_optimize(program, optimize, dump_ir);
+  if (dump_ir) {
+    arena_free(arena);
+    return 0;
+  }
+  if (emit != EMIT_NONE) {
+    Emitter* emitter = init_emitter(program, path);
+    emitter_emit(emitter);
+    int result = emit == EMIT_BUILD ? emitter_build(emitter) : 0;
+    arena_free(arena);
+    return result;
+  }
+  if (jit_differential) {
+    int result = jit_diff(program);
+    arena_free(arena);
+    return result;
+  }
+  VM* vm = init_vm(program);
+  vm->jit = jit;
+  // tokens, the AST and parser arrays are not needed while the program runs
+  program_detach(program);
+  arena_free(arena);
+  vm_run(vm);
   return 0;
 }
@@ -56,10 +56,9 @@ Module* init_module(char* name)
 
 AST* module_function_call(Module* module, char* func_name, AST** args, size_t arg_size)
 {
+  // func_name is interned, so loaded functions are found by address
   for (int i = 0; i < module->function_size; i++) {
-    char act_fn_name[strlen(func_name) + 2];
-    sprintf(act_fn_name, "_%s", func_name);
-    if (strcmp(module->function_names[i], act_fn_name) == 0) {
+    if (module->function_names[i] == func_name) {
       return module->functions[i](args, arg_size);
     }
   }
@@ -67,10 +66,10 @@ AST* module_function_call(Module* module, char* func_name, AST** args, size_t ar
   module->function_size++;
   module->function_names = realloc(module->function_names, module->function_size * sizeof(char*));
   module->functions = realloc(module->functions, module->function_size * sizeof(AST* (*) (AST** args, size_t arg_size)));
+  module->function_names[module->function_size - 1] = func_name;
 
-  char* act_fn_name = calloc(strlen(func_name) + 2, sizeof(char));
+  char act_fn_name[strlen(func_name) + 2];
   sprintf(act_fn_name, "_%s", func_name);
-  module->function_names[module->function_size - 1] = act_fn_name;
 
 #ifdef _WIN32
     FARPROC function = GetProcAddress(module->handle, act_fn_name);
@@ -89,3 +88,17 @@ AST* module_function_call(Module* module, char* func_name, AST** args, size_t ar
   module->functions[module->function_size - 1] = function_ptr;
   return function_ptr(args, arg_size);
 }
+
+Value module_call(Module* module, char* func_name, Value* args, size_t arg_size)
+{
+  // modules still take and return AST nodes
+  AST* ast_args[arg_size ? arg_size : 1];
+  for (int i = 0; i < arg_size; i++) {
+    ast_args[i] = value_to_ast(args[i]);
+  }
+  Value ret = value_from_ast(module_function_call(module, func_name, ast_args, arg_size));
+  for (int i = 0; i < arg_size; i++) {
+    value_free_ast(ast_args[i]);
+  }
+  return ret;
+}
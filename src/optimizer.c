@@ -0,0 +1,272 @@
+#include "inc/optimizer.h"
+#include "inc/value.h"
+#include <limits.h>
+#include <string.h>
+
+Optimizer* init_optimizer(Parser* parser)
+{
+  Optimizer* optimizer = calloc(1, sizeof(Optimizer));
+
+  optimizer->arena = parser->arena;
+  optimizer->function_declarations = parser->function_declarations;
+  optimizer->function_size = parser->function_size;
+
+  return optimizer;
+}
+
+static bool optimizer_is_literal(AST* node)
+{
+  switch (node->type) {
+    case AST_INT:
+    case AST_FLOAT:
+    case AST_STRING:
+    case AST_BOOL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// the literal takes over the line of the node it replaces
+static AST* optimizer_literal(Optimizer* optimizer, AST* node, Value val)
+{
+  switch (val.type) {
+    case VALUE_INT: {
+      AST* ast = arena_alloc(optimizer->arena, ast_size(AST_INT));
+      ast->type = AST_INT;
+      ast->expr_type = TYPE_INT;
+      ast->line = node->line;
+      ast->integer.val = val.integer;
+      return ast;
+    }
+    case VALUE_FLOAT: {
+      AST* ast = arena_alloc(optimizer->arena, ast_size(AST_FLOAT));
+      ast->type = AST_FLOAT;
+      ast->expr_type = TYPE_FLOAT;
+      ast->line = node->line;
+      ast->floating.val = val.floating;
+      return ast;
+    }
+    case VALUE_BOOL:
+      return val.boolean ? get_ast_true() : get_ast_false();
+    default:
+      return (void*)0;
+  }
+}
+
+// same rules as visitor_visit_binary; anything that would fail at runtime
+// is left alone so the error still happens where it used to
+static bool optimizer_fold_binary(_TokenType op, Value left, Value right, Value* out)
+{
+  if (left.type == VALUE_INT && right.type == VALUE_INT) {
+    // wrap like the engines do instead of overflowing at compile time
+    unsigned l = left.integer, r = right.integer;
+    switch (op) {
+      case TOKEN_PLUS: *out = value_int((int)(l + r)); return true;
+      case TOKEN_MINUS: *out = value_int((int)(l - r)); return true;
+      case TOKEN_MUL: *out = value_int((int)(l * r)); return true;
+      case TOKEN_DIV:
+      case TOKEN_MOD:
+        if (right.integer == 0 || (left.integer == INT_MIN && right.integer == -1)) return false;
+        *out = value_int(op == TOKEN_DIV ? left.integer / right.integer : left.integer % right.integer);
+        return true;
+      case TOKEN_EQ: *out = value_bool(left.integer == right.integer); return true;
+      case TOKEN_NE: *out = value_bool(left.integer != right.integer); return true;
+      case TOKEN_GT: *out = value_bool(left.integer > right.integer); return true;
+      case TOKEN_GE: *out = value_bool(left.integer >= right.integer); return true;
+      case TOKEN_LT: *out = value_bool(left.integer < right.integer); return true;
+      case TOKEN_LE: *out = value_bool(left.integer <= right.integer); return true;
+      default: return false;
+    }
+  } else if ((left.type == VALUE_INT || left.type == VALUE_FLOAT) &&
+             (right.type == VALUE_INT || right.type == VALUE_FLOAT)) {
+    float l = left.type == VALUE_FLOAT ? left.floating : (float)left.integer,
+          r = right.type == VALUE_FLOAT ? right.floating : (float)right.integer;
+    switch (op) {
+      case TOKEN_PLUS: *out = value_float(l + r); return true;
+      case TOKEN_MINUS: *out = value_float(l - r); return true;
+      case TOKEN_MUL: *out = value_float(l * r); return true;
+      case TOKEN_DIV: *out = value_float(l / r); return true;
+      case TOKEN_EQ: *out = value_bool(l == r); return true;
+      case TOKEN_NE: *out = value_bool(l != r); return true;
+      case TOKEN_GT: *out = value_bool(l > r); return true;
+      case TOKEN_GE: *out = value_bool(l >= r); return true;
+      case TOKEN_LT: *out = value_bool(l < r); return true;
+      case TOKEN_LE: *out = value_bool(l <= r); return true;
+      default: return false;
+    }
+  } else if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
+    switch (op) {
+      case TOKEN_EQ: *out = value_bool(strcmp(left.string, right.string) == 0); return true;
+      case TOKEN_NE: *out = value_bool(strcmp(left.string, right.string) != 0); return true;
+      default: return false;
+    }
+  } else if (left.type == VALUE_BOOL && right.type == VALUE_BOOL) {
+    switch (op) {
+      case TOKEN_AND: *out = value_bool(left.boolean && right.boolean); return true;
+      case TOKEN_OR: *out = value_bool(left.boolean || right.boolean); return true;
+      case TOKEN_EQ: *out = value_bool(left.boolean == right.boolean); return true;
+      case TOKEN_NE: *out = value_bool(left.boolean != right.boolean); return true;
+      default: return false;
+    }
+  }
+  return false;
+}
+
+static bool optimizer_fold_unary(_TokenType op, Value expr, Value* out)
+{
+  if (op == TOKEN_MINUS && expr.type == VALUE_INT) {
+    *out = value_int((int)-(unsigned)expr.integer);
+    return true;
+  } else if (op == TOKEN_MINUS && expr.type == VALUE_FLOAT) {
+    *out = value_float(-expr.floating);
+    return true;
+  } else if (op == TOKEN_NOT && expr.type == VALUE_BOOL) {
+    *out = value_bool(!expr.boolean);
+    return true;
+  }
+  return false;
+}
+
+static AST* optimizer_expr(Optimizer* optimizer, AST* node);
+
+static void optimizer_args(Optimizer* optimizer, AST* call)
+{
+  for (int i = 0; i < call->function_call.arg_size; i++) {
+    call->function_call.args[i] = optimizer_expr(optimizer, call->function_call.args[i]);
+  }
+}
+
+static AST* optimizer_expr(Optimizer* optimizer, AST* node)
+{
+  Value folded;
+  switch (node->type) {
+    case AST_BINARY:
+      node->binary.left = optimizer_expr(optimizer, node->binary.left);
+      node->binary.right = optimizer_expr(optimizer, node->binary.right);
+      if (optimizer_is_literal(node->binary.left) && optimizer_is_literal(node->binary.right) &&
+          optimizer_fold_binary(node->binary.op, value_from_ast(node->binary.left),
+                                value_from_ast(node->binary.right), &folded)) {
+        return optimizer_literal(optimizer, node, folded);
+      }
+      return node;
+    case AST_UNARY:
+      node->unary.expr = optimizer_expr(optimizer, node->unary.expr);
+      if (optimizer_is_literal(node->unary.expr) &&
+          optimizer_fold_unary(node->unary.op, value_from_ast(node->unary.expr), &folded)) {
+        return optimizer_literal(optimizer, node, folded);
+      }
+      return node;
+    case AST_VARIABLE_ASSIGN:
+      node->variable_assign.assign_val = optimizer_expr(optimizer, node->variable_assign.assign_val);
+      return node;
+    case AST_MEMBER_ASSIGN:
+      node->member_assign.assign_val = optimizer_expr(optimizer, node->member_assign.assign_val);
+      return node;
+    case AST_FUNCTION_CALL:
+      optimizer_args(optimizer, node);
+      return node;
+    case AST_MODULE_FUNCTION_CALL:
+      optimizer_args(optimizer, node->module_function_call.func);
+      return node;
+    default:
+      return node;
+  }
+}
+
+static bool optimizer_is_bool(AST* node, bool val)
+{
+  return node->type == AST_BOOL && node->boolean.val == val;
+}
+
+static void optimizer_compound(Optimizer* optimizer, AST* compound);
+
+static AST* optimizer_statement(Optimizer* optimizer, AST* node)
+{
+  switch (node->type) {
+    case AST_VARIABLE_DECLARATION:
+      for (int i = 0; i < node->variable_declaration.size; i++) {
+        if (node->variable_declaration.is_defined[i]) {
+          node->variable_declaration.values[i] = optimizer_expr(optimizer, node->variable_declaration.values[i]);
+        }
+      }
+      return node;
+    case AST_IF: {
+      node->if_block.cond = optimizer_expr(optimizer, node->if_block.cond);
+      optimizer_compound(optimizer, node->if_block.compound);
+      if (node->if_block.got_else) {
+        node->if_block.else_block = optimizer_statement(optimizer, node->if_block.else_block);
+        if (node->if_block.else_block->type == AST_TYPE_NOOP) {
+          node->if_block.got_else = false;
+        }
+      }
+      if (optimizer_is_bool(node->if_block.cond, true)) {
+        node->if_block.got_else = false;
+      } else if (optimizer_is_bool(node->if_block.cond, false)) {
+        if (!node->if_block.got_else) {
+          return get_ast_noop();
+        }
+        AST* else_block = node->if_block.else_block;
+        if (else_block->type == AST_IF) {
+          return else_block;
+        }
+        // the else body keeps its own block, it just runs unconditionally now
+        node->if_block.cond = get_ast_true();
+        node->if_block.compound = else_block->else_block.compound;
+        node->if_block.got_else = false;
+      }
+      return node;
+    }
+    case AST_ELSE:
+      optimizer_compound(optimizer, node->else_block.compound);
+      return node;
+    case AST_WHILE:
+      node->while_block.cond = optimizer_expr(optimizer, node->while_block.cond);
+      if (optimizer_is_bool(node->while_block.cond, false)) {
+        return get_ast_noop();
+      }
+      optimizer_compound(optimizer, node->while_block.compound);
+      return node;
+    case AST_FOR:
+      if (node->for_block.has_first) {
+        node->for_block.first = optimizer_statement(optimizer, node->for_block.first);
+      }
+      if (node->for_block.has_second) {
+        node->for_block.second = optimizer_expr(optimizer, node->for_block.second);
+      }
+      if (node->for_block.has_third) {
+        node->for_block.third = optimizer_expr(optimizer, node->for_block.third);
+      }
+      optimizer_compound(optimizer, node->for_block.compound);
+      return node;
+    case AST_RETURN:
+      if (!node->return_expr.is_empty_return) {
+        node->return_expr.expr = optimizer_expr(optimizer, node->return_expr.expr);
+      }
+      return node;
+    default:
+      return optimizer_expr(optimizer, node);
+  }
+}
+
+static void optimizer_compound(Optimizer* optimizer, AST* compound)
+{
+  size_t size = 0;
+  for (int i = 0; i < compound->compound.statement_size; i++) {
+    AST* statement = optimizer_statement(optimizer, compound->compound.statements[i]);
+    if (statement->type == AST_TYPE_NOOP) continue;
+    compound->compound.statements[size++] = statement;
+    // nothing after these can run
+    if (statement->type == AST_RETURN || statement->type == AST_STOP || statement->type == AST_SKIP) break;
+  }
+  compound->compound.statement_size = size;
+}
+
+void optimizer_optimize(Optimizer* optimizer, AST* root)
+{
+  optimizer_compound(optimizer, root);
+
+  for (int i = 0; i < optimizer->function_size; i++) {
+    optimizer_compound(optimizer, optimizer->function_declarations[i]->function_declaration.compound);
+  }
+}
@@ -1,20 +1,29 @@
 #include "inc/parser.h"
 #include "inc/ast.h"
 #include "inc/token.h"
+#include "inc/symbol.h"
 #include <stdio.h>
 #include <string.h>
 
-Parser* init_parser(Lexer* lexer)
+#define PARSER_LOOKBEHIND 2
+
+Parser* init_parser(Lexer* lexer, Arena* arena)
 {
   Parser* parser = calloc(1, sizeof(Parser));
 
-  parser->tokens = lexer->tokens;
-  parser->token_size = lexer->token_size;
+  parser->arena = arena;
+  parser->lexer = lexer;
+  parser->src = lexer->src;
   parser->i = 0;
 
+  parser->list = (void*)0;
+  parser->list_size = 0;
+  parser->list_cap = 0;
+
   // function declaration
   parser->function_declarations = (void*)0;
-  size_t function_size = 0;
+  parser->function_size = 0;
+  parser->function_table = init_table();
 
   // object declaration
   parser->object_declarations = (void*)0;
@@ -23,6 +32,41 @@ Parser* init_parser(Lexer* lexer)
   return parser;
 }
 
+static AST* parser_init_ast(Parser* parser, TypeAST type)
+{
+  // nodes only take the bytes their type uses, so small ones pack densely
+  AST* ast = arena_alloc(parser->arena, ast_size(type));
+  ast->type = type;
+  unsigned line = parser_peek(parser)->line;
+  ast->line = line < AST_MAX_LINE ? line : AST_MAX_LINE;
+  return ast;
+}
+
+static void parser_list_push(Parser* parser, void* elem)
+{
+  if (parser->list_size == parser->list_cap) {
+    parser->list_cap = parser->list_cap ? parser->list_cap * 2 : 64;
+    parser->list = realloc(parser->list, parser->list_cap * sizeof(void*));
+  }
+  parser->list[parser->list_size++] = elem;
+}
+
+// moves everything pushed since base into an exactly sized arena array
+static void** parser_list_pop(Parser* parser, size_t base)
+{
+  size_t size = parser->list_size - base;
+  void** list = arena_alloc(parser->arena, size * sizeof(void*));
+  memcpy(list, parser->list + base, size * sizeof(void*));
+  parser->list_size = base;
+  return list;
+}
+
+// names and string literals are interned straight from the token's slice
+static char* parser_symbol(Parser* parser, Token* token)
+{
+  return symbol_intern(parser->src + token->offset, token->length);
+}
+
 static AST* parser_error(Parser* parser, char* msg)
 {
   printf("Parser-> Error at line: %u, %s\n", parser_peek(parser)->line, msg);
@@ -32,24 +76,28 @@ static AST* parser_error(Parser* parser, char* msg)
 
 int parser_is_end(Parser* parser)
 {
-  return parser->i >= parser->token_size;
+  lexer_get_token(parser->lexer, parser->i);
+  return parser->lexer->is_done && parser->i >= parser->lexer->token_size;
 }
 
 Token* parser_peek(Parser* parser)
 {
-  return parser->tokens[parser->i];
+  return lexer_get_token(parser->lexer, parser->i);
 }
 
 Token* parser_peek_offset(Parser* parser, int offset)
 {
-  int i = parser->i + offset;
-  if (i >= parser->token_size) return parser->tokens[parser->token_size - 1];
-  return parser->tokens[i];
+  return lexer_get_token(parser->lexer, parser->i + offset);
 }
 
 Token* parser_advance(Parser* parser)
 { 
-  return parser->tokens[parser->i++];
+  Token* token = lexer_get_token(parser->lexer, parser->i++);
+  // peek_offset never looks further back than this
+  if (parser->i > PARSER_LOOKBEHIND) {
+    lexer_release(parser->lexer, parser->i - PARSER_LOOKBEHIND);
+  }
+  return token;
 }
 
 Token* parser_eat(Parser* parser, _TokenType type)
@@ -63,7 +111,13 @@ Token* parser_eat(Parser* parser, _TokenType type)
 
 AST* parser_parse(Parser* parser)
 {
-  return parser_parse_statements(parser);
+  AST* root = parser_parse_statements(parser);
+
+  free(parser->list);
+  parser->list = (void*)0;
+  parser->list_cap = 0;
+
+  return root;
 }
 
 AST* parser_parse_statement(Parser* parser)
@@ -100,20 +154,19 @@ AST* parser_parse_statement(Parser* parser)
 
 AST* parser_parse_statements(Parser* parser)
 {
-  AST* ast = init_ast(AST_COMPOUND);
+  AST* ast = parser_init_ast(parser, AST_COMPOUND);
 
   ast->compound.type = COMPOUND_ENTRY;
-  ast->compound.statement_size = 1;
-  ast->compound.statements = calloc(1, sizeof(AST*));
-  ast->compound.statements[0] = parser_parse_statement(parser);
+  size_t base = parser->list_size;
+  parser_list_push(parser, parser_parse_statement(parser));
 
   while(!parser_is_end(parser) && parser_peek(parser)->type == TOKEN_NEWL) {
     parser_eat(parser, TOKEN_NEWL);
 
-    ast->compound.statement_size++;
-    ast->compound.statements = realloc(ast->compound.statements, ast->compound.statement_size * sizeof(AST*));
-    ast->compound.statements[ast->compound.statement_size - 1] = parser_parse_statement(parser);
+    parser_list_push(parser, parser_parse_statement(parser));
   }
+  ast->compound.statement_size = parser->list_size - base;
+  ast->compound.statements = (AST**) parser_list_pop(parser, base);
   if (parser_peek(parser)->type != TOKEN_EOF) {
     char msg[64];
     sprintf(msg, "syntax error: encountered %s", token_name(parser_peek(parser)->type));
@@ -171,19 +224,18 @@ AST* parser_parse_statement_in_block(Parser* parser, bool is_function, bool is_l
 
 AST* parser_parse_statements_in_block(Parser* parser, bool is_function, bool is_loop)
 {
-  AST* ast = init_ast(AST_COMPOUND);
+  AST* ast = parser_init_ast(parser, AST_COMPOUND);
 
-  ast->compound.statement_size = 1;
-  ast->compound.statements = calloc(1, sizeof(AST*));
-  ast->compound.statements[0] = parser_parse_statement_in_block(parser, is_function, is_loop);
+  size_t base = parser->list_size;
+  parser_list_push(parser, parser_parse_statement_in_block(parser, is_function, is_loop));
 
   while(!parser_is_end(parser) && parser_peek(parser)->type == TOKEN_NEWL) {
     parser_eat(parser, TOKEN_NEWL);
 
-    ast->compound.statement_size++;
-    ast->compound.statements = realloc(ast->compound.statements, ast->compound.statement_size * sizeof(AST*));
-    ast->compound.statements[ast->compound.statement_size - 1] = parser_parse_statement_in_block(parser, is_function, is_loop);
+    parser_list_push(parser, parser_parse_statement_in_block(parser, is_function, is_loop));
   }
+  ast->compound.statement_size = parser->list_size - base;
+  ast->compound.statements = (AST**) parser_list_pop(parser, base);
   if (parser_peek(parser)->type != TOKEN_DEDENT) {
     char msg[64];
     sprintf(msg, "syntax error: encountered %s", token_name(parser_peek(parser)->type));
@@ -202,7 +254,7 @@ AST* parser_parse_expr(Parser* parser)
         t == TOKEN_AND ||
         t == TOKEN_OR)) {
     
-    AST* binary = init_ast(AST_BINARY);
+    AST* binary = parser_init_ast(parser, AST_BINARY);
     binary->binary.left = left;
     binary->binary.op = parser_advance(parser)->type;
     binary->binary.right = parser_parse_equality(parser);
@@ -224,7 +276,7 @@ AST* parser_parse_equality(Parser* parser)
         t == TOKEN_EQ ||
         t == TOKEN_NE)) {
     
-    AST* binary = init_ast(AST_BINARY);
+    AST* binary = parser_init_ast(parser, AST_BINARY);
     binary->binary.left = left;
     binary->binary.op = parser_advance(parser)->type;
     binary->binary.right = parser_parse_comparison(parser);
@@ -248,7 +300,7 @@ AST* parser_parse_comparison(Parser* parser)
         t == TOKEN_LT ||
         t == TOKEN_LE)) {
     
-    AST* binary = init_ast(AST_BINARY);
+    AST* binary = parser_init_ast(parser, AST_BINARY);
     binary->binary.left = left;
     binary->binary.op = parser_advance(parser)->type;
     binary->binary.right = parser_parse_term(parser);
@@ -270,7 +322,7 @@ AST* parser_parse_term(Parser* parser)
         t == TOKEN_PLUS ||
         t == TOKEN_MINUS)) {
     
-    AST* binary = init_ast(AST_BINARY);
+    AST* binary = parser_init_ast(parser, AST_BINARY);
     binary->binary.left = left;
     binary->binary.op = parser_advance(parser)->type;
     binary->binary.right = parser_parse_factor(parser);
@@ -293,7 +345,7 @@ AST* parser_parse_factor(Parser* parser)
         t == TOKEN_DIV ||
         t == TOKEN_MOD)) {
     
-    AST* binary = init_ast(AST_BINARY);
+    AST* binary = parser_init_ast(parser, AST_BINARY);
     binary->binary.left = left;
     binary->binary.op = parser_advance(parser)->type;
     binary->binary.right = parser_parse_unary(parser);
@@ -311,7 +363,7 @@ AST* parser_parse_unary(Parser* parser)
   switch (parser_peek(parser)->type) {
     case TOKEN_MINUS:
     case TOKEN_NOT: {
-      AST* unary = init_ast(AST_UNARY);
+      AST* unary = parser_init_ast(parser, AST_UNARY);
       unary->unary.op = parser_advance(parser)->type;
       unary->unary.expr = parser_parse_primary(parser);
       return unary;
@@ -354,20 +406,28 @@ AST* parser_parse_primary(Parser* parser)
 
 AST* parser_parse_digit(Parser* parser)
 {
-  AST* ast = calloc(1, sizeof(AST));
+  AST* ast;
 
-  switch (parser_peek(parser)->type) {
+  // the slice is not terminated, copy it so atoi/atof stop at the lexeme
+  Token* token = parser_peek(parser);
+  char digits[token->length + 1];
+  memcpy(digits, parser->src + token->offset, token->length);
+  digits[token->length] = '\0';
+
+  switch (token->type) {
     case TOKEN_INT_VAL:
-      ast->type = AST_INT;
-      ast->integer.val = atoi(parser_advance(parser)->value);
+      ast = parser_init_ast(parser, AST_INT);
+      parser_advance(parser);
+      ast->integer.val = atoi(digits);
       break;
     case TOKEN_FLOAT_VAL:
-      ast->type = AST_FLOAT;
-      ast->floating.val = atof(parser_advance(parser)->value);
+      ast = parser_init_ast(parser, AST_FLOAT);
+      parser_advance(parser);
+      ast->floating.val = atof(digits);
       break;
     default: {
       char msg[64]; sprintf(msg, "unexpected token at parse digit: '%s'", token_name(parser_peek(parser)->type));
-      parser_error(parser, msg);
+      return parser_error(parser, msg);
     }
   }
 
@@ -376,35 +436,34 @@ AST* parser_parse_digit(Parser* parser)
 
 AST* parser_parse_function_call(Parser* parser)
 {
-  AST* ast = init_ast(AST_FUNCTION_CALL);
+  AST* ast = parser_init_ast(parser, AST_FUNCTION_CALL);
 
-  ast->function_call.name = parser_eat(parser, TOKEN_ID)->value;
+  ast->function_call.name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
   parser_eat(parser, TOKEN_LPAREN);
 
-  ast->function_call.arg_size = 0;
+  size_t base = parser->list_size;
 
   if (parser_peek(parser)->type != TOKEN_RPAREN) {
-    ast->function_call.arg_size = 1;
-    ast->function_call.args = calloc(1, sizeof(AST*));
-    ast->function_call.args[0] = parser_parse_expr(parser);
+    parser_list_push(parser, parser_parse_expr(parser));
   }
 
   while (!parser_is_end(parser) && parser_peek(parser)->type != TOKEN_RPAREN) {
     parser_eat(parser, TOKEN_COMMA);
-    ast->function_call.arg_size++;
-    ast->function_call.args = realloc(ast->function_call.args, ast->function_call.arg_size * sizeof(AST*));
-    ast->function_call.args[ast->function_call.arg_size - 1] = parser_parse_expr(parser);
+    parser_list_push(parser, parser_parse_expr(parser));
   }
   parser_eat(parser, TOKEN_RPAREN);
 
+  ast->function_call.arg_size = parser->list_size - base;
+  ast->function_call.args = ast->function_call.arg_size ? (AST**) parser_list_pop(parser, base) : (void*)0;
+
   return ast;
 }
 
 AST* parser_parse_string(Parser* parser)
 {
-  AST* ast = init_ast(AST_STRING);
+  AST* ast = parser_init_ast(parser, AST_STRING);
 
-  ast->string.val = parser_advance(parser)->value;
+  ast->string.val = parser_symbol(parser, parser_advance(parser));
 
   return ast;
 }
@@ -416,7 +475,7 @@ AST* parser_parse_id(Parser* parser)
 
 AST* parser_parse_variable_declaration(Parser* parser)
 {
-  AST* ast = init_ast(AST_VARIABLE_DECLARATION);
+  AST* ast = parser_init_ast(parser, AST_VARIABLE_DECLARATION);
   VariableType var_type;
   switch (parser_advance(parser)->type) {
     case TOKEN_INT:
@@ -433,7 +492,7 @@ AST* parser_parse_variable_declaration(Parser* parser)
       break;
     case TOKEN_ID:
       var_type = VAR_OBJECT;
-      ast->variable_declaration.object_type = parser_peek_offset(parser, -1)->value;
+      ast->variable_declaration.object_type = parser_symbol(parser, parser_peek_offset(parser, -1));
       break;
     default:
       return get_ast_noop();
@@ -441,8 +500,11 @@ AST* parser_parse_variable_declaration(Parser* parser)
 
   ast->variable_declaration.type = var_type;
 
+  // names and values are stacked in pairs, a value is only there when defined
+  size_t base = parser->list_size;
+
   loop: {
-    char* name = parser_eat(parser, TOKEN_ID)->value;
+    char* name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
     bool is_defined = false;
 
     if (var_type == VAR_OBJECT) goto skip_object;
@@ -456,15 +518,8 @@ AST* parser_parse_variable_declaration(Parser* parser)
 
     AST* value = is_defined ? parser_parse_expr(parser) : (void*)0;
 
-    ast->variable_declaration.size++;
-
-    ast->variable_declaration.names = realloc(ast->variable_declaration.names, ast->variable_declaration.size * sizeof(AST*));
-    ast->variable_declaration.values = realloc(ast->variable_declaration.values, ast->variable_declaration.size * sizeof(char*));
-    ast->variable_declaration.is_defined = realloc(ast->variable_declaration.is_defined, ast->variable_declaration.size * sizeof(bool));
-
-    ast->variable_declaration.names[ast->variable_declaration.size - 1] = name;
-    ast->variable_declaration.values[ast->variable_declaration.size - 1] = value;
-    ast->variable_declaration.is_defined[ast->variable_declaration.size - 1] = is_defined;
+    parser_list_push(parser, name);
+    parser_list_push(parser, value);
 
     if (parser_peek(parser)->type == TOKEN_COMMA) {
       parser_eat(parser, TOKEN_COMMA);
@@ -472,6 +527,18 @@ AST* parser_parse_variable_declaration(Parser* parser)
     }
   }
 
+  size_t size = (parser->list_size - base) / 2;
+  ast->variable_declaration.size = size;
+  ast->variable_declaration.names = arena_alloc(parser->arena, size * sizeof(char*));
+  ast->variable_declaration.values = arena_alloc(parser->arena, size * sizeof(AST*));
+  ast->variable_declaration.is_defined = arena_alloc(parser->arena, size * sizeof(bool));
+  for (size_t i = 0; i < size; i++) {
+    ast->variable_declaration.names[i] = parser->list[base + 2 * i];
+    ast->variable_declaration.values[i] = parser->list[base + 2 * i + 1];
+    ast->variable_declaration.is_defined[i] = ast->variable_declaration.values[i] != (void*)0;
+  }
+  parser->list_size = base;
+
   return ast;
 }
 
@@ -485,11 +552,11 @@ AST* parser_parse_variable(Parser* parser)
     return parser_parse_variable_declaration(parser);
   }
 
-  char* name = parser_eat(parser, TOKEN_ID)->value;
+  char* name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
 /*
   if (parser_peek(parser)->type == TOKEN_ASSIGN) {
     parser_advance(parser);
-    AST* ast = init_ast(AST_VARIABLE_ASSIGN);
+    AST* ast = parser_init_ast(parser, AST_VARIABLE_ASSIGN);
     ast->variable_assign.name = name;
     ast->variable_assign.assign_val = parser_parse_expr(parser);
     return ast;
@@ -502,7 +569,7 @@ AST* parser_parse_variable(Parser* parser)
     case TOKEN_MULEQ:
     case TOKEN_DIVEQ:
     case TOKEN_MODEQ: {
-      AST* ast = init_ast(AST_VARIABLE_ASSIGN);
+      AST* ast = parser_init_ast(parser, AST_VARIABLE_ASSIGN);
       ast->variable_assign.name = name;
       ast->variable_assign.op = parser_advance(parser)->type;
       ast->variable_assign.assign_val = parser_parse_expr(parser);
@@ -511,7 +578,7 @@ AST* parser_parse_variable(Parser* parser)
     default:
       break;
   }
-  AST* ast = init_ast(AST_VARIABLE);
+  AST* ast = parser_init_ast(parser, AST_VARIABLE);
   ast->variable.name = name;
   return ast;
 }
@@ -534,7 +601,7 @@ AST* parser_parse_if(Parser* parser, bool in_function, bool in_loop)
 {
   parser_eat(parser, TOKEN_IF);
 
-  AST* ast = init_ast(AST_IF);
+  AST* ast = parser_init_ast(parser, AST_IF);
   ast->if_block.cond = parser_parse_expr(parser);
   parser_eat(parser, TOKEN_NEWL);
   parser_eat(parser, TOKEN_INDENT);
@@ -551,7 +618,7 @@ AST* parser_parse_if(Parser* parser, bool in_function, bool in_loop)
     else {
       parser_eat(parser, TOKEN_NEWL);
       parser_eat(parser, TOKEN_INDENT);
-      AST* ast_else = init_ast(AST_ELSE);
+      AST* ast_else = parser_init_ast(parser, AST_ELSE);
       ast_else->else_block.compound = parser_parse_statements_in_block(parser, in_function, in_loop);
       ast_else->else_block.compound->compound.type = COMPOUND_IF;
       parser_eat(parser, TOKEN_DEDENT);
@@ -568,7 +635,7 @@ AST* parser_parse_while(Parser* parser, bool in_function)
 {
   parser_eat(parser, TOKEN_WHILE);
 
-  AST* ast = init_ast(AST_WHILE);
+  AST* ast = parser_init_ast(parser, AST_WHILE);
   ast->while_block.cond = parser_parse_expr(parser);
   parser_eat(parser, TOKEN_NEWL);
   parser_eat(parser, TOKEN_INDENT);
@@ -583,7 +650,7 @@ AST* parser_parse_for(Parser* parser, bool in_function)
 {
   parser_eat(parser, TOKEN_FOR);
 
-  AST* ast = init_ast(AST_FOR);
+  AST* ast = parser_init_ast(parser, AST_FOR);
 
   // first
   if (parser_peek(parser)->type == TOKEN_SEMICOLON) {
@@ -636,7 +703,7 @@ AST* parser_parse_for(Parser* parser, bool in_function)
 
 AST* parser_parse_function_declaration(Parser* parser)
 {
-  AST* ast = init_ast(AST_FUNCTION_DECLARATION);
+  AST* ast = parser_init_ast(parser, AST_FUNCTION_DECLARATION);
 
   parser_eat(parser, TOKEN_FUNCTION);
   
@@ -662,23 +729,21 @@ AST* parser_parse_function_declaration(Parser* parser)
 
   no_type:
 
-  ast->function_declaration.name = parser_eat(parser, TOKEN_ID)->value;
-  for (int i = 0; i < parser->function_size; i++) {
-    if (strcmp(ast->function_declaration.name, parser->function_declarations[i]->function_declaration.name) == 0) {
-      char msg[128];
-      sprintf(msg,
-              "function '%s' has already been declared",
-              ast->function_declaration.name);
-      parser_error(parser, msg);
-    }
+  ast->function_declaration.name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
+  if (table_get(parser->function_table, ast->function_declaration.name) >= 0) {
+    char msg[128];
+    sprintf(msg,
+            "function '%s' has already been declared",
+            ast->function_declaration.name);
+    parser_error(parser, msg);
   }
 
   parser_eat(parser, TOKEN_LPAREN);
 
   if (parser_peek(parser)->type != TOKEN_RPAREN) {
     ast->function_declaration.arg_size = 1;
-    ast->function_declaration.args = calloc(1, sizeof(AST*));
-    ast->function_declaration.arg_types = calloc(1, sizeof(VariableType));
+    ast->function_declaration.args = arena_grow(parser->arena, (void*)0, 0, sizeof(AST*));
+    ast->function_declaration.arg_types = arena_grow(parser->arena, (void*)0, 0, sizeof(VariableType));
 
     VariableType type;
     switch (parser_advance(parser)->type) {
@@ -706,12 +771,12 @@ AST* parser_parse_function_declaration(Parser* parser)
       }
     }
 
-    AST* arg = init_ast(AST_VARIABLE);
-    arg->variable.name = parser_eat(parser, TOKEN_ID)->value;
+    AST* arg = parser_init_ast(parser, AST_VARIABLE);
+    arg->variable.name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
     ast->function_declaration.args[0] = arg;
     ast->function_declaration.arg_types[0] = type;
     if (type == VAR_OBJECT) {
-      arg->variable.object_type_name = parser_peek_offset(parser, -2)->value;
+      arg->variable.object_type_name = parser_symbol(parser, parser_peek_offset(parser, -2));
     }
   }
 
@@ -719,10 +784,10 @@ AST* parser_parse_function_declaration(Parser* parser)
     parser_eat(parser, TOKEN_COMMA);
 
     ast->function_declaration.arg_size++;
-    ast->function_declaration.args = realloc(ast->function_declaration.args,
-                                            ast->function_declaration.arg_size * sizeof(AST*));
-    ast->function_declaration.arg_types = realloc(ast->function_declaration.arg_types,
-                                                 ast->function_declaration.arg_size * sizeof(VariableType));
+    ast->function_declaration.args = arena_grow(parser->arena, ast->function_declaration.args,
+                                            ast->function_declaration.arg_size - 1, sizeof(AST*));
+    ast->function_declaration.arg_types = arena_grow(parser->arena, ast->function_declaration.arg_types,
+                                                 ast->function_declaration.arg_size - 1, sizeof(VariableType));
 
     VariableType type;
     switch (parser_advance(parser)->type) {
@@ -750,12 +815,12 @@ AST* parser_parse_function_declaration(Parser* parser)
       }
     }
 
-    AST* arg = init_ast(AST_VARIABLE);
-    arg->variable.name = parser_eat(parser, TOKEN_ID)->value;
+    AST* arg = parser_init_ast(parser, AST_VARIABLE);
+    arg->variable.name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
     ast->function_declaration.args[ast->function_declaration.arg_size - 1] = arg;
     ast->function_declaration.arg_types[ast->function_declaration.arg_size - 1] = type;
     if (type == VAR_OBJECT) {
-      arg->variable.object_type_name = parser_peek_offset(parser, -2)->value;
+      arg->variable.object_type_name = parser_symbol(parser, parser_peek_offset(parser, -2));
     }
   }
 
@@ -767,15 +832,16 @@ AST* parser_parse_function_declaration(Parser* parser)
   parser_eat(parser, TOKEN_DEDENT);
   
   parser->function_size++;
-  parser->function_declarations = realloc(parser->function_declarations, parser->function_size * sizeof(AST*));
+  parser->function_declarations = arena_grow(parser->arena, parser->function_declarations, parser->function_size - 1, sizeof(AST*));
   parser->function_declarations[parser->function_size - 1] = ast;
+  table_set(parser->function_table, ast->function_declaration.name, parser->function_size - 1);
 
   return get_ast_noop();
 }
 
 AST* parser_parse_return(Parser* parser)
 {
-  AST* ast = init_ast(AST_RETURN);
+  AST* ast = parser_init_ast(parser, AST_RETURN);
   parser_eat(parser, TOKEN_RETURN);
   
   ast->return_expr.is_empty_return = true;
@@ -790,25 +856,25 @@ AST* parser_parse_return(Parser* parser)
 AST* parser_parse_skip(Parser* parser)
 {
   parser_eat(parser, TOKEN_SKIP);
-  return init_ast(AST_SKIP);
+  return parser_init_ast(parser, AST_SKIP);
 }
 
 AST* parser_parse_stop(Parser* parser)
 {
   parser_eat(parser, TOKEN_STOP);
-  return init_ast(AST_STOP);
+  return parser_init_ast(parser, AST_STOP);
 }
 
 AST* parser_parse_include(Parser* parser)
 {
   parser_eat(parser, TOKEN_INCLUDE);
-  AST* ast = init_ast(AST_INCLUDE);
+  AST* ast = parser_init_ast(parser, AST_INCLUDE);
   ast->include.is_alias = false;
-  ast->include.module_name = parser_eat(parser, TOKEN_ID)->value;
+  ast->include.module_name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
   if (parser_peek(parser)->type == TOKEN_ASSIGN) {
     parser_eat(parser, TOKEN_ASSIGN);
     ast->include.is_alias = true;
-    ast->include.module_alias_name = parser_eat(parser, TOKEN_ID)->value;
+    ast->include.module_alias_name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
   }
 
   return ast;
@@ -816,9 +882,9 @@ AST* parser_parse_include(Parser* parser)
 
 AST* parser_parse_module_function_call(Parser* parser)
 {
-  AST* ast = init_ast(AST_MODULE_FUNCTION_CALL);
+  AST* ast = parser_init_ast(parser, AST_MODULE_FUNCTION_CALL);
 
-  ast->module_function_call.module_name = parser_eat(parser, TOKEN_ID)->value;
+  ast->module_function_call.module_name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
   parser_eat(parser, TOKEN_DOT);
   ast->module_function_call.func = parser_parse_function_call(parser);
 
@@ -827,10 +893,10 @@ AST* parser_parse_module_function_call(Parser* parser)
 
 AST* parser_parse_object_declaration(Parser* parser)
 {
-  AST* ast = init_ast(AST_OBJECT_DECLARATION);
+  AST* ast = parser_init_ast(parser, AST_OBJECT_DECLARATION);
   parser_eat(parser, TOKEN_OBJECT);
 
-  ast->object_declaration.name = parser_eat(parser, TOKEN_ID)->value;
+  ast->object_declaration.name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
 
   parser_eat(parser, TOKEN_NEWL);
   parser_eat(parser, TOKEN_INDENT);
@@ -860,11 +926,11 @@ AST* parser_parse_object_declaration(Parser* parser)
     }
 
     ast->object_declaration.field_size++;
-    ast->object_declaration.field_names = realloc(ast->object_declaration.field_names, ast->object_declaration.field_size * sizeof(char*));
-    ast->object_declaration.field_types = realloc(ast->object_declaration.field_types, ast->object_declaration.field_size * sizeof(VariableType));
+    ast->object_declaration.field_names = arena_grow(parser->arena, ast->object_declaration.field_names, ast->object_declaration.field_size - 1, sizeof(char*));
+    ast->object_declaration.field_types = arena_grow(parser->arena, ast->object_declaration.field_types, ast->object_declaration.field_size - 1, sizeof(VariableType));
 
     ast->object_declaration.field_types[ast->object_declaration.field_size - 1] = type;
-    ast->object_declaration.field_names[ast->object_declaration.field_size - 1] = parser_eat(parser, TOKEN_ID)->value;
+    ast->object_declaration.field_names[ast->object_declaration.field_size - 1] = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
 
     parser_eat(parser, TOKEN_NEWL);
   }
@@ -872,7 +938,7 @@ AST* parser_parse_object_declaration(Parser* parser)
   parser_eat(parser, TOKEN_DEDENT);
 
   parser->object_size++;
-  parser->object_declarations = realloc(parser->object_declarations, parser->object_size * sizeof(AST*));
+  parser->object_declarations = arena_grow(parser->arena, parser->object_declarations, parser->object_size - 1, sizeof(AST*));
   parser->object_declarations[parser->object_size - 1] = ast;
 
   return get_ast_noop();
@@ -884,10 +950,10 @@ AST* parser_parse_member_access(Parser* parser)
     return parser_parse_module_function_call(parser);
   }
 
-  AST* ast = init_ast(AST_MEMBER_ACCESS);
-  ast->member_access.object_name = parser_eat(parser, TOKEN_ID)->value;
+  AST* ast = parser_init_ast(parser, AST_MEMBER_ACCESS);
+  ast->member_access.object_name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
   parser_eat(parser, TOKEN_DOT);
-  ast->member_access.member_name = parser_eat(parser, TOKEN_ID)->value;
+  ast->member_access.member_name = parser_symbol(parser, parser_eat(parser, TOKEN_ID));
 
   switch (parser_peek(parser)->type) {
     case TOKEN_ASSIGN:
@@ -896,7 +962,7 @@ AST* parser_parse_member_access(Parser* parser)
     case TOKEN_MULEQ:
     case TOKEN_DIVEQ:
     case TOKEN_MODEQ: {
-      AST* ast_assign = init_ast(AST_MEMBER_ASSIGN);
+      AST* ast_assign = parser_init_ast(parser, AST_MEMBER_ASSIGN);
       ast_assign->member_assign.member_access = ast;
       ast_assign->member_assign.op = parser_advance(parser)->type;
       ast_assign->member_assign.assign_val = parser_parse_expr(parser);
@@ -0,0 +1,244 @@
+#include "inc/resolver.h"
+#include "inc/builtin.h"
+#include <stdio.h>
+
+static ResolverScope* init_resolver_scope(ResolverScope* prev)
+{
+  ResolverScope* scope = calloc(1, sizeof(ResolverScope));
+
+  scope->names = (void*)0;
+  scope->name_size = 0;
+  scope->first_slot = prev ? prev->first_slot + prev->name_size : 0;
+  scope->prev = prev;
+
+  return scope;
+}
+
+Resolver* init_resolver(Parser* parser)
+{
+  Resolver* resolver = calloc(1, sizeof(Resolver));
+
+  resolver->function_declarations = parser->function_declarations;
+  resolver->function_size = parser->function_size;
+  resolver->function_table = parser->function_table;
+  resolver->global_scope = init_resolver_scope((void*)0);
+  resolver->scope = (void*)0;
+  resolver->function = (void*)0;
+  resolver->frame_size = 0;
+
+  return resolver;
+}
+
+static void resolver_error(char* msg)
+{
+  printf("Resolver-> Error: %s\n", msg);
+  exit(1);
+}
+
+static int resolver_scope_find(ResolverScope* scope, char* name)
+{
+  for (int i = 0; i < scope->name_size; i++) {
+    if (scope->names[i] == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static int resolver_declare(Resolver* resolver, char* name)
+{
+  ResolverScope* scope = resolver->scope ? resolver->scope : resolver->global_scope;
+  if (resolver_scope_find(scope, name) >= 0) {
+    char msg[64];
+    sprintf(msg, "variable '%s' has already been declared", name);
+    resolver_error(msg);
+  }
+  scope->name_size++;
+  scope->names = realloc(scope->names, scope->name_size * sizeof(char*));
+  scope->names[scope->name_size - 1] = name;
+
+  if (!resolver->scope) {
+    return RESOLVER_GLOBAL;
+  }
+  int slot = scope->first_slot + scope->name_size - 1;
+  size_t* frame_size = resolver->function ? &resolver->function->function_declaration.frame_size : &resolver->frame_size;
+  if (slot >= *frame_size) {
+    *frame_size = slot + 1;
+  }
+  return slot;
+}
+
+static void resolver_lookup(Resolver* resolver, char* name, char* what, int* depth, int* slot)
+{
+  for (ResolverScope* scope = resolver->scope; scope; scope = scope->prev) {
+    int i = resolver_scope_find(scope, name);
+    if (i >= 0) {
+      *depth = RESOLVER_FRAME;
+      *slot = scope->first_slot + i;
+      return;
+    }
+  }
+  int i = resolver_scope_find(resolver->global_scope, name);
+  if (i >= 0) {
+    *depth = RESOLVER_GLOBAL;
+    *slot = i;
+    return;
+  }
+  char msg[128];
+  sprintf(msg, "use of undeclared %s: '%s'", what, name);
+  resolver_error(msg);
+}
+
+static void resolver_begin_scope(Resolver* resolver)
+{
+  resolver->scope = init_resolver_scope(resolver->scope);
+}
+
+static void resolver_end_scope(Resolver* resolver)
+{
+  ResolverScope* scope = resolver->scope;
+  resolver->scope = scope->prev;
+  free(scope->names);
+  free(scope);
+}
+
+static void resolver_visit(Resolver* resolver, AST* node);
+
+static void resolver_args(Resolver* resolver, AST* node)
+{
+  for (int i = 0; i < node->function_call.arg_size; i++) {
+    resolver_visit(resolver, node->function_call.args[i]);
+  }
+}
+
+static void resolver_bind_call(Resolver* resolver, AST* node)
+{
+  node->function_call.builtin = builtin_find(node->function_call.name);
+  node->function_call.function = -1;
+  if (node->function_call.builtin >= 0) return;
+
+  node->function_call.function = table_get(resolver->function_table, node->function_call.name);
+  if (node->function_call.function < 0) {
+    char msg[64];
+    sprintf(msg, "call to undeclared function named: '%s'", node->function_call.name);
+    resolver_error(msg);
+  }
+}
+
+static void resolver_visit(Resolver* resolver, AST* node)
+{
+  switch (node->type) {
+    case AST_COMPOUND:
+      for (int i = 0; i < node->compound.statement_size; i++) {
+        resolver_visit(resolver, node->compound.statements[i]);
+      }
+      break;
+    case AST_BINARY:
+      resolver_visit(resolver, node->binary.left);
+      resolver_visit(resolver, node->binary.right);
+      break;
+    case AST_UNARY:
+      resolver_visit(resolver, node->unary.expr);
+      break;
+    case AST_FUNCTION_CALL:
+      resolver_bind_call(resolver, node);
+      resolver_args(resolver, node);
+      break;
+    case AST_MODULE_FUNCTION_CALL:
+      // module functions are looked up when the module is loaded
+      resolver_args(resolver, node->module_function_call.func);
+      break;
+    case AST_VARIABLE_DECLARATION:
+      // the initializer is resolved before its own name is visible
+      for (int i = 0; i < node->variable_declaration.size; i++) {
+        if (node->variable_declaration.is_defined[i]) {
+          resolver_visit(resolver, node->variable_declaration.values[i]);
+        }
+        int slot = resolver_declare(resolver, node->variable_declaration.names[i]);
+        if (i == 0) {
+          node->variable_declaration.slot = slot;
+        }
+      }
+      break;
+    case AST_VARIABLE:
+      resolver_lookup(resolver, node->variable.name, "variable",
+                      &node->variable.depth, &node->variable.slot);
+      break;
+    case AST_VARIABLE_ASSIGN:
+      resolver_lookup(resolver, node->variable_assign.name, "variable",
+                      &node->variable_assign.depth, &node->variable_assign.slot);
+      resolver_visit(resolver, node->variable_assign.assign_val);
+      break;
+    case AST_MEMBER_ACCESS:
+      resolver_lookup(resolver, node->member_access.object_name, "object variable",
+                      &node->member_access.depth, &node->member_access.slot);
+      break;
+    case AST_MEMBER_ASSIGN:
+      resolver_visit(resolver, node->member_assign.member_access);
+      resolver_visit(resolver, node->member_assign.assign_val);
+      break;
+    case AST_IF:
+      resolver_visit(resolver, node->if_block.cond);
+      resolver_begin_scope(resolver);
+      resolver_visit(resolver, node->if_block.compound);
+      resolver_end_scope(resolver);
+      if (node->if_block.got_else) {
+        resolver_visit(resolver, node->if_block.else_block);
+      }
+      break;
+    case AST_ELSE:
+      resolver_begin_scope(resolver);
+      resolver_visit(resolver, node->else_block.compound);
+      resolver_end_scope(resolver);
+      break;
+    case AST_WHILE:
+      resolver_visit(resolver, node->while_block.cond);
+      resolver_begin_scope(resolver);
+      resolver_visit(resolver, node->while_block.compound);
+      resolver_end_scope(resolver);
+      break;
+    case AST_FOR:
+      // the header gets its own scope, the body another one inside it
+      resolver_begin_scope(resolver);
+      if (node->for_block.has_first) {
+        resolver_visit(resolver, node->for_block.first);
+      }
+      if (node->for_block.has_second) {
+        resolver_visit(resolver, node->for_block.second);
+      }
+      if (node->for_block.has_third) {
+        resolver_visit(resolver, node->for_block.third);
+      }
+      resolver_begin_scope(resolver);
+      resolver_visit(resolver, node->for_block.compound);
+      resolver_end_scope(resolver);
+      resolver_end_scope(resolver);
+      break;
+    case AST_RETURN:
+      if (!node->return_expr.is_empty_return) {
+        resolver_visit(resolver, node->return_expr.expr);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void resolver_resolve(Resolver* resolver, AST* root)
+{
+  // top level first so functions can see every global
+  resolver_visit(resolver, root);
+
+  for (int i = 0; i < resolver->function_size; i++) {
+    AST* f = resolver->function_declarations[i];
+    resolver->function = f;
+    f->function_declaration.frame_size = 0;
+    resolver_begin_scope(resolver);
+    for (int j = 0; j < f->function_declaration.arg_size; j++) {
+      resolver_declare(resolver, f->function_declaration.args[j]->variable.name);
+    }
+    resolver_visit(resolver, f->function_declaration.compound);
+    resolver_end_scope(resolver);
+  }
+  resolver->function = (void*)0;
+}
@@ -0,0 +1,650 @@
+// runtime of programs compiled by --emit-c and --build, mirrors the VM, builtins,
+// gc and modules; build.sh checks it and embeds it into the emitter, which writes
+// it in front of every emitted program
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <signal.h>
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <dlfcn.h>
+#endif
+
+// the emitter defines the layout of the interpreter's AST nodes in front of this
+// file, these only stand in when build.sh compiles it on its own
+#ifdef RT_CHECK
+#define RT_AST_SIZE 1
+#define RT_AST_PAYLOAD 0
+#define RT_AST_NOOP 0
+#define RT_AST_INT 1
+#define RT_AST_FLOAT 2
+#define RT_AST_STRING 3
+#define RT_AST_BOOL 4
+#endif
+
+typedef enum {
+  VALUE_UNDEFINED,
+  VALUE_NOOP,
+  VALUE_INT,
+  VALUE_FLOAT,
+  VALUE_STRING,
+  VALUE_BOOL,
+  VALUE_OBJECT,
+} ValueType;
+
+typedef struct {
+  char* name;
+  size_t field_size;
+  char** field_names;
+} Declaration;
+
+typedef struct GCObject {
+  struct GCObject* next;
+  size_t size;
+  bool is_object;
+  bool marked;
+} GCObject;
+
+typedef struct Value {
+  ValueType type;
+  bool is_managed;
+  union {
+    int integer;
+    float floating;
+    char* string;
+    bool boolean;
+    struct Object* object;
+  };
+} Value;
+
+typedef struct Object {
+  GCObject gc;
+  Declaration* declaration;
+  Value fields[];
+} Object;
+
+typedef enum {
+  BIN_ADD,
+  BIN_SUB,
+  BIN_MUL,
+  BIN_DIV,
+  BIN_MOD,
+  BIN_EQ,
+  BIN_NE,
+  BIN_GT,
+  BIN_GE,
+  BIN_LT,
+  BIN_LE,
+  BIN_AND,
+  BIN_OR,
+} Binary;
+
+typedef enum {
+  COND_IF,
+  COND_WHILE,
+  COND_FOR,
+} CondKind;
+
+typedef struct {
+  char* name;
+  void* handle;
+} Module;
+
+// one per call site, the function is looked up on its first call
+typedef struct {
+  char* module_name;
+  char* name;
+  void* function;
+} ModuleCall;
+
+#define INT(v) ((Value) { .type = VALUE_INT, .integer = (v) })
+#define FLOAT(v) ((Value) { .type = VALUE_FLOAT, .floating = (v) })
+#define STRING(v) ((Value) { .type = VALUE_STRING, .string = (v) })
+#define BOOL(v) ((Value) { .type = VALUE_BOOL, .boolean = (v) })
+#define NOOP ((Value) { .type = VALUE_NOOP })
+#define UNDEFINED ((Value) { .type = VALUE_UNDEFINED })
+// what globals hold until their declaration runs
+#define UNDECLARED ((Value) { .type = VALUE_UNDEFINED, .integer = 1 })
+
+#define RT_STACK_SIZE (1 << 22)
+#define RT_FIRST_COLLECT (1024 * 1024)
+
+static Value* rt_stack;
+static Value* rt_top;
+static Value* rt_globals;
+static size_t rt_global_size;
+static Module* rt_modules;
+static size_t rt_module_size;
+static GCObject* rt_objects;
+static size_t rt_bytes, rt_next_collect = RT_FIRST_COLLECT;
+
+static Value rt_error(char* msg)
+{
+  printf("VM-> Error: %s\n", msg);
+  exit(1);
+  return NOOP;
+}
+
+static char* rt_value_name(ValueType type)
+{
+  static char* names[] = {
+    "VALUE_UNDEFINED", "VALUE_NOOP", "VALUE_INT", "VALUE_FLOAT", "VALUE_STRING", "VALUE_BOOL", "VALUE_OBJECT",
+  };
+  return names[type];
+}
+
+static void rt_mark_value(Value val);
+
+static void rt_mark(GCObject* object)
+{
+  if (object->marked) return;
+  object->marked = true;
+  if (object->is_object) {
+    Object* obj = (Object*)object;
+    for (size_t i = 0; i < obj->declaration->field_size; i++) {
+      rt_mark_value(obj->fields[i]);
+    }
+  }
+}
+
+static void rt_mark_value(Value val)
+{
+  if (val.type == VALUE_STRING && val.is_managed) {
+    rt_mark((GCObject*)val.string - 1);
+  } else if (val.type == VALUE_OBJECT) {
+    rt_mark(&val.object->gc);
+  }
+}
+
+static void rt_collect()
+{
+  for (size_t i = 0; i < rt_global_size; i++) {
+    rt_mark_value(rt_globals[i]);
+  }
+  for (Value* val = rt_stack; val < rt_top; val++) {
+    rt_mark_value(*val);
+  }
+  GCObject** link = &rt_objects;
+  while (*link) {
+    GCObject* object = *link;
+    if (object->marked) {
+      object->marked = false;
+      link = &object->next;
+      continue;
+    }
+    *link = object->next;
+    rt_bytes -= object->size;
+    free(object);
+  }
+  rt_next_collect = rt_bytes * 2 > RT_FIRST_COLLECT ? rt_bytes * 2 : RT_FIRST_COLLECT;
+}
+
+static void* rt_alloc(bool is_object, size_t size)
+{
+  if (rt_bytes + size > rt_next_collect) {
+    rt_collect();
+  }
+  GCObject* object = calloc(1, size);
+  object->next = rt_objects;
+  object->size = size;
+  object->is_object = is_object;
+  rt_objects = object;
+  rt_bytes += size;
+  return object;
+}
+
+static Value rt_new_string(char* src)
+{
+  size_t len = strlen(src);
+  GCObject* object = rt_alloc(false, sizeof(GCObject) + len + 1);
+  char* str = (char*)(object + 1);
+  memcpy(str, src, len + 1);
+  return (Value) { .type = VALUE_STRING, .is_managed = true, .string = str };
+}
+
+// registers past the args may still hold values the collector has freed
+static inline Value* rt_enter(Value* R, size_t arg_size, size_t reg_size)
+{
+  if (R + reg_size > rt_stack + RT_STACK_SIZE) {
+    rt_error("stack overflow");
+  }
+  memset(R + arg_size, 0, (reg_size - arg_size) * sizeof(Value));
+  Value* top = rt_top;
+  if (R + reg_size > rt_top) {
+    rt_top = R + reg_size;
+  }
+  return top;
+}
+
+// the interpreter traps on these, which the C compiler would otherwise be free to fold away
+static inline int rt_div(int l, int r)
+{
+  if (r == 0 || (r == -1 && l == INT_MIN)) raise(SIGFPE);
+  return l / r;
+}
+
+static inline int rt_mod(int l, int r)
+{
+  if (r == 0 || (r == -1 && l == INT_MIN)) raise(SIGFPE);
+  return l % r;
+}
+
+static Value rt_binary(Binary op, Value left, Value right)
+{
+  static char* names[] = {
+    "OP_ADD", "OP_SUB", "OP_MUL", "OP_DIV", "OP_MOD", "OP_EQ", "OP_NE", "OP_GT", "OP_GE", "OP_LT", "OP_LE", "OP_AND", "OP_OR",
+  };
+  if (left.type == VALUE_INT && right.type == VALUE_INT) {
+    int l = left.integer, r = right.integer;
+    switch (op) {
+      case BIN_ADD: return INT(l + r);
+      case BIN_SUB: return INT(l - r);
+      case BIN_MUL: return INT(l * r);
+      case BIN_DIV: return INT(rt_div(l, r));
+      case BIN_MOD: return INT(rt_mod(l, r));
+      case BIN_EQ: return BOOL(l == r);
+      case BIN_NE: return BOOL(l != r);
+      case BIN_GT: return BOOL(l > r);
+      case BIN_GE: return BOOL(l >= r);
+      case BIN_LT: return BOOL(l < r);
+      case BIN_LE: return BOOL(l <= r);
+      default: break;
+    }
+  } else if ((left.type == VALUE_INT || left.type == VALUE_FLOAT) &&
+             (right.type == VALUE_INT || right.type == VALUE_FLOAT)) {
+    float l = left.type == VALUE_FLOAT ? left.floating : (float)left.integer,
+          r = right.type == VALUE_FLOAT ? right.floating : (float)right.integer;
+    switch (op) {
+      case BIN_ADD: return FLOAT(l + r);
+      case BIN_SUB: return FLOAT(l - r);
+      case BIN_MUL: return FLOAT(l * r);
+      case BIN_DIV: return FLOAT(l / r);
+      case BIN_MOD: return rt_error("'%' operator cannot be applied to floating values");
+      case BIN_EQ: return BOOL(l == r);
+      case BIN_NE: return BOOL(l != r);
+      case BIN_GT: return BOOL(l > r);
+      case BIN_GE: return BOOL(l >= r);
+      case BIN_LT: return BOOL(l < r);
+      case BIN_LE: return BOOL(l <= r);
+      default: break;
+    }
+  } else if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
+    switch (op) {
+      case BIN_EQ: return BOOL(strcmp(left.string, right.string) == 0);
+      case BIN_NE: return BOOL(strcmp(left.string, right.string) != 0);
+      default: {
+        char msg[64]; sprintf(msg, "%s operator cannot be applied to string", names[op]);
+        return rt_error(msg);
+      }
+    }
+  } else if (left.type == VALUE_BOOL && right.type == VALUE_BOOL) {
+    switch (op) {
+      case BIN_AND: return BOOL(left.boolean && right.boolean);
+      case BIN_OR: return BOOL(left.boolean || right.boolean);
+      case BIN_EQ: return BOOL(left.boolean == right.boolean);
+      case BIN_NE: return BOOL(left.boolean != right.boolean);
+      default: {
+        char msg[64]; sprintf(msg, "%s operator cannot be applied to bool", names[op]);
+        return rt_error(msg);
+      }
+    }
+  }
+  char msg[128];
+  sprintf(msg, "unexpected types in %s: left: %s, right: %s", names[op], rt_value_name(left.type), rt_value_name(right.type));
+  return rt_error(msg);
+}
+
+static Value rt_neg(Value val)
+{
+  if (val.type == VALUE_INT) return INT(-val.integer);
+  if (val.type == VALUE_FLOAT) return FLOAT(-val.floating);
+  char msg[128]; sprintf(msg, "'-' unary operator cannot be applied to %s", rt_value_name(val.type));
+  return rt_error(msg);
+}
+
+static Value rt_not(Value val)
+{
+  if (val.type == VALUE_BOOL) return BOOL(!val.boolean);
+  char msg[128]; sprintf(msg, "'not' unary operator cannot be applied to %s", rt_value_name(val.type));
+  return rt_error(msg);
+}
+
+static void rt_undefined(char* name)
+{
+  char msg[96]; sprintf(msg, "use of value of undefined variable: '%s'", name);
+  rt_error(msg);
+}
+
+static inline bool rt_is_undeclared(Value val)
+{
+  return val.type == VALUE_UNDEFINED && val.integer;
+}
+
+static void rt_undefined_global(Value val, char* name)
+{
+  if (rt_is_undeclared(val)) {
+    char msg[96]; sprintf(msg, "use of undeclared variable: '%s'", name);
+    rt_error(msg);
+  }
+  rt_undefined(name);
+}
+
+static Value rt_type_error(char* name, char* type, Value val)
+{
+  char msg[128];
+  sprintf(msg, "variable '%s' type error: '%s', '%s'", name, type, rt_value_name(val.type));
+  return rt_error(msg);
+}
+
+static inline Value rt_conv_int(Value val, char* name)
+{
+  if (val.type == VALUE_INT) return val;
+  if (val.type == VALUE_FLOAT) return INT((int)val.floating);
+  return rt_type_error(name, "VAR_INT", val);
+}
+
+static inline Value rt_conv_float(Value val, char* name)
+{
+  if (val.type == VALUE_FLOAT) return val;
+  if (val.type == VALUE_INT) return FLOAT((float)val.integer);
+  return rt_type_error(name, "VAR_FLOAT", val);
+}
+
+static inline Value rt_check(Value val, ValueType type, char* type_name, char* name)
+{
+  if (val.type != type) rt_type_error(name, type_name, val);
+  return val;
+}
+
+static Value rt_check_object(Value val, Declaration* expected)
+{
+  if (val.type != VALUE_OBJECT || val.object->declaration != expected) {
+    char msg[128];
+    sprintf(msg, "expected object type: %s, got %s",
+            expected->name, val.type == VALUE_OBJECT ? val.object->declaration->name : rt_value_name(val.type));
+    rt_error(msg);
+  }
+  return val;
+}
+
+static inline bool rt_cond(Value cond, CondKind kind)
+{
+  if (cond.type != VALUE_BOOL) {
+    char msg[128];
+    switch (kind) {
+      case COND_IF: sprintf(msg, "if requires bool but got: '%s'", rt_value_name(cond.type)); break;
+      case COND_WHILE: sprintf(msg, "while requires bool but got: '%s'", rt_value_name(cond.type)); break;
+      case COND_FOR: sprintf(msg, "for condition body requires bool but got: '%s'", rt_value_name(cond.type)); break;
+    }
+    rt_error(msg);
+  }
+  return cond.boolean;
+}
+
+// type is -1 for return types no value can have
+static inline Value rt_return(Value val, char* function, bool has_return, int type, char* type_name)
+{
+  if (!has_return) {
+    if (val.type != VALUE_NOOP) {
+      char msg[128];
+      sprintf(msg, "'%s' function return error: expected no type, got: %s", function, rt_value_name(val.type));
+      rt_error(msg);
+    }
+  } else if (val.type != type) {
+    char msg[128];
+    sprintf(msg, "'%s' function return error: expected: %s, got: %s", function, type_name, rt_value_name(val.type));
+    rt_error(msg);
+  }
+  return val;
+}
+
+static Value rt_new_object(Declaration* declaration)
+{
+  // zeroed memory leaves every field VALUE_UNDEFINED until it is assigned
+  Object* object = rt_alloc(true, sizeof(Object) + declaration->field_size * sizeof(Value));
+  object->declaration = declaration;
+  return (Value) { .type = VALUE_OBJECT, .object = object };
+}
+
+static inline Value rt_get_field(Value val, int field, const char* name)
+{
+  Object* object = val.object;
+  if (object->fields[field].type == VALUE_UNDEFINED) {
+    char msg[128];
+    sprintf(msg, "member '%s' of object variable is not defined or does not have it: '%s'",
+            object->declaration->field_names[field], name);
+    rt_error(msg);
+  }
+  return object->fields[field];
+}
+
+static Value rt_builtin_error(char* msg)
+{
+  printf("Builtin-> Error: %s\n", msg);
+  exit(1);
+  return NOOP;
+}
+
+static Value rt_write(Value* args, size_t arg_size)
+{
+  for (size_t i = 0; i < arg_size; i++) {
+    Value arg = args[i];
+    switch (arg.type) {
+      case VALUE_STRING:
+        printf("%s ", arg.string);
+        break;
+      case VALUE_INT:
+        printf("%d ", arg.integer);
+        break;
+      case VALUE_FLOAT:
+        printf("%f ", arg.floating);
+        break;
+      case VALUE_BOOL:
+        printf("%s ", arg.boolean ? "true" : "false");
+        break;
+      default: {
+        char msg[64]; sprintf(msg, "unexpected %d indexed arg at function write: '%s'", (int)i, rt_value_name(arg.type));
+        return rt_builtin_error(msg);
+      }
+    }
+  }
+  printf("\n");
+  return NOOP;
+}
+
+static Value rt_read(Value* args, size_t arg_size)
+{
+  if (arg_size > 1) {
+    char msg[64]; sprintf(msg, "function read: at most 1 argument, got %lu", arg_size);
+    return rt_builtin_error(msg);
+  }
+  if (arg_size == 1) {
+    if (args[0].type != VALUE_STRING) {
+      char msg[64]; sprintf(msg, "unexpected %d indexed arg at function read: '%s'", 0, rt_value_name(args[0].type));
+      return rt_builtin_error(msg);
+    }
+    printf("%s", args[0].string);
+  }
+  char buffer[1024] = "";
+  fgets(buffer, sizeof(buffer), stdin);
+  if (buffer[0]) {
+    buffer[strlen(buffer) - 1] = '\0';
+  }
+  return rt_new_string(buffer);
+}
+
+static Value rt_quit(Value* args, size_t arg_size)
+{
+  if (arg_size != 1) {
+    char msg[64]; sprintf(msg, "function quit: expected 1 argument, got %lu", arg_size);
+    return rt_builtin_error(msg);
+  }
+  switch (args[0].type) {
+    case VALUE_INT:
+      exit(args[0].integer);
+    case VALUE_FLOAT:
+      exit(args[0].floating);
+    default: {
+      char msg[64]; sprintf(msg, "unexpected arg at function quit: '%s'", rt_value_name(args[0].type));
+      return rt_builtin_error(msg);
+    }
+  }
+}
+
+static Value rt_int(Value* args, size_t arg_size)
+{
+  if (arg_size != 1) {
+    char msg[64]; sprintf(msg, "function int: expected 1 argument, got %lu", arg_size);
+    return rt_builtin_error(msg);
+  }
+  Value arg = args[0];
+  switch (arg.type) {
+    case VALUE_STRING: return INT(atoi(arg.string));
+    case VALUE_INT: return arg;
+    case VALUE_FLOAT: return INT((int)arg.floating);
+    case VALUE_BOOL: return INT(arg.boolean);
+    default: {
+      char msg[64]; sprintf(msg, "unexpected arg at function int: '%s'", rt_value_name(arg.type));
+      return rt_builtin_error(msg);
+    }
+  }
+}
+
+static Value rt_float(Value* args, size_t arg_size)
+{
+  if (arg_size != 1) {
+    char msg[64]; sprintf(msg, "function float: expected 1 argument, got %lu", arg_size);
+    return rt_builtin_error(msg);
+  }
+  Value arg = args[0];
+  switch (arg.type) {
+    case VALUE_STRING: return FLOAT(atof(arg.string));
+    case VALUE_INT: return FLOAT((float)arg.integer);
+    case VALUE_FLOAT: return arg;
+    case VALUE_BOOL: return FLOAT(arg.boolean);
+    default: {
+      char msg[64]; sprintf(msg, "unexpected arg at function float: '%s'", rt_value_name(arg.type));
+      return rt_builtin_error(msg);
+    }
+  }
+}
+
+static Value rt_string(Value* args, size_t arg_size)
+{
+  if (arg_size != 1) {
+    char msg[64]; sprintf(msg, "function string: expected 1 argument, got %lu", arg_size);
+    return rt_builtin_error(msg);
+  }
+  Value arg = args[0];
+  switch (arg.type) {
+    case VALUE_STRING: return arg;
+    case VALUE_INT: return NOOP;
+    case VALUE_FLOAT: return NOOP;
+    case VALUE_BOOL: return STRING(arg.boolean ? "true" : "false");
+    default: {
+      char msg[64]; sprintf(msg, "unexpected arg at function string: '%s'", rt_value_name(arg.type));
+      return rt_builtin_error(msg);
+    }
+  }
+}
+
+static void rt_module_error()
+{
+#ifdef _WIN32
+  fprintf(stderr, "Module-> error: %lu\n", GetLastError());
+#else
+  fprintf(stderr, "Module-> error: %s\n", dlerror());
+#endif
+  exit(1);
+}
+
+static void rt_include(char* name, char* alias)
+{
+  for (size_t i = 0; i < rt_module_size; i++) {
+    if (strcmp(rt_modules[i].name, name) == 0) {
+      char msg[96]; sprintf(msg, "module '%s' has already been included", name);
+      rt_error(msg);
+    }
+  }
+  char path[256];
+#ifdef _WIN32
+  sprintf(path, "./%s.dll", name);
+  void* handle = LoadLibrary(path);
+#else
+  sprintf(path, "./%s.so", name);
+  void* handle = dlopen(path, RTLD_LAZY);
+#endif
+  if (!handle) {
+    rt_module_error();
+  }
+  rt_module_size++;
+  rt_modules = realloc(rt_modules, rt_module_size * sizeof(Module));
+  rt_modules[rt_module_size - 1] = (Module) { alias ? alias : name, handle };
+}
+
+// modules take and return AST nodes of the interpreter, only the tag and the payload are used
+static void* rt_to_ast(Value val)
+{
+  unsigned char* ast = calloc(1, RT_AST_SIZE);
+  switch (val.type) {
+    case VALUE_INT: ast[0] = RT_AST_INT; memcpy(ast + RT_AST_PAYLOAD, &val.integer, sizeof(int)); break;
+    case VALUE_FLOAT: ast[0] = RT_AST_FLOAT; memcpy(ast + RT_AST_PAYLOAD, &val.floating, sizeof(float)); break;
+    case VALUE_STRING: ast[0] = RT_AST_STRING; memcpy(ast + RT_AST_PAYLOAD, &val.string, sizeof(char*)); break;
+    case VALUE_BOOL: ast[0] = RT_AST_BOOL; memcpy(ast + RT_AST_PAYLOAD, &val.boolean, sizeof(bool)); break;
+    default: ast[0] = RT_AST_NOOP; break;
+  }
+  return ast;
+}
+
+static Value rt_from_ast(unsigned char* ast)
+{
+  Value val = NOOP;
+  switch (ast[0]) {
+    case RT_AST_INT: val.type = VALUE_INT; memcpy(&val.integer, ast + RT_AST_PAYLOAD, sizeof(int)); break;
+    case RT_AST_FLOAT: val.type = VALUE_FLOAT; memcpy(&val.floating, ast + RT_AST_PAYLOAD, sizeof(float)); break;
+    case RT_AST_STRING: val.type = VALUE_STRING; memcpy(&val.string, ast + RT_AST_PAYLOAD, sizeof(char*)); break;
+    case RT_AST_BOOL: val.type = VALUE_BOOL; memcpy(&val.boolean, ast + RT_AST_PAYLOAD, sizeof(bool)); break;
+  }
+  return val;
+}
+
+static Value rt_module_call(ModuleCall* call, Value* args, size_t arg_size)
+{
+  if (!call->function) {
+    Module* module = (void*)0;
+    for (size_t i = 0; i < rt_module_size; i++) {
+      if (strcmp(rt_modules[i].name, call->module_name) == 0) {
+        module = &rt_modules[i];
+      }
+    }
+    if (!module) {
+      char msg[128]; sprintf(msg, "undeclared module: '%s'", call->module_name);
+      return rt_error(msg);
+    }
+    char name[strlen(call->name) + 2];
+    sprintf(name, "_%s", call->name);
+#ifdef _WIN32
+    call->function = GetProcAddress(module->handle, name);
+    if (!call->function) {
+      fprintf(stderr, "%s function is not found in module: %s\n", call->name, module->name);
+    }
+#else
+    call->function = dlsym(module->handle, name);
+#endif
+    if (!call->function) {
+      rt_module_error();
+    }
+  }
+  void* ast_args[arg_size ? arg_size : 1];
+  for (size_t i = 0; i < arg_size; i++) {
+    ast_args[i] = rt_to_ast(args[i]);
+  }
+  Value ret = rt_from_ast(((void* (*)(void**, size_t))call->function)(ast_args, arg_size));
+  for (size_t i = 0; i < arg_size; i++) {
+    free(ast_args[i]);
+  }
+  return ret;
+}
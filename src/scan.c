@@ -0,0 +1,163 @@
+#include "inc/scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #define SCAN_X86
+#endif
+
+// first byte equal to a or b
+static size_t scan_until_scalar(char* src, size_t i, size_t size, char a, char b)
+{
+  while (i < size && src[i] != a && src[i] != b) i++;
+  return i;
+}
+
+// first byte not equal to c
+static size_t scan_skip_scalar(char* src, size_t i, size_t size, char c)
+{
+  while (i < size && src[i] == c) i++;
+  return i;
+}
+
+static int scan_is_ident(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// first byte that can not continue an identifier
+static size_t scan_ident_scalar(char* src, size_t i, size_t size)
+{
+  while (i < size && scan_is_ident(src[i])) i++;
+  return i;
+}
+
+#ifdef SCAN_X86
+
+// the vector loops stop 16 (or 32) bytes short of the end, the mapped source has no padding to read into
+
+__attribute__((target("sse2")))
+static size_t scan_until_sse2(char* src, size_t i, size_t size, char a, char b)
+{
+  __m128i va = _mm_set1_epi8(a);
+  __m128i vb = _mm_set1_epi8(b);
+  for (; i + 16 <= size; i += 16) {
+    __m128i v = _mm_loadu_si128((__m128i*)(src + i));
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+    if (mask) return i + __builtin_ctz(mask);
+  }
+  return scan_until_scalar(src, i, size, a, b);
+}
+
+__attribute__((target("sse2")))
+static size_t scan_skip_sse2(char* src, size_t i, size_t size, char c)
+{
+  __m128i vc = _mm_set1_epi8(c);
+  for (; i + 16 <= size; i += 16) {
+    __m128i v = _mm_loadu_si128((__m128i*)(src + i));
+    unsigned mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, vc)) & 0xffff;
+    if (mask) return i + __builtin_ctz(mask);
+  }
+  return scan_skip_scalar(src, i, size, c);
+}
+
+// signed compares, so bytes >= 0x80 are never part of an identifier
+__attribute__((target("sse2")))
+static __m128i scan_ident_mask_sse2(__m128i v)
+{
+  __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+  __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+  __m128i under = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+  return _mm_or_si128(_mm_or_si128(alpha, digit), under);
+}
+
+__attribute__((target("sse2")))
+static size_t scan_ident_sse2(char* src, size_t i, size_t size)
+{
+  for (; i + 16 <= size; i += 16) {
+    __m128i v = _mm_loadu_si128((__m128i*)(src + i));
+    unsigned mask = ~_mm_movemask_epi8(scan_ident_mask_sse2(v)) & 0xffff;
+    if (mask) return i + __builtin_ctz(mask);
+  }
+  return scan_ident_scalar(src, i, size);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_until_avx2(char* src, size_t i, size_t size, char a, char b)
+{
+  __m256i va = _mm256_set1_epi8(a);
+  __m256i vb = _mm256_set1_epi8(b);
+  for (; i + 32 <= size; i += 32) {
+    __m256i v = _mm256_loadu_si256((__m256i*)(src + i));
+    unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+    if (mask) return i + __builtin_ctz(mask);
+  }
+  return scan_until_sse2(src, i, size, a, b);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_skip_avx2(char* src, size_t i, size_t size, char c)
+{
+  __m256i vc = _mm256_set1_epi8(c);
+  for (; i + 32 <= size; i += 32) {
+    __m256i v = _mm256_loadu_si256((__m256i*)(src + i));
+    unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vc));
+    if (mask) return i + __builtin_ctz(mask);
+  }
+  return scan_skip_sse2(src, i, size, c);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_ident_avx2(char* src, size_t i, size_t size)
+{
+  for (; i + 32 <= size; i += 32) {
+    __m256i v = _mm256_loadu_si256((__m256i*)(src + i));
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    __m256i under = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), under));
+    if (mask) return i + __builtin_ctz(mask);
+  }
+  return scan_ident_sse2(src, i, size);
+}
+
+#endif
+
+size_t (*scan_until)(char* src, size_t i, size_t size, char a, char b) = scan_until_scalar;
+size_t (*scan_skip)(char* src, size_t i, size_t size, char c) = scan_skip_scalar;
+size_t (*scan_ident)(char* src, size_t i, size_t size) = scan_ident_scalar;
+
+ScanLevel scan_init(ScanLevel max)
+{
+  ScanLevel level = SCAN_SCALAR;
+#ifdef SCAN_X86
+  __builtin_cpu_init();
+  if (max >= SCAN_AVX2 && __builtin_cpu_supports("avx2")) {
+    level = SCAN_AVX2;
+  } else if (max >= SCAN_SSE2 && __builtin_cpu_supports("sse2")) {
+    level = SCAN_SSE2;
+  }
+#endif
+
+  switch (level) {
+#ifdef SCAN_X86
+    case SCAN_AVX2:
+      scan_until = scan_until_avx2;
+      scan_skip = scan_skip_avx2;
+      scan_ident = scan_ident_avx2;
+      break;
+    case SCAN_SSE2:
+      scan_until = scan_until_sse2;
+      scan_skip = scan_skip_sse2;
+      scan_ident = scan_ident_sse2;
+      break;
+#endif
+    default:
+      scan_until = scan_until_scalar;
+      scan_skip = scan_skip_scalar;
+      scan_ident = scan_ident_scalar;
+      break;
+  }
+  return level;
+}
@@ -1,5 +1,4 @@
 #include "inc/scope.h"
-#include <string.h>
 #include <stdio.h>
 
 Scope* init_scope()
@@ -32,7 +31,7 @@ bool scope_is_var_declared(Scope* scope, char* name)
 {
   for (int i = 0; i < scope->var_size; i++) {
     Var* var = scope->vars[i];
-    if (strcmp(var->name, name) == 0) {
+    if (var->name == name) {
       return true;
     }
   }
@@ -43,7 +42,7 @@ Var* scope_get_var(Scope* scope, char* name)
 {
   for (int i = 0; i < scope->var_size; i++) {
     Var* var = scope->vars[i];
-    if (strcmp(var->name, name) == 0) {
+    if (var->name == name) {
       return var;
     }
   }
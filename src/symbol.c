@@ -0,0 +1,76 @@
+#include "inc/symbol.h"
+#include "inc/arena.h"
+#include <string.h>
+
+#define SYMBOL_FIRST_CAP 256
+
+typedef struct {
+  char* name;
+  size_t len;
+  unsigned hash;
+} Symbol;
+
+static struct {
+  Symbol* entries;
+  size_t size;
+  size_t cap;
+  // symbols outlive the program's arena, runtime strings point at them
+  Arena* arena;
+} symbols;
+
+static unsigned symbol_hash(char* src, size_t len)
+{
+  // FNV-1a
+  unsigned hash = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)src[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static Symbol* symbol_find(Symbol* entries, size_t cap, char* src, size_t len, unsigned hash)
+{
+  size_t i = hash & (cap - 1);
+  while (entries[i].name) {
+    if (entries[i].hash == hash && entries[i].len == len && memcmp(entries[i].name, src, len) == 0) {
+      break;
+    }
+    i = (i + 1) & (cap - 1);
+  }
+  return &entries[i];
+}
+
+static void symbol_grow()
+{
+  size_t cap = symbols.cap ? symbols.cap * 2 : SYMBOL_FIRST_CAP;
+  Symbol* entries = calloc(cap, sizeof(Symbol));
+  for (int i = 0; i < symbols.cap; i++) {
+    Symbol* s = &symbols.entries[i];
+    if (s->name) {
+      *symbol_find(entries, cap, s->name, s->len, s->hash) = *s;
+    }
+  }
+  free(symbols.entries);
+  symbols.entries = entries;
+  symbols.cap = cap;
+}
+
+char* symbol_intern(char* src, size_t len)
+{
+  if ((symbols.size + 1) * 4 > symbols.cap * 3) {
+    symbol_grow();
+  }
+  unsigned hash = symbol_hash(src, len);
+  Symbol* entry = symbol_find(symbols.entries, symbols.cap, src, len, hash);
+  if (!entry->name) {
+    if (!symbols.arena) {
+      symbols.arena = init_arena();
+    }
+    entry->name = arena_strndup(symbols.arena, src, len);
+    entry->len = len;
+    entry->hash = hash;
+    symbols.size++;
+  }
+  return entry->name;
+}
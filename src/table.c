@@ -0,0 +1,61 @@
+#include "inc/table.h"
+
+Table* init_table()
+{
+  Table* table = calloc(1, sizeof(Table));
+
+  table->cap = 16;
+  table->size = 0;
+  table->entries = calloc(table->cap, sizeof(TableEntry));
+
+  return table;
+}
+
+static unsigned table_hash(char* key)
+{
+  // keys are interned, so the address identifies the name; the multiply
+  // spreads names from different arena chunks across the whole table
+  return (unsigned)(((unsigned long long)(size_t)key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static TableEntry* table_find(TableEntry* entries, size_t cap, char* key)
+{
+  size_t i = table_hash(key) & (cap - 1);
+  while (entries[i].key && entries[i].key != key) {
+    i = (i + 1) & (cap - 1);
+  }
+  return &entries[i];
+}
+
+static void table_grow(Table* table)
+{
+  size_t cap = table->cap * 2;
+  TableEntry* entries = calloc(cap, sizeof(TableEntry));
+  for (int i = 0; i < table->cap; i++) {
+    if (table->entries[i].key) {
+      *table_find(entries, cap, table->entries[i].key) = table->entries[i];
+    }
+  }
+  free(table->entries);
+  table->entries = entries;
+  table->cap = cap;
+}
+
+void table_set(Table* table, char* key, int val)
+{
+  if ((table->size + 1) * 4 > table->cap * 3) {
+    table_grow(table);
+  }
+  TableEntry* entry = table_find(table->entries, table->cap, key);
+  if (!entry->key) {
+    entry->key = key;
+    table->size++;
+  }
+  entry->val = val;
+}
+
+int table_get(Table* table, char* key)
+{
+  TableEntry* entry = table_find(table->entries, table->cap, key);
+  return entry->key ? entry->val : -1;
+}
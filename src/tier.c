@@ -0,0 +1,139 @@
+#include "inc/tier.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// reported by --tier-stats
+static Tier* tier_stats;
+
+static double tier_now(Tier* tier)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - tier->start.tv_sec) * 1e3 + (now.tv_nsec - tier->start.tv_nsec) / 1e6;
+}
+
+// builds queued units one at a time, the visitor keeps running meanwhile
+static void* tier_work(void* arg)
+{
+  Tier* tier = arg;
+  int top = tier->unit_size - 1;
+  pthread_mutex_lock(&tier->lock);
+  while (true) {
+    while (!tier->is_done && tier->queue_head == tier->queue_size) {
+      pthread_cond_wait(&tier->wake, &tier->lock);
+    }
+    if (tier->is_done) break;
+    int unit = tier->queue[tier->queue_head++];
+    pthread_mutex_unlock(&tier->lock);
+
+    if (unit == top) {
+      closure_build_top(tier->builder);
+    } else {
+      closure_build_function(tier->builder, unit);
+    }
+
+    pthread_mutex_lock(&tier->lock);
+    tier->units[unit].ready_at = tier_now(tier);
+  }
+  pthread_mutex_unlock(&tier->lock);
+  return (void*)0;
+}
+
+Tier* init_tier(Visitor* visitor, ClosureBuilder* builder)
+{
+  Tier* tier = calloc(1, sizeof(Tier));
+
+  tier->builder = builder;
+  tier->unit_size = builder->parser->function_size + 1;
+  tier->units = calloc(tier->unit_size, sizeof(TierUnit));
+  // every unit is queued at most once
+  tier->queue = calloc(tier->unit_size, sizeof(int));
+  tier->queue_head = 0;
+  tier->queue_size = 0;
+  tier->is_done = false;
+  pthread_mutex_init(&tier->lock, (void*)0);
+  pthread_cond_init(&tier->wake, (void*)0);
+  clock_gettime(CLOCK_MONOTONIC, &tier->start);
+
+  closure_attach(visitor);
+  visitor->tier = tier;
+  tier_stats = tier;
+  pthread_create(&tier->worker, (void*)0, tier_work, tier);
+
+  return tier;
+}
+
+static void tier_request(Tier* tier, int unit, unsigned count, unsigned line)
+{
+  pthread_mutex_lock(&tier->lock);
+  if (!tier->units[unit].is_queued) {
+    char name[96];
+    if (unit == tier->unit_size - 1) {
+      sprintf(name, "top level");
+    } else {
+      snprintf(name, sizeof(name), "function '%s'", tier->builder->functions[unit].declaration->function_declaration.name);
+    }
+    tier->units[unit].name = strdup(name);
+    tier->units[unit].is_queued = true;
+    tier->units[unit].count = count;
+    tier->units[unit].line = line;
+    tier->units[unit].queued_at = tier_now(tier);
+    tier->queue[tier->queue_size++] = unit;
+    pthread_cond_signal(&tier->wake);
+  }
+  pthread_mutex_unlock(&tier->lock);
+}
+
+Closure* tier_function(Tier* tier, int function)
+{
+  Closure* body = __atomic_load_n(&tier->builder->functions[function].body, __ATOMIC_ACQUIRE);
+  if (!body && ++tier->units[function].calls == TIER_CALL_THRESHOLD) {
+    tier_request(tier, function, TIER_CALL_THRESHOLD, 0);
+  }
+  return body;
+}
+
+Closure* tier_loop(Tier* tier, int function, AST* loop)
+{
+  LoopTier* loop_tier = loop->type == AST_WHILE ? &loop->while_block.tier : &loop->for_block.tier;
+  Closure* compiled = __atomic_load_n(&loop_tier->compiled, __ATOMIC_ACQUIRE);
+  if (!compiled && ++loop_tier->passes == TIER_LOOP_THRESHOLD) {
+    // the whole function is built, a loop alone would not know the types of its frame
+    tier_request(tier, function < 0 ? tier->unit_size - 1 : function, TIER_LOOP_THRESHOLD, loop->line);
+  }
+  return compiled;
+}
+
+void tier_finish(Tier* tier)
+{
+  pthread_mutex_lock(&tier->lock);
+  tier->is_done = true;
+  pthread_cond_signal(&tier->wake);
+  pthread_mutex_unlock(&tier->lock);
+  pthread_join(tier->worker, (void*)0);
+}
+
+void tier_print_stats()
+{
+  Tier* tier = tier_stats;
+  if (!tier) return;
+  pthread_mutex_lock(&tier->lock);
+  size_t ready = 0;
+  for (int i = 0; i < tier->queue_size; i++) {
+    TierUnit* u = &tier->units[tier->queue[i]];
+    if (u->line) {
+      printf("Tier-> %s: loop at line %u hot after %u passes at %.3f ms", u->name, u->line, u->count, u->queued_at);
+    } else {
+      printf("Tier-> %s: hot after %u calls at %.3f ms", u->name, u->count, u->queued_at);
+    }
+    if (u->ready_at > 0) {
+      ready++;
+      printf(", closures ready at %.3f ms (%.3f ms to build)\n", u->ready_at, u->ready_at - u->queued_at);
+    } else {
+      printf(", still building at exit\n");
+    }
+  }
+  printf("Tier-> %lu of %lu units promoted at %.3f ms\n", ready, tier->unit_size, tier_now(tier));
+  pthread_mutex_unlock(&tier->lock);
+}
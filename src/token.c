@@ -1,14 +1,8 @@
 #include "inc/token.h"
 
-Token* init_token(_TokenType type, char* value, unsigned line)
+Token init_token(_TokenType type, size_t offset, size_t length, unsigned line)
 {
-  Token* token = calloc(1, sizeof(Token));
-
-  token->type = type;
-  token->value = value;
-  token->line = line;
-
-  return token;
+  return (Token) { .type = type, .line = line, .offset = offset, .length = length };
 }
 
 char* token_name(_TokenType type)
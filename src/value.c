@@ -0,0 +1,127 @@
+#include "inc/value.h"
+#include "inc/gc.h"
+
+Value value_int(int val)
+{
+  return (Value) { .type = VALUE_INT, .integer = val };
+}
+
+Value value_float(float val)
+{
+  return (Value) { .type = VALUE_FLOAT, .floating = val };
+}
+
+Value value_string(char* val)
+{
+  return (Value) { .type = VALUE_STRING, .string = val };
+}
+
+Value value_bool(bool val)
+{
+  return (Value) { .type = VALUE_BOOL, .boolean = val };
+}
+
+Value value_object(Object* val)
+{
+  return (Value) { .type = VALUE_OBJECT, .object = val };
+}
+
+Value value_noop()
+{
+  return (Value) { .type = VALUE_NOOP };
+}
+
+Value value_undefined()
+{
+  return (Value) { .type = VALUE_UNDEFINED };
+}
+
+Value value_undeclared()
+{
+  return (Value) { .type = VALUE_UNDEFINED, .integer = 1 };
+}
+
+bool value_is_undeclared(Value val)
+{
+  return val.type == VALUE_UNDEFINED && val.integer;
+}
+
+Object* init_object(AST* declaration)
+{
+  // zeroed memory leaves every field VALUE_UNDEFINED until it is assigned
+  Object* object = gc_alloc(GC_OBJECT, sizeof(Object) + declaration->object_declaration.field_size * sizeof(Value));
+
+  object->declaration = declaration;
+
+  return object;
+}
+
+AST* value_to_ast(Value val)
+{
+  switch (val.type) {
+    case VALUE_INT: {
+      AST* ast = init_ast(AST_INT);
+      ast->integer.val = val.integer;
+      return ast;
+    }
+    case VALUE_FLOAT: {
+      AST* ast = init_ast(AST_FLOAT);
+      ast->floating.val = val.floating;
+      return ast;
+    }
+    case VALUE_STRING: {
+      AST* ast = init_ast(AST_STRING);
+      ast->string.val = val.string;
+      return ast;
+    }
+    case VALUE_BOOL: {
+      // not the shared nodes, those carry the checker's type
+      AST* ast = init_ast(AST_BOOL);
+      ast->boolean.val = val.boolean;
+      return ast;
+    }
+    default:
+      return get_ast_noop();
+  }
+}
+
+Value value_from_ast(AST* ast)
+{
+  switch (ast->type) {
+    case AST_INT: return value_int(ast->integer.val);
+    case AST_FLOAT: return value_float(ast->floating.val);
+    case AST_STRING: return value_string(ast->string.val);
+    case AST_BOOL: return value_bool(ast->boolean.val);
+    default: return value_noop();
+  }
+}
+
+// releases an argument built by value_to_ast once the module call is done
+void value_free_ast(AST* ast)
+{
+  switch (ast->type) {
+    case AST_INT:
+    case AST_FLOAT:
+    case AST_STRING:
+    case AST_BOOL:
+      free(ast);
+      break;
+    default:
+      // noop is shared
+      break;
+  }
+}
+
+char* value_name(ValueType type)
+{
+  switch (type) {
+    case VALUE_UNDEFINED: return "VALUE_UNDEFINED";
+    case VALUE_NOOP: return "VALUE_NOOP";
+    case VALUE_INT: return "VALUE_INT";
+    case VALUE_FLOAT: return "VALUE_FLOAT";
+    case VALUE_STRING: return "VALUE_STRING";
+    case VALUE_BOOL: return "VALUE_BOOL";
+    case VALUE_OBJECT: return "VALUE_OBJECT";
+  }
+  return (void*)0;
+}
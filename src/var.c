@@ -1,20 +1,12 @@
 #include "inc/var.h"
 
-Var* init_var(bool is_object, char* name, AST* val, VariableType type, bool is_defined)
+Var* init_var(char* name, Value val, VariableType type)
 {
   Var* var = calloc(1, sizeof(Var));
   
   var->name = name;
+  var->val = val;
   var->type = type;
-  var->is_defined = is_defined;
-  
-  if (!is_object) {
-    var->val = val;
-  } else {
-    var->object.declaration = val;
-    var->object.size = 0;
-    var->object.vars = (void*)0;
-  }
 
   return var;
 }
@@ -1,274 +1,226 @@
 #include "inc/visitor.h"
 #include "inc/ast.h"
 #include "inc/module.h"
+#include "inc/builtin.h"
+#include "inc/resolver.h"
+#include "inc/gc.h"
+#include "inc/tier.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-
-Visitor* init_visitor(Parser* parser)
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+
+// a binary node that loses its specialization this often stays generic
+#define VISITOR_MAX_DEOPTS 4
+
+static void visitor_mark_roots(void* ctx);
+
+// counts how binary nodes ran, reported by --quick-stats
+static struct {
+  size_t proven;
+  size_t hits;
+  size_t misses;
+  size_t generic;
+  size_t specialized;
+  size_t megamorphic;
+} quick_stats;
+
+Visitor* init_visitor(Parser* parser, size_t frame_size)
 {
   Visitor* visitor = calloc(1, sizeof(Visitor));
 
   visitor->global_scope = init_scope();
   visitor->global_scope->is_global = true;
+  visitor->signal = SIGNAL_NONE;
+  visitor->stack_cap = 256;
+  while (visitor->stack_cap < frame_size) {
+    visitor->stack_cap *= 2;
+  }
+  visitor->stack = calloc(visitor->stack_cap, sizeof(Var));
+  // the bottom frame holds the locals of top-level blocks
+  visitor->stack_size = frame_size;
+  visitor->frame = 0;
+  visitor->function = -1;
   visitor->function_declarations = parser->function_declarations;
   visitor->function_size = parser->function_size;
   visitor->modules = (void*)0;
   visitor->module_size = 0;
   visitor->object_declarations = parser->object_declarations;
   visitor->object_size = parser->object_size;
+  visitor->tier = (void*)0;
+  gc_set_roots(visitor_mark_roots, visitor);
 
   return visitor;
 }
 
-static AST* visitor_error(char* msg)
+static Value visitor_error(char* msg)
 {
   printf("Visitor-> Error: %s\n", msg);
   exit(1);
-  return get_ast_noop();
+  return value_noop();
 }
 
-static AST* builtin_write(Visitor* visitor, Scope* scope, AST** args, size_t arg_size)
+static void visitor_mark_roots(void* ctx)
 {
-  for (int i = 0; i < arg_size; i++) {
-    AST* arg = visitor_visit(visitor, scope, args[i]);
-
-    switch (arg->type) {
-      case AST_STRING:
-        printf("%s ", arg->string.val);
-        break;
-      case AST_INT:
-        printf("%d ", arg->integer.val);
-        break;
-      case AST_FLOAT:
-        printf("%f ", arg->floating.val);
-        break;
-      case AST_BOOL:
-        printf("%s ", arg->boolean.val ? "true" : "false");
-        break;
-      default: {
-        char msg[64]; sprintf(msg, "unexpected %d indexed arg at function write: '%s'", i, ast_name(arg->type));
-        return visitor_error(msg);
-      }
-    }
+  Visitor* visitor = ctx;
+  for (int i = 0; i < visitor->global_scope->var_size; i++) {
+    gc_mark_value(visitor->global_scope->vars[i]->val);
+  }
+  for (int i = 0; i < visitor->stack_size; i++) {
+    gc_mark_value(visitor->stack[i].val);
   }
-  printf("\n");
-
-  return get_ast_noop();
 }
 
-static AST* builtin_read(Visitor* visitor, Scope* scope, AST** args, size_t arg_size)
+static Var* visitor_reserve_stack(size_t max)
 {
-  if (arg_size > 1) {
-    char msg[64]; sprintf(msg, "function read: at most 1 argument, got %lu", arg_size);
-    return visitor_error(msg);
-  } else if (arg_size == 0) goto no_arg;
-
-  AST* arg = visitor_visit(visitor, scope, args[0]);
-  switch (arg->type) {
-    case AST_STRING:
-      printf("%s", arg->string.val);
-      break;
-    default: {
-      char msg[64]; sprintf(msg, "unexpected %d indexed arg at function read: '%s'", 0, ast_name(arg->type));
-      return visitor_error(msg);
-    }
+#ifdef _WIN32
+  return VirtualAlloc((void*)0, max * sizeof(Var), MEM_RESERVE, PAGE_NOACCESS);
+#else
+  // a limited address space is left at least half for the heap
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_AS, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && max > limit.rlim_cur / 2 / sizeof(Var)) {
+    return (void*)0;
   }
-
-  no_arg:
-
-  char buffer[1024];
-  fgets(buffer, sizeof(buffer), stdin);
-  buffer[strlen(buffer) - 1] = '\0';
-  AST* ast = init_ast(AST_STRING);
-  ast->string.val = calloc(strlen(buffer) + 1, sizeof(char));
-  strcpy(ast->string.val, buffer);
-  return ast;
+  Var* stack = mmap((void*)0, max * sizeof(Var), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return stack == MAP_FAILED ? (void*)0 : stack;
+#endif
 }
 
-static AST* builtin_quit(Visitor* visitor, Scope* scope, AST** args, size_t arg_size)
+// moves the stack into reserved address space, less of it when the system will not give that much
+void visitor_fix_stack(Visitor* visitor, size_t max)
 {
-  if (arg_size != 1) {
-    char msg[64]; sprintf(msg, "function quit: expected 1 argument, got %lu", arg_size);
-    return visitor_error(msg);
+  if (visitor->is_fixed) return;
+  Var* stack = visitor_reserve_stack(max);
+  while (!stack && max / 2 > visitor->stack_cap) {
+    max /= 2;
+    stack = visitor_reserve_stack(max);
   }
-  for (int i = 0; i < arg_size; i++) {
-    AST* arg = visitor_visit(visitor, scope, args[i]);
-    switch (arg->type) {
-      case AST_INT:
-        exit(arg->integer.val);
-        break;
-      case AST_FLOAT:
-        exit(arg->floating.val);
-      default: {
-        char msg[64]; sprintf(msg, "unexpected arg at function quit: '%s'", ast_name(arg->type));
-        return visitor_error(msg);
-      }
-    }
+  Var* old = visitor->stack;
+  size_t cap = visitor->stack_cap;
+  if (stack) {
+    visitor->stack = stack;
+    visitor->stack_cap = 0;
+    visitor->stack_max = max;
+    visitor_grow_fixed(visitor, cap);
+    memcpy(visitor->stack, old, visitor->stack_size * sizeof(Var));
+    free(old);
+  } else {
+    visitor->stack_max = cap;
   }
-
-  return get_ast_noop();
+  visitor->is_fixed = true;
 }
 
-static AST* builtin_int(Visitor* visitor, Scope* scope, AST** args, size_t arg_size)
+// commits more of the reserved stack, which stays where it is
+bool visitor_grow_fixed(Visitor* visitor, size_t cap)
 {
-  if (arg_size != 1) {
-    char msg[64]; sprintf(msg, "function int: expected 1 argument, got %lu", arg_size);
-    return visitor_error(msg);
+  if (cap <= visitor->stack_cap) return true;
+  if (cap > visitor->stack_max) return false;
+  size_t new_cap = visitor->stack_cap ? visitor->stack_cap : 256;
+  while (new_cap < cap) {
+    new_cap *= 2;
   }
-
-  AST* arg = visitor_visit(visitor, scope, args[0]);
-
-  switch (arg->type) {
-    case AST_STRING: {
-      AST* ret = init_ast(AST_INT);
-      ret->integer.val = atoi(arg->string.val);
-      return ret;
-    }
-    case AST_INT:
-      return arg;
-    case AST_FLOAT: {
-      AST* ret = init_ast(AST_INT);
-      ret->integer.val = (int)arg->floating.val;
-      return ret;
-    }
-    case AST_BOOL: {
-      AST* ret = init_ast(AST_INT);
-      ret->integer.val = arg->boolean.val;
-      return ret;
-    }
-    default: {
-      char msg[64]; sprintf(msg, "unexpected arg at function int: '%s'", ast_name(arg->type));
-      return visitor_error(msg);
-    }
+  if (new_cap > visitor->stack_max) {
+    new_cap = visitor->stack_max;
   }
+#ifdef _WIN32
+  if (!VirtualAlloc(visitor->stack, new_cap * sizeof(Var), MEM_COMMIT, PAGE_READWRITE)) return false;
+#else
+  if (mprotect(visitor->stack, new_cap * sizeof(Var), PROT_READ | PROT_WRITE) != 0) return false;
+#endif
+  visitor->stack_cap = new_cap;
+  return true;
 }
 
-static AST* builtin_float(Visitor* visitor, Scope* scope, AST** args, size_t arg_size)
+// pushes size cleared vars, for a call frame or for temporaries the collector must see
+static size_t visitor_reserve(Visitor* visitor, size_t size)
 {
-  if (arg_size != 1) {
-    char msg[64]; sprintf(msg, "function float: expected 1 argument, got %lu", arg_size);
-    return visitor_error(msg);
-  }
-
-  AST* arg = visitor_visit(visitor, scope, args[0]);
-
-  switch (arg->type) {
-    case AST_STRING: {
-      AST* ret = init_ast(AST_FLOAT);
-      ret->floating.val = atof(arg->string.val);
-      return ret;
-    }
-    case AST_INT: {
-      AST* ret = init_ast(AST_FLOAT);
-      ret->floating.val = (float)arg->integer.val;
-      return ret;
-    }
-    case AST_FLOAT:
-      return arg;
-    case AST_BOOL: {
-      AST* ret = init_ast(AST_FLOAT);
-      ret->floating.val = arg->boolean.val;
-      return ret;
+  size_t base = visitor->stack_size;
+  visitor->stack_size += size;
+  if (visitor->stack_size > visitor->stack_cap) {
+    if (visitor->is_fixed) {
+      if (!visitor_grow_fixed(visitor, visitor->stack_size)) {
+        char msg[64];
+        sprintf(msg, "stack overflow");
+        visitor_error(msg);
+      }
+      memset(visitor->stack + base, 0, size * sizeof(Var));
+      return base;
     }
-    default: {
-      char msg[64]; sprintf(msg, "unexpected arg at function float: '%s'", ast_name(arg->type));
-      return visitor_error(msg);
+    while (visitor->stack_size > visitor->stack_cap) {
+      visitor->stack_cap *= 2;
     }
+    visitor->stack = realloc(visitor->stack, visitor->stack_cap * sizeof(Var));
   }
+  memset(visitor->stack + base, 0, size * sizeof(Var));
+  return base;
 }
 
-static AST* builtin_string(Visitor* visitor, Scope* scope, AST** args, size_t arg_size)
+// a plain assignment of a value the checker proved to have the variable's
+// type needs neither conversion nor checking
+static bool visitor_is_exact(VariableType type, _TokenType op, AST* val)
 {
-  if (arg_size != 1) {
-    char msg[64]; sprintf(msg, "function string: expected 1 argument, got %lu", arg_size);
-    return visitor_error(msg);
-  }
-
-  AST* arg = visitor_visit(visitor, scope, args[0]);
-
-  switch (arg->type) {
-    case AST_STRING:
-      return arg;
-    case AST_INT:
-      return get_ast_noop();
-    case AST_FLOAT:
-      return get_ast_noop();
-    case AST_BOOL: {
-      AST* ret = init_ast(AST_STRING);
-      ret->string.val = arg->boolean.val ? "true" : "false";
-      return ret;
-    }
-    default: {
-      char msg[64]; sprintf(msg, "unexpected arg at function string: '%s'", ast_name(arg->type));
-      return visitor_error(msg);
-    }
+  if (op != TOKEN_ASSIGN) return false;
+  switch (type) {
+    case VAR_INT: return val->expr_type == TYPE_INT;
+    case VAR_FLOAT: return val->expr_type == TYPE_FLOAT;
+    case VAR_STRING: return val->expr_type == TYPE_STRING;
+    case VAR_BOOL: return val->expr_type == TYPE_BOOL;
+    default: return false;
   }
 }
 
-void visitor_check_types(bool is_declared, Var* var, _TokenType op, AST* var_val)
+void visitor_check_types(char* name, VariableType type, Value* dst, _TokenType op, Value val)
 {
-  if (!var->is_defined && op != TOKEN_ASSIGN) {
+  if (dst->type == VALUE_UNDEFINED && op != TOKEN_ASSIGN) {
     char msg[96];
-    sprintf(msg, "invalid '%s' operator for undefined '%s' variable", token_name(op), var->name);
+    sprintf(msg, "invalid '%s' operator for undefined '%s' variable", token_name(op), name);
     visitor_error(msg);
     return;
   }
-  if (var_val->type == AST_INT && var->type == VAR_INT) {
+  if (val.type == VALUE_INT && type == VAR_INT) {
     switch (op) {
-      case TOKEN_ASSIGN: {
-        if (is_declared || !var->is_defined) {
-          AST* ast = init_ast(AST_INT);
-          ast->integer.val = var_val->integer.val;
-          var->val = ast;
-          break;
-        } else {
-          var->val->integer.val = var_val->integer.val;
-          break;
-        }
-      }
+      case TOKEN_ASSIGN:
+        *dst = val;
+        break;
       case TOKEN_PLUSEQ:
-        var->val->integer.val += var_val->integer.val;
+        dst->integer += val.integer;
         break;
       case TOKEN_MINUSEQ:
-        var->val->integer.val -= var_val->integer.val;
+        dst->integer -= val.integer;
         break;
       case TOKEN_MULEQ:
-        var->val->integer.val *= var_val->integer.val;
+        dst->integer *= val.integer;
         break;
       case TOKEN_DIVEQ:
-        var->val->integer.val /= var_val->integer.val;
+        dst->integer /= val.integer;
         break;
       case TOKEN_MODEQ:
-        var->val->integer.val %= var_val->integer.val;
+        dst->integer %= val.integer;
         break;
       default:
         break;
     }
-  } else if (var_val->type == AST_FLOAT && var->type == VAR_FLOAT) {
+  } else if (val.type == VALUE_FLOAT && type == VAR_FLOAT) {
     switch (op) {
-      case TOKEN_ASSIGN: {
-        if (is_declared || !var->is_defined) {
-          AST* ast = init_ast(AST_FLOAT);
-          ast->floating.val = var_val->floating.val;
-          var->val = ast;
-          break;
-        } else {
-          var->val->floating.val = var_val->floating.val;
-          break;
-        }
-      }
+      case TOKEN_ASSIGN:
+        *dst = val;
+        break;
       case TOKEN_PLUSEQ:
-        var->val->floating.val += var_val->floating.val;
+        dst->floating += val.floating;
         break;
       case TOKEN_MINUSEQ:
-        var->val->floating.val -= var_val->floating.val;
+        dst->floating -= val.floating;
         break;
       case TOKEN_MULEQ:
-        var->val->floating.val *= var_val->floating.val;
+        dst->floating *= val.floating;
         break;
       case TOKEN_DIVEQ:
-        var->val->floating.val /= var_val->floating.val;
+        dst->floating /= val.floating;
         break;
       case TOKEN_MODEQ:
         char msg[64];
@@ -279,30 +231,22 @@ void visitor_check_types(bool is_declared, Var* var, _TokenType op, AST* var_val
         break;
     }
   }
-  else if (var_val->type == AST_INT && var->type == VAR_FLOAT) {
+  else if (val.type == VALUE_INT && type == VAR_FLOAT) {
     switch (op) {
-      case TOKEN_ASSIGN: {
-        if (is_declared || !var->is_defined) {
-          AST* ast = init_ast(AST_FLOAT);
-          ast->floating.val = (float)var_val->integer.val;
-          var->val = ast;
-          break;
-        } else {
-          var->val->floating.val = var_val->integer.val;
-          break;
-        }
-      }
+      case TOKEN_ASSIGN:
+        *dst = value_float((float)val.integer);
+        break;
       case TOKEN_PLUSEQ:
-        var->val->floating.val += var_val->integer.val;
+        dst->floating += val.integer;
         break;
       case TOKEN_MINUSEQ:
-        var->val->floating.val -= var_val->integer.val;
+        dst->floating -= val.integer;
         break;
       case TOKEN_MULEQ:
-        var->val->floating.val *= var_val->integer.val;
+        dst->floating *= val.integer;
         break;
       case TOKEN_DIVEQ:
-        var->val->floating.val /= var_val->integer.val;
+        dst->floating /= val.integer;
         break;
       case TOKEN_MODEQ:
         char msg[64];
@@ -312,30 +256,22 @@ void visitor_check_types(bool is_declared, Var* var, _TokenType op, AST* var_val
       default:
         break;
     }
-  } else if (var_val->type == AST_FLOAT && var->type == VAR_INT) {
+  } else if (val.type == VALUE_FLOAT && type == VAR_INT) {
     switch (op) {
-      case TOKEN_ASSIGN: {
-        if (is_declared || !var->is_defined) {
-          AST* ast = init_ast(AST_INT);
-          ast->integer.val = (int)var_val->floating.val;
-          var->val = ast;
-          break;
-        } else {
-          var->val->integer.val = var_val->floating.val;
-          break;
-        }
-      }
+      case TOKEN_ASSIGN:
+        *dst = value_int((int)val.floating);
+        break;
       case TOKEN_PLUSEQ:
-        var->val->integer.val += var_val->floating.val;
+        dst->integer += val.floating;
         break;
       case TOKEN_MINUSEQ:
-        var->val->integer.val -= var_val->floating.val;
+        dst->integer -= val.floating;
         break;
       case TOKEN_MULEQ:
-        var->val->integer.val *= var_val->floating.val;
+        dst->integer *= val.floating;
         break;
       case TOKEN_DIVEQ:
-        var->val->integer.val /= var_val->floating.val;
+        dst->integer /= val.floating;
         break;
       case TOKEN_MODEQ:
         char msg[64];
@@ -345,249 +281,356 @@ void visitor_check_types(bool is_declared, Var* var, _TokenType op, AST* var_val
       default:
         break;
     }
-  } else if (var_val->type == AST_STRING && var->type == VAR_STRING) {
+  } else if (val.type == VALUE_STRING && type == VAR_STRING) {
     if (op != TOKEN_ASSIGN) {
       char msg[64];
       sprintf(msg, "strings can only get = operator");
       visitor_error(msg);
       return;
     }
-    if (is_declared || !var->is_defined) {
-      AST* ast = init_ast(AST_STRING);
-      ast->string.val = var_val->string.val;
-      var->val = ast;
-    } else {
-      var->val->string.val = var_val->string.val;
-    }
-  } else if (var_val->type == AST_BOOL && var->type == VAR_BOOL) {
+    *dst = val;
+  } else if (val.type == VALUE_BOOL && type == VAR_BOOL) {
     if (op != TOKEN_ASSIGN) {
       char msg[64];
       sprintf(msg, "bools can only get = operator");
       visitor_error(msg);
       return;
     }
-    if (is_declared || !var->is_defined) {
-      AST* ast = init_ast(AST_BOOL);
-      ast->boolean.val = var_val->boolean.val;
-      var->val = ast;
-    } else {
-      var->val->boolean.val = var_val->boolean.val;
-    }
+    *dst = val;
   } else {
     char msg[64];
-    sprintf(msg, "variable '%s' type error: '%s', '%s'", var->name, var_type_name(var->type), ast_name(var_val->type));
+    sprintf(msg, "variable '%s' type error: '%s', '%s'", name, var_type_name(type), value_name(val.type));
     visitor_error(msg);
   }
-
-  var->is_defined = true;
 }
 
-AST* visitor_visit(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit(Visitor* visitor, AST* node)
 {
   switch (node->type) {
-    case AST_TYPE_NOOP: return get_ast_noop();
-    case AST_COMPOUND: return visitor_visit_compound(visitor, scope, node);
-    case AST_INT: return visitor_visit_int(visitor, scope, node);
-    case AST_FLOAT: return visitor_visit_float(visitor, scope, node);
-    case AST_STRING: return visitor_visit_string(visitor, scope, node);
-    case AST_BINARY: return visitor_visit_binary(visitor, scope, node);
-//    case AST_FUNCTION_DECLARATION: return visitor_visit_function(visitor, scope, node);
-    case AST_FUNCTION_CALL: return visitor_visit_function_call(visitor, scope, node);
-    case AST_VARIABLE_DECLARATION: return visitor_visit_variable_declaration(visitor, scope, node);
-    case AST_VARIABLE: return visitor_visit_variable(visitor, scope, node);
-    case AST_VARIABLE_ASSIGN: return visitor_visit_variable_assign(visitor, scope, node);
-    case AST_BOOL: return visitor_visit_bool(visitor, scope, node);
-    case AST_IF: return visitor_visit_if(visitor, scope, node);
-    case AST_ELSE: return visitor_visit_else(visitor, scope, node);
-    case AST_WHILE: return visitor_visit_while(visitor, scope, node);
-    case AST_FOR: return visitor_visit_for(visitor, scope, node);
-    case AST_RETURN: return visitor_visit_return(visitor, scope, node);
-    case AST_RETURN_VAL: return visitor_visit_return_val(visitor, scope, node);
-    case AST_UNARY: return visitor_visit_unary(visitor, scope, node);
-    case AST_SKIP: return visitor_visit_skip(visitor, scope, node);
-    case AST_STOP: return visitor_visit_stop(visitor, scope, node);
-    case AST_INCLUDE: return visitor_visit_include(visitor, scope, node);
-    case AST_MODULE_FUNCTION_CALL: return visitor_visit_module_function_call(visitor, scope, node);
-    case AST_MEMBER_ACCESS: return visitor_visit_member_access(visitor, scope, node);
-    case AST_MEMBER_ASSIGN: return visitor_visit_member_assign(visitor, scope, node);
+    case AST_TYPE_NOOP: return value_noop();
+    case AST_COMPOUND: return visitor_visit_compound(visitor, node);
+    case AST_INT: return visitor_visit_int(visitor, node);
+    case AST_FLOAT: return visitor_visit_float(visitor, node);
+    case AST_STRING: return visitor_visit_string(visitor, node);
+    case AST_BINARY: return visitor_visit_binary(visitor, node);
+//    case AST_FUNCTION_DECLARATION: return visitor_visit_function(visitor, node);
+    case AST_FUNCTION_CALL: return visitor_visit_function_call(visitor, node);
+    case AST_VARIABLE_DECLARATION: return visitor_visit_variable_declaration(visitor, node);
+    case AST_VARIABLE: return visitor_visit_variable(visitor, node);
+    case AST_VARIABLE_ASSIGN: return visitor_visit_variable_assign(visitor, node);
+    case AST_BOOL: return visitor_visit_bool(visitor, node);
+    case AST_IF: return visitor_visit_if(visitor, node);
+    case AST_ELSE: return visitor_visit_else(visitor, node);
+    case AST_WHILE: return visitor_visit_while(visitor, node);
+    case AST_FOR: return visitor_visit_for(visitor, node);
+    case AST_RETURN: return visitor_visit_return(visitor, node);
+    case AST_UNARY: return visitor_visit_unary(visitor, node);
+    case AST_SKIP: return visitor_visit_skip(visitor, node);
+    case AST_STOP: return visitor_visit_stop(visitor, node);
+    case AST_INCLUDE: return visitor_visit_include(visitor, node);
+    case AST_MODULE_FUNCTION_CALL: return visitor_visit_module_function_call(visitor, node);
+    case AST_MEMBER_ACCESS: return visitor_visit_member_access(visitor, node);
+    case AST_MEMBER_ASSIGN: return visitor_visit_member_assign(visitor, node);
+    default: return value_noop();
   }
 }
 
-AST* visitor_visit_compound(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_compound(Visitor* visitor, AST* node)
 {
   for (int i = 0; i < node->compound.statement_size; i++) {
     AST* statement = node->compound.statements[i];
-    AST* visited = visitor_visit(visitor, scope, statement);
-    switch (visited->type) {
-      case AST_RETURN_VAL:
-      case AST_SKIP:
-      case AST_STOP:
-        return visited;
-      default:
-        break;
+    Value visited = visitor_visit(visitor, statement);
+    if (visitor->signal != SIGNAL_NONE) {
+      return visited;
     }
   }
-  return get_ast_noop();
+  return value_noop();
 }
 
-AST* visitor_visit_int(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_int(Visitor* visitor, AST* node)
 {
-  return node;
+  return value_int(node->integer.val);
 }
 
-AST* visitor_visit_float(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_float(Visitor* visitor, AST* node)
 {
-  return node;
+  return value_float(node->floating.val);
 }
 
-AST* visitor_visit_string(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_string(Visitor* visitor, AST* node)
 {
-  return node;
+  return value_string(node->string.val);
 }
 
-AST* visitor_visit_bool(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_bool(Visitor* visitor, AST* node)
 {
-  return node;
+  return value_bool(node->boolean.val);
 }
 
-AST* visitor_visit_binary(Visitor* visitor, Scope* scope, AST* node)
+static Value visitor_binary_int(_TokenType op, int left, int right)
 {
-  AST* ast = init_ast(AST_FLOAT);
-
-  AST* bin_left = visitor_visit(visitor, scope, node->binary.left);
-  AST* bin_right = visitor_visit(visitor, scope, node->binary.right);
+  switch (op) {
+    case TOKEN_PLUS:
+      return value_int(left + right);
+    case TOKEN_MINUS:
+      return value_int(left - right);
+    case TOKEN_MUL:
+      return value_int(left * right);
+    case TOKEN_DIV:
+      return value_int(left / right);
+    case TOKEN_MOD:
+      return value_int(left % right);
+    case TOKEN_EQ:
+      return value_bool(left == right);
+    case TOKEN_NE:
+      return value_bool(left != right);
+    case TOKEN_GT:
+      return value_bool(left > right);
+    case TOKEN_GE:
+      return value_bool(left >= right);
+    case TOKEN_LT:
+      return value_bool(left < right);
+    case TOKEN_LE:
+      return value_bool(left <= right);
+    default:
+      return value_noop();
+  }
+}
 
-  if (bin_left->type == AST_INT && bin_right->type == AST_INT) { 
-    ast->type = AST_INT;
-    int left = bin_left->integer.val, right = bin_right->integer.val;
+// also used once an int operand has been promoted
+static Value visitor_binary_float(_TokenType op, float left, float right)
+{
+  switch (op) {
+    case TOKEN_PLUS:
+      return value_float(left + right);
+    case TOKEN_MINUS:
+      return value_float(left - right);
+    case TOKEN_MUL:
+      return value_float(left * right);
+    case TOKEN_DIV:
+      return value_float(left / right);
+    case TOKEN_MOD: {
+      char msg[64];
+      sprintf(msg, "'%%' operator cannot be applied to floating values");
+      return visitor_error(msg);
+    }
+    case TOKEN_EQ:
+      return value_bool(left == right);
+    case TOKEN_NE:
+      return value_bool(left != right);
+    case TOKEN_GT:
+      return value_bool(left > right);
+    case TOKEN_GE:
+      return value_bool(left >= right);
+    case TOKEN_LT:
+      return value_bool(left < right);
+    case TOKEN_LE:
+      return value_bool(left <= right);
+    default:
+      return value_noop();
+  }
+}
 
-    switch (node->binary.op) {
-      case TOKEN_PLUS:
-        ast->integer.val = left + right;
-        break;
-      case TOKEN_MINUS:
-        ast->integer.val = left - right;
-        break;
-      case TOKEN_MUL:
-        ast->integer.val = left * right;
-        break;
-      case TOKEN_DIV:
-        ast->integer.val = left / right;
-        break;
-      case TOKEN_MOD:
-        ast->integer.val = left % right;
-        break;
-      case TOKEN_EQ:
-        return left == right ? get_ast_true() : get_ast_false();
-      case TOKEN_NE:
-        return left != right ? get_ast_true() : get_ast_false();
-      case TOKEN_GT:
-        return left > right ? get_ast_true() : get_ast_false();
-      case TOKEN_GE:
-        return left >= right ? get_ast_true() : get_ast_false();
-      case TOKEN_LT:
-        return left < right ? get_ast_true() : get_ast_false();
-      case TOKEN_LE:
-        return left <= right ? get_ast_true() : get_ast_false();
-      default:
-        return get_ast_noop();
+// picks the specialized form for the operand tags just seen, QUICK_NONE when there is none
+static QuickBinary visitor_quick_kind(_TokenType op, Value left, Value right)
+{
+  if (left.type == VALUE_INT && right.type == VALUE_INT) {
+    switch (op) {
+      case TOKEN_PLUS: return QUICK_INT_ADD;
+      case TOKEN_MINUS: return QUICK_INT_SUB;
+      case TOKEN_MUL: return QUICK_INT_MUL;
+      case TOKEN_DIV: return QUICK_INT_DIV;
+      case TOKEN_MOD: return QUICK_INT_MOD;
+      case TOKEN_EQ: return QUICK_INT_EQ;
+      case TOKEN_NE: return QUICK_INT_NE;
+      case TOKEN_GT: return QUICK_INT_GT;
+      case TOKEN_GE: return QUICK_INT_GE;
+      case TOKEN_LT: return QUICK_INT_LT;
+      case TOKEN_LE: return QUICK_INT_LE;
+      default: return QUICK_NONE;
     }
-  } else if (bin_left->type == AST_FLOAT && bin_right->type == AST_FLOAT) { 
-    float left = bin_left->floating.val, right = bin_right->floating.val;
+  } else if (left.type == VALUE_FLOAT && right.type == VALUE_FLOAT) {
+    switch (op) {
+      case TOKEN_PLUS: return QUICK_FLOAT_ADD;
+      case TOKEN_MINUS: return QUICK_FLOAT_SUB;
+      case TOKEN_MUL: return QUICK_FLOAT_MUL;
+      case TOKEN_DIV: return QUICK_FLOAT_DIV;
+      case TOKEN_EQ: return QUICK_FLOAT_EQ;
+      case TOKEN_NE: return QUICK_FLOAT_NE;
+      case TOKEN_GT: return QUICK_FLOAT_GT;
+      case TOKEN_GE: return QUICK_FLOAT_GE;
+      case TOKEN_LT: return QUICK_FLOAT_LT;
+      case TOKEN_LE: return QUICK_FLOAT_LE;
+      default: return QUICK_NONE;
+    }
+  } else if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
+    switch (op) {
+      case TOKEN_EQ: return QUICK_STRING_EQ;
+      case TOKEN_NE: return QUICK_STRING_NE;
+      default: return QUICK_NONE;
+    }
+  } else if (left.type == VALUE_BOOL && right.type == VALUE_BOOL) {
+    switch (op) {
+      case TOKEN_AND: return QUICK_BOOL_AND;
+      case TOKEN_OR: return QUICK_BOOL_OR;
+      case TOKEN_EQ: return QUICK_BOOL_EQ;
+      case TOKEN_NE: return QUICK_BOOL_NE;
+      default: return QUICK_NONE;
+    }
+  }
+  return QUICK_NONE;
+}
 
-    switch (node->binary.op) {
-      case TOKEN_PLUS:
-        ast->floating.val = left + right;
-        break;
-      case TOKEN_MINUS:
-        ast->floating.val = left - right;
-        break;
-      case TOKEN_MUL:
-        ast->floating.val = left * right;
-        break;
-      case TOKEN_DIV:
-        ast->floating.val = left / right;
-        break;
-      case TOKEN_MOD: {
-        char msg[64];
-        sprintf(msg, "'%%' operator cannot be applied to floating values");
-        return visitor_error(msg);
-      }
-      case TOKEN_EQ:
-        return left == right ? get_ast_true() : get_ast_false();
-      case TOKEN_NE:
-        return left != right ? get_ast_true() : get_ast_false();
-      case TOKEN_GT:
-        return left > right ? get_ast_true() : get_ast_false();
-      case TOKEN_GE:
-        return left >= right ? get_ast_true() : get_ast_false();
-      case TOKEN_LT:
-        return left < right ? get_ast_true() : get_ast_false();
-      case TOKEN_LE:
-        return left <= right ? get_ast_true() : get_ast_false();
-      default:
-        return get_ast_noop();
+#define VISITOR_QUICK(kind, tag, make) \
+  case kind: \
+    if (left.type != tag || right.type != tag) return false; \
+    *result = make; \
+    return true;
+
+// runs a specialized node, false when the guard sees other tags than it was specialized for
+static bool visitor_quick(QuickBinary quick, Value left, Value right, Value* result)
+{
+  switch (quick) {
+    VISITOR_QUICK(QUICK_INT_ADD, VALUE_INT, value_int(left.integer + right.integer))
+    VISITOR_QUICK(QUICK_INT_SUB, VALUE_INT, value_int(left.integer - right.integer))
+    VISITOR_QUICK(QUICK_INT_MUL, VALUE_INT, value_int(left.integer * right.integer))
+    VISITOR_QUICK(QUICK_INT_DIV, VALUE_INT, value_int(left.integer / right.integer))
+    VISITOR_QUICK(QUICK_INT_MOD, VALUE_INT, value_int(left.integer % right.integer))
+    VISITOR_QUICK(QUICK_INT_EQ, VALUE_INT, value_bool(left.integer == right.integer))
+    VISITOR_QUICK(QUICK_INT_NE, VALUE_INT, value_bool(left.integer != right.integer))
+    VISITOR_QUICK(QUICK_INT_GT, VALUE_INT, value_bool(left.integer > right.integer))
+    VISITOR_QUICK(QUICK_INT_GE, VALUE_INT, value_bool(left.integer >= right.integer))
+    VISITOR_QUICK(QUICK_INT_LT, VALUE_INT, value_bool(left.integer < right.integer))
+    VISITOR_QUICK(QUICK_INT_LE, VALUE_INT, value_bool(left.integer <= right.integer))
+    VISITOR_QUICK(QUICK_FLOAT_ADD, VALUE_FLOAT, value_float(left.floating + right.floating))
+    VISITOR_QUICK(QUICK_FLOAT_SUB, VALUE_FLOAT, value_float(left.floating - right.floating))
+    VISITOR_QUICK(QUICK_FLOAT_MUL, VALUE_FLOAT, value_float(left.floating * right.floating))
+    VISITOR_QUICK(QUICK_FLOAT_DIV, VALUE_FLOAT, value_float(left.floating / right.floating))
+    VISITOR_QUICK(QUICK_FLOAT_EQ, VALUE_FLOAT, value_bool(left.floating == right.floating))
+    VISITOR_QUICK(QUICK_FLOAT_NE, VALUE_FLOAT, value_bool(left.floating != right.floating))
+    VISITOR_QUICK(QUICK_FLOAT_GT, VALUE_FLOAT, value_bool(left.floating > right.floating))
+    VISITOR_QUICK(QUICK_FLOAT_GE, VALUE_FLOAT, value_bool(left.floating >= right.floating))
+    VISITOR_QUICK(QUICK_FLOAT_LT, VALUE_FLOAT, value_bool(left.floating < right.floating))
+    VISITOR_QUICK(QUICK_FLOAT_LE, VALUE_FLOAT, value_bool(left.floating <= right.floating))
+    VISITOR_QUICK(QUICK_STRING_EQ, VALUE_STRING, value_bool(strcmp(left.string, right.string) == 0))
+    VISITOR_QUICK(QUICK_STRING_NE, VALUE_STRING, value_bool(strcmp(left.string, right.string) != 0))
+    VISITOR_QUICK(QUICK_BOOL_AND, VALUE_BOOL, value_bool(left.boolean && right.boolean))
+    VISITOR_QUICK(QUICK_BOOL_OR, VALUE_BOOL, value_bool(left.boolean || right.boolean))
+    VISITOR_QUICK(QUICK_BOOL_EQ, VALUE_BOOL, value_bool(left.boolean == right.boolean))
+    VISITOR_QUICK(QUICK_BOOL_NE, VALUE_BOOL, value_bool(left.boolean != right.boolean))
+    default:
+      return false;
+  }
+}
+
+void visitor_print_quick_stats()
+{
+  // a guard miss runs the generic path too, so it is already in generic
+  size_t runs = quick_stats.hits + quick_stats.generic;
+  printf("Visitor-> binary: %lu proven by the checker, %lu checked at runtime\n", quick_stats.proven, runs);
+  printf("Visitor-> quickened: %lu hits (%.1f%%), %lu guard misses, %lu generic\n", quick_stats.hits,
+         runs ? 100.0 * quick_stats.hits / runs : 0.0, quick_stats.misses, quick_stats.generic);
+  printf("Visitor-> nodes: %lu specialized, %lu de-specialized, %lu left generic\n",
+         quick_stats.specialized, quick_stats.misses, quick_stats.megamorphic);
+}
+
+Value visitor_visit_binary(Visitor* visitor, AST* node)
+{
+  // the checker proved both operand types, numbers need no collector rooting
+  switch (node->binary.operands) {
+    case OPERANDS_INT: {
+      quick_stats.proven++;
+      int left = visitor_visit(visitor, node->binary.left).integer;
+      return visitor_binary_int(node->binary.op, left, visitor_visit(visitor, node->binary.right).integer);
+    }
+    case OPERANDS_FLOAT: {
+      quick_stats.proven++;
+      float left = visitor_visit(visitor, node->binary.left).floating;
+      return visitor_binary_float(node->binary.op, left, visitor_visit(visitor, node->binary.right).floating);
+    }
+    case OPERANDS_INT_FLOAT: {
+      quick_stats.proven++;
+      float left = visitor_visit(visitor, node->binary.left).integer;
+      return visitor_binary_float(node->binary.op, left, visitor_visit(visitor, node->binary.right).floating);
     }
-  } else if ((bin_left->type == AST_INT || bin_left->type == AST_FLOAT) &&
-              bin_right->type == AST_INT || bin_right->type == AST_FLOAT) {
-    float left = bin_left->type == AST_FLOAT ? bin_left->floating.val : (float)bin_left->integer.val,
-          right = bin_right->type == AST_FLOAT ? bin_right->floating.val : (float)bin_right->integer.val;
+    case OPERANDS_FLOAT_INT: {
+      quick_stats.proven++;
+      float left = visitor_visit(visitor, node->binary.left).floating;
+      return visitor_binary_float(node->binary.op, left, visitor_visit(visitor, node->binary.right).integer);
+    }
+    default:
+      break;
+  }
 
-    switch (node->binary.op) {
-      case TOKEN_PLUS:
-        ast->floating.val = left + right;
-        break;
-      case TOKEN_MINUS:
-        ast->floating.val = left - right;
-        break;
-      case TOKEN_MUL:
-        ast->floating.val = left * right;
-        break;
-      case TOKEN_DIV:
-        ast->floating.val = left / right;
-        break;
-      case TOKEN_MOD: {
-        char msg[64];
-        sprintf(msg, "'%%' operator cannot be applied to floating values");
-        return visitor_error(msg);
-      }
-      case TOKEN_EQ:
-        return left == right ? get_ast_true() : get_ast_false();
-      case TOKEN_NE:
-        return left != right ? get_ast_true() : get_ast_false();
-      case TOKEN_GT:
-        return left > right ? get_ast_true() : get_ast_false();
-      case TOKEN_GE:
-        return left >= right ? get_ast_true() : get_ast_false();
-      case TOKEN_LT:
-        return left < right ? get_ast_true() : get_ast_false();
-      case TOKEN_LE:
-        return left <= right ? get_ast_true() : get_ast_false();
-      default:
-        return get_ast_noop();
+  Value bin_left = visitor_visit(visitor, node->binary.left);
+  // and/or leave the right side alone once a bool on the left decides
+  if (bin_left.type == VALUE_BOOL &&
+      ((node->binary.op == TOKEN_AND && !bin_left.boolean) || (node->binary.op == TOKEN_OR && bin_left.boolean))) {
+    return bin_left;
+  }
+  Value bin_right;
+  if (bin_left.is_managed) {
+    // keep the left string alive while the right side runs
+    size_t base = visitor_reserve(visitor, 1);
+    visitor->stack[base].val = bin_left;
+    bin_right = visitor_visit(visitor, node->binary.right);
+    visitor->stack_size = base;
+  } else {
+    bin_right = visitor_visit(visitor, node->binary.right);
+  }
+
+  if (node->binary.quick > QUICK_GENERIC) {
+    Value result;
+    if (visitor_quick(node->binary.quick, bin_left, bin_right, &result)) {
+      quick_stats.hits++;
+      return result;
     }
-  } else if (bin_left->type == AST_STRING && bin_right->type == AST_STRING) {
+    // the operand types changed, go generic and let the node specialize again
+    quick_stats.misses++;
+    if (++node->binary.deopts < VISITOR_MAX_DEOPTS) {
+      node->binary.quick = QUICK_NONE;
+    } else {
+      node->binary.quick = QUICK_GENERIC;
+      quick_stats.megamorphic++;
+    }
+  }
+  if (node->binary.quick == QUICK_NONE) {
+    node->binary.quick = visitor_quick_kind(node->binary.op, bin_left, bin_right);
+    if (node->binary.quick != QUICK_NONE) {
+      quick_stats.specialized++;
+    }
+  }
+  quick_stats.generic++;
+
+  if (bin_left.type == VALUE_INT && bin_right.type == VALUE_INT) { 
+    return visitor_binary_int(node->binary.op, bin_left.integer, bin_right.integer);
+  } else if ((bin_left.type == VALUE_INT || bin_left.type == VALUE_FLOAT) &&
+             (bin_right.type == VALUE_INT || bin_right.type == VALUE_FLOAT)) {
+    float left = bin_left.type == VALUE_FLOAT ? bin_left.floating : (float)bin_left.integer,
+          right = bin_right.type == VALUE_FLOAT ? bin_right.floating : (float)bin_right.integer;
+    return visitor_binary_float(node->binary.op, left, right);
+  } else if (bin_left.type == VALUE_STRING && bin_right.type == VALUE_STRING) {
     switch (node->binary.op) {
       case TOKEN_EQ:
-        return strcmp(bin_left->string.val, bin_right->string.val) == 0 ? get_ast_true() : get_ast_false();
+        return value_bool(strcmp(bin_left.string, bin_right.string) == 0);
       case TOKEN_NE:
-        return strcmp(bin_left->string.val, bin_right->string.val) != 0 ? get_ast_true() : get_ast_false();
+        return value_bool(strcmp(bin_left.string, bin_right.string) != 0);
       default: {
         char msg[64];
         sprintf(msg, "%s operator cannot be applied to string", token_name(node->binary.op));
         return visitor_error(msg);
       }
     } 
-  } else if (bin_left->type == AST_BOOL && bin_right->type == AST_BOOL) {
+  } else if (bin_left.type == VALUE_BOOL && bin_right.type == VALUE_BOOL) {
     switch (node->binary.op) {
       case TOKEN_AND:
-        return bin_left->boolean.val && bin_right->boolean.val ? get_ast_true() : get_ast_false();
+        return value_bool(bin_left.boolean && bin_right.boolean);
       case TOKEN_OR:
-        return bin_left->boolean.val || bin_right->boolean.val ? get_ast_true() : get_ast_false();
+        return value_bool(bin_left.boolean || bin_right.boolean);
       case TOKEN_EQ:
-        return bin_left->boolean.val == bin_right->boolean.val ? get_ast_true() : get_ast_false();
+        return value_bool(bin_left.boolean == bin_right.boolean);
       case TOKEN_NE:
-        return bin_left->boolean.val != bin_right->boolean.val ? get_ast_true() : get_ast_false();
+        return value_bool(bin_left.boolean != bin_right.boolean);
       default: {
         char msg[64];
         sprintf(msg, "%s operator cannot be applied to bool", token_name(node->binary.op));
@@ -596,45 +639,39 @@ AST* visitor_visit_binary(Visitor* visitor, Scope* scope, AST* node)
     }
   } else {
     char msg[64];
-    sprintf(msg, "unexpected types in binary: left: %s, right: %s", ast_name(bin_left->type), ast_name(bin_right->type));
+    sprintf(msg, "unexpected types in binary: left: %s, right: %s", value_name(bin_left.type), value_name(bin_right.type));
     return visitor_error(msg);
   }
-
-  return ast;
 }
 
-AST* visitor_visit_unary(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_unary(Visitor* visitor, AST* node)
 {
-  AST* expr = visitor_visit(visitor, scope, node->unary.expr);
+  Value expr = visitor_visit(visitor, node->unary.expr);
   switch (node->unary.op) {
     case TOKEN_MINUS:
-      if (expr->type == AST_INT) {
-        AST* ast = init_ast(AST_INT);
-        ast->integer.val = -expr->integer.val;
-        return ast;
-      } else if (expr->type == AST_FLOAT) {
-        AST* ast = init_ast(AST_FLOAT);
-        ast->floating.val = -expr->floating.val;
-        return ast;
+      if (expr.type == VALUE_INT) {
+        return value_int(-expr.integer);
+      } else if (expr.type == VALUE_FLOAT) {
+        return value_float(-expr.floating);
       } else {
         char msg[128];
-        sprintf(msg, "'-' unary operator cannot be applied to %s", ast_name(expr->type));
+        sprintf(msg, "'-' unary operator cannot be applied to %s", value_name(expr.type));
         return visitor_error(msg);
       }
     case TOKEN_NOT:
-      if (expr->type == AST_BOOL) {
-        return expr->boolean.val ? get_ast_false() : get_ast_true();
+      if (expr.type == VALUE_BOOL) {
+        return value_bool(!expr.boolean);
       } else {
         char msg[128];
-        sprintf(msg, "'not' unary operator cannot be applied to %s", ast_name(expr->type));
+        sprintf(msg, "'not' unary operator cannot be applied to %s", value_name(expr.type));
         return visitor_error(msg);
       }
     default:
-      return get_ast_noop();
+      return value_noop();
   }
 }
 
-AST* visitor_visit_function(Visitor* visitor, Scope* scope, AST* f, AST* f_call)
+Value visitor_visit_function(Visitor* visitor, AST* f, AST* f_call)
 {
   if (f_call->function_call.arg_size != f->function_declaration.arg_size) {
     char msg[128];
@@ -644,20 +681,17 @@ AST* visitor_visit_function(Visitor* visitor, Scope* scope, AST* f, AST* f_call)
             f_call->function_call.arg_size);
     return visitor_error(msg);
   }
-  Scope* local_scope = init_scope();
+  // args are checked straight into the new frame so they stay visible to the collector
+  size_t base = visitor_reserve(visitor, f->function_declaration.frame_size);
   for (int i = 0; i < f->function_declaration.arg_size; i++) {
+    char* var_name = f->function_declaration.args[i]->variable.name;
     VariableType var_type = f->function_declaration.arg_types[i];
+    Value var_val = visitor_visit(visitor, f_call->function_call.args[i]);
     if (var_type == VAR_OBJECT) {
-      Var* var = scope_get_var(scope, f_call->function_call.args[i]->variable.name);
-      if (strcmp(f->function_declaration.args[i]->variable.object_type_name, var->object.declaration->object_declaration.name) == 0) {
-        Var* dup_var = calloc(1, sizeof(Var));
-        dup_var->name = f->function_declaration.args[i]->variable.name;
-        dup_var->val = var->val;
-        dup_var->type = var->type;
-        dup_var->is_defined = var->is_defined;
-        dup_var->object = var->object;
-
-        scope_add_var(local_scope, dup_var);
+      // objects are passed by reference
+      if (var_val.type == VALUE_OBJECT &&
+          f->function_declaration.args[i]->variable.object_type_name == var_val.object->declaration->object_declaration.name) {
+        visitor->stack[base + i] = (Var) { var_name, var_val, var_type };
         continue;
       } else {
         char msg[128];
@@ -665,117 +699,104 @@ AST* visitor_visit_function(Visitor* visitor, Scope* scope, AST* f, AST* f_call)
                 f->function_declaration.name,
                 i,
                 f->function_declaration.args[i]->variable.object_type_name,
-                var->object.declaration->object_declaration.name);
+                var_val.type == VALUE_OBJECT ? var_val.object->declaration->object_declaration.name : value_name(var_val.type));
         return visitor_error(msg);
       }
     }
-    AST* var_val = visitor_visit(visitor, scope, f_call->function_call.args[i]);
-    /*
-    if (!((var_val->type == AST_INT && var_type == VAR_INT)||
-        (var_val->type == AST_FLOAT && var_type == VAR_FLOAT)||
-        (var_val->type == AST_STRING && var_type == VAR_STRING)||
-        (var_val->type == AST_BOOL && var_type == VAR_BOOL))) {
-      char msg[128];
-      sprintf(msg, "'%s' function call arg error\n\targ %d: expected: %s, got: %s",
-              f->function_declaration.name, i, var_type_name(var_type), ast_name(var_val->type));
-      return visitor_error(msg);
-    }
-    */
-    Var* var = init_var(false, f->function_declaration.args[i]->variable.name, var_val, var_type, true);
-
-    visitor_check_types(true, var, TOKEN_ASSIGN, var_val);
-
-    scope_add_var(local_scope, var);
+    Value val = value_undefined();
+    visitor_check_types(var_name, var_type, &val, TOKEN_ASSIGN, var_val);
+    visitor->stack[base + i] = (Var) { var_name, val, var_type };
   }
-  scope = local_scope;
-
-  AST* compound = f->function_declaration.compound;
-
-  AST* return_val_unvisited = visitor_visit(visitor, scope, compound);
-  AST* return_val = visitor_visit(visitor, scope, return_val_unvisited);
-/*
-  if (!f->function_declaration.has_return && return_val->type != AST_TYPE_NOOP) {
-    char msg[128];
-    sprintf(msg, "'%s' function return error: expected: nothing, got: %s",
-            f->function_declaration.name, ast_name(return_val->type));
-    return visitor_error(msg);
-  } else */
 
-  // dont get return val for now
-//  return get_ast_noop();
+  Value return_val = visitor_call_body(visitor, f_call->function_call.function, base);
+  if (visitor->signal == SIGNAL_RETURN) {
+    visitor->signal = SIGNAL_NONE;
+  } else {
+    return_val = value_noop();
+  }
   
   if (!f->function_declaration.has_return) {
-    if (return_val->type != AST_TYPE_NOOP) {
+    if (return_val.type != VALUE_NOOP) {
       char msg[128];
       sprintf(msg, "'%s' function return error: expected no type, got: %s",
-              f->function_declaration.name, ast_name(return_val->type));
+              f->function_declaration.name, value_name(return_val.type));
       return visitor_error(msg);
     }
-    return get_ast_noop();
+    return value_noop();
   }
   
   VariableType return_type = f->function_declaration.return_type;
-  if (!((return_val->type == AST_INT && return_type == VAR_INT)||
-      (return_val->type == AST_FLOAT && return_type == VAR_FLOAT)||
-      (return_val->type == AST_STRING && return_type == VAR_STRING)||
-      (return_val->type == AST_BOOL && return_type == VAR_BOOL))) {
+  if (!((return_val.type == VALUE_INT && return_type == VAR_INT)||
+      (return_val.type == VALUE_FLOAT && return_type == VAR_FLOAT)||
+      (return_val.type == VALUE_STRING && return_type == VAR_STRING)||
+      (return_val.type == VALUE_BOOL && return_type == VAR_BOOL))) {
     char msg[128];
     sprintf(msg, "'%s' function return error: expected: %s, got: %s",
-            f->function_declaration.name, var_type_name(return_type), ast_name(return_val->type));
+            f->function_declaration.name, var_type_name(return_type), value_name(return_val.type));
     return visitor_error(msg);
   }
   return return_val;
 }
 
-AST* visitor_visit_function_call(Visitor* visitor, Scope* scope, AST* node)
+// runs the body of function in the frame at base and pops that frame,
+// hot functions run their closure once the tiered engine has built it
+Value visitor_call_body(Visitor* visitor, int function, size_t base)
 {
-  if (strcmp(node->function_call.name, "write") == 0) {
-    return builtin_write(visitor, scope, node->function_call.args, node->function_call.arg_size);
-  } else if (strcmp(node->function_call.name, "read") == 0) {
-    return builtin_read(visitor, scope, node->function_call.args, node->function_call.arg_size);
-  } else if (strcmp(node->function_call.name, "quit") == 0) {
-    return builtin_quit(visitor, scope, node->function_call.args, node->function_call.arg_size);
-  } else if (strcmp(node->function_call.name, "int") == 0) {
-    return builtin_int(visitor, scope, node->function_call.args, node->function_call.arg_size);
-  } else if (strcmp(node->function_call.name, "float") == 0) {
-    return builtin_float(visitor, scope, node->function_call.args, node->function_call.arg_size);
-  } else if (strcmp(node->function_call.name, "string") == 0) {
-    return builtin_string(visitor, scope, node->function_call.args, node->function_call.arg_size);
-  } else {
-    for (int i = 0; i < visitor->function_size; i++) {
-      AST* function = visitor->function_declarations[i];
-      if (strcmp(node->function_call.name, function->function_declaration.name) == 0) {
-        return visitor_visit_function(visitor, scope, function, node);
-      }
+  size_t prev_frame = visitor->frame;
+  int prev_function = visitor->function;
+  visitor->frame = base;
+  visitor->function = function;
+
+  Closure* body = visitor->tier ? tier_function(visitor->tier, function) : (void*)0;
+  Value val = body ? closure_enter(body) : visitor_visit(visitor, visitor->function_declarations[function]->function_declaration.compound);
+  visitor->stack_size = base;
+  visitor->frame = prev_frame;
+  visitor->function = prev_function;
+  return val;
+}
+
+Value visitor_visit_function_call(Visitor* visitor, AST* node)
+{
+  if (node->function_call.builtin >= 0) {
+    size_t arg_size = node->function_call.arg_size;
+    size_t base = visitor_reserve(visitor, arg_size);
+    for (int i = 0; i < arg_size; i++) {
+      Value arg = visitor_visit(visitor, node->function_call.args[i]);
+      visitor->stack[base + i].val = arg;
     }
+    Value args[arg_size ? arg_size : 1];
+    for (int i = 0; i < arg_size; i++) {
+      args[i] = visitor->stack[base + i].val;
+    }
+    Value ret = builtin_call(node->function_call.builtin, args, arg_size);
+    visitor->stack_size = base;
+    return ret;
   }
-  
-  char msg[64]; sprintf(msg, "call to undeclared function named: '%s'", node->function_call.name);
-  return visitor_error(msg);
+  AST* function = visitor->function_declarations[node->function_call.function];
+  return visitor_visit_function(visitor, function, node);
 }
 
-AST* visitor_visit_variable_declaration(Visitor* visitor, Scope* scope, AST* node)
+static void visitor_declare(Visitor* visitor, AST* node, int i, Value val)
 {
-  for (int i = 0; i < node->variable_declaration.size; i++) {
-    if (scope_is_var_declared(scope, node->variable_declaration.names[i])) {
-      char msg[64];
-      sprintf(msg, "variable '%s' has already been declared", node->variable_declaration.names[i]);
-      return visitor_error(msg);
-    }
+  char* name = node->variable_declaration.names[i];
+  VariableType type = node->variable_declaration.type;
+  if (node->variable_declaration.slot == RESOLVER_GLOBAL) {
+    scope_add_var(visitor->global_scope, init_var(name, val, type));
+    return;
+  }
+  visitor->stack[visitor->frame + node->variable_declaration.slot + i] = (Var) { name, val, type };
+}
 
+Value visitor_visit_variable_declaration(Visitor* visitor, AST* node)
+{
+  for (int i = 0; i < node->variable_declaration.size; i++) {
     if (node->variable_declaration.type == VAR_OBJECT) {
       bool is_object_type_declared = false;
       for (int j = 0; j < visitor->object_size; j++) {
         AST* obj_dec = visitor->object_declarations[j];
-        if (strcmp(node->variable_declaration.object_type, obj_dec->object_declaration.name) == 0) {
+        if (node->variable_declaration.object_type == obj_dec->object_declaration.name) {
           // declare variable here and return
-          Var* var = init_var(true,
-                              node->variable_declaration.names[i],
-                              obj_dec,
-                              node->variable_declaration.type,
-                              //node->variable_declaration.is_defined[i] // object are only defined in that way: Objecttype objectname
-                              true);
-          scope_add_var(scope, var);
+          visitor_declare(visitor, node, i, value_object(init_object(obj_dec)));
           is_object_type_declared = true;
           break;
         }
@@ -788,217 +809,281 @@ AST* visitor_visit_variable_declaration(Visitor* visitor, Scope* scope, AST* nod
       continue;
     }
     
-    AST* var_val = node->variable_declaration.is_defined[i] ? visitor_visit(visitor, scope, node->variable_declaration.values[i]) : (void*)0;
-
-    Var* var = init_var(false, node->variable_declaration.names[i], var_val, node->variable_declaration.type, node->variable_declaration.is_defined[i]);
-
+    Value val = value_undefined();
     if (node->variable_declaration.is_defined[i]) {
-      visitor_check_types(true, var, TOKEN_ASSIGN, var_val);
+      AST* value = node->variable_declaration.values[i];
+      Value var_val = visitor_visit(visitor, value);
+      if (visitor_is_exact(node->variable_declaration.type, TOKEN_ASSIGN, value)) {
+        val = var_val;
+      } else {
+        visitor_check_types(node->variable_declaration.names[i], node->variable_declaration.type, &val, TOKEN_ASSIGN, var_val);
+      }
     }
 
-    scope_add_var(scope, var);
+    visitor_declare(visitor, node, i, val);
   }
 
-  return get_ast_noop();
+  return value_noop();
 }
 
-
-AST* visitor_visit_variable(Visitor* visitor, Scope* scope, AST* node)
+static Var* visitor_get_var(Visitor* visitor, int depth, int slot, char* name)
 {
-  do {
-    Var* var = scope_get_var(scope, node->variable.name);
-    if (var) {
-      if (!var->is_defined) {
-        char msg[96];
-        sprintf(msg, "use of value of undefined variable: '%s'", node->variable.name);
-        return visitor_error(msg);
-      }
-      return var->val;
-    }
-    if (scope->is_global) break;
-    if (!scope->prev) {
-      scope = visitor->global_scope;
-    } else {
-      scope = scope->prev;
-    }
-  } while (scope);
-
-  char msg[64];
-  sprintf(msg, "use of undeclared variable: '%s'", node->variable.name);
-  return visitor_error(msg);
+  if (depth == RESOLVER_FRAME) {
+    return &visitor->stack[visitor->frame + slot];
+  }
+  Scope* scope = visitor->global_scope;
+  // a function may run before the global it uses has been declared
+  if (slot >= scope->var_size) {
+    char msg[64];
+    sprintf(msg, "use of undeclared variable: '%s'", name);
+    visitor_error(msg);
+  }
+  return scope->vars[slot];
 }
 
-AST* visitor_visit_variable_assign(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_variable(Visitor* visitor, AST* node)
 {
-  Var* var;
-  Scope* main_scope = scope;
-  do {
-    var = scope_get_var(scope, node->variable_assign.name);
-    if (var) {
-      goto assign;
-    }
-    if (scope->is_global) break;
-    if (!scope->prev) {
-      scope = visitor->global_scope;
-    } else {
-      scope = scope->prev;
-    }
-  } while (scope);
-  char msg[64];
-  sprintf(msg, "use of undeclared variable: '%s'", node->variable_assign.name);
-  return visitor_error(msg);
-
-  assign:
+  Var* var = visitor_get_var(visitor, node->variable.depth, node->variable.slot, node->variable.name);
+  if (var->val.type == VALUE_UNDEFINED) {
+    char msg[96];
+    sprintf(msg, "use of value of undefined variable: '%s'", node->variable.name);
+    return visitor_error(msg);
+  }
+  return var->val;
+}
 
+Value visitor_visit_variable_assign(Visitor* visitor, AST* node)
+{
   _TokenType op = node->variable_assign.op;
-  AST* var_val = visitor_visit(visitor, main_scope, node->variable_assign.assign_val);
-  visitor_check_types(false, var, op, var_val);
+  Value var_val = visitor_visit(visitor, node->variable_assign.assign_val);
+  // the value may have called a function and moved the stack
+  Var* var = visitor_get_var(visitor, node->variable_assign.depth, node->variable_assign.slot, node->variable_assign.name);
+  if (visitor_is_exact(var->type, op, node->variable_assign.assign_val)) {
+    var->val = var_val;
+    return var->val;
+  }
+  visitor_check_types(var->name, var->type, &var->val, op, var_val);
   
-  return visitor_visit(visitor, scope, var->val);
+  return var->val;
 }
 
-AST* visitor_visit_if(Visitor* visitor, Scope* scope, AST* node)
+static bool visitor_compare_int(_TokenType op, int left, int right)
 {
-  AST* cond = visitor_visit(visitor, scope, node->if_block.cond);
-  if (cond->type != AST_BOOL) {
-    char msg[64];
-    sprintf(msg, "if requires bool but got: '%s'", ast_name(cond->type));
-    return visitor_error(msg);
+  switch (op) {
+    case TOKEN_EQ: return left == right;
+    case TOKEN_NE: return left != right;
+    case TOKEN_GT: return left > right;
+    case TOKEN_GE: return left >= right;
+    case TOKEN_LT: return left < right;
+    default: return left <= right;
   }
-  if (cond->boolean.val == true) {
-    Scope* local_scope = init_scope();
-    if (!scope->is_global) {
-      local_scope->prev = scope;
+}
+
+static bool visitor_compare_float(_TokenType op, float left, float right)
+{
+  switch (op) {
+    case TOKEN_EQ: return left == right;
+    case TOKEN_NE: return left != right;
+    case TOKEN_GT: return left > right;
+    case TOKEN_GE: return left >= right;
+    case TOKEN_LT: return left < right;
+    default: return left <= right;
+  }
+}
+
+static bool visitor_is_compare(_TokenType op)
+{
+  return op == TOKEN_EQ || op == TOKEN_NE || op == TOKEN_GT ||
+         op == TOKEN_GE || op == TOKEN_LT || op == TOKEN_LE;
+}
+
+// evaluates a condition straight to a branch: comparisons of proven numbers
+// do not build a bool and and/or of proven bools stop once they know
+static bool visitor_test(Visitor* visitor, AST* cond, char* what)
+{
+  if (cond->type == AST_BINARY) {
+    _TokenType op = cond->binary.op;
+    if (visitor_is_compare(op)) {
+      switch (cond->binary.operands) {
+        case OPERANDS_INT: {
+          int left = visitor_visit(visitor, cond->binary.left).integer;
+          return visitor_compare_int(op, left, visitor_visit(visitor, cond->binary.right).integer);
+        }
+        case OPERANDS_FLOAT: {
+          float left = visitor_visit(visitor, cond->binary.left).floating;
+          return visitor_compare_float(op, left, visitor_visit(visitor, cond->binary.right).floating);
+        }
+        case OPERANDS_INT_FLOAT: {
+          float left = visitor_visit(visitor, cond->binary.left).integer;
+          return visitor_compare_float(op, left, visitor_visit(visitor, cond->binary.right).floating);
+        }
+        case OPERANDS_FLOAT_INT: {
+          float left = visitor_visit(visitor, cond->binary.left).floating;
+          return visitor_compare_float(op, left, visitor_visit(visitor, cond->binary.right).integer);
+        }
+        default:
+          break;
+      }
+    } else if ((op == TOKEN_AND || op == TOKEN_OR) &&
+               cond->binary.left->expr_type == TYPE_BOOL && cond->binary.right->expr_type == TYPE_BOOL) {
+      bool left = visitor_test(visitor, cond->binary.left, what);
+      if (op == TOKEN_AND ? !left : left) return left;
+      return visitor_test(visitor, cond->binary.right, what);
     }
-    scope = local_scope;
-    return visitor_visit(visitor, scope, node->if_block.compound);
+  }
+
+  Value val = visitor_visit(visitor, cond);
+  if (val.type != VALUE_BOOL) {
+    char msg[128];
+    sprintf(msg, "%s requires bool but got: '%s'", what, value_name(val.type));
+    visitor_error(msg);
+  }
+  return val.boolean;
+}
+
+Value visitor_visit_if(Visitor* visitor, AST* node)
+{
+  if (visitor_test(visitor, node->if_block.cond, "if")) {
+    return visitor_visit(visitor, node->if_block.compound);
   } else {
     if (node->if_block.got_else == true) {
-      return visitor_visit(visitor, scope, node->if_block.else_block);
+      return visitor_visit(visitor, node->if_block.else_block);
     }
   }
 
-  return get_ast_noop();
+  return value_noop();
 }
 
-AST* visitor_visit_else(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_else(Visitor* visitor, AST* node)
 {
-  Scope* local_scope = init_scope();
-  if (!scope->is_global) {
-    local_scope->prev = scope;
-  }
-  scope = local_scope;
-  return visitor_visit(visitor, scope, node->else_block.compound);
+  return visitor_visit(visitor, node->else_block.compound);
 }
 
-AST* visitor_visit_while(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_while(Visitor* visitor, AST* node)
 {
-  AST* cond = visitor_visit(visitor, scope, node->while_block.cond);
-  if (cond->type != AST_BOOL) {
-    char msg[128];
-    sprintf(msg, "while requires bool but got: '%s'", ast_name(cond->type));
-    return visitor_error(msg);
-  }
-  loop:
-  if (cond->boolean.val == true) {
-    Scope* local_scope = init_scope();
-    if (!scope->is_global) {
-      local_scope->prev = scope;
+  while (visitor_test(visitor, node->while_block.cond, "while")) {
+    Value visited = visitor_visit(visitor, node->while_block.compound);
+    switch (visitor->signal) {
+      case SIGNAL_RETURN:
+        return visited;
+      case SIGNAL_STOP:
+        visitor->signal = SIGNAL_NONE;
+        return value_noop();
+      case SIGNAL_SKIP:
+        visitor->signal = SIGNAL_NONE;
+        break;
+      default:
+        break;
+    }
+    Closure* compiled = visitor->tier ? tier_loop(visitor->tier, visitor->function, node) : (void*)0;
+    if (compiled) {
+      return closure_enter(compiled);
     }
-    AST* visited = visitor_visit(visitor, local_scope, node->while_block.compound);
-    switch (visited->type) {
-      case AST_RETURN_VAL:
+  }
+
+  return value_noop();
+}
+
+// the checker proved the bound cannot change, so it is read once and the
+// counter is stepped in its slot without visiting the condition or third
+static Value visitor_visit_counted_for(Visitor* visitor, AST* node)
+{
+  visitor_visit(visitor, node->for_block.first);
+  AST* counter = node->for_block.second->binary.left;
+  _TokenType op = node->for_block.second->binary.op;
+  int bound = visitor_visit(visitor, node->for_block.second->binary.right).integer;
+  int step = node->for_block.step;
+
+  // the slot is looked up again after the body, calls in it may move the stack
+  Var* var = visitor_get_var(visitor, counter->variable.depth, counter->variable.slot, counter->variable.name);
+  while (visitor_compare_int(op, var->val.integer, bound)) {
+    Value visited = visitor_visit(visitor, node->for_block.compound);
+    switch (visitor->signal) {
+      case SIGNAL_RETURN:
         return visited;
-      case AST_STOP:
-        return get_ast_noop();
+      case SIGNAL_STOP:
+        visitor->signal = SIGNAL_NONE;
+        return value_noop();
+      case SIGNAL_SKIP:
+        visitor->signal = SIGNAL_NONE;
+        break;
       default:
         break;
     }
-    cond = visitor_visit(visitor, scope, node->while_block.cond);
-    goto loop;
+    var = visitor_get_var(visitor, counter->variable.depth, counter->variable.slot, counter->variable.name);
+    var->val.integer += step;
+    // the closure reads the bound again, the checker proved it the same
+    Closure* compiled = visitor->tier ? tier_loop(visitor->tier, visitor->function, node) : (void*)0;
+    if (compiled) {
+      return closure_enter(compiled);
+    }
   }
-  
-  return get_ast_noop();
+
+  return value_noop();
 }
 
-AST* visitor_visit_for(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_for(Visitor* visitor, AST* node)
 {
-  Scope* for_scope = init_scope();
-  if (!scope->is_global) {
-    for_scope->prev = scope;
+  if (node->for_block.is_counted) {
+    return visitor_visit_counted_for(visitor, node);
   }
-  scope = for_scope;
 
   // visit first
   if (node->for_block.has_first) {
-    visitor_visit(visitor, scope, node->for_block.first);
+    visitor_visit(visitor, node->for_block.first);
   }
 
-  // visit second
-  AST* cond = node->for_block.has_second ? visitor_visit(visitor, scope, node->for_block.second) : get_ast_true();
-  if (cond->type != AST_BOOL) {
-    char msg[128];
-    sprintf(msg, "for condition body requires bool but got: '%s'", ast_name(cond->type));
-    return visitor_error(msg);
-  }
-
-  loop:
-  if (cond->boolean.val == true) {
-    Scope* local_scope = init_scope();
-    if (!scope->is_global) {
-      local_scope->prev = scope;
-    }
-    AST* visited = visitor_visit(visitor, local_scope, node->for_block.compound);
-    switch (visited->type) {
-      case AST_RETURN_VAL:
+  // visit second before every pass
+  while (!node->for_block.has_second || visitor_test(visitor, node->for_block.second, "for condition body")) {
+    Value visited = visitor_visit(visitor, node->for_block.compound);
+    switch (visitor->signal) {
+      case SIGNAL_RETURN:
         return visited;
-      case AST_STOP:
-        return get_ast_noop();
+      case SIGNAL_STOP:
+        visitor->signal = SIGNAL_NONE;
+        return value_noop();
+      case SIGNAL_SKIP:
+        visitor->signal = SIGNAL_NONE;
+        break;
       default:
         break;
     }
     // visit third after loop executed
     if (node->for_block.has_third) {
-      visitor_visit(visitor, scope, node->for_block.third);
+      visitor_visit(visitor, node->for_block.third);
+    }
+    Closure* compiled = visitor->tier ? tier_loop(visitor->tier, visitor->function, node) : (void*)0;
+    if (compiled) {
+      return closure_enter(compiled);
     }
-    // and then check second again
-    cond = node->for_block.has_second ? visitor_visit(visitor, scope, node->for_block.second) : get_ast_true();
-    goto loop;
   }
-  
-  return get_ast_noop();
-}
 
-AST* visitor_visit_return(Visitor* visitor, Scope* scope, AST* node)
-{
-  AST* ast = init_ast(AST_RETURN_VAL);
-  if (node->return_expr.is_empty_return) {
-    ast->return_val.val = get_ast_noop();
-    return ast;
-  }
-  ast->return_val.val = visitor_visit(visitor, scope, node->return_expr.expr);
-  return ast;
+  return value_noop();
 }
 
-AST* visitor_visit_return_val(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_return(Visitor* visitor, AST* node)
 {
-  return node->return_val.val;
+  Value val = node->return_expr.is_empty_return ? value_noop() : visitor_visit(visitor, node->return_expr.expr);
+  visitor->signal = SIGNAL_RETURN;
+  return val;
 }
 
-AST* visitor_visit_skip(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_skip(Visitor* visitor, AST* node)
 {
-  return node;
+  visitor->signal = SIGNAL_SKIP;
+  return value_noop();
 }
 
-AST* visitor_visit_stop(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_stop(Visitor* visitor, AST* node)
 {
-  return node;
+  visitor->signal = SIGNAL_STOP;
+  return value_noop();
 }
 
-AST* visitor_visit_include(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_include(Visitor* visitor, AST* node)
 {
   for (int i = 0; i < visitor->module_size; i++) {
-    if (strcmp(visitor->modules[i]->name, node->include.module_name) == 0) {
+    if (visitor->modules[i]->name == node->include.module_name) {
       char msg[96];
       sprintf(msg, "module '%s' has already been included", node->include.module_name);
       return visitor_error(msg);
@@ -1012,19 +1097,26 @@ AST* visitor_visit_include(Visitor* visitor, Scope* scope, AST* node)
     module->name = node->include.module_alias_name;
   }
 
-  return get_ast_noop();
+  return value_noop();
 }
 
-AST* visitor_visit_module_function_call(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_module_function_call(Visitor* visitor, AST* node)
 {
   for (int i = 0; i < visitor->module_size; i++) {
-    if (strcmp(visitor->modules[i]->name, node->module_function_call.module_name) == 0) {
+    if (visitor->modules[i]->name == node->module_function_call.module_name) {
       AST* f_call = node->module_function_call.func;
-      AST** args = calloc(f_call->function_call.arg_size, sizeof(AST*));
-      for (int i = 0; i < f_call->function_call.arg_size; i++) {
-        args[i] = visitor_visit(visitor, scope, f_call->function_call.args[i]);
+      size_t arg_size = f_call->function_call.arg_size;
+      size_t base = visitor_reserve(visitor, arg_size);
+      for (int j = 0; j < arg_size; j++) {
+        Value arg = visitor_visit(visitor, f_call->function_call.args[j]);
+        visitor->stack[base + j].val = arg;
       }
-      return module_function_call(visitor->modules[i], f_call->function_call.name, args, f_call->function_call.arg_size);
+      Value args[arg_size ? arg_size : 1];
+      for (int j = 0; j < arg_size; j++) {
+        args[j] = visitor->stack[base + j].val;
+      }
+      visitor->stack_size = base;
+      return module_call(visitor->modules[i], f_call->function_call.name, args, arg_size);
     }
   }
   char msg[128];
@@ -1032,98 +1124,64 @@ AST* visitor_visit_module_function_call(Visitor* visitor, Scope* scope, AST* nod
   return visitor_error(msg);
 }
 
-AST* visitor_visit_member_access(Visitor* visitor, Scope* scope, AST* node)
+static int visitor_field_index(AST* obj_dec, char* member_name)
 {
-  do {
-    Var* var = scope_get_var(scope, node->member_access.object_name);
-    if (var) {
-      if (var->type != VAR_OBJECT) {
-        char msg[96];
-        sprintf(msg, "variable is not an object: '%s'",
-                      node->member_access.object_name);
-        return visitor_error(msg);
-      }
-      for (int i = 0; i < var->object.size; i++) {
-        if (strcmp(node->member_access.member_name, var->object.vars[i]->name) == 0) {
-          return var->object.vars[i]->val;
-        }
-      }
-      char msg[96];
-      sprintf(msg, "member '%s' of object variable is not defined or does not have it: '%s'",
-                    node->member_access.member_name,
-                    node->member_access.object_name);
-      return visitor_error(msg);
+  for (int i = 0; i < obj_dec->object_declaration.field_size; i++) {
+    if (obj_dec->object_declaration.field_names[i] == member_name) {
+      return i;
     }
-    if (scope->is_global) break;
-    if (!scope->prev) {
-      scope = visitor->global_scope;
-    } else {
-      scope = scope->prev;
-    }
-  } while (scope);
-
-  char msg[128];
-  sprintf(msg, "use of undeclared object variable: '%s'", node->member_access.object_name);
-  return visitor_error(msg);
+  }
+  return -1;
 }
 
-AST* visitor_visit_member_assign(Visitor* visitor, Scope* scope, AST* node)
+Value visitor_visit_member_access(Visitor* visitor, AST* node)
 {
-  Var* var;
-  Scope* main_scope = scope;
-  do {
-    var = scope_get_var(scope, node->member_assign.member_access->member_access.object_name);
-    if (var) {
-      goto assign;
-    }
-    if (scope->is_global) break;
-    if (!scope->prev) {
-      scope = visitor->global_scope;
-    } else {
-      scope = scope->prev;
-    }
-  } while (scope);
-  char msg[64];
-  sprintf(msg, "use of undeclared object variable: '%s'", node->member_assign.member_access->member_access.object_name);
+  Var* var = visitor_get_var(visitor, node->member_access.depth, node->member_access.slot, node->member_access.object_name);
+  if (var->type != VAR_OBJECT) {
+    char msg[96];
+    sprintf(msg, "variable is not an object: '%s'",
+                  node->member_access.object_name);
+    return visitor_error(msg);
+  }
+  Object* object = var->val.object;
+  int field = visitor_field_index(object->declaration, node->member_access.member_name);
+  if (field >= 0 && object->fields[field].type != VALUE_UNDEFINED) {
+    return object->fields[field];
+  }
+  char msg[96];
+  sprintf(msg, "member '%s' of object variable is not defined or does not have it: '%s'",
+                node->member_access.member_name,
+                node->member_access.object_name);
   return visitor_error(msg);
+}
 
-  assign:
-  
-  Var* member_var;
-  bool is_member_declaration = true;
-  for (int i = 0; i < var->object.size; i++) {
-    if (strcmp(node->member_assign.member_access->member_access.member_name, var->object.vars[i]->name) == 0) {
-      member_var = var->object.vars[i];
-      is_member_declaration = false;
-      goto final;
-    }
-  }
-  for (int i = 0; i < var->object.declaration->object_declaration.field_size; i++) {
-    if (strcmp(var->object.declaration->object_declaration.field_names[i], node->member_assign.member_access->member_access.member_name) == 0) {
-      var->object.size++;
-      var->object.vars = realloc(var->object.vars, var->object.size * sizeof(Var*));
-      member_var = init_var(false,
-                            var->object.declaration->object_declaration.field_names[i],
-                            (void*)0,
-                            var->object.declaration->object_declaration.field_types[i],
-                            false);
-      var->object.vars[var->object.size - 1] = member_var;
-      goto final;
-    }
+Value visitor_visit_member_assign(Visitor* visitor, AST* node)
+{
+  AST* access = node->member_assign.member_access;
+  Var* var = visitor_get_var(visitor, access->member_access.depth, access->member_access.slot, access->member_access.object_name);
+  if (var->type != VAR_OBJECT) {
+    char msg[96];
+    sprintf(msg, "variable is not an object: '%s'", var->name);
+    return visitor_error(msg);
   }
-  {
+  Object* object = var->val.object;
+  AST* obj_dec = object->declaration;
+  int field = visitor_field_index(obj_dec, access->member_access.member_name);
+  if (field < 0) {
     char msg[128];
     sprintf(msg, "no such field '%s' in object type: '%s'",
-                  node->member_assign.member_access->member_access.member_name,
-                  var->object.declaration->object_declaration.name);
+                  access->member_access.member_name,
+                  obj_dec->object_declaration.name);
     return visitor_error(msg);
   }
 
-  final:
-
   _TokenType op = node->member_assign.op;
-  AST* var_val = visitor_visit(visitor, main_scope, node->member_assign.assign_val);
-  visitor_check_types(is_member_declaration, member_var, op, var_val);
+  Value var_val = visitor_visit(visitor, node->member_assign.assign_val);
+  visitor_check_types(obj_dec->object_declaration.field_names[field],
+                      obj_dec->object_declaration.field_types[field],
+                      &object->fields[field],
+                      op,
+                      var_val);
   
-  return visitor_visit(visitor, scope, member_var->val);
+  return object->fields[field];
 }
@@ -0,0 +1,728 @@
+#include "inc/vm.h"
+#include "inc/builtin.h"
+#include "inc/gc.h"
+#include "inc/jit.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__GNUC__)
+  #define VM_COMPUTED_GOTO
+#endif
+
+static void vm_mark_roots(void* ctx);
+
+VM* init_vm(Program* program)
+{
+  VM* vm = calloc(1, sizeof(VM));
+
+  vm->program = program;
+  vm->globals = calloc(program->global_size, sizeof(Value));
+  for (size_t i = 0; i < program->global_size; i++) {
+    vm->globals[i] = value_undeclared();
+  }
+  vm->stack_size = 1024;
+  vm->stack = calloc(vm->stack_size, sizeof(Value));
+  vm->frame_cap = 64;
+  vm->frames = calloc(vm->frame_cap, sizeof(Frame));
+  vm->frame_size = 0;
+  vm->modules = (void*)0;
+  vm->module_size = 0;
+  vm->jit = JIT_OFF;
+  vm->native_depth = 0;
+  vm->native_limit = jit_max_nesting();
+  gc_set_roots(vm_mark_roots, vm);
+
+  return vm;
+}
+
+static Value vm_error(char* msg)
+{
+  printf("VM-> Error: %s\n", msg);
+  exit(1);
+  return value_noop();
+}
+
+static void vm_ensure_stack(VM* vm, size_t size)
+{
+  if (size <= vm->stack_size) return;
+  size_t old_size = vm->stack_size;
+  while (vm->stack_size < size) {
+    vm->stack_size *= 2;
+  }
+  vm->stack = realloc(vm->stack, vm->stack_size * sizeof(Value));
+  memset(vm->stack + old_size, 0, (vm->stack_size - old_size) * sizeof(Value));
+}
+
+static Frame* vm_push_frame(VM* vm, Function* function, size_t base)
+{
+  if (vm->frame_size == vm->frame_cap) {
+    vm->frame_cap *= 2;
+    vm->frames = realloc(vm->frames, vm->frame_cap * sizeof(Frame));
+  }
+  vm_ensure_stack(vm, base + function->reg_size);
+  // registers past the args may still hold values the collector has freed
+  memset(vm->stack + base + function->arg_size, 0, (function->reg_size - function->arg_size) * sizeof(Value));
+  Frame* frame = &vm->frames[vm->frame_size++];
+  frame->function = function;
+  frame->ip = function->code;
+  frame->base = base;
+  return frame;
+}
+
+static void vm_mark_roots(void* ctx)
+{
+  VM* vm = ctx;
+  for (int i = 0; i < vm->program->global_size; i++) {
+    gc_mark_value(vm->globals[i]);
+  }
+  size_t top = 0;
+  for (int i = 0; i < vm->frame_size; i++) {
+    size_t end = vm->frames[i].base + vm->frames[i].function->reg_size;
+    if (end > top) top = end;
+  }
+  for (int i = 0; i < top; i++) {
+    gc_mark_value(vm->stack[i]);
+  }
+}
+
+static Value vm_binary(Opcode op, Value left, Value right)
+{
+  if (left.type == VALUE_INT && right.type == VALUE_INT) {
+    int l = left.integer, r = right.integer;
+    switch (op) {
+      case OP_ADD: return value_int(l + r);
+      case OP_SUB: return value_int(l - r);
+      case OP_MUL: return value_int(l * r);
+      case OP_DIV: return value_int(l / r);
+      case OP_MOD: return value_int(l % r);
+      case OP_EQ: return value_bool(l == r);
+      case OP_NE: return value_bool(l != r);
+      case OP_GT: return value_bool(l > r);
+      case OP_GE: return value_bool(l >= r);
+      case OP_LT: return value_bool(l < r);
+      case OP_LE: return value_bool(l <= r);
+      default: break;
+    }
+  } else if ((left.type == VALUE_INT || left.type == VALUE_FLOAT) &&
+             (right.type == VALUE_INT || right.type == VALUE_FLOAT)) {
+    float l = left.type == VALUE_FLOAT ? left.floating : (float)left.integer,
+          r = right.type == VALUE_FLOAT ? right.floating : (float)right.integer;
+    switch (op) {
+      case OP_ADD: return value_float(l + r);
+      case OP_SUB: return value_float(l - r);
+      case OP_MUL: return value_float(l * r);
+      case OP_DIV: return value_float(l / r);
+      case OP_MOD: return vm_error("'%' operator cannot be applied to floating values");
+      case OP_EQ: return value_bool(l == r);
+      case OP_NE: return value_bool(l != r);
+      case OP_GT: return value_bool(l > r);
+      case OP_GE: return value_bool(l >= r);
+      case OP_LT: return value_bool(l < r);
+      case OP_LE: return value_bool(l <= r);
+      default: break;
+    }
+  } else if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
+    switch (op) {
+      case OP_EQ: return value_bool(strcmp(left.string, right.string) == 0);
+      case OP_NE: return value_bool(strcmp(left.string, right.string) != 0);
+      default: {
+        char msg[64]; sprintf(msg, "%s operator cannot be applied to string", op_name(op));
+        return vm_error(msg);
+      }
+    }
+  } else if (left.type == VALUE_BOOL && right.type == VALUE_BOOL) {
+    switch (op) {
+      case OP_AND: return value_bool(left.boolean && right.boolean);
+      case OP_OR: return value_bool(left.boolean || right.boolean);
+      case OP_EQ: return value_bool(left.boolean == right.boolean);
+      case OP_NE: return value_bool(left.boolean != right.boolean);
+      default: {
+        char msg[64]; sprintf(msg, "%s operator cannot be applied to bool", op_name(op));
+        return vm_error(msg);
+      }
+    }
+  }
+
+  char msg[128];
+  sprintf(msg, "unexpected types in %s: left: %s, right: %s", op_name(op), value_name(left.type), value_name(right.type));
+  return vm_error(msg);
+}
+
+static Value vm_unary(Opcode op, Value val)
+{
+  if (op == OP_NEG) {
+    if (val.type == VALUE_INT) return value_int(-val.integer);
+    if (val.type == VALUE_FLOAT) return value_float(-val.floating);
+    char msg[128]; sprintf(msg, "'-' unary operator cannot be applied to %s", value_name(val.type));
+    return vm_error(msg);
+  }
+  if (val.type == VALUE_BOOL) return value_bool(!val.boolean);
+  char msg[128]; sprintf(msg, "'not' unary operator cannot be applied to %s", value_name(val.type));
+  return vm_error(msg);
+}
+
+static Value vm_type_error(char* name, char* type, Value val)
+{
+  char msg[128];
+  sprintf(msg, "variable '%s' type error: '%s', '%s'", name, type, value_name(val.type));
+  return vm_error(msg);
+}
+
+static Value vm_undefined(Value val, char* name)
+{
+  char msg[96];
+  if (value_is_undeclared(val)) {
+    // a function ran before the declaration of the global it uses
+    sprintf(msg, "use of undeclared variable: '%s'", name);
+  } else {
+    sprintf(msg, "use of value of undefined variable: '%s'", name);
+  }
+  return vm_error(msg);
+}
+
+static void vm_include(VM* vm, AST* node)
+{
+  for (int i = 0; i < vm->module_size; i++) {
+    if (vm->modules[i]->name == node->include.module_name) {
+      char msg[96]; sprintf(msg, "module '%s' has already been included", node->include.module_name);
+      vm_error(msg);
+    }
+  }
+  vm->module_size++;
+  vm->modules = realloc(vm->modules, vm->module_size * sizeof(Module*));
+  Module* module = init_module(node->include.module_name);
+  vm->modules[vm->module_size - 1] = module;
+  if (node->include.is_alias) {
+    module->name = node->include.module_alias_name;
+  }
+}
+
+static Value vm_module_call(VM* vm, AST* node, Value* args, size_t arg_size)
+{
+  for (int i = 0; i < vm->module_size; i++) {
+    if (vm->modules[i]->name == node->module_function_call.module_name) {
+      return module_call(vm->modules[i], node->module_function_call.func->function_call.name, args, arg_size);
+    }
+  }
+  char msg[128]; sprintf(msg, "undeclared module: '%s'", node->module_function_call.module_name);
+  return vm_error(msg);
+}
+
+static void vm_check_return(Function* function, Value val)
+{
+  if (!function->has_return) {
+    if (val.type != VALUE_NOOP) {
+      char msg[128];
+      sprintf(msg, "'%s' function return error: expected no type, got: %s", function->name, value_name(val.type));
+      vm_error(msg);
+    }
+    return;
+  }
+  VariableType return_type = function->return_type;
+  if (!((val.type == VALUE_INT && return_type == VAR_INT)||
+      (val.type == VALUE_FLOAT && return_type == VAR_FLOAT)||
+      (val.type == VALUE_STRING && return_type == VAR_STRING)||
+      (val.type == VALUE_BOOL && return_type == VAR_BOOL))) {
+    char msg[128];
+    sprintf(msg, "'%s' function return error: expected: %s, got: %s",
+            function->name, var_type_name(return_type), value_name(val.type));
+    vm_error(msg);
+  }
+}
+
+#ifdef VM_COMPUTED_GOTO
+  #define VM_CASE(op) do_##op:
+  #define VM_NEXT() goto *dispatch[ip->op]
+  #define VM_SWITCH VM_NEXT();
+  #define VM_END
+#else
+  #define VM_CASE(op) case op:
+  #define VM_NEXT() goto dispatch
+  #define VM_SWITCH dispatch: switch (ip->op) {
+  #define VM_END }
+#endif
+
+#define VM_LOAD_FRAME() do { \
+    frame = &vm->frames[vm->frame_size - 1]; \
+    ip = frame->ip; \
+    R = vm->stack + frame->base; \
+    K = frame->function->consts; \
+  } while (0)
+
+#define VM_BINARY(opcode, OPER, make) VM_CASE(opcode) { \
+    Value l = R[ip->b], r = R[ip->c]; \
+    if (l.type == VALUE_INT && r.type == VALUE_INT) { \
+      R[ip->a] = make(l.integer OPER r.integer); \
+    } else { \
+      R[ip->a] = vm_binary(opcode, l, r); \
+    } \
+    ip++; \
+    VM_NEXT(); \
+  }
+
+// operands were proven by the checker, so the tags are not looked at
+#define VM_TYPED(opcode, OPER, field, make) VM_CASE(opcode) { \
+    R[ip->a] = make(R[ip->b].field OPER R[ip->c].field); \
+    ip++; \
+    VM_NEXT(); \
+  }
+
+// compare-and-branch on operands proven by the checker, falls through when it holds
+#define VM_BRANCH(opcode, OPER, field) VM_CASE(opcode) { \
+    ip = R[ip->a].field OPER R[ip->b].field ? ip + 1 : frame->function->code + ip->c; \
+    VM_NEXT(); \
+  }
+
+// compiles function once it has been called often enough, true if it runs natively
+static bool vm_jit_call(VM* vm, Function* function)
+{
+  if (vm->native_depth >= vm->native_limit) return false;
+  if (function->jit_code) return true;
+  if (function->jit_failed) return false;
+  if (vm->jit == JIT_ALWAYS || ++function->calls >= JIT_CALL_THRESHOLD) {
+    return jit_compile(function);
+  }
+  return false;
+}
+
+// a loop of the top frame jumps back to at, once it is hot the rest of
+// the frame runs natively from there; true when it has returned
+static bool vm_jit_backedge(VM* vm, Instr* at)
+{
+  Function* function = vm->frames[vm->frame_size - 1].function;
+  if (vm->native_depth >= vm->native_limit) return false;
+  if (!function->jit_code) {
+    if (function->jit_failed || ++function->loops < JIT_LOOP_THRESHOLD) return false;
+    if (!jit_compile(function)) return false;
+  }
+  jit_enter(vm, at);
+  return true;
+}
+
+// jumps back to target, or leaves the loop to native code that finishes the frame
+#define VM_BACKEDGE(target) do { \
+    Instr* to = (target); \
+    if (vm->jit != JIT_OFF && vm_jit_backedge(vm, to)) { \
+      if (vm->frame_size == depth) return; \
+      VM_LOAD_FRAME(); \
+    } else { \
+      ip = to; \
+    } \
+    VM_NEXT(); \
+  } while (0)
+
+// the counter is an int local and the bound was proven not to change
+#define VM_FORLOOP(opcode, OPER) VM_CASE(opcode) { \
+    int i = R[ip->a].integer += R[ip->b + 1].integer; \
+    if (!(i OPER R[ip->b].integer)) { \
+      ip++; \
+      VM_NEXT(); \
+    } \
+    VM_BACKEDGE(frame->function->code + ip->c); \
+  }
+
+// runs frames until the one below depth is on top again
+static void vm_loop(VM* vm, size_t depth)
+{
+#ifdef VM_COMPUTED_GOTO
+  static void* dispatch[] = {
+    [OP_LOADK] = &&do_OP_LOADK,
+    [OP_UNDEF] = &&do_OP_UNDEF,
+    [OP_MOVE] = &&do_OP_MOVE,
+    [OP_TESTDEF] = &&do_OP_TESTDEF,
+    [OP_GETGLOBAL] = &&do_OP_GETGLOBAL,
+    [OP_SETGLOBAL] = &&do_OP_SETGLOBAL,
+    [OP_CONV_INT] = &&do_OP_CONV_INT,
+    [OP_CONV_FLOAT] = &&do_OP_CONV_FLOAT,
+    [OP_CHECK_STRING] = &&do_OP_CHECK_STRING,
+    [OP_CHECK_BOOL] = &&do_OP_CHECK_BOOL,
+    [OP_CHECK_OBJECT] = &&do_OP_CHECK_OBJECT,
+    [OP_ADD] = &&do_OP_ADD,
+    [OP_SUB] = &&do_OP_SUB,
+    [OP_MUL] = &&do_OP_MUL,
+    [OP_DIV] = &&do_OP_DIV,
+    [OP_MOD] = &&do_OP_MOD,
+    [OP_EQ] = &&do_OP_EQ,
+    [OP_NE] = &&do_OP_NE,
+    [OP_GT] = &&do_OP_GT,
+    [OP_GE] = &&do_OP_GE,
+    [OP_LT] = &&do_OP_LT,
+    [OP_LE] = &&do_OP_LE,
+    [OP_AND] = &&do_OP_AND,
+    [OP_OR] = &&do_OP_OR,
+    [OP_ADDI] = &&do_OP_ADDI,
+    [OP_SUBI] = &&do_OP_SUBI,
+    [OP_MULI] = &&do_OP_MULI,
+    [OP_DIVI] = &&do_OP_DIVI,
+    [OP_MODI] = &&do_OP_MODI,
+    [OP_EQI] = &&do_OP_EQI,
+    [OP_NEI] = &&do_OP_NEI,
+    [OP_GTI] = &&do_OP_GTI,
+    [OP_GEI] = &&do_OP_GEI,
+    [OP_LTI] = &&do_OP_LTI,
+    [OP_LEI] = &&do_OP_LEI,
+    [OP_ADDF] = &&do_OP_ADDF,
+    [OP_SUBF] = &&do_OP_SUBF,
+    [OP_MULF] = &&do_OP_MULF,
+    [OP_DIVF] = &&do_OP_DIVF,
+    [OP_EQF] = &&do_OP_EQF,
+    [OP_NEF] = &&do_OP_NEF,
+    [OP_GTF] = &&do_OP_GTF,
+    [OP_GEF] = &&do_OP_GEF,
+    [OP_LTF] = &&do_OP_LTF,
+    [OP_LEF] = &&do_OP_LEF,
+    [OP_SHLI] = &&do_OP_SHLI,
+    [OP_SHRI] = &&do_OP_SHRI,
+    [OP_ANDI] = &&do_OP_ANDI,
+    [OP_NEG] = &&do_OP_NEG,
+    [OP_NOT] = &&do_OP_NOT,
+    [OP_JMP] = &&do_OP_JMP,
+    [OP_JMPF] = &&do_OP_JMPF,
+    [OP_ANDJMP] = &&do_OP_ANDJMP,
+    [OP_ORJMP] = &&do_OP_ORJMP,
+    [OP_IFEQI] = &&do_OP_IFEQI,
+    [OP_IFNEI] = &&do_OP_IFNEI,
+    [OP_IFGTI] = &&do_OP_IFGTI,
+    [OP_IFGEI] = &&do_OP_IFGEI,
+    [OP_IFLTI] = &&do_OP_IFLTI,
+    [OP_IFLEI] = &&do_OP_IFLEI,
+    [OP_IFEQF] = &&do_OP_IFEQF,
+    [OP_IFNEF] = &&do_OP_IFNEF,
+    [OP_IFGTF] = &&do_OP_IFGTF,
+    [OP_IFGEF] = &&do_OP_IFGEF,
+    [OP_IFLTF] = &&do_OP_IFLTF,
+    [OP_IFLEF] = &&do_OP_IFLEF,
+    [OP_FORLT] = &&do_OP_FORLT,
+    [OP_FORLE] = &&do_OP_FORLE,
+    [OP_FORGT] = &&do_OP_FORGT,
+    [OP_FORGE] = &&do_OP_FORGE,
+    [OP_CALL] = &&do_OP_CALL,
+    [OP_BUILTIN] = &&do_OP_BUILTIN,
+    [OP_MODCALL] = &&do_OP_MODCALL,
+    [OP_INCLUDE] = &&do_OP_INCLUDE,
+    [OP_NEWOBJ] = &&do_OP_NEWOBJ,
+    [OP_GETFIELD] = &&do_OP_GETFIELD,
+    [OP_SETFIELD] = &&do_OP_SETFIELD,
+    [OP_RETURN] = &&do_OP_RETURN,
+    [OP_RETURN0] = &&do_OP_RETURN0,
+    [OP_HALT] = &&do_OP_HALT,
+    [OP_YIELD] = &&do_OP_YIELD,
+  };
+#endif
+  Program* program = vm->program;
+  Frame* frame;
+  Instr* ip;
+  Value* R;
+  Value* K;
+
+  VM_LOAD_FRAME();
+
+  VM_SWITCH
+
+  VM_CASE(OP_LOADK) {
+    R[ip->a] = K[ip->b];
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_UNDEF) {
+    R[ip->a] = value_undefined();
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_MOVE) {
+    R[ip->a] = R[ip->b];
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_TESTDEF) {
+    if (R[ip->a].type == VALUE_UNDEFINED) {
+      vm_undefined(R[ip->a], K[ip->b].string);
+    }
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_GETGLOBAL) {
+    Value val = vm->globals[ip->b];
+    if (val.type == VALUE_UNDEFINED) {
+      vm_undefined(val, K[ip->c].string);
+    }
+    R[ip->a] = val;
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_SETGLOBAL) {
+    if (ip->c >= 0 && value_is_undeclared(vm->globals[ip->b])) {
+      vm_undefined(vm->globals[ip->b], K[ip->c].string);
+    }
+    vm->globals[ip->b] = R[ip->a];
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_CONV_INT) {
+    Value val = R[ip->b];
+    if (val.type == VALUE_INT) {
+      R[ip->a] = val;
+    } else if (val.type == VALUE_FLOAT) {
+      R[ip->a] = value_int((int)val.floating);
+    } else {
+      vm_type_error(K[ip->c].string, "VAR_INT", val);
+    }
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_CONV_FLOAT) {
+    Value val = R[ip->b];
+    if (val.type == VALUE_FLOAT) {
+      R[ip->a] = val;
+    } else if (val.type == VALUE_INT) {
+      R[ip->a] = value_float((float)val.integer);
+    } else {
+      vm_type_error(K[ip->c].string, "VAR_FLOAT", val);
+    }
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_CHECK_STRING) {
+    Value val = R[ip->b];
+    if (val.type != VALUE_STRING) {
+      vm_type_error(K[ip->c].string, "VAR_STRING", val);
+    }
+    R[ip->a] = val;
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_CHECK_BOOL) {
+    Value val = R[ip->b];
+    if (val.type != VALUE_BOOL) {
+      vm_type_error(K[ip->c].string, "VAR_BOOL", val);
+    }
+    R[ip->a] = val;
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_CHECK_OBJECT) {
+    Value val = R[ip->b];
+    AST* expected = program->object_declarations[ip->c];
+    if (val.type != VALUE_OBJECT || val.object->declaration != expected) {
+      char msg[128];
+      sprintf(msg, "expected object type: %s, got %s",
+              expected->object_declaration.name,
+              val.type == VALUE_OBJECT ? val.object->declaration->object_declaration.name : value_name(val.type));
+      vm_error(msg);
+    }
+    R[ip->a] = val;
+    ip++;
+    VM_NEXT();
+  }
+  VM_BINARY(OP_ADD, +, value_int)
+  VM_BINARY(OP_SUB, -, value_int)
+  VM_BINARY(OP_MUL, *, value_int)
+  VM_BINARY(OP_DIV, /, value_int)
+  VM_BINARY(OP_MOD, %, value_int)
+  VM_BINARY(OP_EQ, ==, value_bool)
+  VM_BINARY(OP_NE, !=, value_bool)
+  VM_BINARY(OP_GT, >, value_bool)
+  VM_BINARY(OP_GE, >=, value_bool)
+  VM_BINARY(OP_LT, <, value_bool)
+  VM_BINARY(OP_LE, <=, value_bool)
+  VM_TYPED(OP_ADDI, +, integer, value_int)
+  VM_TYPED(OP_SUBI, -, integer, value_int)
+  VM_TYPED(OP_MULI, *, integer, value_int)
+  VM_TYPED(OP_DIVI, /, integer, value_int)
+  VM_TYPED(OP_MODI, %, integer, value_int)
+  VM_TYPED(OP_EQI, ==, integer, value_bool)
+  VM_TYPED(OP_NEI, !=, integer, value_bool)
+  VM_TYPED(OP_GTI, >, integer, value_bool)
+  VM_TYPED(OP_GEI, >=, integer, value_bool)
+  VM_TYPED(OP_LTI, <, integer, value_bool)
+  VM_TYPED(OP_LEI, <=, integer, value_bool)
+  VM_TYPED(OP_ADDF, +, floating, value_float)
+  VM_TYPED(OP_SUBF, -, floating, value_float)
+  VM_TYPED(OP_MULF, *, floating, value_float)
+  VM_TYPED(OP_DIVF, /, floating, value_float)
+  VM_TYPED(OP_EQF, ==, floating, value_bool)
+  VM_TYPED(OP_NEF, !=, floating, value_bool)
+  VM_TYPED(OP_GTF, >, floating, value_bool)
+  VM_TYPED(OP_GEF, >=, floating, value_bool)
+  VM_TYPED(OP_LTF, <, floating, value_bool)
+  VM_TYPED(OP_LEF, <=, floating, value_bool)
+  VM_CASE(OP_SHLI) {
+    // wraps like the multiplication it replaces
+    R[ip->a] = value_int((int)((unsigned)R[ip->b].integer << ip->c));
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_SHRI) {
+    R[ip->a] = value_int(R[ip->b].integer >> ip->c);
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_ANDI) {
+    R[ip->a] = value_int(R[ip->b].integer & ip->c);
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_AND) {
+    R[ip->a] = vm_binary(OP_AND, R[ip->b], R[ip->c]);
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_OR) {
+    R[ip->a] = vm_binary(OP_OR, R[ip->b], R[ip->c]);
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_NEG) {
+    R[ip->a] = vm_unary(OP_NEG, R[ip->b]);
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_NOT) {
+    R[ip->a] = vm_unary(OP_NOT, R[ip->b]);
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_JMP) {
+    Instr* target = frame->function->code + ip->a;
+    if (target > ip) {
+      ip = target;
+      VM_NEXT();
+    }
+    VM_BACKEDGE(target);
+  }
+  VM_CASE(OP_JMPF) {
+    Value cond = R[ip->a];
+    if (cond.type != VALUE_BOOL) {
+      char msg[128];
+      switch ((CondKind)ip->c) {
+        case COND_IF: sprintf(msg, "if requires bool but got: '%s'", value_name(cond.type)); break;
+        case COND_WHILE: sprintf(msg, "while requires bool but got: '%s'", value_name(cond.type)); break;
+        case COND_FOR: sprintf(msg, "for condition body requires bool but got: '%s'", value_name(cond.type)); break;
+      }
+      vm_error(msg);
+    }
+    ip = cond.boolean ? ip + 1 : frame->function->code + ip->b;
+    VM_NEXT();
+  }
+  VM_CASE(OP_ANDJMP) {
+    Value left = R[ip->a];
+    ip = left.type == VALUE_BOOL && !left.boolean ? frame->function->code + ip->b : ip + 1;
+    VM_NEXT();
+  }
+  VM_CASE(OP_ORJMP) {
+    Value left = R[ip->a];
+    ip = left.type == VALUE_BOOL && left.boolean ? frame->function->code + ip->b : ip + 1;
+    VM_NEXT();
+  }
+  VM_BRANCH(OP_IFEQI, ==, integer)
+  VM_BRANCH(OP_IFNEI, !=, integer)
+  VM_BRANCH(OP_IFGTI, >, integer)
+  VM_BRANCH(OP_IFGEI, >=, integer)
+  VM_BRANCH(OP_IFLTI, <, integer)
+  VM_BRANCH(OP_IFLEI, <=, integer)
+  VM_BRANCH(OP_IFEQF, ==, floating)
+  VM_BRANCH(OP_IFNEF, !=, floating)
+  VM_BRANCH(OP_IFGTF, >, floating)
+  VM_BRANCH(OP_IFGEF, >=, floating)
+  VM_BRANCH(OP_IFLTF, <, floating)
+  VM_BRANCH(OP_IFLEF, <=, floating)
+  VM_FORLOOP(OP_FORLT, <)
+  VM_FORLOOP(OP_FORLE, <=)
+  VM_FORLOOP(OP_FORGT, >)
+  VM_FORLOOP(OP_FORGE, >=)
+  VM_CASE(OP_CALL) {
+    Function* function = program->functions[ip->b];
+    frame->ip = ip + 1;
+    vm_push_frame(vm, function, frame->base + ip->a);
+    // native code runs the whole call and pops its frame again
+    if (vm->jit != JIT_OFF && vm_jit_call(vm, function)) {
+      jit_enter(vm, function->code);
+    }
+    VM_LOAD_FRAME();
+    VM_NEXT();
+  }
+  VM_CASE(OP_BUILTIN) {
+    R[ip->a] = builtin_call(ip->b, R + ip->a, ip->c);
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_MODCALL) {
+    R[ip->a] = vm_module_call(vm, program->module_calls[ip->b], R + ip->a, ip->c);
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_INCLUDE) {
+    vm_include(vm, program->includes[ip->a]);
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_NEWOBJ) {
+    R[ip->a] = value_object(init_object(program->object_declarations[ip->b]));
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_GETFIELD) {
+    Object* object = R[ip->b].object;
+    int field = FIELD_INDEX(ip->c);
+    Value val = object->fields[field];
+    if (val.type == VALUE_UNDEFINED) {
+      char msg[128];
+      sprintf(msg, "member '%s' of object variable is not defined or does not have it: '%s'",
+              object->declaration->object_declaration.field_names[field], K[FIELD_NAME(ip->c)].string);
+      vm_error(msg);
+    }
+    R[ip->a] = val;
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_SETFIELD) {
+    R[ip->a].object->fields[ip->b] = R[ip->c];
+    ip++;
+    VM_NEXT();
+  }
+  VM_CASE(OP_RETURN) {
+    Value val = R[ip->a];
+    vm_check_return(frame->function, val);
+    vm->stack[frame->base] = val;
+    vm->frame_size--;
+    if (vm->frame_size == depth) return;
+    VM_LOAD_FRAME();
+    VM_NEXT();
+  }
+  VM_CASE(OP_RETURN0) {
+    vm_check_return(frame->function, value_noop());
+    vm->stack[frame->base] = value_noop();
+    vm->frame_size--;
+    if (vm->frame_size == depth) return;
+    VM_LOAD_FRAME();
+    VM_NEXT();
+  }
+  VM_CASE(OP_HALT) {
+    vm->frame_size--;
+    return;
+  }
+  VM_CASE(OP_YIELD) {
+    return;
+  }
+
+  VM_END
+}
+
+void vm_run(VM* vm)
+{
+  Function* main = vm->program->main;
+  vm_push_frame(vm, main, 0);
+  if (vm->jit == JIT_ALWAYS && jit_compile(main)) {
+    jit_enter(vm, main->code);
+    return;
+  }
+  vm_loop(vm, 0);
+}
+
+void vm_step(VM* vm, Instr* ip)
+{
+  // the interpreter stops at the yield, or once a return pops the frame
+  Instr code[2] = { *ip, { OP_YIELD, 0, 0, 0 } };
+  vm->frames[vm->frame_size - 1].ip = code;
+  vm_loop(vm, vm->frame_size - 1);
+}
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# runs every script in tests/ on each engine and compares what it writes
+# against the unoptimized vm, after ./build.sh from the repo root
+
+LANG_BIN="./lang"
+TEST_DIR="tests"
+ENGINES=("" "--jit=always" "--engine=visitor" "--engine=closure" "--engine=tiered")
+
+if [[ ! -x $LANG_BIN ]]; then
+  echo "Error: $LANG_BIN not found, run ./build.sh first"
+  exit 1
+fi
+
+failed=0
+for file in $TEST_DIR/*.lang; do
+  expected=$($LANG_BIN --no-opt $file 2>&1)
+  for engine in "${ENGINES[@]}"; do
+    actual=$($LANG_BIN $engine $file 2>&1)
+    if [[ "$actual" != "$expected" ]]; then
+      echo "FAIL $file ${engine:-vm}"
+      diff <(echo "$expected") <(echo "$actual") | head -10
+      failed=1
+    fi
+  done
+done
+
+if [[ $failed == 0 ]]; then
+  echo "all tests passed"
+fi
+exit $failed